@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +43,7 @@ extern "C" {
  * locally generated one. */
 
 struct sg_pt_base;
+struct sg_mdev_st;      /* defined in sg_lib.h */
 
 
 /* Invokes a SCSI INQUIRY command and yields the response
@@ -248,6 +250,15 @@ int sg_ll_test_unit_ready_progress(int sg_fd, int pack_id, int * progress,
 int sg_ll_test_unit_ready_progress_pt(struct sg_pt_base * ptp, int pack_id,
                                      int * progress, bool noisy, int verbose);
 
+/* Polls one DEVICE (see struct sg_mdev_st in sg_lib.h) for progress with
+ * TEST UNIT READY, falling back to REQUEST SENSE if TUR yields no progress
+ * indication while not ready. Sets mdp->next_tm so the interval shrinks
+ * as the DEVICE nears completion, between SG_MDEV_MIN_POLL_SECS and
+ * max_poll_secs. Returns true if this DEVICE has finished (successfully
+ * or not) in which case mdp->res holds 0 or the error. */
+bool sg_mdev_poll(struct sg_mdev_st * mdp, time_t now, int max_poll_secs,
+                  int verbose);
+
 
 struct sg_simple_inquiry_resp {
     uint8_t peripheral_qualifier;
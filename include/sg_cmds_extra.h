@@ -29,7 +29,8 @@ extern "C" {
  * argument. That object is assumed to be constructed and have a device file
  * descriptor * associated with it. Caller is responsible for lifetime of
  * ptp.
- *    ^^^ apart from sg_ll_ata_pt() as 'pass-through' is part of its name. */
+ *    ^^^ apart from sg_ll_ata_pt() as 'pass-through' is part of its name;
+ *        its "_pt" variant is sg_ll_ata_pt_pt(). */
 
 struct sg_pt_base;
 
@@ -58,6 +59,17 @@ int sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
                  uint8_t * sensep, int max_sense_len, uint8_t * ata_return_dp,
                  int max_ata_return_len, int * residp, int verbose);
 
+/* Similar to sg_ll_ata_pt() but uses the pass-through object ptp, which
+ * must already be associated with a device file descriptor, rather than
+ * constructing and destroying one for each call. ptp is cleared (but keeps
+ * its file descriptor) before the command is built so it may be reused
+ * for a long sequence of ATA PASS-THROUGH commands. */
+int sg_ll_ata_pt_pt(struct sg_pt_base * ptp, const uint8_t * cdbp,
+                    int cdb_len, int timeout_secs, void * dinp, void * doutp,
+                    int dlen, uint8_t * sensep, int max_sense_len,
+                    uint8_t * ata_return_dp, int max_ata_return_len,
+                    int * residp, int verbose);
+
 /* Invokes a FORMAT UNIT (SBC-3) command. Return of 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> Format unit not supported,
  * SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb, SG_LIB_CAT_UNIT_ATTENTION,
@@ -92,6 +104,48 @@ int sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
                            void * resp, int alloc_len, bool noisy,
                            int verbose);
 
+/* Invokes a SCSI STREAM CONTROL command (SBC-4). str_ctl is 1 to open a
+ * stream (the assigned stream id is then in bytes 4 and 5 of resp) or 2
+ * to close stream str_id. If residp is non-NULL then the residual count
+ * is written there. Returns 0 -> success,
+ * SG_LIB_CAT_INVALID_OP -> STREAM CONTROL not supported,
+ * SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb (e.g. no streams free),
+ * SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_ABORTED_COMMAND, -1 -> other
+ * failure */
+int sg_ll_stream_control(int sg_fd, int str_ctl, uint16_t str_id,
+                         void * resp, int alloc_len, int * residp,
+                         bool noisy, int verbose);
+
+/* Invokes a SCSI REPORT ZONES command (ZBC) starting at zone start LBA
+ * zs_lba. report_opts is the 6 bit REPORTING OPTIONS field and partial
+ * sets the PARTIAL bit. If residp is non-NULL then the residual count is
+ * written there. Returns 0 -> success, SG_LIB_CAT_INVALID_OP -> REPORT
+ * ZONES not supported, SG_LIB_CAT_ILLEGAL_REQ -> bad field in cdb,
+ * SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_ABORTED_COMMAND, -1 -> other
+ * failure */
+int sg_ll_report_zones(int sg_fd, uint64_t zs_lba, bool partial,
+                       int report_opts, void * resp, int mx_resp_len,
+                       int * residp, bool noisy, int verbose);
+
+/* Invokes one of the ZONING IN commands (ZBC-2) selected by service action
+ * 'sa': 0 for REPORT ZONES, 6 for REPORT REALMS and 7 for REPORT ZONE
+ * DOMAINS. 'locator' is the LBA (or realm locator) that the report starts
+ * from. Other arguments and return values as for sg_ll_report_zones(). */
+int sg_ll_zoning_in(int sg_fd, int sa, uint64_t locator, bool partial,
+                    int report_opts, void * resp, int mx_resp_len,
+                    int * residp, bool noisy, int verbose);
+
+/* Invokes one of the SCSI ZONE OUT commands (ZBC) selected by service
+ * action 'sa' (e.g. 1 for CLOSE ZONE, 2 for FINISH ZONE, 3 for OPEN ZONE,
+ * 4 for RESET WRITE POINTER) on the zone starting at LBA zid. zc is the
+ * zone count (ZBC-2, 0 and 1 both mean one zone) and 'all' sets the ALL
+ * bit. The REMOVE ELEMENT AND MODIFY ZONES service action (0x1a) is sent
+ * as a SERVICE ACTION IN(16) command with the element identifier in zid.
+ * timeout_secs of 0 or less selects the default. Returns 0 -> success,
+ * various SG_LIB_CAT_* positive values or -1 -> other errors */
+int sg_ll_zone_out(int sg_fd, int sa, uint64_t zid, uint16_t zc, bool all,
+                   int timeout_secs, bool noisy, int verbose);
+
 /* Invokes a SCSI PERSISTENT RESERVE IN command (SPC). Returns 0
  * when successful, SG_LIB_CAT_INVALID_OP if command not supported,
  * SG_LIB_CAT_ILLEGAL_REQ if field in cdb not supported,
@@ -134,6 +188,17 @@ int sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist,
                         int dl_format, void * resp, int mx_resp_len,
                         bool noisy, int verbose);
 
+/* Invokes a SCSI READ DEFECT DATA (12) command (SBC). Address descriptors
+ * are returned starting at addr_desc_index (0 based). If residp is
+ * non-NULL the residual count is written to it. Return of 0 -> success,
+ * SG_LIB_CAT_INVALID_OP -> invalid opcode, SG_LIB_CAT_ILLEGAL_REQ -> bad
+ * field in cdb, SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_NOT_READY -> device
+ * not ready, SG_LIB_CAT_ABORTED_COMMAND, -1 -> other failure */
+int sg_ll_read_defect12(int sg_fd, bool req_plist, bool req_glist,
+                        int dl_format, uint32_t addr_desc_index,
+                        void * resp, int mx_resp_len, int * residp,
+                        bool noisy, int verbose);
+
 /* Invokes a SCSI READ LONG (10) command (SBC). Note that 'xfer_len'
  * is in bytes. Returns 0 -> success,
  * SG_LIB_CAT_INVALID_OP -> READ LONG(10) not supported,
@@ -384,6 +449,38 @@ int sg_ll_pre_fetch_x(int sg_fd, bool do_seek10, bool cdb16, bool immed,
                       uint64_t lba, uint32_t num_blocks, int group_num,
                       int timeout_secs, bool noisy, int verbose);
 
+/* Command timeouts reported by the device itself. A REPORT SUPPORTED
+ * OPERATION CODES (SPC) command with RCTD set fetches every supported
+ * opcode and service action together with its nominal processing time and
+ * recommended timeout. Do that once per device with
+ * sg_cmd_timeouts_fetch(), then look up timeouts as often as needed; the
+ * returned object is read-only so may be shared between threads. Returns
+ * 0 -> success (*ctpp must later be given to sg_cmd_timeouts_free()),
+ * SG_LIB_CAT_INVALID_OP -> RSOC not supported, SG_LIB_CAT_ILLEGAL_REQ ->
+ * RCTD probably not supported, other SG_LIB_CAT_* positive values or -1 ->
+ * other failure. */
+struct sg_cmd_timeouts;         /* opaque */
+
+int sg_cmd_timeouts_fetch(int sg_fd, struct sg_cmd_timeouts ** ctpp,
+                          bool noisy, int verbose);
+
+/* Yields the nominal processing time and recommended timeout (both in
+ * seconds, 0 if the device did not report them) of the command with the
+ * given opcode and service action (use 0 when there is no service
+ * action). Returns false if that command is not in ctp or ctp is NULL. */
+bool sg_cmd_timeouts_find(const struct sg_cmd_timeouts * ctp, int opcode,
+                          int sa, uint32_t * nominalp,
+                          uint32_t * recommendedp);
+
+/* Returns the device recommended timeout in seconds for the command in
+ * cdbp, suitable for the timeout_secs argument of do_scsi_pt(). The
+ * service action, if any, is taken from the cdb. Returns def_secs if
+ * ctp is NULL or the device gave no recommended timeout for it. */
+int sg_cmd_timeout_secs(const struct sg_cmd_timeouts * ctp,
+                        const uint8_t * cdbp, int cdb_len, int def_secs);
+
+void sg_cmd_timeouts_free(struct sg_cmd_timeouts * ctp);
+
 #ifdef __cplusplus
 }
 #endif
@@ -190,6 +190,69 @@ int sg_err_category_new(int scsi_status, int host_status, int driver_status,
 int sg_err_category3(struct sg_io_hdr * hp);
 
 
+/* Request sharing (sg v4 driver 4.0.45 and later) lets the data-in buffer
+ * of a READ on one sg fd become the data-out buffer of a following WRITE
+ * on another sg fd, so the data never visits user space. The installed
+ * <scsi/sg.h> header probably pre-dates that driver. */
+#ifndef SG_SET_GET_EXTENDED
+
+struct sg_extended_info {
+    uint32_t   sei_wr_mask;    /* OR-ed SG_SEIM_* user->driver values */
+    uint32_t   sei_rd_mask;    /* OR-ed SG_SEIM_* driver->user values */
+    uint32_t   ctl_flags_wr_mask;      /* OR-ed SG_CTL_FLAGM_* values */
+    uint32_t   ctl_flags_rd_mask;      /* OR-ed SG_CTL_FLAGM_* values */
+    uint32_t   ctl_flags;      /* bit values OR-ed, see SG_CTL_FLAGM_* */
+    uint32_t   read_value;     /* write SG_SEIRV_*, read back related */
+
+    uint32_t   reserved_sz;    /* data/sgl size of pre-allocated request */
+    uint32_t   tot_fd_thresh;  /* total data/sgat for this fd, 0: no limit */
+    uint32_t   minor_index;    /* rd: kernel's sg device minor number */
+    uint32_t   share_fd;       /* SHARE_FD and CHG_SHARE_FD use this */
+    uint32_t   sgat_elem_sz;   /* sgat element size (must be power of 2) */
+    uint8_t    pad_to_96[52];  /* pad so struct is 96 bytes long */
+};
+
+#define SG_IOCTL_MAGIC_NUM 0x22
+
+#define SG_SET_GET_EXTENDED _IOWR(SG_IOCTL_MAGIC_NUM, 0x51,     \
+                                  struct sg_extended_info)
+#endif
+
+#ifndef SG_SEIM_SHARE_FD
+#define SG_SEIM_SHARE_FD 0x20   /* write-side gives fd of read-side */
+#endif
+#ifndef SGV4_FLAG_SHARE
+#define SGV4_FLAG_SHARE 0x4000
+#endif
+#ifndef SGV4_FLAG_NO_DXFER
+#define SGV4_FLAG_NO_DXFER SG_FLAG_NO_DXFER
+#endif
+
+#define SG_LINUX_SHARE_MIN_VERSION 40045        /* sg driver 4.0.45 */
+
+/* Returns the sg driver version number from procfs or, if that fails, from
+ * sysfs (e.g. 40045 for 4.0.45). Returns 0 if it cannot be found. */
+int sg_linux_driver_version(void);
+
+/* Returns the NUMA node of the host adapter (e.g. a PCIe HBA) that serves
+ * the device open on fd; for a regular file, the device holding its file
+ * system. Found by walking up the device's path in sysfs. Returns -1 if
+ * unknown (e.g. a machine with one node). */
+int sg_linux_fd_numa_node(int fd, int vb);
+
+/* Allocates a zeroed, page aligned buffer of at least num_bytes for data
+ * transfers. If huge is true, explicit huge pages (1 GiB ones when
+ * num_bytes is that large, then 2 MiB) are tried first, then normal pages
+ * advised to use transparent huge pages. If numa_node >= 0 the buffer is
+ * bound to that node. Returns NULL on failure. Otherwise *alloc_lenp is
+ * set to the length that must be given to sg_linux_free_buf(). */
+uint8_t * sg_linux_alloc_buf(uint32_t num_bytes, bool huge, int numa_node,
+                             uint32_t * alloc_lenp, int vb);
+
+/* Frees a buffer from sg_linux_alloc_buf(). */
+void sg_linux_free_buf(uint8_t * bp, uint32_t alloc_len);
+
+
 /* Note about SCSI status codes found in older versions of Linux.
  * Linux has traditionally used a 1 bit right shifted and masked
  * version of SCSI standard status codes. Now CHECK_CONDITION
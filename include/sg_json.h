@@ -57,6 +57,7 @@ typedef struct sgj_state_t {
     /* the following set by default, the SG3_UTILS_JSON_OPTS environment
      * variable or command line argument to --json option, in that order. */
     bool pr_as_json;            /* = false (def: is plain text output) */
+    bool pr_cbor;               /* 'c' (def: false) binary CBOR output */
     bool pr_exit_status;        /* 'e' (def: true) */
     bool pr_hex;                /* 'h' (def: false) */
     bool pr_leadin;             /* 'l' (def: true) */
@@ -64,6 +65,7 @@ typedef struct sgj_state_t {
     bool pr_out_hr;             /* 'o' (def: false), see out_hrp below */
     bool pr_packed;             /* 'k' (def: false) only when !pr_pretty */
     bool pr_pretty;             /* 'p' (def: true) */
+    bool pr_stream;             /* 'w' (def: false) see sgj_start_stream_r */
     bool pr_string;             /* 's' (def: true) */
     char pr_format;             /*  (def: '\0') */
     int pr_indent_size;         /* digit (def: 4) */
@@ -78,6 +80,12 @@ typedef struct sgj_state_t {
                                  * element contains a line of plain text. The
                                  * array's JSON name is 'plain_text_output' */
     sgj_opaque_p userp;         /* for temporary usage */
+    void * streamp;             /* non-NULL when output is being streamed */
+    unsigned int arena_sz;      /* sgj_init_state() sets a default slab size
+                                 * of the arena that in-core tree nodes come
+                                 * from. May be set to 0 before sgj_start_r()
+                                 * to allocate each node with malloc() */
+    void * arenap;              /* arena (if any), released by sgj_finish() */
 } sgj_state;
 
 /* This function tries to convert the in_name C string to the "snake_case"
@@ -148,10 +156,29 @@ bool sgj_init_state(sgj_state * jsp, const char * j_optarg);
  * "utility_invoked" object  (creating it in the case when jsp->pr_leadin is
  * false) and a pointer to that array object is placed in jsp->out_hrp . The
  * returned pointer is not usually needed but if it is NULL then a heap
- * allocation has failed. */
+ * allocation has failed. Unless jsp->arena_sz is 0, all nodes of the in-core
+ * tree, including unattached ones, are taken from an arena that sgj_finish()
+ * frees in one go; so sgj_free_unattached() is then a no-op. */
 sgj_opaque_p sgj_start_r(const char * util_name, const char * ver_str,
                          int argc, char *argv[], sgj_state * jsp);
 
+/* Same as sgj_start_r() unless jsp->pr_stream is true ('w' control
+ * character) and jsp->pr_out_hr is false. In that case the lead-in fields
+ * are written to fp immediately and no in-core tree is kept. Thereafter
+ * each sgj_js_nv_*() and sgj_haj_*() call appends its name-value pair to
+ * fp, a named sub-object or sub-array stays open until something is added
+ * to one of its ancestors. So a utility using this function must add the
+ * members of each sub-object (sub-array) before returning to its parent.
+ * Unattached objects and arrays (e.g. from sgj_new_unattached_object_r())
+ * are still built in-core; they are serialized to fp, then freed, when they
+ * are attached by sgj_js_nv_o() so they must be complete at that point.
+ * The output is finished by sgj_js2file_estr() (or sgj_finish()) and the
+ * FILE argument given to it is ignored. Utilities that need to revisit
+ * (post-edit) their JSON tree should keep using sgj_start_r(). */
+sgj_opaque_p sgj_start_stream_r(const char * util_name, const char * ver_str,
+                                int argc, char *argv[], FILE * fp,
+                                sgj_state * jsp);
+
 /* These are low level functions returning a pointer to a newly created JSON
  * object or array. If jsp is NULL or jsp->pr_as_json is false nothing happens
  * and NULL is returned. Note that this JSON object is _not_ placed in the
@@ -298,7 +325,8 @@ void sgj_js_nv_s_nex(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
 /* Add named field whose value is a (large) JSON string made up of num_bytes
  * ASCII hexadecimal bytes (each two hex digits separated by a space) starting
  * at byte_arr. The heap is used for intermediate storage so num_bytes can
- * be arbitrarily large. */
+ * be arbitrarily large. If jsp->pr_cbor is true the bytes are kept as is
+ * and output as a CBOR byte string. */
 void sgj_js_nv_hex_bytes(sgj_state * jsp, sgj_opaque_p jop,
                          const char * sn_name, const uint8_t * byte_arr,
                          int num_bytes);
@@ -366,8 +394,10 @@ void sgj_hr_str_out(sgj_state * jsp, const char * sp, int slen);
  * or jsp->basep is NULL then this function does nothing. If jsp->exit_status
  * is true then a new JSON object named "exit_status" and the 'exit_status'
  * value rendered as a JSON integer is appended to jsp->basep. The in-core
- * JSON tree with jsp->basep as its root is streamed to 'fp'. fp is
- * assumed to be non-NULL. */
+ * JSON tree with jsp->basep as its root is streamed to 'fp'. If
+ * jsp->pr_cbor is true then the tree is written to 'fp' as binary CBOR
+ * (RFC 8949) prefixed by the self-describe tag. fp is assumed to be
+ * non-NULL. */
 void sgj_js2file_estr(sgj_state * jsp, sgj_opaque_p jop, int exit_status,
                       const char * estr, FILE * fp);
 
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -700,6 +701,111 @@ void hex2stderr(const uint8_t * b_str, int len, int no_ascii);
 int sg_f2hex_arr(const char * fname, bool as_binary, bool no_space,
                  uint8_t * mp_arr, int * mp_arr_len, int max_arr_len_and);
 
+/* A scatter gather list (sgl) element: a starting LBA and the number of
+ * blocks from (and including) that LBA. */
+struct sg_lba_extent {
+    uint64_t lba;
+    uint32_t num;
+};
+
+/* Builds an array of LBA extents from 'arg'. If 'arg' starts with '@' the
+ * rest is the name of a file ("-" for stdin) holding LBA,NUM pairs, 'H@'
+ * is the same but all numbers in the file are hex; otherwise 'arg' itself
+ * is a comma separated list: LBA0,NUM0,LBA1,NUM1... In a file, pairs may
+ * be separated by commas or whitespace and '#' starts a comment. Extents
+ * with NUM of zero are dropped and an extent that starts where the
+ * previous one ends is merged into it, so each element is a maximal
+ * transfer. Returns 0 if ok in which case a heap allocated array (the
+ * caller should free it) is written to *sglpp, its element count to
+ * *num_elemsp and, if sum_blksp is non-NULL, the total number of blocks
+ * to *sum_blksp. If max_lba_p1 is greater than 0 then each extent's LBA
+ * and LBA+NUM must not exceed it, else SG_LIB_LBA_OUT_OF_RANGE is
+ * returned. Otherwise returns an SG_LIB_* error code. */
+int sg_get_lba_extents(const char * arg, struct sg_lba_extent ** sglpp,
+                       int * num_elemsp, int64_t * sum_blksp,
+                       int64_t max_lba_p1, int verbose);
+
+/* State carried between lines by sg_parse_lba_pairs(). Zero it, then set
+ * def_hex, flexible, add_fn and argp before parsing the first line. After
+ * the last line an odd 'off' means a LBA is missing its NUM. */
+struct sg_lba_pairs_st {
+    bool def_hex;       /* numbers are hex (no multipliers) */
+    bool flexible;      /* a 'HEX' line may switch from decimal to hex */
+    bool hex_seen;      /* a 'HEX' line has been seen */
+    int off;            /* count of numbers decoded so far */
+    uint64_t lba;       /* pending LBA waiting for its NUM */
+    /* called with each LBA,NUM pair; a non-zero return stops the parse */
+    int (*add_fn)(uint64_t lba, uint64_t num, void * argp);
+    void * argp;
+};
+
+/* Decodes the LBA,NUM pairs in one line (NUL terminated, without its
+ * newline) of an extent list; used by sg_get_lba_extents() and by the C++
+ * scat_gath_list class so both accept the same syntax. Numbers are
+ * separated by commas or whitespace and '#' starts a comment. Unless
+ * sp->def_hex is set, numbers are decimal (multiplier suffixes allowed) or
+ * hex when prefixed by '0x' or suffixed by 'h'. Lines starting with 'HEX'
+ * are accepted before the first number: they switch to hex when
+ * sp->flexible is set and are an error if decimal is expected otherwise.
+ * src and line_num (origin 1) are used in error messages. Returns 0,
+ * SG_LIB_SYNTAX_ERROR or the non-zero value returned by add_fn(). */
+int sg_parse_lba_pairs(const char * line, struct sg_lba_pairs_st * sp,
+                       const char * src, int line_num);
+
+/* Reads names (e.g. of DEVICEs) from the file fn ('-' for stdin), one per
+ * line. Leading and trailing whitespace is removed, then blank lines and
+ * lines starting with '#' are ignored. For each name add_fn() is called with
+ * a heap copy of the name which add_fn() owns if it returns 0. Stops at the
+ * first non-zero value returned by add_fn() and returns it. Returns 0 if
+ * successful, else an SG_LIB_* error. */
+int sg_read_name_list(const char * fn, int (*add_fn)(char * name, void * argp),
+                      void * argp);
+
+/* Calls work_fn(argp) from num_thr threads and waits for them to finish.
+ * If fewer threads can be created, continues with those that were; if
+ * none (or num_thr is 1 or less, or there is no pthread support) then
+ * work_fn(argp) is called from this thread. work_fn() is expected to take
+ * items from a list shared via argp, under its own lock, until none
+ * remain. Returns the number of threads used, which is at least 1. */
+int sg_run_workers(int num_thr, void * (*work_fn)(void * argp), void * argp);
+
+#define SG_MDEV_MIN_POLL_SECS 2 /* multiple DEVICEs: poll no faster */
+
+/* Per DEVICE state kept by utilities (e.g. sg_format and sg_sanitize) that
+ * launch a long running command with IMMED set on several DEVICEs and then
+ * poll all of them from one loop. Progress is polled with
+ * sg_mdev_poll() [in sg_cmds_basic.h]. */
+struct sg_mdev_st {
+    bool active;        /* command launched, not yet finished */
+    bool use_rs;        /* poll with REQUEST SENSE rather than TUR */
+    bool desc;          /* ask REQUEST SENSE for descriptor format */
+    int fd;
+    int res;            /* 0 or first error (SG_LIB_* value) */
+    int progress;       /* 0 to 65536, -1 if not yet known */
+    time_t start_tm;    /* when the command was launched */
+    time_t next_tm;     /* when this DEVICE should next be polled */
+    time_t end_tm;      /* when completion or failure noticed */
+    const char * name;
+};
+
+/* Places 'h:mm:ss' form of secs in b (or "-" if secs is negative), returns
+ * b. */
+char * sg_mdev_hms_str(long secs, char * b, int blen);
+
+/* Estimated seconds until DEVICE completes based on its progress rate
+ * since its command was launched. Returns -1 if no estimate possible. */
+long sg_mdev_eta_secs(const struct sg_mdev_st * mdp, time_t now);
+
+/* Outputs (to stdout) one line per DEVICE in mdarr followed by an
+ * aggregate line. start_tm is when the first command was launched. */
+void sg_mdev_report(const struct sg_mdev_st * mdarr, int num,
+                    time_t start_tm, time_t now);
+
+/* Returns a monotonic time in microseconds, for timing and scheduling.
+ * Uses gettimeofday() if CLOCK_MONOTONIC is not available, and failing
+ * that time() (so whole seconds). */
+int64_t sg_get_monotonic_usecs(void);
+
 /* Returns true when executed on big endian machine; else returns false.
  * Useful for displaying ATA identify words (which need swapping on a
  * big endian machine). */
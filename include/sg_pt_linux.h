@@ -192,6 +192,8 @@ extern long sg_lin_page_size;
 void sg_find_bsg_nvme_char_major(int verbose);
 int sg_do_nvme_pt(struct sg_pt_base * vp, int fd, int time_secs, int vb);
 int sg_linux_get_sg_version(const struct sg_pt_base * vp);
+void sg_lin_trace_rec(const struct sg_pt_base * vp, int kind, int ret,
+                      int verbose);
 
 /* This trims given NVMe block device name in Linux (e.g. /dev/nvme0n1p5)
  * to the name of its associated char device (e.g. /dev/nvme0). If this
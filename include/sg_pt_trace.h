@@ -0,0 +1,70 @@
+#ifndef SG_PT_TRACE_H
+#define SG_PT_TRACE_H
+
+/*
+ * Copyright (c) 2026 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/* This header is for internal use by the sg3_utils library (libsgutils).
+ * It describes the binary pass-through trace that is written when the
+ * SG3_UTILS_PT_RECORD environment variable names a file (Linux only, see
+ * sg_pt_linux.c). The replay pass-through (sg_pt_replay.c, selected by
+ * './configure --enable-pt_replay') answers commands from the trace named
+ * by the SG3_UTILS_PT_REPLAY environment variable.
+ *
+ * All multi-byte fields are little endian. The file starts with a 16 byte
+ * header:
+ *     offset  length
+ *        0      8     magic: "SGPTTRC" followed by a zero byte
+ *        8      2     version (SG_PT_TRACE_VERSION)
+ *       10      6     reserved
+ * Then follows one record per command. Each record is a 56 byte header
+ * followed by the command (cdb_len bytes), the data-out (dout_len bytes),
+ * the data-in actually received (din_len bytes) then the sense data or
+ * NVMe completion queue entry (sense_len bytes). The record header:
+ *        0      1     kind: SG_PT_TRACE_SCSI or SG_PT_TRACE_NVM
+ *        1      1     flags: SG_PT_TRACE_F_NVME if device is NVMe
+ *        2      2     cdb_len (64 for NVMe commands)
+ *        4      2     sense_len
+ *        6      1     result category (SCSI_PT_RESULT_* from sg_pt.h)
+ *        7      1     reserved
+ *        8      4     return value of do_scsi_pt() or do_nvm_pt()
+ *       12      4     operating system error (errno)
+ *       16      4     status response
+ *       20      4     result (e.g. NVMe completion queue DW0)
+ *       24      4     transport error
+ *       28      4     driver status
+ *       32      4     dout_len
+ *       36      4     din_len
+ *       40      4     data-in residual count
+ *       44      4     NVMe namespace identifier
+ *       48      8     command duration in nanoseconds (0 if not known)
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SG_PT_TRACE_RECORD_EV "SG3_UTILS_PT_RECORD"
+#define SG_PT_TRACE_REPLAY_EV "SG3_UTILS_PT_REPLAY"
+
+#define SG_PT_TRACE_MAGIC "SGPTTRC"     /* sizeof() includes trailing 0 */
+#define SG_PT_TRACE_VERSION 1
+#define SG_PT_TRACE_HDR_LEN 16
+#define SG_PT_TRACE_REC_LEN 56
+
+#define SG_PT_TRACE_SCSI 1      /* from do_scsi_pt() */
+#define SG_PT_TRACE_NVM 2       /* from do_nvm_pt() */
+
+#define SG_PT_TRACE_F_NVME 0x1
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif          /* end of SG_PT_TRACE_H */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014-2020 Douglas Gilbert.
+ * Copyright (c) 2014-2026 Douglas Gilbert.
  * All rights reserved.
  * Use of this source code is governed by a BSD-style
  * license that can be found in the BSD_LICENSE file.
@@ -16,10 +16,11 @@
 // C++ standard headers
 #include <vector>
 
-// This file is a C++ header file
+#include "sg_lib.h"
 
-
-#define SG_SGL_MAX_ELEMENTS 16384
+// This file is a C++ header file. Its implementation is in
+// lib/sg_scat_gath.cpp which is not part of libsgutils2 (a C library);
+// C++ utilities that need it build that file themselves.
 
 #define SG_COUNT_INDEFINITE (-1)
 #define SG_LBA_INVALID SG_COUNT_INDEFINITE
@@ -50,7 +51,7 @@ enum sgl_linearity_e {
 class scat_gath_list {
 public:
     scat_gath_list() : linearity(SGL_LINEAR), sum_hard(false), m_errno(0),
-        high_lba_p1(0), lowest_lba(0), sum(0) { }
+        high_lba_p1(0), lowest_lba(0), sum(0), cum_blks(1, 0) { }
 
     scat_gath_list(const scat_gath_list &) = default;
     scat_gath_list & operator=(const scat_gath_list &) = default;
@@ -96,10 +97,31 @@ public:
 private:
     friend class scat_gath_iter;
 
+    // state carried from one line to the next when parsing a sgl file
+    struct parse_state {
+        struct sg_lba_pairs_st lp;  // shared with sg_get_lba_extents()
+        scat_gath_list * sglp;
+        bool b_vb;
+    };
+
+    void push_elem(const scat_gath_elem & sge);
+    static int add_lba_pair(uint64_t lba, uint64_t num, void * argp);
+    void init_parse(struct parse_state & ps, bool def_hex, bool flexible,
+                    bool b_vb);
+    bool parse_line(const char * line, int line_num, const char * fnp,
+                    struct parse_state & ps);
     bool file2sgl_helper(FILE * fp, const char * fnp, bool def_hex,
                          bool flexible, bool b_vb);
+    bool mem2sgl_helper(const char * bp, int64_t blen, const char * fnp,
+                        bool def_hex, bool flexible, bool b_vb);
+    bool parse_fini(const struct parse_state & ps, const char * fnp,
+                    bool b_vb);
 
     std::vector<scat_gath_elem> sgl;  // an array on heap [0..num_elems())
+    // cum_blks[k] is the sum of sgl[0..k).num so it has one more element
+    // than sgl and cum_blks[0] is always 0. Allows binary search by block
+    // index. Only push_elem() and append_1or() should change sgl.
+    std::vector<int64_t> cum_blks;
 };
 
 
@@ -139,5 +161,5 @@ private:
     int it_el_ind;      // refers to sge==sglist[it_el_ind]
     int it_blk_off;     // refers to LBA==(sge.lba + it_blk_off)
     int64_t blk_idx;    // in range: [0 .. sglist.sum)
-    bool extend_last;
+    bool extend_last;   // last element degenerate: treat as open ended
 };
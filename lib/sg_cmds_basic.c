@@ -42,7 +42,7 @@
 #endif
 
 
-static const char * const version_str = "2.02 20230311";
+static const char * const version_str = "2.03 20261018";
 
 
 #define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
@@ -836,6 +836,70 @@ sg_ll_request_sense_pt(struct sg_pt_base * ptvp, bool desc, void * resp,
                                    noisy, verbose);
 }
 
+/* Polls one DEVICE (see struct sg_mdev_st in sg_lib.h) for progress with
+ * TEST UNIT READY, falling back to REQUEST SENSE if TUR yields no progress
+ * indication while not ready. Sets mdp->next_tm so the interval shrinks
+ * as the DEVICE nears completion, between SG_MDEV_MIN_POLL_SECS and
+ * max_poll_secs. Returns true if this DEVICE has finished (successfully
+ * or not) in which case mdp->res holds 0 or the error. */
+bool
+sg_mdev_poll(struct sg_mdev_st * mdp, time_t now, int max_poll_secs,
+             int verbose)
+{
+    int res, resp_len, progress, wait_secs;
+    long eta;
+    uint8_t rs_b[252];  /* largest REQUEST SENSE response */
+
+    progress = -1;
+    if (! mdp->use_rs) {
+        res = sg_ll_test_unit_ready_progress(mdp->fd, 0, &progress, false,
+                                             verbose);
+        if ((progress < 0) && ((SG_LIB_CAT_NOT_READY == res) ||
+                               (SG_LIB_PROGRESS_NOT_READY == res)))
+            mdp->use_rs = true;
+        else if ((progress < 0) && (SG_LIB_CAT_UNIT_ATTENTION != res)) {
+            mdp->res = res;
+            goto finished;
+        }
+    }
+    if (mdp->use_rs) {
+        memset(rs_b, 0, sizeof(rs_b));
+        res = sg_ll_request_sense(mdp->fd, mdp->desc, rs_b, sizeof(rs_b),
+                                  false, verbose);
+        if ((SG_LIB_CAT_ILLEGAL_REQ == res) && mdp->desc) {
+            mdp->desc = false;  /* try fixed format sense next time */
+            mdp->next_tm = now + SG_MDEV_MIN_POLL_SECS;
+            return false;
+        } else if (res) {
+            mdp->res = res;
+            goto finished;
+        }
+        resp_len = rs_b[7] + 8;
+        sg_get_sense_progress_fld(rs_b, resp_len, &progress);
+        if (progress < 0)
+            goto finished;
+    }
+    if (progress >= 0)
+        mdp->progress = progress;
+    eta = sg_mdev_eta_secs(mdp, now);
+    if (eta < 0)        /* no estimate yet, back off towards maximum */
+        wait_secs = 2 * (int)(now - mdp->start_tm);
+    else
+        wait_secs = (int)(eta / 8);
+    if (wait_secs < SG_MDEV_MIN_POLL_SECS)
+        wait_secs = SG_MDEV_MIN_POLL_SECS;
+    else if (wait_secs > max_poll_secs)
+        wait_secs = max_poll_secs;
+    mdp->next_tm = now + wait_secs;
+    return false;
+finished:
+    mdp->active = false;
+    mdp->end_tm = now;
+    if (0 == mdp->res)
+        mdp->progress = 65536;
+    return true;
+}
+
 /* Invokes a SCSI REPORT LUNS command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 static int
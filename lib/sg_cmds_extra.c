@@ -62,10 +62,16 @@
 #define READ_BUFFER_CMDLEN 10
 #define READ_DEFECT10_CMD     0x37
 #define READ_DEFECT10_CMDLEN    10
+#define READ_DEFECT12_CMD     0xb7
+#define READ_DEFECT12_CMDLEN    12
 #define REASSIGN_BLKS_CMD     0x7
 #define REASSIGN_BLKS_CMDLEN  6
 #define RECEIVE_DIAGNOSTICS_CMD   0x1c
 #define RECEIVE_DIAGNOSTICS_CMDLEN  6
+#define ZONING_OUT_CMD 0x94
+#define ZONING_OUT_CMDLEN 16
+#define ZONING_IN_CMD 0x95
+#define ZONING_IN_CMDLEN 16
 #define THIRD_PARTY_COPY_OUT_CMD 0x83   /* was EXTENDED_COPY_CMD */
 #define THIRD_PARTY_COPY_OUT_CMDLEN 16
 #define THIRD_PARTY_COPY_IN_CMD 0x84     /* was RECEIVE_COPY_RESULTS_CMD */
@@ -104,6 +110,9 @@
 #define WRITE_LONG_16_SA 0x11
 #define REPORT_REFERRALS_SA 0x13
 #define EXTENDED_COPY_LID1_SA 0x0
+#define STREAM_CONTROL_SA 0x14
+#define REPORT_ZONES_SA 0x0
+#define REM_ELEM_MOD_ZONES_SA 0x1a      /* uses SERVICE ACTION IN(16) */
 
 
 static struct sg_pt_base *
@@ -262,6 +271,207 @@ sg_ll_get_lba_status32(int sg_fd, uint64_t start_llba, uint32_t scan_len,
     return ret;
 }
 
+/* Invokes a SCSI STREAM CONTROL command (SBC-4). Even though it opens or
+ * closes a stream, it is a SERVICE ACTION IN(16) command because its
+ * data-in buffer carries the ASSIGNED_STR_ID field after an open. Returns
+ * 0 -> success, various SG_LIB_CAT_* positive values or -1 -> other
+ * errors */
+int
+sg_ll_stream_control(int sg_fd, int str_ctl, uint16_t str_id, void * resp,
+                     int alloc_len, int * residp, bool noisy, int vb)
+{
+    static const char * const cdb_s = "Stream control";
+    int res, s_cat, ret;
+    uint8_t scCmd[SERVICE_ACTION_IN_16_CMDLEN];
+    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
+    struct sg_pt_base * ptvp;
+
+    memset(scCmd, 0, sizeof(scCmd));
+    scCmd[0] = SERVICE_ACTION_IN_16_CMD;
+    scCmd[1] = STREAM_CONTROL_SA | ((str_ctl & 0x3) << 5);
+    if (str_id)         /* Only used for close, stream id to close */
+        sg_put_unaligned_be16(str_id, scCmd + 4);
+    sg_put_unaligned_be32((uint32_t)alloc_len, scCmd + 10);
+    if (vb) {
+        char b[128];
+
+        pr2ws("    %s cdb: %s\n", cdb_s,
+              sg_get_command_str(scCmd, SERVICE_ACTION_IN_16_CMDLEN, false,
+                                 sizeof(b), b));
+    }
+
+    if (NULL == ((ptvp = create_pt_obj(cdb_s))))
+        return sg_convert_errno(ENOMEM);
+    set_scsi_pt_cdb(ptvp, scCmd, sizeof(scCmd));
+    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
+    set_scsi_pt_data_in(ptvp, (uint8_t *)resp, alloc_len);
+    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, vb);
+    ret = sg_cmds_process_resp(ptvp, cdb_s, res, noisy, vb, &s_cat);
+    if (-1 == ret) {
+        if (get_scsi_pt_transport_err(ptvp))
+            ret = SG_LIB_TRANSPORT_ERROR;
+        else
+            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
+    } else if (-2 == ret) {
+        switch (s_cat) {
+        case SG_LIB_CAT_RECOVERED:
+        case SG_LIB_CAT_NO_SENSE:
+            ret = 0;
+            break;
+        default:
+            ret = s_cat;
+            break;
+        }
+    } else {
+        if ((vb > 2) && (ret > 0)) {
+            pr2ws("    %s: parameter data returned:\n", cdb_s);
+            hex2stderr((const uint8_t *)resp, ret, ((vb > 3) ? -1 : 1));
+        }
+        ret = 0;
+    }
+    if (residp)
+        *residp = ret ? alloc_len : get_scsi_pt_resid(ptvp);
+    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+int
+sg_ll_report_zones(int sg_fd, uint64_t zs_lba, bool partial, int report_opts,
+                   void * resp, int mx_resp_len, int * residp, bool noisy,
+                   int vb)
+{
+    return sg_ll_zoning_in(sg_fd, REPORT_ZONES_SA, zs_lba, partial,
+                           report_opts, resp, mx_resp_len, residp, noisy, vb);
+}
+
+/* Invokes a SCSI ZONING IN command (ZBC-2) with service action 'sa' (e.g.
+ * REPORT ZONES). Return of 0 -> success, various SG_LIB_CAT_* positive
+ * values or -1 -> other errors */
+int
+sg_ll_zoning_in(int sg_fd, int sa, uint64_t locator, bool partial,
+                int report_opts, void * resp, int mx_resp_len, int * residp,
+                bool noisy, int vb)
+{
+    int res, s_cat, ret;
+    uint8_t rzCmd[ZONING_IN_CMDLEN] =
+          {ZONING_IN_CMD, REPORT_ZONES_SA, 0, 0,  0, 0, 0, 0, 0, 0,
+           0, 0, 0, 0, 0, 0};
+    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
+    struct sg_pt_base * ptvp;
+    char cdb_s[64];
+
+    rzCmd[1] = 0x1f & sa;
+    sg_get_opcode_sa_name(rzCmd[0], sa, -1, sizeof(cdb_s), cdb_s);
+    sg_put_unaligned_be64(locator, rzCmd + 2);
+    sg_put_unaligned_be32((uint32_t)mx_resp_len, rzCmd + 10);
+    rzCmd[14] = report_opts & 0x3f;
+    if (partial)
+        rzCmd[14] |= 0x80;
+    if (vb) {
+        char b[128];
+
+        pr2ws("    %s cdb: %s\n", cdb_s,
+              sg_get_command_str(rzCmd, ZONING_IN_CMDLEN, false, sizeof(b),
+                                 b));
+    }
+
+    if (NULL == ((ptvp = create_pt_obj(cdb_s))))
+        return sg_convert_errno(ENOMEM);
+    set_scsi_pt_cdb(ptvp, rzCmd, sizeof(rzCmd));
+    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
+    set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
+    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, vb);
+    ret = sg_cmds_process_resp(ptvp, cdb_s, res, noisy, vb, &s_cat);
+    if (-1 == ret) {
+        if (get_scsi_pt_transport_err(ptvp))
+            ret = SG_LIB_TRANSPORT_ERROR;
+        else
+            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
+    } else if (-2 == ret) {
+        switch (s_cat) {
+        case SG_LIB_CAT_RECOVERED:
+        case SG_LIB_CAT_NO_SENSE:
+            ret = 0;
+            break;
+        default:
+            ret = s_cat;
+            break;
+        }
+    } else {
+        if ((vb > 2) && (ret > 0)) {
+            pr2ws("    %s: response:\n", cdb_s);
+            hex2stderr((const uint8_t *)resp, (ret > 256 ? 256 : ret),
+                       ((vb > 3) ? -1 : 1));
+        }
+        ret = 0;
+    }
+    if (residp)
+        *residp = ret ? mx_resp_len : get_scsi_pt_resid(ptvp);
+    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+/* Invokes a SCSI ZONE OUT command (ZBC) with service action 'sa'. Return of
+ * 0 -> success, various SG_LIB_CAT_* positive values or -1 -> other
+ * errors */
+int
+sg_ll_zone_out(int sg_fd, int sa, uint64_t zid, uint16_t zc, bool all,
+               int timeout_secs, bool noisy, int vb)
+{
+    int res, s_cat, ret;
+    uint8_t zoCmd[ZONING_OUT_CMDLEN] =
+          {ZONING_OUT_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  0, 0, 0, 0};
+    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
+    struct sg_pt_base * ptvp;
+    char b[64];
+
+    zoCmd[1] = 0x1f & sa;
+    if (REM_ELEM_MOD_ZONES_SA == sa) {  /* zid carries element identifier */
+        zoCmd[0] = SERVICE_ACTION_IN_16_CMD;    /* N.B. changing opcode */
+        sg_put_unaligned_be32((uint32_t)zid, zoCmd + 10);
+    } else {
+        sg_put_unaligned_be64(zid, zoCmd + 2);
+        sg_put_unaligned_be16(zc, zoCmd + 12);
+        if (all)
+            zoCmd[14] = 0x1;
+    }
+    sg_get_opcode_sa_name(zoCmd[0], sa, -1, sizeof(b), b);
+    if (vb) {
+        char d[128];
+
+        pr2ws("    %s cdb: %s\n", b,
+              sg_get_command_str(zoCmd, ZONING_OUT_CMDLEN, false,
+                                 sizeof(d), d));
+    }
+
+    if (NULL == ((ptvp = create_pt_obj(b))))
+        return sg_convert_errno(ENOMEM);
+    set_scsi_pt_cdb(ptvp, zoCmd, sizeof(zoCmd));
+    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
+    res = do_scsi_pt(ptvp, sg_fd, ((timeout_secs > 0) ? timeout_secs :
+                                                        DEF_PT_TIMEOUT), vb);
+    ret = sg_cmds_process_resp(ptvp, b, res, noisy, vb, &s_cat);
+    if (-1 == ret) {
+        if (get_scsi_pt_transport_err(ptvp))
+            ret = SG_LIB_TRANSPORT_ERROR;
+        else
+            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
+    } else if (-2 == ret) {
+        switch (s_cat) {
+        case SG_LIB_CAT_RECOVERED:
+        case SG_LIB_CAT_NO_SENSE:
+            ret = 0;
+            break;
+        default:
+            ret = s_cat;
+            break;
+        }
+    } else
+        ret = 0;
+    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
 int
 sg_ll_report_tgt_prt_grp(int sg_fd, void * resp, int mx_resp_len,
                          bool noisy, int vb)
@@ -776,6 +986,73 @@ sg_ll_read_defect10(int sg_fd, bool req_plist, bool req_glist, int dl_format,
     return ret;
 }
 
+/* Invokes a SCSI READ DEFECT DATA (12) command (SBC). The address
+ * descriptor index allows a long defect list to be fetched in pieces.
+ * Return of 0 -> success, various SG_LIB_CAT_* positive values or -1 ->
+ * other errors */
+int
+sg_ll_read_defect12(int sg_fd, bool req_plist, bool req_glist, int dl_format,
+                    uint32_t addr_desc_index, void * resp, int mx_resp_len,
+                    int * residp, bool noisy, int vb)
+{
+    static const char * const cdb_s = "Read defect(12)";
+    int res, ret, s_cat;
+    uint8_t rdef_cdb[READ_DEFECT12_CMDLEN] =
+        {READ_DEFECT12_CMD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
+    struct sg_pt_base * ptvp;
+
+    rdef_cdb[1] = (dl_format & 0x7);
+    if (req_plist)
+        rdef_cdb[1] |= 0x10;
+    if (req_glist)
+        rdef_cdb[1] |= 0x8;
+    sg_put_unaligned_be32(addr_desc_index, rdef_cdb + 2);
+    sg_put_unaligned_be32((uint32_t)mx_resp_len, rdef_cdb + 6);
+    if (vb) {
+        char b[128];
+
+        pr2ws("    %s cdb: %s\n", cdb_s,
+              sg_get_command_str(rdef_cdb, READ_DEFECT12_CMDLEN,
+                                 false, sizeof(b), b));
+    }
+
+    if (NULL == ((ptvp = create_pt_obj(cdb_s))))
+        return sg_convert_errno(ENOMEM);
+    set_scsi_pt_cdb(ptvp, rdef_cdb, sizeof(rdef_cdb));
+    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
+    set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
+    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, vb);
+    ret = sg_cmds_process_resp(ptvp, cdb_s, res, noisy, vb, &s_cat);
+    if (residp)
+        *residp = get_scsi_pt_resid(ptvp);
+    if (-1 == ret) {
+        if (get_scsi_pt_transport_err(ptvp))
+            ret = SG_LIB_TRANSPORT_ERROR;
+        else
+            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
+    } else if (-2 == ret) {
+        switch (s_cat) {
+        case SG_LIB_CAT_RECOVERED:
+        case SG_LIB_CAT_NO_SENSE:
+            ret = 0;
+            break;
+        default:
+            ret = s_cat;
+            break;
+        }
+    } else {
+        if ((vb > 2) && (ret > 0)) {
+            pr2ws("    %s: response%s\n", cdb_s,
+                  (ret > 256 ? ", first 256 bytes" : ""));
+            hex2stderr((const uint8_t *)resp, (ret > 256 ? 256 : ret), -1);
+        }
+        ret = 0;
+    }
+    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
 /* Invokes a SCSI READ MEDIA SERIAL NUMBER command. Return of 0 -> success,
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
@@ -1797,13 +2074,14 @@ sg_ll_verify16(int sg_fd, int vrprotect, bool dpo, int bytchk, uint64_t llba,
  * data may be placed in *sensep in which case sensep[0]==0x70, prior to
  * SAT-2 descriptor sense format was required (i.e. sensep[0]==0x72).
  */
-int
-sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
-             int timeout_secs, void * dinp, void * doutp, int dlen,
-             uint8_t * sensep, int max_sense_len,
-             uint8_t * ata_return_dp, int max_ata_return_len,
-             int * residp, int vb)
+static int
+sg_ll_ata_pt_com(struct sg_pt_base * ptvp, int sg_fd, const uint8_t * cdbp,
+                 int cdb_len, int timeout_secs, void * dinp, void * doutp,
+                 int dlen, uint8_t * sensep, int max_sense_len,
+                 uint8_t * ata_return_dp, int max_ata_return_len,
+                 int * residp, int vb)
 {
+    bool ptvp_given = false;
     int k, res, slen;
     int ret = -1;
     uint8_t apt_cdb[ATA_PT_32_CMDLEN];
@@ -1811,7 +2089,6 @@ sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
     uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
     uint8_t * sp;
     const uint8_t * bp;
-    struct sg_pt_base * ptvp;
     const char * cnamep;
     char b[256];
 
@@ -1867,7 +2144,11 @@ sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
             hex2stderr(apt_cdb, cdb_len, -1);
         }
     }
-    if (NULL == ((ptvp = create_pt_obj(cnamep))))
+    if (ptvp) {
+        ptvp_given = true;
+        clear_scsi_pt_obj(ptvp);        /* keeps the device file handle */
+        sg_fd = -1;
+    } else if (NULL == ((ptvp = create_pt_obj(cnamep))))
         return -1;
     set_scsi_pt_cdb(ptvp, apt_cdb, cdb_len);
     set_scsi_pt_sense(ptvp, sp, slen);
@@ -1975,10 +2256,40 @@ sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
     }
 
 out:
-    destruct_scsi_pt_obj(ptvp);
+    if (! ptvp_given)
+        destruct_scsi_pt_obj(ptvp);
     return ret;
 }
 
+int
+sg_ll_ata_pt(int sg_fd, const uint8_t * cdbp, int cdb_len,
+             int timeout_secs, void * dinp, void * doutp, int dlen,
+             uint8_t * sensep, int max_sense_len,
+             uint8_t * ata_return_dp, int max_ata_return_len,
+             int * residp, int vb)
+{
+    return sg_ll_ata_pt_com(NULL, sg_fd, cdbp, cdb_len, timeout_secs, dinp,
+                            doutp, dlen, sensep, max_sense_len,
+                            ata_return_dp, max_ata_return_len, residp, vb);
+}
+
+int
+sg_ll_ata_pt_pt(struct sg_pt_base * ptp, const uint8_t * cdbp, int cdb_len,
+                int timeout_secs, void * dinp, void * doutp, int dlen,
+                uint8_t * sensep, int max_sense_len,
+                uint8_t * ata_return_dp, int max_ata_return_len,
+                int * residp, int vb)
+{
+    if (NULL == ptp) {
+        if (vb)
+            pr2ws("%s: NULL pt object\n", __func__);
+        return -1;
+    }
+    return sg_ll_ata_pt_com(ptp, -1, cdbp, cdb_len, timeout_secs, dinp,
+                            doutp, dlen, sensep, max_sense_len,
+                            ata_return_dp, max_ata_return_len, residp, vb);
+}
+
 /* Invokes a SCSI READ BUFFER(10) command (SPC). Return of 0 -> success
  * various SG_LIB_CAT_* positive values or -1 -> other errors */
 int
@@ -2642,3 +2953,231 @@ fini:
     destruct_scsi_pt_obj(ptvp);
     return ret;
 }
+
+/* Command timeouts, per opcode and service action, as reported by REPORT
+ * SUPPORTED OPERATION CODES (RSOC) with the RCTD bit set. */
+struct sg_cmd_to_elem {
+    uint8_t opcode;
+    bool sa_valid;
+    uint16_t sa;
+    uint32_t nominal;           /* in seconds, 0 -> not reported */
+    uint32_t recommended;       /* in seconds, 0 -> not reported */
+};
+
+struct sg_cmd_timeouts {
+    int num;                    /* number of elements in arr */
+    struct sg_cmd_to_elem arr[];        /* sorted by opcode then sa */
+};
+
+#define RSOC_SA 0xc
+#define RSOC_CMDLEN 12
+#define RSOC_INIT_RESP_LEN 8192
+#define RSOC_MAX_RESP_LEN (1024 * 1024)
+#define RSOC_CMD_DESC_LEN 8
+#define RSOC_CTD_LEN 12         /* command timeouts descriptor */
+
+static int
+rsoc_all_rctd(int sg_fd, uint8_t * resp, int alloc_len, int * act_lenp,
+              bool noisy, int vb)
+{
+    static const char * const cdb_s = "Report supported operation codes";
+    int res, s_cat, ret;
+    uint8_t rsocCmd[RSOC_CMDLEN];
+    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
+    struct sg_pt_base * ptvp;
+
+    memset(rsocCmd, 0, sizeof(rsocCmd));
+    rsocCmd[0] = MAINTENANCE_IN_CMD;
+    rsocCmd[1] = RSOC_SA;
+    rsocCmd[2] = 0x80;          /* RCTD=1, REPORTING OPTIONS=0 (all) */
+    sg_put_unaligned_be32((uint32_t)alloc_len, rsocCmd + 6);
+    if (vb) {
+        char b[128];
+
+        pr2ws("    %s cdb: %s\n", cdb_s,
+              sg_get_command_str(rsocCmd, RSOC_CMDLEN, false, sizeof(b),
+                                 b));
+    }
+
+    if (NULL == ((ptvp = create_pt_obj(cdb_s))))
+        return sg_convert_errno(ENOMEM);
+    set_scsi_pt_cdb(ptvp, rsocCmd, sizeof(rsocCmd));
+    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
+    set_scsi_pt_data_in(ptvp, resp, alloc_len);
+    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, vb);
+    ret = sg_cmds_process_resp(ptvp, cdb_s, res, noisy, vb, &s_cat);
+    if (-1 == ret) {
+        if (get_scsi_pt_transport_err(ptvp))
+            ret = SG_LIB_TRANSPORT_ERROR;
+        else
+            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
+    } else if (-2 == ret) {
+        switch (s_cat) {
+        case SG_LIB_CAT_RECOVERED:
+        case SG_LIB_CAT_NO_SENSE:
+            ret = 0;
+            break;
+        default:
+            ret = s_cat;
+            break;
+        }
+    } else {
+        *act_lenp = ret;
+        ret = 0;
+    }
+    destruct_scsi_pt_obj(ptvp);
+    return ret;
+}
+
+static int
+cmd_to_elem_cmp(const void * left, const void * right)
+{
+    const struct sg_cmd_to_elem * lp = (const struct sg_cmd_to_elem *)left;
+    const struct sg_cmd_to_elem * rp = (const struct sg_cmd_to_elem *)right;
+
+    if (lp->opcode != rp->opcode)
+        return (lp->opcode < rp->opcode) ? -1 : 1;
+    if (lp->sa != rp->sa)
+        return (lp->sa < rp->sa) ? -1 : 1;
+    return 0;
+}
+
+int
+sg_cmd_timeouts_fetch(int sg_fd, struct sg_cmd_timeouts ** ctpp, bool noisy,
+                      int vb)
+{
+    int k, n, res, desc_len;
+    int alloc_len = RSOC_INIT_RESP_LEN;
+    int act_len = 0;
+    int num = 0;
+    uint32_t cd_len;
+    const uint8_t * bp;
+    uint8_t * resp = NULL;
+    uint8_t * free_resp = NULL;
+    struct sg_cmd_timeouts * ctp;
+    struct sg_cmd_to_elem * ep;
+
+    if (NULL == ctpp)
+        return SG_LIB_SYNTAX_ERROR;
+    *ctpp = NULL;
+    while (true) {
+        resp = sg_memalign(alloc_len, 0, &free_resp, false);
+        if (NULL == resp)
+            return sg_convert_errno(ENOMEM);
+        res = rsoc_all_rctd(sg_fd, resp, alloc_len, &act_len, noisy, vb);
+        if (res)
+            goto fini;
+        if (act_len < 4) {
+            res = SG_LIB_CAT_MALFORMED;
+            goto fini;
+        }
+        cd_len = sg_get_unaligned_be32(resp + 0);
+        if ((cd_len + 4 <= (uint32_t)alloc_len) ||
+            (alloc_len >= RSOC_MAX_RESP_LEN))
+            break;
+        /* response was truncated, try again with the length it wants */
+        alloc_len = (cd_len + 4 > RSOC_MAX_RESP_LEN) ? RSOC_MAX_RESP_LEN :
+                                                       (int)cd_len + 4;
+        free(free_resp);
+        free_resp = NULL;
+    }
+    if (cd_len + 4 > (uint32_t)act_len)
+        cd_len = act_len - 4;
+
+    /* first pass counts descriptors, second fills in the table */
+    for (n = 0; n < 2; ++n) {
+        for (k = 0, bp = resp + 4; k + RSOC_CMD_DESC_LEN <= (int)cd_len;
+             k += desc_len, bp += desc_len) {
+            bool ctdp = !! (0x2 & bp[5]);
+
+            desc_len = RSOC_CMD_DESC_LEN + (ctdp ? RSOC_CTD_LEN : 0);
+            if (k + desc_len > (int)cd_len)
+                break;
+            if (0 == n) {
+                ++num;
+                continue;
+            }
+            ep = ctp->arr + ctp->num++;
+            ep->opcode = bp[0];
+            ep->sa_valid = !! (0x1 & bp[5]);
+            ep->sa = ep->sa_valid ? sg_get_unaligned_be16(bp + 2) : 0;
+            if (ctdp && (10 == sg_get_unaligned_be16(bp + 8))) {
+                ep->nominal = sg_get_unaligned_be32(bp + 12);
+                ep->recommended = sg_get_unaligned_be32(bp + 16);
+            }
+        }
+        if (0 == n) {
+            ctp = (struct sg_cmd_timeouts *)calloc(1, sizeof(*ctp) +
+                                (num * sizeof(struct sg_cmd_to_elem)));
+            if (NULL == ctp) {
+                res = sg_convert_errno(ENOMEM);
+                goto fini;
+            }
+        }
+    }
+    qsort(ctp->arr, ctp->num, sizeof(struct sg_cmd_to_elem),
+          cmd_to_elem_cmp);
+    if (vb > 1)
+        pr2ws("%s: %d commands reported\n", __func__, ctp->num);
+    *ctpp = ctp;
+fini:
+    free(free_resp);
+    return res;
+}
+
+static const struct sg_cmd_to_elem *
+cmd_to_elem_find(const struct sg_cmd_timeouts * ctp, int opcode, int sa)
+{
+    struct sg_cmd_to_elem key;
+
+    memset(&key, 0, sizeof(key));
+    key.opcode = (uint8_t)opcode;
+    key.sa = (sa > 0) ? (uint16_t)sa : 0;
+    return (const struct sg_cmd_to_elem *)bsearch(&key, ctp->arr, ctp->num,
+                                                  sizeof(key),
+                                                  cmd_to_elem_cmp);
+}
+
+bool
+sg_cmd_timeouts_find(const struct sg_cmd_timeouts * ctp, int opcode, int sa,
+                     uint32_t * nominalp, uint32_t * recommendedp)
+{
+    const struct sg_cmd_to_elem * ep;
+
+    if ((NULL == ctp) || (NULL == (ep = cmd_to_elem_find(ctp, opcode, sa))))
+        return false;
+    if (nominalp)
+        *nominalp = ep->nominal;
+    if (recommendedp)
+        *recommendedp = ep->recommended;
+    return true;
+}
+
+int
+sg_cmd_timeout_secs(const struct sg_cmd_timeouts * ctp, const uint8_t * cdbp,
+                    int cdb_len, int def_secs)
+{
+    int sa;
+    const struct sg_cmd_to_elem * ep;
+
+    if ((NULL == ctp) || (NULL == cdbp) || (cdb_len < 6))
+        return def_secs;
+    if (SG_VARIABLE_LENGTH_CMD == cdbp[0])
+        sa = (cdb_len >= 10) ? sg_get_unaligned_be16(cdbp + 8) : 0;
+    else
+        sa = cdbp[1] & 0x1f;
+    /* opcodes without service actions are held with sa=0 */
+    ep = cmd_to_elem_find(ctp, cdbp[0], 0);
+    if ((NULL == ep) || ep->sa_valid)
+        ep = cmd_to_elem_find(ctp, cdbp[0], sa);
+    if (ep && (ep->recommended > 0))
+        return (ep->recommended > INT32_MAX) ? INT32_MAX :
+                                               (int)ep->recommended;
+    return def_secs;
+}
+
+void
+sg_cmd_timeouts_free(struct sg_cmd_timeouts * ctp)
+{
+    free(ctp);
+}
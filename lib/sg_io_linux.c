@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 1999-2021 Douglas Gilbert.
+ * Copyright (c) 1999-2026 Douglas Gilbert.
  * All rights reserved.
  * Use of this source code is governed by a BSD-style
  * license that can be found in the BSD_LICENSE file.
@@ -7,12 +7,19 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+/* for realpath(), syscall() and MAP_ANONYMOUS with -std=c99 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -20,11 +27,17 @@
 
 #ifdef SG_LIB_LINUX
 
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+
 #include "sg_io_linux.h"
 #include "sg_pr2serr.h"
 
 
-/* Version 1.13 20210831 */
+/* Version 1.14 20261018 */
 
 
 void
@@ -232,4 +245,216 @@ sg_err_category_new(int scsi_status, int host_status, int driver_status,
     return SG_LIB_CAT_OTHER;
 }
 
+#define PROC_SCSI_SG_VERSION "/proc/scsi/sg/version"
+#define SYS_SCSI_SG_VERSION "/sys/module/sg/version"
+
+int
+sg_linux_driver_version(void)
+{
+    int ver = 0;
+    int j, k, l;
+    FILE * fp;
+    char b[96];
+
+    fp = fopen(PROC_SCSI_SG_VERSION, "r");
+    if (fp && fgets(b, sizeof(b) - 1, fp)) {
+        if (1 != sscanf(b, "%d", &ver))
+            ver = 0;
+    } else {
+        if (fp)
+            fclose(fp);
+        fp = fopen(SYS_SCSI_SG_VERSION, "r");
+        if (fp && fgets(b, sizeof(b) - 1, fp)) {
+            if (3 == sscanf(b, "%d.%d.%d", &j, &k, &l))
+                ver = (j * 10000) + (k * 100) + l;
+        }
+    }
+    if (fp)
+        fclose(fp);
+    return (ver > 0) ? ver : 0;
+}
+
+/* sysfs places each device below the device that connects it, so the
+ * first ancestor with a numa_node attribute is the host's (PCIe) function */
+int
+sg_linux_fd_numa_node(int fd, int vb)
+{
+    int node = -1;
+    char * cp;
+    FILE * fp;
+    struct stat a_st;
+    char b[PATH_MAX + sizeof("/numa_node")];
+    char rp[PATH_MAX];
+
+    if (fstat(fd, &a_st) < 0)
+        return -1;
+    if (S_ISCHR(a_st.st_mode) || S_ISBLK(a_st.st_mode))
+        snprintf(b, sizeof(b), "/sys/dev/%s/%u:%u",
+                 (S_ISCHR(a_st.st_mode) ? "char" : "block"),
+                 major(a_st.st_rdev), minor(a_st.st_rdev));
+    else        /* regular file: use the device holding its file system */
+        snprintf(b, sizeof(b), "/sys/dev/block/%u:%u", major(a_st.st_dev),
+                 minor(a_st.st_dev));
+    if (NULL == realpath(b, rp)) {
+        if (vb > 2)
+            pr2ws("%s: realpath(%s): %s\n", __func__, b,
+                  safe_strerror(errno));
+        return -1;
+    }
+    while ((cp = strrchr(rp, '/')) && (cp > rp)) {
+        snprintf(b, sizeof(b), "%s/numa_node", rp);
+        fp = fopen(b, "r");
+        if (fp) {
+            if (1 != fscanf(fp, "%d", &node))
+                node = -1;
+            fclose(fp);
+            if (vb > 2)
+                pr2ws("%s: %s contains %d\n", __func__, b, node);
+            break;
+        }
+        *cp = '\0';
+        if (0 == strcmp(rp, "/sys/devices"))
+            break;
+    }
+    return (node < 0) ? -1 : node;
+}
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+#define SG_HUGE_2M (1U << 21)
+#define SG_HUGE_1G (1U << 30)
+
+static uint32_t
+round_up(uint32_t num_bytes, uint32_t unit)
+{
+    uint64_t r = ((uint64_t)num_bytes + unit - 1) / unit * unit;
+
+    return (r > UINT32_MAX) ? 0 : (uint32_t)r;
+}
+
+/* Tries an explicit (hugetlbfs) mapping of huge pages of 1 << shift bytes,
+ * needs pages reserved in /proc/sys/vm/nr_hugepages (or the hugepages-*
+ * sysfs equivalents) */
+static uint8_t *
+huge_mmap(uint32_t num_bytes, int shift, uint32_t * alloc_lenp, int vb)
+{
+    uint32_t len = round_up(num_bytes, 1U << shift);
+    void * p;
+
+    if (0 == len)
+        return NULL;
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+             (shift << MAP_HUGE_SHIFT), -1, 0);
+    if (MAP_FAILED == p) {
+        if (vb > 1)
+            pr2ws("%s: %u MiB huge pages: %s\n", __func__,
+                  (1U << shift) >> 20, safe_strerror(errno));
+        return NULL;
+    }
+    *alloc_lenp = len;
+    return (uint8_t *)p;
+}
+
+uint8_t *
+sg_linux_alloc_buf(uint32_t num_bytes, bool huge, int numa_node,
+                   uint32_t * alloc_lenp, int vb)
+{
+    uint32_t len = 0;
+    uint32_t psz = sg_get_page_size();
+    uint8_t * bp = NULL;
+    void * p;
+
+    if (0 == num_bytes)
+        num_bytes = psz;
+    if (huge) {
+        int shift = 30;
+
+        if (num_bytes >= SG_HUGE_1G)
+            bp = huge_mmap(num_bytes, shift, &len, vb);
+        if (NULL == bp) {
+            shift = 21;
+            bp = huge_mmap(num_bytes, shift, &len, vb);
+        }
+        if (bp && vb)
+            pr2ws("%s: %u bytes in %u MiB huge pages\n", __func__, len,
+                  (1U << shift) >> 20);
+    }
+    if (NULL == bp) {
+        /* normal pages; 2 MiB multiple so transparent huge pages fit */
+        len = round_up(num_bytes, huge ? SG_HUGE_2M : psz);
+        if (0 == len)
+            return NULL;
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == p) {
+            pr2ws("%s: mmap(%u bytes): %s\n", __func__, len,
+                  safe_strerror(errno));
+            return NULL;
+        }
+        bp = (uint8_t *)p;
+#ifdef MADV_HUGEPAGE
+        if (huge) {
+            if (madvise(bp, len, MADV_HUGEPAGE) < 0) {
+                if (vb)
+                    pr2ws("%s: madvise(MADV_HUGEPAGE): %s\n", __func__,
+                          safe_strerror(errno));
+            } else if (vb)
+                pr2ws("%s: no huge pages reserved, %u bytes with "
+                      "transparent huge pages\n", __func__, len);
+        }
+#endif
+    }
+#ifdef SYS_mbind
+    if (numa_node >= 0) {
+        const int ulong_bits = 8 * sizeof(unsigned long);
+        unsigned long nodemask[1024 / (8 * sizeof(unsigned long))];
+
+        if (numa_node >= 1024) {
+            if (vb)
+                pr2ws("%s: NUMA node %d too large, not bound\n", __func__,
+                      numa_node);
+        } else {
+            memset(nodemask, 0, sizeof(nodemask));
+            nodemask[numa_node / ulong_bits] |= 1UL <<
+                                                (numa_node % ulong_bits);
+            /* maxnode is one more than the highest bit, as libnuma does */
+            if (syscall(SYS_mbind, bp, (unsigned long)len, MPOL_BIND,
+                        nodemask, (unsigned long)(8 * sizeof(nodemask) + 1),
+                        0) < 0) {
+                if (vb)
+                    pr2ws("%s: mbind(node=%d): %s\n", __func__, numa_node,
+                          safe_strerror(errno));
+            } else if (vb > 1)
+                pr2ws("%s: %u bytes bound to NUMA node %d\n", __func__,
+                      len, numa_node);
+        }
+    }
+#else
+    if ((numa_node >= 0) && vb)
+        pr2ws("%s: no mbind(2), NUMA node %d ignored\n", __func__,
+              numa_node);
+#endif
+    /* fault every page in now (anonymous maps are already zero) so that
+     * neither page faults nor placement happen during the first IOs */
+    memset(bp, 0, len);
+    *alloc_lenp = len;
+    return bp;
+}
+
+void
+sg_linux_free_buf(uint8_t * bp, uint32_t alloc_len)
+{
+    if (bp && (alloc_len > 0))
+        munmap(bp, alloc_len);
+}
+
 #endif  /* if SG_LIB_LINUX defined */
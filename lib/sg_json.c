@@ -23,6 +23,8 @@
 
 #define sgj_opts_ev "SG3_UTILS_JSON_OPTS"
 
+#define SGJ_DEF_ARENA_SZ (64 * 1024)
+
 /*
  * #define json_serialize_mode_multiline     0
  * #define json_serialize_mode_single_line   1
@@ -44,6 +46,67 @@ static const json_serialize_opts def_out_settings = {
 
 static int sgj_name_to_snake(const char * in, char * out, int maxlen_out);
 
+/* Fixed names used by the utilities with their snake_case equivalents */
+struct sgj_snake_t {
+    const char * name;
+    const char * sn_name;
+    int sn_len;
+};
+
+#include "sg_json_snake_tbl.h"
+
+/* Returns the arena that in-core tree nodes are taken from, or NULL if they
+ * are allocated individually with malloc() */
+static inline json_builder_arena *
+sgj_arena(const sgj_state * jsp)
+{
+    return (jsp && jsp->pr_as_json) ? (json_builder_arena *)jsp->arenap :
+                                      NULL;
+}
+
+/* In-core tree node constructors that use the arena (if any) of jsp */
+static inline json_value *
+sgj_object_new(const sgj_state * jsp)
+{
+    return json_object_new_ex(sgj_arena(jsp), 0);
+}
+
+static inline json_value *
+sgj_array_new(const sgj_state * jsp)
+{
+    return json_array_new_ex(sgj_arena(jsp), 0);
+}
+
+static inline json_value *
+sgj_str_len_new(const sgj_state * jsp, int vlen, const char * value)
+{
+    return json_string_new_length_ex(sgj_arena(jsp), vlen, value);
+}
+
+static inline json_value *
+sgj_string_new(const sgj_state * jsp, const char * value)
+{
+    return json_string_new_length_ex(sgj_arena(jsp), strlen(value), value);
+}
+
+static inline json_value *
+sgj_integer_new(const sgj_state * jsp, int64_t value)
+{
+    return json_integer_new_ex(sgj_arena(jsp), value);
+}
+
+static inline json_value *
+sgj_boolean_new(const sgj_state * jsp, bool value)
+{
+    return json_boolean_new_ex(sgj_arena(jsp), value);
+}
+
+static inline json_value *
+sgj_null_new(const sgj_state * jsp)
+{
+    return json_null_new_ex(sgj_arena(jsp));
+}
+
 
 static bool
 sgj_parse_opts(sgj_state * jsp, const char * j_optarg)
@@ -86,6 +149,9 @@ sgj_parse_opts(sgj_state * jsp, const char * j_optarg)
         case '8':
             jsp->pr_indent_size = 8;
             break;
+        case 'c':
+            jsp->pr_cbor = ! prev_negate;
+            break;
         case 'e':
             jsp->pr_exit_status = ! prev_negate;
             break;
@@ -119,6 +185,9 @@ sgj_parse_opts(sgj_state * jsp, const char * j_optarg)
         case 'v':
             ++jsp->verbose;
             break;
+        case 'w':
+            jsp->pr_stream = ! prev_negate;
+            break;
         case 'y':
             jsp->pr_format = 'g';
             break;
@@ -158,6 +227,8 @@ sg_json_usage(int char_if_not_j, char * b, int blen)
     n += sg_scn3pr(b, blen, n, "      8    tab pretty output to 8 spaces\n");
     if (n >= (blen - 1))
         goto fini;
+    n += sg_scn3pr(b, blen, n, "      c    binary CBOR output (RFC 8949) "
+                   "rather than JSON text\n");
     n += sg_scn3pr(b, blen, n, "      e    show 'exit_status' field\n");
     n += sg_scn3pr(b, blen, n, "      h    show 'hex' fields\n");
     n += sg_scn3pr(b, blen, n,
@@ -176,6 +247,8 @@ sg_json_usage(int char_if_not_j, char * b, int blen)
                    "      s    show string output (usually fields named "
                    "'meaning')\n");
     n += sg_scn3pr(b, blen, n, "      v    make JSON output more verbose\n");
+    n += sg_scn3pr(b, blen, n, "      w    write JSON output as it is "
+                   "decoded (streamed)\n");
     n += sg_scn3pr(b, blen, n,
                    "      - | ~ | !    toggle next letter setting\n");
 
@@ -194,12 +267,14 @@ fini:
 static char *
 sg_json_settings(sgj_state * jsp, char * b, int blen)
 {
-    snprintf(b, blen, "%d%se%sh%sk%sl%sn%so%sp%ss%sv", jsp->pr_indent_size,
-             jsp->pr_exit_status ? "" : "-", jsp->pr_hex ? "" : "-",
-             jsp->pr_packed ? "" : "-", jsp->pr_leadin ? "" : "-",
-             jsp->pr_name_ex ? "" : "-", jsp->pr_out_hr ? "" : "-",
-             jsp->pr_pretty ? "" : "-", jsp->pr_string ? "" : "-",
-             jsp->verbose ? "" : "-");
+    snprintf(b, blen, "%d%sc%se%sh%sk%sl%sn%so%sp%ss%sv%sw",
+             jsp->pr_indent_size, jsp->pr_cbor ? "" : "-",
+             jsp->pr_exit_status ? "" : "-",
+             jsp->pr_hex ? "" : "-", jsp->pr_packed ? "" : "-",
+             jsp->pr_leadin ? "" : "-", jsp->pr_name_ex ? "" : "-",
+             jsp->pr_out_hr ? "" : "-", jsp->pr_pretty ? "" : "-",
+             jsp->pr_string ? "" : "-", jsp->verbose ? "" : "-",
+             jsp->pr_stream ? "" : "-");
     return b;
 }
 
@@ -207,6 +282,7 @@ static void
 sgj_def_opts(sgj_state * jsp)
 {
     jsp->pr_as_json = true;
+    jsp->pr_cbor = false;
     jsp->pr_exit_status = true;
     jsp->pr_hex = false;
     jsp->pr_leadin = true;
@@ -214,6 +290,7 @@ sgj_def_opts(sgj_state * jsp)
     jsp->pr_name_ex = false;
     jsp->pr_packed = false;     /* 'k' control character, needs '-p' */
     jsp->pr_pretty = true;
+    jsp->pr_stream = false;     /* 'w' control character, needs tool support */
     jsp->pr_string = true;
     jsp->pr_format = 0;
     jsp->first_bad_char = 0;
@@ -232,6 +309,9 @@ sgj_init_state(sgj_state * jsp, const char * j_optarg)
     jsp->basep = NULL;
     jsp->out_hrp = NULL;
     jsp->userp = NULL;
+    jsp->streamp = NULL;
+    jsp->arena_sz = SGJ_DEF_ARENA_SZ;
+    jsp->arenap = NULL;
 
     cp = getenv(sgj_opts_ev);
     if (cp) {
@@ -244,6 +324,298 @@ sgj_init_state(sgj_state * jsp, const char * j_optarg)
     return j_optarg ? sgj_parse_opts(jsp, j_optarg) : true;
 }
 
+/* Streamed JSON output. Rather than building the in-core tree, each
+ * name-value pair is written to a (buffered) FILE stream as it is added.
+ * Objects and arrays that are still open are kept on a small stack of
+ * frames; a pointer to a frame is what the sgj_* functions return (as an
+ * sgj_opaque_p) in place of a pointer into the tree. Adding to a frame
+ * closes any frames above it on that stack. The output format matches
+ * json_serialize_ex() for the same JO settings. */
+
+#define SGJ_STREAM_MAX_DEPTH 32
+
+struct sgj_stream_frame_t {
+    bool is_array;
+    int count;          /* number of members written so far */
+};
+
+struct sgj_stream_t {
+    FILE * fp;
+    int depth;          /* number of open frames, frame[0] is the root */
+    int mode;           /* json_serialize_mode_* */
+    int indent_size;
+    json_serialize_opts out_settings;
+    struct sgj_stream_frame_t frame[SGJ_STREAM_MAX_DEPTH];
+};
+
+static void
+sgj_out_settings(const sgj_state * jsp, json_serialize_opts * osp)
+{
+    memcpy(osp, &def_out_settings, sizeof(*osp));
+    if (jsp->pr_indent_size != def_out_settings.indent_size)
+        osp->indent_size = jsp->pr_indent_size;
+    if (! jsp->pr_pretty)
+        osp->mode = jsp->pr_packed ? json_serialize_mode_packed :
+                                     json_serialize_mode_single_line;
+}
+
+/* Returns the index of the frame that jop (or jsp->basep if jop is NULL)
+ * refers to. Returns -1 if not streaming or jop is not a frame (e.g. it is
+ * an unattached object) in which case the in-core tree should be used. */
+static int
+sgj_stream_idx(const sgj_state * jsp, sgj_opaque_p jop)
+{
+    const struct sgj_stream_t * ssp = (const struct sgj_stream_t *)
+                                      jsp->streamp;
+    uintptr_t p, first;
+
+    if (NULL == ssp)
+        return -1;
+    p = (uintptr_t)(jop ? jop : jsp->basep);
+    first = (uintptr_t)&ssp->frame[0];
+    if ((p < first) ||
+        (p >= (uintptr_t)&ssp->frame[SGJ_STREAM_MAX_DEPTH]))
+        return -1;
+    return (int)((p - first) / sizeof(ssp->frame[0]));
+}
+
+/* Writes str, which is len bytes long, with the same escapes as
+ * serialize_string() in sg_json_builder.c */
+static void
+sgj_stream_esc(FILE * fp, const char * str, int len)
+{
+    int k, j;
+    char c;
+
+    for (k = 0, j = 0; k < len; ++k) {
+        c = str[k];
+        switch (c) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            c = 'b';
+            break;
+        case '\f':
+            c = 'f';
+            break;
+        case '\n':
+            c = 'n';
+            break;
+        case '\r':
+            c = 'r';
+            break;
+        case '\t':
+            c = 't';
+            break;
+        default:
+            continue;
+        }
+        if (k > j)
+            fwrite(str + j, 1, k - j, fp);
+        putc('\\', fp);
+        putc(c, fp);
+        j = k + 1;
+    }
+    if (k > j)
+        fwrite(str + j, 1, k - j, fp);
+}
+
+static void
+sgj_stream_newline(struct sgj_stream_t * ssp, int level)
+{
+    int k;
+
+    if (json_serialize_mode_multiline != ssp->mode)
+        return;
+    putc('\n', ssp->fp);
+    for (k = level * ssp->indent_size; k > 0; --k)
+        putc(' ', ssp->fp);
+}
+
+static void
+sgj_stream_close_top(struct sgj_stream_t * ssp)
+{
+    struct sgj_stream_frame_t * frp;
+
+    if (ssp->depth < 1)
+        return;
+    frp = &ssp->frame[--ssp->depth];
+    if (0 == frp->count)
+        fputs(frp->is_array ? "[]" : "{}", ssp->fp);
+    else {
+        sgj_stream_newline(ssp, ssp->depth);
+        if (json_serialize_mode_single_line == ssp->mode)
+            putc(' ', ssp->fp);
+        putc(frp->is_array ? ']' : '}', ssp->fp);
+    }
+}
+
+/* Closes frames above idx, then writes the separator and name (if the
+ * frame is an object) of a new member of frame idx. Returns false if
+ * frame idx has already been closed or a name is missing. */
+static bool
+sgj_stream_member(sgj_state * jsp, int idx, const char * sn_name)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+    struct sgj_stream_frame_t * frp;
+
+    if (idx >= ssp->depth) {
+        if (jsp->verbose)
+            pr2ws("%s: frame %d already closed, '%s' dropped\n", __func__,
+                  idx, sn_name ? sn_name : "");
+        return false;
+    }
+    frp = &ssp->frame[idx];
+    if ((! frp->is_array) && (NULL == sn_name))
+        return false;
+    while (ssp->depth > idx + 1)
+        sgj_stream_close_top(ssp);
+    if (0 == frp->count) {
+        putc(frp->is_array ? '[' : '{', ssp->fp);
+        if (json_serialize_mode_single_line == ssp->mode)
+            putc(' ', ssp->fp);
+    } else {
+        putc(',', ssp->fp);
+        if (json_serialize_mode_single_line == ssp->mode)
+            putc(' ', ssp->fp);
+    }
+    sgj_stream_newline(ssp, idx + 1);
+    ++frp->count;
+    if (! frp->is_array) {
+        putc('"', ssp->fp);
+        sgj_stream_esc(ssp->fp, sn_name, strlen(sn_name));
+        putc('"', ssp->fp);
+        putc(':', ssp->fp);
+        if (json_serialize_mode_packed != ssp->mode)
+            putc(' ', ssp->fp);
+    }
+    return true;
+}
+
+static sgj_opaque_p
+sgj_stream_str(sgj_state * jsp, int idx, const char * sn_name,
+               const char * value, int vlen)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+
+    if (! sgj_stream_member(jsp, idx, sn_name))
+        return NULL;
+    putc('"', ssp->fp);
+    sgj_stream_esc(ssp->fp, value, vlen);
+    putc('"', ssp->fp);
+    return &ssp->frame[idx];
+}
+
+static sgj_opaque_p
+sgj_stream_int(sgj_state * jsp, int idx, const char * sn_name, int64_t value)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+
+    if (! sgj_stream_member(jsp, idx, sn_name))
+        return NULL;
+    fprintf(ssp->fp, "%" PRId64, value);
+    return &ssp->frame[idx];
+}
+
+static sgj_opaque_p
+sgj_stream_bool(sgj_state * jsp, int idx, const char * sn_name, bool value)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+
+    if (! sgj_stream_member(jsp, idx, sn_name))
+        return NULL;
+    fputs(value ? "true" : "false", ssp->fp);
+    return &ssp->frame[idx];
+}
+
+/* Opens a new (empty) object or array frame as a member of frame idx.
+ * Returns a pointer to the new frame or NULL. */
+static sgj_opaque_p
+sgj_stream_open(sgj_state * jsp, int idx, const char * sn_name,
+                bool is_array)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+    struct sgj_stream_frame_t * frp;
+
+    if (idx + 1 >= SGJ_STREAM_MAX_DEPTH) {
+        pr2ws("%s: nested too deeply, '%s' dropped\n", __func__,
+              sn_name ? sn_name : "");
+        return NULL;
+    }
+    if (! sgj_stream_member(jsp, idx, sn_name))
+        return NULL;
+    frp = &ssp->frame[ssp->depth++];
+    frp->is_array = is_array;
+    frp->count = 0;
+    return frp;
+}
+
+/* Serializes the unattached in-core value pointed to by jvp as a member of
+ * frame idx, then frees it. */
+static sgj_opaque_p
+sgj_stream_jv(sgj_state * jsp, int idx, const char * sn_name,
+              json_value * jvp)
+{
+    struct sgj_stream_t * ssp = (struct sgj_stream_t *)jsp->streamp;
+    size_t len;
+    char * b;
+    char * cp;
+    char * np;
+    sgj_opaque_p resp = NULL;
+
+    if (! sgj_stream_member(jsp, idx, sn_name))
+        goto fini;
+    len = json_measure_ex(jvp, ssp->out_settings);
+    b = (char *)malloc(len);
+    if (NULL == b) {
+        fputs("null", ssp->fp);
+        goto fini;
+    }
+    json_serialize_ex(b, jvp, ssp->out_settings);
+    /* re-indent each line after the first to the depth of frame idx */
+    for (cp = b; (np = strchr(cp, '\n')); cp = np + 1) {
+        fwrite(cp, 1, np + 1 - cp, ssp->fp);
+        for (len = (idx + 1) * ssp->indent_size; len > 0; --len)
+            putc(' ', ssp->fp);
+    }
+    fputs(cp, ssp->fp);
+    free(b);
+    resp = &ssp->frame[idx];
+fini:
+    json_builder_free(jvp);
+    return resp;
+}
+
+/* Closes all open frames, terminates the output with a LF and flushes. */
+static void
+sgj_stream_end(struct sgj_stream_t * ssp)
+{
+    if (ssp->depth < 1)
+        return;
+    while (ssp->depth > 0)
+        sgj_stream_close_top(ssp);
+    putc('\n', ssp->fp);
+    fflush(ssp->fp);
+}
+
+/* Pushes jvp into the in-core tree at jop or, if streaming to that point,
+ * writes it out. Either way jvp is 'owned' by this call. */
+static sgj_opaque_p
+sgj_push_jv(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
+            json_value * jvp)
+{
+    int idx = sgj_stream_idx(jsp, jop);
+
+    if (idx >= 0)
+        return sgj_stream_jv(jsp, idx, sn_name, jvp);
+    if (sn_name)
+        return json_object_push((json_value *)(jop ? jop : jsp->basep),
+                                sn_name, jvp);
+    else
+        return json_array_push((json_value *)(jop ? jop : jsp->basep), jvp);
+}
+
 sgj_opaque_p
 sgj_start_r(const char * util_name, const char * ver_str, int argc,
             char *argv[], sgj_state * jsp)
@@ -256,39 +628,41 @@ sgj_start_r(const char * util_name, const char * ver_str, int argc,
 
     if (NULL == jsp)
         return NULL;
-    jvp = json_object_new(0);
+    if (jsp->arena_sz && (NULL == jsp->arenap))
+        jsp->arenap = json_builder_arena_new(jsp->arena_sz);
+    jvp = sgj_object_new(jsp);
     if (NULL == jvp)
         return NULL;
 
     jsp->basep = jvp;
     if (jsp->pr_leadin) {
-        jap = json_array_new(0);
+        jap = sgj_array_new(jsp);
         if  (NULL == jap) {
             json_builder_free((json_value *)jvp);
             return NULL;
         }
         /* assume rest of json_*_new() calls succeed */
-        json_array_push((json_value *)jap, json_integer_new(1));
-        json_array_push((json_value *)jap, json_integer_new(0));
+        json_array_push((json_value *)jap, sgj_integer_new(jsp, 1));
+        json_array_push((json_value *)jap, sgj_integer_new(jsp, 0));
         json_object_push((json_value *)jvp, "json_format_version",
                          (json_value *)jap);
         if (util_name) {
-            jap = json_array_new(0);
+            jap = sgj_array_new(jsp);
             if (argv) {
                 for (k = 0; k < argc; ++k)
                     json_array_push((json_value *)jap,
-                                    json_string_new(argv[k]));
+                                    sgj_string_new(jsp, argv[k]));
             }
             jv2p = json_object_push((json_value *)jvp, "utility_invoked",
-                                    json_object_new(0));
+                                    sgj_object_new(jsp));
             json_object_push((json_value *)jv2p, "name",
-                             json_string_new(util_name));
+                             sgj_string_new(jsp, util_name));
             if (ver_str)
                 json_object_push((json_value *)jv2p, "version_date",
-                                 json_string_new(ver_str));
+                                 sgj_string_new(jsp, ver_str));
             else
                 json_object_push((json_value *)jv2p, "version_date",
-                                 json_string_new("0.0"));
+                                 sgj_string_new(jsp, "0.0"));
             json_object_push((json_value *)jv2p, "argv", jap);
         }
         if (jsp->verbose) {
@@ -296,22 +670,22 @@ sgj_start_r(const char * util_name, const char * ver_str, int argc,
             char b[32];
 
             json_object_push((json_value *)jv2p, "environment_variable_name",
-                             json_string_new(sgj_opts_ev));
+                             sgj_string_new(jsp, sgj_opts_ev));
             json_object_push((json_value *)jv2p, "environment_variable_value",
-                             json_string_new(cp ? cp : "no available"));
+                             sgj_string_new(jsp, cp ? cp : "no available"));
             sg_json_settings(jsp, b, sizeof(b));
             json_object_push((json_value *)jv2p, "json_options",
-                             json_string_new(b));
+                             sgj_string_new(jsp, b));
         }
     } else {
         if (jsp->pr_out_hr && util_name)
             jv2p = json_object_push((json_value *)jvp, "utility_invoked",
-                                    json_object_new(0));
+                                    sgj_object_new(jsp));
     }
     if (jsp->pr_out_hr && jv2p) {
         jsp->out_hrp = json_object_push((json_value *)jv2p,
                                          "plain_text_output",
-                                        json_array_new(0));
+                                        sgj_array_new(jsp));
         if (jsp->pr_leadin && (jsp->verbose > 3)) {
             char * bp = (char *)calloc(4096, 1);
 
@@ -325,6 +699,158 @@ sgj_start_r(const char * util_name, const char * ver_str, int argc,
     return jvp;
 }
 
+/* CBOR (RFC 8949) encoding of the in-core tree. Each data item starts with
+ * a head: the major type in the top 3 bits of the initial byte, then the
+ * argument (an integer, a length or a count) in the following 0, 1, 2, 4
+ * or 8 bytes, big endian. */
+#define SGJ_CBOR_UINT 0
+#define SGJ_CBOR_NINT 1
+#define SGJ_CBOR_BSTR 2
+#define SGJ_CBOR_TSTR 3
+#define SGJ_CBOR_ARRAY 4
+#define SGJ_CBOR_MAP 5
+#define SGJ_CBOR_TAG 6
+#define SGJ_CBOR_SIMPLE 7
+
+#define SGJ_CBOR_FALSE 20
+#define SGJ_CBOR_TRUE 21
+#define SGJ_CBOR_NULL 22
+#define SGJ_CBOR_SELF_DESCRIBE 55799    /* 0xd9d9f7 magic prefix */
+
+static void
+sgj_cbor_head(FILE * fp, int major, uint64_t val)
+{
+    int k, n;
+    uint8_t b[9];
+
+    b[0] = (uint8_t)(major << 5);
+    if (val < 24) {
+        b[0] |= (uint8_t)val;
+        n = 0;
+    } else if (val <= UINT8_MAX) {
+        b[0] |= 24;
+        n = 1;
+    } else if (val <= UINT16_MAX) {
+        b[0] |= 25;
+        n = 2;
+    } else if (val <= UINT32_MAX) {
+        b[0] |= 26;
+        n = 4;
+    } else {
+        b[0] |= 27;
+        n = 8;
+    }
+    for (k = n; k > 0; --k, val >>= 8)
+        b[k] = (uint8_t)(val & 0xff);
+    fwrite(b, 1, n + 1, fp);
+}
+
+static void
+sgj_cbor_str(FILE * fp, int major, const char * sp, unsigned int slen)
+{
+    sgj_cbor_head(fp, major, slen);
+    if (slen > 0)
+        fwrite(sp, 1, slen, fp);
+}
+
+static void
+sgj_cbor_value(FILE * fp, const json_value * jvp)
+{
+    unsigned int k;
+    uint64_t u;
+    uint8_t b[9];
+    union {
+        double d;
+        uint64_t u;
+    } du;
+
+    switch (jvp->type) {
+    case json_object:
+        sgj_cbor_head(fp, SGJ_CBOR_MAP, jvp->u.object.length);
+        for (k = 0; k < jvp->u.object.length; ++k) {
+            const json_object_entry * ep = jvp->u.object.values + k;
+
+            sgj_cbor_str(fp, SGJ_CBOR_TSTR, ep->name, ep->name_length);
+            sgj_cbor_value(fp, ep->value);
+        }
+        break;
+    case json_array:
+        sgj_cbor_head(fp, SGJ_CBOR_ARRAY, jvp->u.array.length);
+        for (k = 0; k < jvp->u.array.length; ++k)
+            sgj_cbor_value(fp, jvp->u.array.values[k]);
+        break;
+    case json_integer:
+        if (jvp->u.integer < 0) {   /* encoded as -1 - u */
+            u = (uint64_t)(-(jvp->u.integer + 1));
+            sgj_cbor_head(fp, SGJ_CBOR_NINT, u);
+        } else
+            sgj_cbor_head(fp, SGJ_CBOR_UINT, (uint64_t)jvp->u.integer);
+        break;
+    case json_double:     /* always as IEEE 754 double precision */
+        du.d = jvp->u.dbl;
+        b[0] = (SGJ_CBOR_SIMPLE << 5) | 27;
+        for (k = 8, u = du.u; k > 0; --k, u >>= 8)
+            b[k] = (uint8_t)(u & 0xff);
+        fwrite(b, 1, 9, fp);
+        break;
+    case json_string:
+        sgj_cbor_str(fp, json_builder_is_bytes(jvp) ? SGJ_CBOR_BSTR :
+                                                      SGJ_CBOR_TSTR,
+                     jvp->u.string.ptr, jvp->u.string.length);
+        break;
+    case json_boolean:
+        sgj_cbor_head(fp, SGJ_CBOR_SIMPLE, jvp->u.boolean ? SGJ_CBOR_TRUE :
+                                                            SGJ_CBOR_FALSE);
+        break;
+    case json_null:
+    default:
+        sgj_cbor_head(fp, SGJ_CBOR_SIMPLE, SGJ_CBOR_NULL);
+        break;
+    }
+}
+
+sgj_opaque_p
+sgj_start_stream_r(const char * util_name, const char * ver_str, int argc,
+                   char *argv[], FILE * fp, sgj_state * jsp)
+{
+    unsigned int k;
+    json_value * jvp;
+    json_value * rootp;
+    json_object_entry * ep;
+    struct sgj_stream_t * ssp;
+
+    rootp = (json_value *)sgj_start_r(util_name, ver_str, argc, argv, jsp);
+    if ((NULL == rootp) || (! jsp->pr_stream) || jsp->pr_out_hr ||
+        jsp->pr_cbor || (NULL == fp))
+        return rootp;
+    ssp = (struct sgj_stream_t *)calloc(1, sizeof(*ssp));
+    if (NULL == ssp)
+        return rootp;   /* fall back to building the in-core tree */
+    ssp->fp = fp;
+    sgj_out_settings(jsp, &ssp->out_settings);
+    ssp->mode = ssp->out_settings.mode;
+    ssp->indent_size = ssp->out_settings.indent_size;
+    ssp->depth = 1;     /* frame[0] is the root object */
+    jsp->streamp = ssp;
+    jsp->basep = &ssp->frame[0];
+    /* write out then discard the lead-in fields built by sgj_start_r() */
+    for (k = 0; k < rootp->u.object.length; ++k) {
+        ep = rootp->u.object.values + k;
+        jvp = ep->value;
+        jvp->parent = NULL;
+        sgj_stream_jv(jsp, 0, ep->name, jvp);
+        if (NULL == jsp->arenap)
+            free(ep->name);
+    }
+    rootp->u.object.length = 0;
+    json_builder_free(rootp);
+    /* from here on unattached objects are freed as soon as they are
+     * written out, an arena would only keep growing */
+    json_builder_arena_free((json_builder_arena *)jsp->arenap);
+    jsp->arenap = NULL;
+    return jsp->basep;
+}
+
 /* Serializes JSON in-memory tree and writes it to fp (usually stdout) .
  * jsp and fp are assumed to be valid, non-NULL pointers. */ 
 void
@@ -355,13 +881,19 @@ sgj_js2file_estr(sgj_state * jsp, sgj_opaque_p jop, int exit_status,
         }
         sgj_js_nv_istr(jsp, jop, "exit_status", exit_status, NULL, ccp);
     }
-    memcpy(&out_settings, &def_out_settings, sizeof(out_settings));
-    if (jsp->pr_indent_size != def_out_settings.indent_size)
-        out_settings.indent_size = jsp->pr_indent_size;
-    if (! jsp->pr_pretty)
-        out_settings.mode = jsp->pr_packed ? json_serialize_mode_packed :
-                                json_serialize_mode_single_line;
-
+    if (sgj_stream_idx(jsp, jop) >= 0) {
+        /* already written out, only the root (i.e. jop NULL) remains */
+        if (NULL == jop)
+            sgj_stream_end((struct sgj_stream_t *)jsp->streamp);
+        return;
+    }
+    if (jsp->pr_cbor) {
+        sgj_cbor_head(fp, SGJ_CBOR_TAG, SGJ_CBOR_SELF_DESCRIBE);
+        sgj_cbor_value(fp, jvp);
+        fflush(fp);
+        return;
+    }
+    sgj_out_settings(jsp, &out_settings);
     len = json_measure_ex(jvp, out_settings);
     if (len < 1)
         return;
@@ -383,12 +915,23 @@ sgj_js2file_estr(sgj_state * jsp, sgj_opaque_p jop, int exit_status,
 void
 sgj_finish(sgj_state * jsp)
 {
-    if (jsp && jsp->basep) {
+    if (jsp && jsp->streamp) {
+        /* output may be cut short, still want it to be valid JSON */
+        sgj_stream_end((struct sgj_stream_t *)jsp->streamp);
+        free(jsp->streamp);
+        jsp->streamp = NULL;
+        jsp->basep = NULL;
+        jsp->userp = NULL;
+    } else if (jsp && jsp->basep) {
         json_builder_free((json_value *)jsp->basep);
         jsp->basep = NULL;
         jsp->out_hrp = NULL;
         jsp->userp = NULL;
     }
+    if (jsp && jsp->arenap) {
+        json_builder_arena_free((json_builder_arena *)jsp->arenap);
+        jsp->arenap = NULL;
+    }
 }
 
 void
@@ -455,7 +998,7 @@ sgj_pr_hr(sgj_state * jsp, const char * fmt, ...)
             }
         }
         json_array_push((json_value *)jsp->out_hrp,
-                        json_string_new(step ? b + 1 : b));
+                        sgj_string_new(jsp, step ? b + 1 : b));
         va_end(args);
     } else {    /* do nothing, just consume arguments */
         va_start(args, fmt);
@@ -467,11 +1010,16 @@ sgj_pr_hr(sgj_state * jsp, const char * fmt, ...)
 sgj_opaque_p
 sgj_named_subobject_r(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name)
 {
+    int idx;
     sgj_opaque_p resp = NULL;
 
-    if (jsp && jsp->pr_as_json && sn_name)
+    if (jsp && jsp->pr_as_json && sn_name) {
+        idx = sgj_stream_idx(jsp, jop);
+        if (idx >= 0)
+            return sgj_stream_open(jsp, idx, sn_name, false);
         resp = json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                 sn_name, json_object_new(0));
+                                 sn_name, sgj_object_new(jsp));
+    }
     return resp;
 }
 
@@ -479,27 +1027,35 @@ sgj_opaque_p
 sgj_snake_named_subobject_r(sgj_state * jsp, sgj_opaque_p jop,
                             const char * conv2sname)
 {
+    sgj_opaque_p resp = NULL;
+
     if (jsp && jsp->pr_as_json && conv2sname) {
         int olen = strlen(conv2sname);
         char * sname = (char *)malloc(olen + 8);
-        int nlen = sgj_name_to_snake(conv2sname, sname, olen + 8);
 
-        if (nlen > 0)
-            return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sname, json_object_new(0));
+        if (NULL == sname)
+            return NULL;
+        if (sgj_name_to_snake(conv2sname, sname, olen + 8) > 0)
+            resp = sgj_named_subobject_r(jsp, jop, sname);
+        free(sname);
     }
-    return NULL;
+    return resp;
 }
 
 /* jop will 'own' returned value (if non-NULL) */
 sgj_opaque_p
 sgj_named_subarray_r(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name)
 {
+    int idx;
     sgj_opaque_p resp = NULL;
 
-    if (jsp && jsp->pr_as_json && sn_name)
+    if (jsp && jsp->pr_as_json && sn_name) {
+        idx = sgj_stream_idx(jsp, jop);
+        if (idx >= 0)
+            return sgj_stream_open(jsp, idx, sn_name, true);
         resp = json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                sn_name, json_array_new(0));
+                                sn_name, sgj_array_new(jsp));
+    }
     return resp;
 }
 
@@ -507,37 +1063,40 @@ sgj_opaque_p
 sgj_snake_named_subarray_r(sgj_state * jsp, sgj_opaque_p jop,
                            const char * conv2sname)
 {
+    sgj_opaque_p resp = NULL;
+
     if (jsp && jsp->pr_as_json && conv2sname) {
         int olen = strlen(conv2sname);
         char * sname = (char *)malloc(olen + 8);
-        int nlen = sgj_name_to_snake(conv2sname, sname, olen + 8);
 
-        if (nlen > 0)
-            return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sname, json_array_new(0));
+        if (NULL == sname)
+            return NULL;
+        if (sgj_name_to_snake(conv2sname, sname, olen + 8) > 0)
+            resp = sgj_named_subarray_r(jsp, jop, sname);
+        free(sname);
     }
-    return NULL;
+    return resp;
 }
 
 /* Newly created object is un-attached to jsp->basep tree */
 sgj_opaque_p
 sgj_new_unattached_object_r(sgj_state * jsp)
 {
-    return (jsp && jsp->pr_as_json) ? json_object_new(0) : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_object_new(jsp) : NULL;
 }
 
 /* Newly created array is un-attached to jsp->basep tree */
 sgj_opaque_p
 sgj_new_unattached_array_r(sgj_state * jsp)
 {
-    return (jsp && jsp->pr_as_json) ? json_array_new(0) : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_array_new(jsp) : NULL;
 }
 
 /* Newly created string is un-attached to jsp->basep tree */
 sgj_opaque_p
 sgj_new_unattached_string_r(sgj_state * jsp, const char * value)
 {
-    return (jsp && jsp->pr_as_json) ? json_string_new(value) : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_string_new(jsp, value) : NULL;
 }
 
 /* Newly created string with length object is un-attached to jsp->basep
@@ -545,7 +1104,7 @@ sgj_new_unattached_string_r(sgj_state * jsp, const char * value)
 sgj_opaque_p
 sgj_new_unattached_str_len_r(sgj_state * jsp, const char * value, int vlen)
 {
-    return (jsp && jsp->pr_as_json) ? json_string_new_length(vlen, value) :
+    return (jsp && jsp->pr_as_json) ? sgj_str_len_new(jsp, vlen, value) :
                                       NULL;
 }
 
@@ -553,21 +1112,21 @@ sgj_new_unattached_str_len_r(sgj_state * jsp, const char * value, int vlen)
 sgj_opaque_p
 sgj_new_unattached_integer_r(sgj_state * jsp, uint64_t value)
 {
-    return (jsp && jsp->pr_as_json) ? json_integer_new(value) : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_integer_new(jsp, value) : NULL;
 }
 
 /* Newly created boolean object is un-attached to jsp->basep tree */
 sgj_opaque_p
 sgj_new_unattached_bool_r(sgj_state * jsp, bool value)
 {
-    return (jsp && jsp->pr_as_json) ? json_boolean_new(value) : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_boolean_new(jsp, value) : NULL;
 }
 
 /* Newly created null object is un-attached to jsp->basep tree */
 sgj_opaque_p
 sgj_new_unattached_null_r(sgj_state * jsp)
 {
-    return (jsp && jsp->pr_as_json) ? json_null_new() : NULL;
+    return (jsp && jsp->pr_as_json) ? sgj_null_new(jsp) : NULL;
 }
 
 sgj_opaque_p
@@ -575,12 +1134,16 @@ sgj_js_nv_s(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
             const char * value)
 {
     if (jsp && jsp->pr_as_json && value) {
+        int idx = sgj_stream_idx(jsp, jop);
+
+        if (idx >= 0)
+            return sgj_stream_str(jsp, idx, sn_name, value, strlen(value));
         if (sn_name)
             return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sn_name, json_string_new(value));
+                                    sn_name, sgj_string_new(jsp, value));
         else
             return json_array_push((json_value *)(jop ? jop : jsp->basep),
-                                   json_string_new(value));
+                                   sgj_string_new(jsp, value));
     } else
         return NULL;
 }
@@ -589,19 +1152,22 @@ sgj_opaque_p
 sgj_js_nv_s_len(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
                 const char * value, int vlen)
 {
-    int k;
+    int k, idx;
 
     if (jsp && jsp->pr_as_json && value && (vlen >= 0)) {
         for (k = 0; k < vlen; ++k) {    /* don't want '\0' in value string */
             if (0 == value[k])
                 break;
         }
+        idx = sgj_stream_idx(jsp, jop);
+        if (idx >= 0)
+            return sgj_stream_str(jsp, idx, sn_name, value, k);
         if (sn_name)
             return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sn_name, json_string_new_length(k, value));
+                                    sn_name, sgj_str_len_new(jsp, k, value));
         else
             return json_array_push((json_value *)(jop ? jop : jsp->basep),
-                                   json_string_new_length(k, value));
+                                   sgj_str_len_new(jsp, k, value));
     } else
         return NULL;
 }
@@ -658,12 +1224,16 @@ sgj_js_nv_i(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
             int64_t value)
 {
     if (jsp && jsp->pr_as_json) {
+        int idx = sgj_stream_idx(jsp, jop);
+
+        if (idx >= 0)
+            return sgj_stream_int(jsp, idx, sn_name, value);
         if (sn_name)
             return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sn_name, json_integer_new(value));
+                                    sn_name, sgj_integer_new(jsp, value));
         else
             return json_array_push((json_value *)(jop ? jop : jsp->basep),
-                                   json_integer_new(value));
+                                   sgj_integer_new(jsp, value));
     }
     else
         return NULL;
@@ -674,29 +1244,29 @@ sgj_js_nv_b(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
             bool value)
 {
     if (jsp && jsp->pr_as_json) {
+        int idx = sgj_stream_idx(jsp, jop);
+
+        if (idx >= 0)
+            return sgj_stream_bool(jsp, idx, sn_name, value);
         if (sn_name)
             return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sn_name, json_boolean_new(value));
+                                    sn_name, sgj_boolean_new(jsp, value));
         else
             return json_array_push((json_value *)(jop ? jop : jsp->basep),
-                                   json_boolean_new(value));
+                                   sgj_boolean_new(jsp, value));
     } else
         return NULL;
 }
 
-/* jop will 'own' ua_jop (if returned value is non-NULL) */
+/* jop will 'own' ua_jop (if returned value is non-NULL). When streaming
+ * ua_jop is written out and freed by this call. */
 sgj_opaque_p
 sgj_js_nv_o(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
             sgj_opaque_p ua_jop)
 {
-    if (jsp && jsp->pr_as_json && ua_jop) {
-        if (sn_name)
-            return json_object_push((json_value *)(jop ? jop : jsp->basep),
-                                    sn_name, (json_value *)ua_jop);
-        else
-            return json_array_push((json_value *)(jop ? jop : jsp->basep),
-                                   (json_value *)ua_jop);
-    } else
+    if (jsp && jsp->pr_as_json && ua_jop)
+        return sgj_push_jv(jsp, jop, sn_name, (json_value *)ua_jop);
+    else
         return NULL;
 }
 
@@ -807,8 +1377,7 @@ sgj_js_nv_s_nex(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
     as_nex = jsp->pr_name_ex && nex_s;
     if ((NULL == val_s) && (! as_nex))
         /* corner case: assume jop is an array */
-        json_array_push((json_value *)(jop ? jop : jsp->basep),
-                         json_string_new(sn_name));
+        sgj_push_jv(jsp, jop, NULL, sgj_string_new(jsp, sn_name));
     else if (NULL == val_s)
         sgj_js_nv_s(jsp, jop, sn_name, nex_s);
     else if (! as_nex)
@@ -855,6 +1424,17 @@ sgj_js_nv_hex_bytes(sgj_state * jsp, sgj_opaque_p jop, const char * sn_name,
 
     if ((NULL == jsp) || (! jsp->pr_as_json))
         return;
+    if (jsp->pr_cbor) {     /* native byte string, no hex text needed */
+        json_value * jvp = json_bytes_new_ex(sgj_arena(jsp), num_bytes,
+                                             (const char *)byte_arr);
+
+        if (sn_name)
+            json_object_push((json_value *)(jop ? jop : jsp->basep),
+                             sn_name, jvp);
+        else
+            json_array_push((json_value *)(jop ? jop : jsp->basep), jvp);
+        return;
+    }
     bp = (char *)calloc(blen + 4, 1);
     if (bp) {
         h2str(byte_arr, num_bytes, bp, blen);
@@ -1019,17 +1599,50 @@ sgj_convert2snake_rm_parens(const char * in, char * out, int maxlen_out)
     return out;
 }
 
+/* Must match the hash used by sg_json_snake_gen.sh */
+static inline uint32_t
+sgj_snake_hash(const char * in)
+{
+    uint32_t h = 0;
+
+    for ( ; *in; ++in)
+        h = (h * 31) + (uint8_t)*in;
+    return h;
+}
+
+/* Looks up in in the generated table, returns NULL if it is not there */
+static const struct sgj_snake_t *
+sgj_snake_lookup(const char * in)
+{
+    int k, idx;
+
+    for (k = sgj_snake_hash(in) % SGJ_SNAKE_HASH_SZ; ;
+         k = (k + 1) % SGJ_SNAKE_HASH_SZ) {
+        idx = sgj_snake_idx[k];
+        if (idx < 0)
+            return NULL;
+        if (0 == strcmp(in, sgj_snake_tbl[idx].name))
+            return sgj_snake_tbl + idx;
+    }
+}
+
 static int
 sgj_name_to_snake(const char * in, char * out, int maxlen_out)
 {
     bool prev_underscore = false;
     int c, k, j, inlen;
+    const struct sgj_snake_t * sp;
 
     if (maxlen_out < 2) {
         if (maxlen_out == 1)
             out[0] = '\0';
         return 0;
     }
+    sp = sgj_snake_lookup(in);
+    if (sp && (sp->sn_len < maxlen_out)) {
+        memcpy(out, sp->sn_name, sp->sn_len + 1);
+        return sp->sn_len;
+    }
     inlen = strlen(in);
     for (k = 0, j = 0; (k < inlen) && (j < maxlen_out); ++k) {
         c = in[k];
@@ -1161,13 +1774,12 @@ sgj_haj_xx(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
             if (as_json && jsp->pr_out_hr) {
                 eaten = true;
                 json_array_push((json_value *)jsp->out_hrp,
-                                jvp ? jvp : json_null_new());
+                                jvp ? jvp : sgj_null_new(jsp));
             }
         } else {        /* assume jop points to named array */
             if (as_json) {
                 eaten = true;
-                json_array_push((json_value *)jop,
-                                jvp ? jvp : json_null_new());
+                sgj_push_jv(jsp, jop, NULL, jvp ? jvp : sgj_null_new(jsp));
             }
         }
         goto fini;
@@ -1216,8 +1828,7 @@ sgj_haj_xx(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
             }
             if (! done) {
                 eaten = true;
-                json_object_push((json_value *)jop, jname,
-                                 jvp ? jvp : json_null_new());
+                sgj_push_jv(jsp, jop, jname, jvp ? jvp : sgj_null_new(jsp));
             }
         }
     }
@@ -1225,7 +1836,7 @@ sgj_haj_xx(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
         sgj_haj_helper(b + n, blen - n, aname, sep, true, jvp, 0, hex_haj);
 
     if (as_json && jsp->pr_out_hr)
-        json_array_push((json_value *)jsp->out_hrp, json_string_new(b));
+        json_array_push((json_value *)jsp->out_hrp, sgj_string_new(jsp, b));
     if (! as_json)
         printf("%s\n", b);
 fini:
@@ -1240,7 +1851,7 @@ sgj_haj_vs(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
     json_value * jvp;
 
     /* make json_value even if jsp->pr_as_json is false */
-    jvp = value ? json_string_new(value) : NULL;
+    jvp = value ? sgj_string_new(jsp, value) : NULL;
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, false, NULL, NULL);
 }
 
@@ -1251,7 +1862,7 @@ sgj_haj_vi(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
 {
     json_value * jvp;
 
-    jvp = json_integer_new(value);
+    jvp = sgj_integer_new(jsp, value);
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, hex_haj, NULL, NULL);
 }
 
@@ -1262,7 +1873,7 @@ sgj_haj_vistr(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
 {
     json_value * jvp;
 
-    jvp = json_integer_new(value);
+    jvp = sgj_integer_new(jsp, value);
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, hex_haj, val_s,
                  NULL);
 }
@@ -1274,7 +1885,7 @@ sgj_haj_vi_nex(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
 {
     json_value * jvp;
 
-    jvp = json_integer_new(value);
+    jvp = sgj_integer_new(jsp, value);
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, hex_haj, NULL, nex_s);
 }
 
@@ -1286,7 +1897,7 @@ sgj_haj_vistr_nex(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
 {
     json_value * jvp;
 
-    jvp = json_integer_new(value);
+    jvp = sgj_integer_new(jsp, value);
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, hex_haj, val_s,
                nex_s);
 }
@@ -1297,7 +1908,7 @@ sgj_haj_vb(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
 {
     json_value * jvp;
 
-    jvp = json_boolean_new(value);
+    jvp = sgj_boolean_new(jsp, value);
     sgj_haj_xx(jsp, jop, leadin_sp, aname, sep, jvp, false, NULL, NULL);
 }
 
@@ -1322,7 +1933,7 @@ sgj_haj_subo_r(sgj_state * jsp, sgj_opaque_p jop, int leadin_sp,
                        hex_haj);
 
     if (as_json && jsp->pr_out_hr)
-        json_array_push((json_value *)jsp->out_hrp, json_string_new(b));
+        json_array_push((json_value *)jsp->out_hrp, sgj_string_new(jsp, b));
     if (! as_json)
         printf("%s\n", b);
 
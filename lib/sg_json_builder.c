@@ -60,11 +60,166 @@ typedef struct json_builder_value
    size_t additional_length_allocated;
    size_t length_iterated;
 
+   json_builder_arena * arena;  /* NULL when from malloc() */
+   int is_bytes;        /* json_string holding binary data, not text */
+
 } json_builder_value;
 
 /* Use this to silence clang --analyze warning about 'unix.MallocSizeof' */
 static const int jbv_sz = sizeof (json_builder_value);
 
+#define jb_arena(v) (((json_builder_value *) (v))->arena)
+
+/* Arena slabs are kept on a singly linked list, the head slab is the one
+ * currently being carved up. Allocations are rounded up to jb_align bytes.
+ */
+typedef struct json_builder_slab
+{
+   struct json_builder_slab * next;
+   size_t size;
+   size_t used;
+
+} json_builder_slab;
+
+struct json_builder_arena
+{
+   json_builder_slab * head;
+   size_t slab_size;
+};
+
+#define jb_align 16
+#define jb_round(n) (((n) + (jb_align - 1)) & ~((size_t) jb_align - 1))
+#define jb_slab_data(s) ((char *) (s) + jb_round (sizeof (json_builder_slab)))
+
+static const size_t jb_def_slab_size = 64 * 1024;
+
+json_builder_arena * json_builder_arena_new (size_t slab_size)
+{
+   json_builder_arena * arena = (json_builder_arena *) calloc (1, sizeof (*arena));
+
+   if (!arena)
+      return NULL;
+
+   arena->slab_size = slab_size ? jb_round (slab_size) : jb_def_slab_size;
+
+   return arena;
+}
+
+void json_builder_arena_free (json_builder_arena * arena)
+{
+   json_builder_slab * slab, * next;
+
+   if (!arena)
+      return;
+
+   for (slab = arena->head; slab; slab = next)
+   {
+      next = slab->next;
+      free (slab);
+   }
+
+   free (arena);
+}
+
+static void * jb_alloc (json_builder_arena * arena, size_t size, int zero)
+{
+   json_builder_slab * slab;
+   void * p;
+
+   if (!arena)
+      return zero ? calloc (1, size) : malloc (size);
+
+   size = jb_round (size ? size : 1);
+   slab = arena->head;
+
+   if (!slab || (slab->used + size > slab->size))
+   {
+      size_t slab_size = arena->slab_size;
+
+      /* big requests get a slab of their own placed behind the head, so
+       * the space left in the head slab is not wasted
+       */
+      if (size > slab_size / 4)
+         slab_size = size;
+
+      if (! (slab = (json_builder_slab *) malloc
+               (jb_round (sizeof (json_builder_slab)) + slab_size)))
+         return NULL;
+
+      slab->size = slab_size;
+      slab->used = 0;
+
+      if (arena->head && (slab_size == size))
+      {
+         slab->next = arena->head->next;
+         arena->head->next = slab;
+      }
+      else
+      {
+         slab->next = arena->head;
+         arena->head = slab;
+      }
+   }
+
+   p = jb_slab_data (slab) + slab->used;
+   slab->used += size;
+
+   if (zero)
+      memset (p, 0, size);
+
+   return p;
+}
+
+static void * jb_realloc (json_builder_arena * arena, void * p,
+                          size_t old_size, size_t new_size)
+{
+   json_builder_slab * slab;
+   size_t old_round;
+   void * p_new;
+
+   if (!arena)
+      return realloc (p, new_size);
+
+   /* grow in place if p was the last thing carved from the head slab */
+   slab = arena->head;
+
+   old_round = jb_round (old_size ? old_size : 1);
+
+   if (p && slab &&
+         ((char *) p + old_round == jb_slab_data (slab) + slab->used) &&
+         (slab->used - old_round + jb_round (new_size) <= slab->size))
+   {
+      slab->used = slab->used - old_round + jb_round (new_size);
+      return p;
+   }
+
+   if (! (p_new = jb_alloc (arena, new_size, 0)))
+      return NULL;
+
+   if (p && old_size)
+      memcpy (p_new, p, old_size < new_size ? old_size : new_size);
+
+   return p_new;
+}
+
+static void jb_free (json_builder_arena * arena, void * p)
+{
+   if (!arena)
+      free (p);
+}
+
+/* Array and object growth. Without an arena this is one more slot per push
+ * (as json-builder has always done); from an arena, where the old space
+ * can't be reused, the capacity is doubled instead.
+ */
+static size_t jb_grow_by (json_value * value, unsigned int length)
+{
+   if (!jb_arena (value))
+      return 1;
+
+   return length < 4 ? 4 : length;
+}
+
 
 static int builderize (json_value * value)
 {
@@ -85,7 +240,7 @@ static int builderize (json_value * value)
          json_char * name_copy;
          json_object_entry * entry = &value->u.object.values [i];
 
-         if (! (name_copy = (json_char *) malloc ((entry->name_length + 1) * sizeof (json_char))))
+         if (! (name_copy = (json_char *) jb_alloc (jb_arena (value), (entry->name_length + 1) * sizeof (json_char), 0)))
             return 0;
 
          memcpy (name_copy, entry->name, entry->name_length + 1);
@@ -136,20 +291,26 @@ static int get_serialize_flags (json_serialize_opts opts)
 }
 
 json_value * json_array_new (size_t length)
+{
+    return json_array_new_ex (NULL, length);
+}
+
+json_value * json_array_new_ex (json_builder_arena * arena, size_t length)
 {
     /* 'value' will be pointer to an instance of the base class json_value */
-    json_value * value = (json_value *) calloc (1, jbv_sz);
+    json_value * value = (json_value *) jb_alloc (arena, jbv_sz, 1);
 
     if (!value)
        return NULL;
 
     ((json_builder_value *) value)->is_builder_value = 1;
+    ((json_builder_value *) value)->arena = arena;
 
     value->type = json_array;
 
-    if (! (value->u.array.values = (json_value **) malloc (length * sizeof (json_value *))))
+    if (! (value->u.array.values = (json_value **) jb_alloc (arena, length * sizeof (json_value *), 0)))
     {
-       free (value);
+       jb_free (arena, value);
        return NULL;
     }
 
@@ -158,10 +319,21 @@ json_value * json_array_new (size_t length)
     return value;
 }
 
+/* A container from an arena may only hold values from that same arena.
+ * json_builder_free() does not walk arena trees and json_builder_arena_free()
+ * only knows about its own slabs, so anything else would never be freed. */
+static int jb_arena_match (json_value * container, json_value * value)
+{
+   return !jb_arena (container) || (jb_arena (container) == jb_arena (value));
+}
+
 json_value * json_array_push (json_value * array, json_value * value)
 {
    assert (array->type == json_array);
 
+   if (!jb_arena_match (array, value))
+      return NULL;
+
    if (!builderize (array) || !builderize (value))
       return NULL;
 
@@ -171,13 +343,17 @@ json_value * json_array_push (json_value * array, json_value * value)
    }
    else
    {
-      json_value ** values_new = (json_value **) realloc
-            (array->u.array.values, sizeof (json_value *) * (array->u.array.length + 1));
+      size_t grow = jb_grow_by (array, array->u.array.length);
+      json_value ** values_new = (json_value **) jb_realloc
+            (jb_arena (array), array->u.array.values,
+             sizeof (json_value *) * array->u.array.length,
+             sizeof (json_value *) * (array->u.array.length + grow));
 
       if (!values_new)
          return NULL;
 
       array->u.array.values = values_new;
+      ((json_builder_value *) array)->additional_length_allocated = grow - 1;
    }
 
    array->u.array.values [array->u.array.length] = value;
@@ -190,19 +366,25 @@ json_value * json_array_push (json_value * array, json_value * value)
 
 json_value * json_object_new (size_t length)
 {
-    json_value * value = (json_value *) calloc (1, jbv_sz);
+    return json_object_new_ex (NULL, length);
+}
+
+json_value * json_object_new_ex (json_builder_arena * arena, size_t length)
+{
+    json_value * value = (json_value *) jb_alloc (arena, jbv_sz, 1);
 
     if (!value)
        return NULL;
 
     ((json_builder_value *) value)->is_builder_value = 1;
+    ((json_builder_value *) value)->arena = arena;
 
     value->type = json_object;
 
-    if (! (value->u.object.values = (json_object_entry *) calloc
-           (length, sizeof (*value->u.object.values))))
+    if (! (value->u.object.values = (json_object_entry *) jb_alloc
+           (arena, length * sizeof (*value->u.object.values), 1)))
     {
-       free (value);
+       jb_free (arena, value);
        return NULL;
     }
 
@@ -226,7 +408,7 @@ json_value * json_object_push_length (json_value * object,
 
    assert (object->type == json_object);
 
-   if (! (name_copy = (json_char *) malloc ((name_length + 1) * sizeof (json_char))))
+   if (! (name_copy = (json_char *) jb_alloc (jb_arena (object), (name_length + 1) * sizeof (json_char), 0)))
       return NULL;
    
    memcpy (name_copy, name, name_length * sizeof (json_char));
@@ -234,7 +416,7 @@ json_value * json_object_push_length (json_value * object,
 
    if (!json_object_push_nocopy (object, name_length, name_copy, value))
    {
-      free (name_copy);
+      jb_free (jb_arena (object), name_copy);
       return NULL;
    }
 
@@ -249,6 +431,9 @@ json_value * json_object_push_nocopy (json_value * object,
 
    assert (object->type == json_object);
 
+   if (!jb_arena_match (object, value))
+      return NULL;
+
    if (!builderize (object) || !builderize (value))
       return NULL;
 
@@ -258,14 +443,18 @@ json_value * json_object_push_nocopy (json_value * object,
    }
    else
    {
+      size_t grow = jb_grow_by (object, object->u.object.length);
       json_object_entry * values_new = (json_object_entry *)
-            realloc (object->u.object.values, sizeof (*object->u.object.values)
-                            * (object->u.object.length + 1));
+            jb_realloc (jb_arena (object), object->u.object.values,
+                        sizeof (*object->u.object.values) * object->u.object.length,
+                        sizeof (*object->u.object.values)
+                            * (object->u.object.length + grow));
 
       if (!values_new)
          return NULL;
 
       object->u.object.values = values_new;
+      ((json_builder_value *) object)->additional_length_allocated = grow - 1;
    }
 
    entry = object->u.object.values + object->u.object.length;
@@ -287,9 +476,15 @@ json_value * json_string_new (const json_char * buf)
 }
 
 json_value * json_string_new_length (unsigned int length, const json_char * buf)
+{
+   return json_string_new_length_ex (NULL, length, buf);
+}
+
+json_value * json_string_new_length_ex (json_builder_arena * arena,
+                                        unsigned int length, const json_char * buf)
 {
    json_value * value;
-   json_char * copy = (json_char *) malloc ((length + 1) * sizeof (json_char));
+   json_char * copy = (json_char *) jb_alloc (arena, (length + 1) * sizeof (json_char), 0);
 
    if (!copy)
       return NULL;
@@ -297,15 +492,40 @@ json_value * json_string_new_length (unsigned int length, const json_char * buf)
    memcpy (copy, buf, length * sizeof (json_char));
    copy [length] = 0;
 
-   if (! (value = json_string_new_nocopy (length, copy)))
+   if (! (value = (json_value *) jb_alloc (arena, jbv_sz, 1)))
    {
-      free (copy);
+      jb_free (arena, copy);
       return NULL;
    }
 
+   ((json_builder_value *) value)->is_builder_value = 1;
+   ((json_builder_value *) value)->arena = arena;
+
+   value->type = json_string;
+   value->u.string.length = length;
+   value->u.string.ptr = copy;
+
    return value;
 }
 
+json_value * json_bytes_new_ex (json_builder_arena * arena,
+                               unsigned int length, const json_char * buf)
+{
+   json_value * value = json_string_new_length_ex (arena, length, buf);
+
+   if (value)
+      ((json_builder_value *) value)->is_bytes = 1;
+
+   return value;
+}
+
+int json_builder_is_bytes (const json_value * value)
+{
+   return (value->type == json_string) &&
+          ((json_builder_value *) value)->is_builder_value &&
+          ((json_builder_value *) value)->is_bytes;
+}
+
 json_value * json_string_new_nocopy (unsigned int length, json_char * buf)
 {
    json_value * value = (json_value *) calloc (1, jbv_sz);
@@ -324,12 +544,18 @@ json_value * json_string_new_nocopy (unsigned int length, json_char * buf)
 
 json_value * json_integer_new (json_int_t integer)
 {
-   json_value * value = (json_value *) calloc (1, jbv_sz);
+   return json_integer_new_ex (NULL, integer);
+}
+
+json_value * json_integer_new_ex (json_builder_arena * arena, json_int_t integer)
+{
+   json_value * value = (json_value *) jb_alloc (arena, jbv_sz, 1);
    
    if (!value)
       return NULL;
 
    ((json_builder_value *) value)->is_builder_value = 1;
+   ((json_builder_value *) value)->arena = arena;
 
    value->type = json_integer;
    value->u.integer = integer;
@@ -354,12 +580,18 @@ json_value * json_double_new (double dbl)
 
 json_value * json_boolean_new (int b)
 {
-   json_value * value = (json_value *) calloc (1, jbv_sz);
+   return json_boolean_new_ex (NULL, b);
+}
+
+json_value * json_boolean_new_ex (json_builder_arena * arena, int b)
+{
+   json_value * value = (json_value *) jb_alloc (arena, jbv_sz, 1);
    
    if (!value)
       return NULL;
 
    ((json_builder_value *) value)->is_builder_value = 1;
+   ((json_builder_value *) value)->arena = arena;
 
    value->type = json_boolean;
    value->u.boolean = b;
@@ -369,12 +601,18 @@ json_value * json_boolean_new (int b)
 
 json_value * json_null_new (void)
 {
-   json_value * value = (json_value *) calloc (1, jbv_sz);
+   return json_null_new_ex (NULL);
+}
+
+json_value * json_null_new_ex (json_builder_arena * arena)
+{
+   json_value * value = (json_value *) jb_alloc (arena, jbv_sz, 1);
    
    if (!value)
       return NULL;
 
    ((json_builder_value *) value)->is_builder_value = 1;
+   ((json_builder_value *) value)->arena = arena;
 
    value->type = json_null;
 
@@ -422,6 +660,10 @@ json_value * json_object_merge (json_value * objectA, json_value * objectB)
    assert (objectB->type == json_object);
    assert (objectA != objectB);
 
+   /* entries (and their names) move from B to A so both must agree */
+   if (jb_arena (objectA) != jb_arena (objectB))
+      return NULL;
+
    if (!builderize (objectA) || !builderize (objectB))
       return NULL;
 
@@ -441,7 +683,10 @@ json_value * json_object_merge (json_value * objectA, json_value * objectB)
               + objectB->u.object.length;
 
       if (! (values_new = (json_object_entry *)
-            realloc (objectA->u.object.values, sizeof (json_object_entry) * alloc)))
+            jb_realloc (jb_arena (objectA), objectA->u.object.values,
+                        sizeof (json_object_entry) * (objectA->u.object.length
+                            + ((json_builder_value *) objectA)->additional_length_allocated),
+                        sizeof (json_object_entry) * alloc)))
       {
           return NULL;
       }
@@ -459,8 +704,8 @@ json_value * json_object_merge (json_value * objectA, json_value * objectB)
 
    objectA->u.object.length += objectB->u.object.length;
 
-   free (objectB->u.object.values);
-   free (objectB);
+   jb_free (jb_arena (objectB), objectB->u.object.values);
+   jb_free (jb_arena (objectB), objectB);
 
    return objectA;
 }
@@ -948,6 +1193,13 @@ void json_builder_free (json_value * value)
 
    while (value)
    {
+      if (jb_arena (value))
+      {
+         /* released with the rest of its arena */
+         value = value->parent;
+         continue;
+      }
+
       switch (value->type)
       {
          case json_array:
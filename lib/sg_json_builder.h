@@ -222,25 +222,43 @@ void json_value_free_ex (json_settings * settings,
  * parsing.  Otherwise there will not be room for the extra state and
  * json-builder WILL invoke undefined behaviour.
  *
- * Also note that unlike json-parser, json-builder does not currently support
- * custom allocators (for no particular reason other than that it doesn't have
- * any settings or global state.)
+ * Also note that unlike json-parser, json-builder does not support custom
+ * allocators. Instead values may be taken from an arena (see below).
  */
 extern const size_t json_builder_extra;
 
 
+/*** Arenas
+ ***
+ * An arena hands out memory from large slabs with a bump allocator. Values
+ * made by the *_new_ex() functions with a non-NULL arena, and every name
+ * copy and array/object growth for containers made that way, come from that
+ * arena. json_builder_free() on such a value does nothing; all of it is
+ * released at once by json_builder_arena_free(). Do not push arena values
+ * into a tree that outlives the arena. Pushing a value that is not from the
+ * same arena into an arena container (or merging objects from different
+ * arenas) fails, returning NULL. slab_size of 0 selects a default.
+ */
+typedef struct json_builder_arena json_builder_arena;
+
+json_builder_arena * json_builder_arena_new (size_t slab_size);
+void json_builder_arena_free (json_builder_arena *);
+
+
 /*** Arrays
  ***
  * Note that all of these length arguments are just a hint to allow for
  * pre-allocation - passing 0 is fine.
  */
 json_value * json_array_new (size_t length);
+json_value * json_array_new_ex (json_builder_arena *, size_t length);
 json_value * json_array_push (json_value * array, json_value *);
 
 
 /*** Objects
  ***/
 json_value * json_object_new (size_t length);
+json_value * json_object_new_ex (json_builder_arena *, size_t length);
 
 json_value * json_object_push (json_value * object,
                                const json_char * name,
@@ -275,6 +293,16 @@ void json_object_sort (json_value * object, json_value * proto);
 json_value * json_string_new (const json_char *);
 json_value * json_string_new_length (unsigned int length, const json_char *);
 json_value * json_string_new_nocopy (unsigned int length, json_char *);
+json_value * json_string_new_length_ex (json_builder_arena *,
+                                        unsigned int length, const json_char *);
+
+/* A string value that holds binary data (which may contain nulls). It is
+ * meant for binary encodings (e.g. CBOR) of the tree; the text serializer
+ * treats it like any other string.
+ */
+json_value * json_bytes_new_ex (json_builder_arena *,
+                                unsigned int length, const json_char *);
+int json_builder_is_bytes (const json_value *);
 
 
 /*** Everything else
@@ -283,6 +311,9 @@ json_value * json_integer_new (json_int_t);
 json_value * json_double_new (double);
 json_value * json_boolean_new (int);
 json_value * json_null_new (void);
+json_value * json_integer_new_ex (json_builder_arena *, json_int_t);
+json_value * json_boolean_new_ex (json_builder_arena *, int);
+json_value * json_null_new_ex (json_builder_arena *);
 
 
 /*** Serializing
@@ -0,0 +1,216 @@
+#!/bin/sh
+#
+# Generates sg_json_snake_tbl.h which maps the fixed (i.e. string literal)
+# names that the utilities pass to sgj_haj_*(), sgj_snake_named_sub*_r()
+# and sgj_convert2snake() to their snake_case JSON names. This saves
+# lib/sg_json.c converting each of those names every time it is output.
+# Names that are not found in the table are still converted at run time.
+#
+# Run from the top level directory after adding or changing such names:
+#     sh lib/sg_json_snake_gen.sh > lib/sg_json_snake_tbl.h
+# or use 'make snake_tbl' in the lib directory.
+
+LC_ALL=C
+export LC_ALL
+
+if [ $# -gt 0 ] ; then
+    files="$*"
+else
+    files="src/*.c lib/*.c"
+fi
+
+cat <<'HDR'
+/*
+ * Generated by lib/sg_json_snake_gen.sh ; do not edit. Each entry maps a
+ * fixed name given to the sgj_haj_*(), sgj_snake_named_sub*_r() and
+ * sgj_convert2snake() functions to the same snake_case name that
+ * sgj_name_to_snake() would produce. sgj_snake_idx[] holds indexes into
+ * that table (or -1) placed by a hash of the name (see sgj_snake_hash()).
+ */
+
+HDR
+echo "static const struct sgj_snake_t sgj_snake_tbl[] = {"
+
+# shellcheck disable=SC2086
+awk '
+function snake(in_s,    k, c, out, prev_us) {
+    out = ""
+    prev_us = 0
+    for (k = 1; k <= length(in_s); ++k) {
+        c = substr(in_s, k, 1)
+        if (c ~ /[A-Za-z0-9]/) {
+            out = out tolower(c)
+            prev_us = 0
+        } else if ((length(out) > 0) && (! prev_us)) {
+            out = out "_"
+            prev_us = 1
+        }
+    }
+    if (length(out) == 0)
+        return "_"
+    if (substr(out, length(out), 1) == "_")
+        out = substr(out, 1, length(out) - 1)
+    return out
+}
+
+# Returns the string literal(s) starting at position p in s (concatenating
+# adjacent literals) if that is the whole argument, else returns "". An
+# identifier is accepted if it names a "const char * id = <literal>;" in
+# the same file.
+function literal_at(s, f, p,    c, res, n, id) {
+    res = ""
+    n = length(s)
+    while (1) {
+        while ((p <= n) && (substr(s, p, 1) ~ /[ \t\n]/))
+            ++p
+        c = substr(s, p, 1)
+        if (c == ",")
+            return res
+        if (c == ")")
+            return res
+        if ((res == "") && (c ~ /[A-Za-z_]/)) {
+            for (id = ""; (p <= n) && ((c = substr(s, p, 1)) ~ /[A-Za-z0-9_]/); ++p)
+                id = id c
+            while ((p <= n) && (substr(s, p, 1) ~ /[ \t\n]/))
+                ++p
+            c = substr(s, p, 1)
+            if (((c == ",") || (c == ")")) && ((f SUBSEP id) in cstr))
+                return cstr[f, id]
+            return ""
+        }
+        if (c != "\"")
+            return ""
+        for (++p; (p <= n) && ((c = substr(s, p, 1)) != "\""); ++p) {
+            if (c == "\\")
+                return ""
+            res = res c
+        }
+        ++p
+    }
+}
+
+# Find the start of argument number argn (0 based) of the call whose
+# opening parenthesis is at position p. Returns 0 if not found.
+function arg_start(s, p, argn,    depth, n, c, in_str) {
+    depth = 0
+    in_str = 0
+    n = length(s)
+    if (argn == 0)
+        return p + 1
+    for (++p; p <= n; ++p) {
+        c = substr(s, p, 1)
+        if (in_str) {
+            if (c == "\\")
+                ++p
+            else if (c == "\"")
+                in_str = 0
+            continue
+        }
+        if (c == "\"")
+            in_str = 1
+        else if ((c == "(") || (c == "["))
+            ++depth
+        else if ((c == ")") || (c == "]")) {
+            if (depth == 0)
+                return 0
+            --depth
+        } else if ((c == ",") && (depth == 0)) {
+            if (--argn == 0)
+                return p + 1
+        }
+    }
+    return 0
+}
+
+{
+    text[FILENAME] = text[FILENAME] $0 "\n"
+    if (match($0, /const char \* *[A-Za-z0-9_]+ *= *"[^"\\]*" *;/)) {
+        d = substr($0, RSTART, RLENGTH)
+        sub(/^const char \* */, "", d)
+        id = d
+        sub(/ *=.*$/, "", id)
+        sub(/^[^"]*"/, "", d)
+        sub(/" *;$/, "", d)
+        cstr[FILENAME, id] = d
+    }
+}
+
+END {
+    for (f in text) {
+        s = text[f]
+        base = 0
+        while (match(substr(s, base + 1),
+                     /sgj_(haj_[a-z_]+|snake_named_sub(object|array)_r|convert2snake)\(/)) {
+            fname = substr(s, base + RSTART, RLENGTH - 1)
+            paren = base + RSTART + RLENGTH - 1
+            base = paren
+            if (fname ~ /^sgj_haj_/)
+                argn = 3
+            else if (fname ~ /^sgj_snake_named/)
+                argn = 2
+            else
+                argn = 0
+            a = arg_start(s, paren, argn)
+            if (a == 0)
+                continue
+            lit = literal_at(s, f, a)
+            if (length(lit) > 0)
+                print lit "\t" snake(lit)
+        }
+    }
+}' $files | sort -u | awk -F '\t' '
+# Same hash as sgj_snake_hash() in sg_json.c: h = h * 31 + c over the bytes
+# of the name, modulo 2**32. Names with bytes outside printable ASCII are
+# skipped as ord() below can not represent them.
+BEGIN {
+    n = 0
+    for (k = 32; k < 127; ++k)
+        ord[sprintf("%c", k)] = k
+}
+{
+    h = 0
+    for (k = 1; k <= length($1); ++k) {
+        c = substr($1, k, 1)
+        if (! (c in ord))
+            next
+        h = (h * 31 + ord[c]) % 4294967296
+    }
+    name[n] = $1
+    sn[n] = $2
+    hash[n] = h
+    ++n
+}
+END {
+    for (k = 0; k < n; ++k) {
+        len = length(sn[k])
+        if ((length(name[k]) + len + length(len) + 14) < 80)
+            printf("    {\"%s\", \"%s\", %d},\n", name[k], sn[k], len)
+        else
+            printf("    {\"%s\",\n     \"%s\", %d},\n", name[k], sn[k], len)
+    }
+    print "};"
+    print ""
+    # open addressing index with linear probing, at most 1/3 full
+    for (sz = 64; sz < 3 * n; sz *= 2)
+        ;
+    for (k = 0; k < sz; ++k)
+        slot[k] = -1
+    for (k = 0; k < n; ++k) {
+        for (j = hash[k] % sz; slot[j] >= 0; j = (j + 1) % sz)
+            ;
+        slot[j] = k
+    }
+    printf("#define SGJ_SNAKE_HASH_SZ %d\n\n", sz)
+    print "static const short sgj_snake_idx[SGJ_SNAKE_HASH_SZ] = {"
+    line = "   "
+    for (k = 0; k < sz; ++k) {
+        item = sprintf(" %d,", slot[k])
+        if (length(line) + length(item) > 78) {
+            print line
+            line = "   "
+        }
+        line = line item
+    }
+    print line
+    print "};"
+}'
@@ -0,0 +1,412 @@
+/*
+ * Generated by lib/sg_json_snake_gen.sh ; do not edit. Each entry maps a
+ * fixed name given to the sgj_haj_*(), sgj_snake_named_sub*_r() and
+ * sgj_convert2snake() functions to the same snake_case name that
+ * sgj_name_to_snake() would produce. sgj_snake_idx[] holds indexes into
+ * that table (or -1) placed by a hash of the name (see sgj_snake_hash()).
+ */
+
+static const struct sgj_snake_t sgj_snake_tbl[] = {
+    {"AAORB", "aaorb", 5},
+    {"ANC_SUP", "anc_sup", 7},
+    {"APP_CHK", "app_chk", 7},
+    {"Active zone domain id", "active_zone_domain_id", 21},
+    {"Additional element status descriptor list",
+     "additional_element_status_descriptor_list", 41},
+    {"Allowed number of logical blocks",
+     "allowed_number_of_logical_blocks", 32},
+    {"Array Serial Number", "array_serial_number", 19},
+    {"Asymmetric access state", "asymmetric_access_state", 23},
+    {"Atomic alignment", "atomic_alignment", 16},
+    {"Atomic transfer length granularity",
+     "atomic_transfer_length_granularity", 34},
+    {"CBCS", "cbcs", 4},
+    {"CGA profile supported", "cga_profile_supported", 21},
+    {"CRD_SUP", "crd_sup", 7},
+    {"Commands exceeding optimal limit",
+     "commands_exceeding_optimal_limit", 32},
+    {"Completion condition", "completion_condition", 20},
+    {"Configuration diagnostic page", "configuration_diagnostic_page", 29},
+    {"Current number of depopulated elements",
+     "current_number_of_depopulated_elements", 38},
+    {"DAV", "dav", 3},
+    {"DMS_VALID", "dms_valid", 9},
+    {"DM_MD_4", "dm_md_4", 7},
+    {"DM_MD_5", "dm_md_5", 7},
+    {"DM_MD_6", "dm_md_6", 7},
+    {"DM_MD_7", "dm_md_7", 7},
+    {"DM_MD_D", "dm_md_d", 7},
+    {"DM_MD_E", "dm_md_e", 7},
+    {"DM_MD_F", "dm_md_f", 7},
+    {"DP", "dp", 2},
+    {"Data segment granularity", "data_segment_granularity", 24},
+    {"Default inactivity timeout", "default_inactivity_timeout", 26},
+    {"Default owner", "default_owner", 13},
+    {"Density code", "density_code", 12},
+    {"Designed last Logical Block Address",
+     "designed_last_logical_block_address", 35},
+    {"Designed zone alignment method", "designed_zone_alignment_method", 30},
+    {"Designed zone maximum address", "designed_zone_maximum_address", 29},
+    {"Designed zone starting LBA granularity",
+     "designed_zone_starting_lba_granularity", 38},
+    {"Destinationl address", "destinationl_address", 20},
+    {"Device cache fast writes", "device_cache_fast_writes", 24},
+    {"Device cache full read hits", "device_cache_full_read_hits", 27},
+    {"Device cache partial read hits", "device_cache_partial_read_hits", 30},
+    {"Device cache read misses", "device_cache_read_misses", 24},
+    {"Device cache write hits", "device_cache_write_hits", 23},
+    {"Download microcode status descriptor list",
+     "download_microcode_status_descriptor_list", 41},
+    {"Download microcode status diagnostic page",
+     "download_microcode_status_diagnostic_page", 41},
+    {"Element address", "element_address", 15},
+    {"Enclosure Status diagnostic page",
+     "enclosure_status_diagnostic_page", 32},
+    {"Extended self-test completion minutes",
+     "extended_self_test_completion_minutes", 37},
+    {"FMTPINFO", "fmtpinfo", 8},
+    {"FUAB", "fuab", 4},
+    {"Failed explicit opens", "failed_explicit_opens", 21},
+    {"Firmware revision", "firmware_revision", 17},
+    {"Flash Correction Count", "flash_correction_count", 22},
+    {"Format index", "format_index", 12},
+    {"GList size", "glist_size", 10},
+    {"GRD_CHK", "grd_chk", 7},
+    {"GROUP_SUP", "group_sup", 9},
+    {"HDW EXC", "hdw_exc", 7},
+    {"HEADSUP", "headsup", 7},
+    {"HRA_SUP", "hra_sup", 7},
+    {"HSSRELEF", "hssrelef", 8},
+    {"Held data granularity", "held_data_granularity", 21},
+    {"Held data limit", "held_data_limit", 15},
+    {"High LBA conventional zones percentage",
+     "high_lba_conventional_zones_percentage", 38},
+    {"Hours since last clean", "hours_since_last_clean", 22},
+    {"IAS", "ias", 3},
+    {"IAV", "iav", 3},
+    {"IBS", "ibs", 3},
+    {"INVOP", "invop", 5},
+    {"Identifier of element being depopulated",
+     "identifier_of_element_being_depopulated", 39},
+    {"Idle_a condition recovery time", "idle_a_condition_recovery_time", 30},
+    {"Idle_b condition recovery time", "idle_b_condition_recovery_time", 30},
+    {"Idle_c condition recovery time", "idle_c_condition_recovery_time", 30},
+    {"Implicit failback", "implicit_failback", 17},
+    {"Initial address", "initial_address", 15},
+    {"Inline data granularity", "inline_data_granularity", 23},
+    {"LBA range number", "lba_range_number", 16},
+    {"LBPRZ", "lbprz", 5},
+    {"LBPU", "lbpu", 4},
+    {"LBPWS", "lbpws", 5},
+    {"LBPWS10", "lbpws10", 7},
+    {"LSAV", "lsav", 4},
+    {"LUICLR", "luiclr", 6},
+    {"LUN State", "lun_state", 9},
+    {"LUN WWN", "lun_wwn", 7},
+    {"Last successful address", "last_successful_address", 23},
+    {"Lifetime media motion hours", "lifetime_media_motion_hours", 27},
+    {"Logical block length", "logical_block_length", 20},
+    {"Logical blocks per physical block exponent",
+     "logical_blocks_per_physical_block_exponent", 42},
+    {"Logical blocks per zone", "logical_blocks_per_zone", 23},
+    {"Low LBA conventional zones percentage",
+     "low_lba_conventional_zones_percentage", 37},
+    {"MACT", "mact", 4},
+    {"MED EXC", "med_exc", 7},
+    {"MTAV", "mtav", 4},
+    {"Max Drive Temp (Celsius)", "max_drive_temp_celsius", 22},
+    {"Maximum CSCD descriptor count", "maximum_cscd_descriptor_count", 29},
+    {"Maximum atomic boundary size", "maximum_atomic_boundary_size", 28},
+    {"Maximum atomic transfer length", "maximum_atomic_transfer_length", 30},
+    {"Maximum bytes in block ROD", "maximum_bytes_in_block_rod", 26},
+    {"Maximum bytes in stream ROD", "maximum_bytes_in_stream_rod", 27},
+    {"Maximum compare and write length",
+     "maximum_compare_and_write_length", 32},
+    {"Maximum descriptor list length", "maximum_descriptor_list_length", 30},
+    {"Maximum explicitly open zones", "maximum_explicitly_open_zones", 29},
+    {"Maximum identified concurrent copies",
+     "maximum_identified_concurrent_copies", 36},
+    {"Maximum implicitly open zones", "maximum_implicitly_open_zones", 29},
+    {"Maximum inactivity timeout", "maximum_inactivity_timeout", 26},
+    {"Maximum inline data length", "maximum_inline_data_length", 26},
+    {"Maximum inquiry change logs", "maximum_inquiry_change_logs", 27},
+    {"Maximum mode page change logs", "maximum_mode_page_change_logs", 29},
+    {"Maximum non-sequential zones", "maximum_non_sequential_zones", 28},
+    {"Maximum number of LUNS", "maximum_number_of_luns", 22},
+    {"Maximum number of open sequential write required zones",
+     "maximum_number_of_open_sequential_write_required_zones", 54},
+    {"Maximum number of streams", "maximum_number_of_streams", 25},
+    {"Maximum open zones", "maximum_open_zones", 18},
+    {"Maximum prefetch length", "maximum_prefetch_length", 23},
+    {"Maximum range descriptors", "maximum_range_descriptors", 25},
+    {"Maximum scattered LBA range descriptor count",
+     "maximum_scattered_lba_range_descriptor_count", 44},
+    {"Maximum scattered LBA range transfer length",
+     "maximum_scattered_lba_range_transfer_length", 43},
+    {"Maximum scattered transfer length",
+     "maximum_scattered_transfer_length", 33},
+    {"Maximum segment descriptor count",
+     "maximum_segment_descriptor_count", 32},
+    {"Maximum segment length", "maximum_segment_length", 22},
+    {"Maximum stream device transfer size",
+     "maximum_stream_device_transfer_size", 35},
+    {"Maximum supported sense data length",
+     "maximum_supported_sense_data_length", 35},
+    {"Maximum token inactivity timeout",
+     "maximum_token_inactivity_timeout", 32},
+    {"Maximum token transfer size", "maximum_token_transfer_size", 27},
+    {"Maximum transfer length", "maximum_transfer_length", 23},
+    {"Maximum unmap LBA count", "maximum_unmap_lba_count", 23},
+    {"Maximum unmap block descriptor count",
+     "maximum_unmap_block_descriptor_count", 36},
+    {"Maximum write same length", "maximum_write_same_length", 25},
+    {"Media changer error type", "media_changer_error_type", 24},
+    {"Medium transport address", "medium_transport_address", 24},
+    {"Medium type", "medium_type", 11},
+    {"Minimum empty zones", "minimum_empty_zones", 19},
+    {"Minimum percentage", "minimum_percentage", 18},
+    {"Model number", "model_number", 12},
+    {"Multi I_T nexus microcode download",
+     "multi_i_t_nexus_microcode_download", 34},
+    {"NGUID", "nguid", 5},
+    {"NON_SEQ", "non_seq", 7},
+    {"NO_PI_CHK", "no_pi_chk", 9},
+    {"NRD0", "nrd0", 4},
+    {"NRD1", "nrd1", 4},
+    {"NV_SUP", "nv_sup", 6},
+    {"Number of Information Exceptions",
+     "number_of_information_exceptions", 32},
+    {"Number of LBA formats", "number_of_lba_formats", 21},
+    {"Number of LBAs", "number_of_lbas", 14},
+    {"Number of descriptors", "number_of_descriptors", 21},
+    {"Number of descriptors returned", "number_of_descriptors_returned", 30},
+    {"Number of determined volume identifiers",
+     "number_of_determined_volume_identifiers", 39},
+    {"Number of import/export door opens",
+     "number_of_import_export_door_opens", 34},
+    {"Number of invalid volume tags returned by volume tag reader",
+     "number_of_invalid_volume_tags_returned_by_volume_tag_reader", 59},
+    {"Number of library door opens", "number_of_library_door_opens", 28},
+    {"Number of moves", "number_of_moves", 15},
+    {"Number of physical inventory scans",
+     "number_of_physical_inventory_scans", 34},
+    {"Number of pick retries", "number_of_pick_retries", 22},
+    {"Number of picks", "number_of_picks", 15},
+    {"Number of place retries", "number_of_place_retries", 23},
+    {"Number of places", "number_of_places", 16},
+    {"Number of storage elements", "number_of_storage_elements", 26},
+    {"Number of unreadable volume identifiers",
+     "number_of_unreadable_volume_identifiers", 39},
+    {"Number of volume tags read by volume tag reader",
+     "number_of_volume_tags_read_by_volume_tag_reader", 47},
+    {"Number of zone domains supported",
+     "number_of_zone_domains_supported", 32},
+    {"ORDSUP", "ordsup", 6},
+    {"Operation code", "operation_code", 14},
+    {"Optimal Bytes from token per segment",
+     "optimal_bytes_from_token_per_segment", 36},
+    {"Optimal Bytes in block ROD transfer",
+     "optimal_bytes_in_block_rod_transfer", 35},
+    {"Optimal Bytes to token per segment",
+     "optimal_bytes_to_token_per_segment", 34},
+    {"Optimal block ROD length granularity",
+     "optimal_block_rod_length_granularity", 36},
+    {"Optimal number of non-sequentially written sequential write preferred zones",
+     "optimal_number_of_non_sequentially_written_sequential_write_preferred_zones", 75},
+    {"Optimal number of open sequential write preferred zones",
+     "optimal_number_of_open_sequential_write_preferred_zones", 55},
+    {"Optimal stream write size", "optimal_stream_write_size", 25},
+    {"Optimal transfer count", "optimal_transfer_count", 22},
+    {"Optimal transfer length", "optimal_transfer_length", 23},
+    {"Optimal transfer length granularity",
+     "optimal_transfer_length_granularity", 35},
+    {"Optimal unmap granularity", "optimal_unmap_granularity", 25},
+    {"Overrun counter", "overrun_counter", 15},
+    {"POA_SUP", "poa_sup", 7},
+    {"PRIOR_SUP", "prior_sup", 9},
+    {"PUEP", "puep", 4},
+    {"P_I_I_SUP", "p_i_i_sup", 9},
+    {"Partitions", "partitions", 10},
+    {"Path priority", "path_priority", 13},
+    {"Power consumption identifier", "power_consumption_identifier", 28},
+    {"Power on hours", "power_on_hours", 14},
+    {"Preference indicator", "preference_indicator", 20},
+    {"Preferred path auto changeable", "preferred_path_auto_changeable", 30},
+    {"Preset identifier", "preset_identifier", 17},
+    {"Product identification", "product_identification", 22},
+    {"Product revision level", "product_revision_level", 22},
+    {"Product serial number", "product_serial_number", 21},
+    {"Protection field usage", "protection_field_usage", 22},
+    {"Protection interval exponent", "protection_interval_exponent", 28},
+    {"Protocol identifier", "protocol_identifier", 19},
+    {"Provisioning group descriptor", "provisioning_group_descriptor", 29},
+    {"RBWZ", "rbwz", 4},
+    {"REF_CHK", "ref_chk", 7},
+    {"RESET", "reset", 5},
+    {"RSCS", "rscs", 4},
+    {"RTD_SUP", "rtd_sup", 7},
+    {"RTP", "rtp", 3},
+    {"R_SUP", "r_sup", 5},
+    {"Read rule violations", "read_rule_violations", 20},
+    {"Realm id", "realm_id", 8},
+    {"Realms count", "realms_count", 12},
+    {"Realms descriptor length", "realms_descriptor_length", 24},
+    {"Relative port", "relative_port", 13},
+    {"Remote tokens", "remote_tokens", 13},
+    {"Repeat", "repeat", 6},
+    {"SAC", "sac", 3},
+    {"SAT Product identification", "sat_product_identification", 26},
+    {"SAT Product revision level", "sat_product_revision_level", 26},
+    {"SAT Vendor identification", "sat_vendor_identification", 25},
+    {"SIMPSUP", "simpsup", 7},
+    {"SNT product identification", "snt_product_identification", 26},
+    {"SNT product revision level", "snt_product_revision_level", 26},
+    {"SNT vendor identification", "snt_vendor_identification", 25},
+    {"SRB", "srb", 3},
+    {"Schema type", "schema_type", 11},
+    {"Sequential write data size", "sequential_write_data_size", 26},
+    {"Serial number", "serial_number", 13},
+    {"Service action", "service_action", 14},
+    {"Service buffer identifier", "service_buffer_identifier", 25},
+    {"Software Date", "software_date", 13},
+    {"Software Version", "software_version", 16},
+    {"Standby_y condition recovery time",
+     "standby_y_condition_recovery_time", 33},
+    {"Standby_z condition recovery time",
+     "standby_z_condition_recovery_time", 33},
+    {"Starting LBA", "starting_lba", 12},
+    {"Stopped condition recovery time", "stopped_condition_recovery_time", 31},
+    {"Stream granularity size", "stream_granularity_size", 23},
+    {"Subenclosure String In diagnostic page",
+     "subenclosure_string_in_diagnostic_page", 38},
+    {"Subenclosure help text diagnostic page",
+     "subenclosure_help_text_diagnostic_page", 38},
+    {"Suboptimal write commands", "suboptimal_write_commands", 25},
+    {"T0PS", "t0ps", 4},
+    {"T1PS", "t1ps", 4},
+    {"T2PS", "t2ps", 4},
+    {"T3PS", "t3ps", 4},
+    {"TLR control supported", "tlr_control_supported", 21},
+    {"TSMC", "tsmc", 4},
+    {"Target port group data", "target_port_group_data", 22},
+    {"Target port group present", "target_port_group_present", 25},
+    {"Threshold percentage", "threshold_percentage", 20},
+    {"Timestamp origin", "timestamp_origin", 16},
+    {"Total Read Commands", "total_read_commands", 19},
+    {"Total Write Commands", "total_write_commands", 20},
+    {"Total bytes read", "total_bytes_read", 16},
+    {"Total bytes written", "total_bytes_written", 19},
+    {"Total concurrent copies", "total_concurrent_copies", 23},
+    {"UASK_SUP", "uask_sup", 8},
+    {"URSWRZ", "urswrz", 6},
+    {"Underrun counter", "underrun_counter", 16},
+    {"Unmap granularity alignment", "unmap_granularity_alignment", 27},
+    {"User data segment multiplier", "user_data_segment_multiplier", 28},
+    {"Utilization A", "utilization_a", 13},
+    {"Utilization B", "utilization_b", 13},
+    {"Utilization interval", "utilization_interval", 20},
+    {"Utilization type", "utilization_type", 16},
+    {"Utilization units", "utilization_units", 17},
+    {"VBULS", "vbuls", 5},
+    {"VSA_SUP", "vsa_sup", 7},
+    {"VZDZT", "vzdzt", 5},
+    {"V_SUP", "v_sup", 5},
+    {"Vendor specific field", "vendor_specific_field", 21},
+    {"Version", "version", 7},
+    {"Volume access via", "volume_access_via", 17},
+    {"WABEREQ", "wabereq", 7},
+    {"WACEREQ", "wacereq", 7},
+    {"WORM", "worm", 4},
+    {"WU_SUP", "wu_sup", 6},
+    {"Workload utilization", "workload_utilization", 20},
+    {"Write rule violations", "write_rule_violations", 21},
+    {"Zero Seeks", "zero_seeks", 10},
+    {"Zone domain", "zone_domain", 11},
+    {"Zone domains reported", "zone_domains_reported", 21},
+    {"Zone domains returned list length",
+     "zone_domains_returned_list_length", 33},
+    {"Zone starting LBA granularity", "zone_starting_lba_granularity", 29},
+    {"Zoned alignment method", "zoned_alignment_method", 22},
+    {"Zoned block device extension", "zoned_block_device_extension", 28},
+    {"Zones emptied", "zones_emptied", 13},
+    {"alternate_controller", "alternate_controller", 20},
+    {"enclosure descriptor list", "enclosure_descriptor_list", 25},
+    {"enclosure logical identifier", "enclosure_logical_identifier", 28},
+    {"features", "features", 8},
+    {"name", "name", 4},
+    {"number of type descriptor headers",
+     "number_of_type_descriptor_headers", 33},
+    {"parameter_control_byte", "parameter_control_byte", 22},
+    {"phy identifier", "phy_identifier", 14},
+    {"subenclosure nickname", "subenclosure_nickname", 21},
+    {"subenclosure nickname additional status",
+     "subenclosure_nickname_additional_status", 39},
+    {"subenclosure nickname language code",
+     "subenclosure_nickname_language_code", 35},
+    {"subenclosure nickname status", "subenclosure_nickname_status", 28},
+    {"this_controller", "this_controller", 15},
+};
+
+#define SGJ_SNAKE_HASH_SZ 1024
+
+static const short sgj_snake_idx[SGJ_SNAKE_HASH_SZ] = {
+    53, 74, 276, -1, -1, -1, -1, -1, -1, -1, 207, -1, -1, -1, -1, -1, -1, -1,
+    35, 225, -1, -1, -1, -1, -1, 114, -1, -1, 91, 50, 15, 121, -1, -1, -1, 31,
+    -1, 1, -1, -1, -1, -1, 140, -1, -1, 271, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, 278, -1, -1, 132, 145, -1, -1, -1, -1, -1, 18,
+    -1, -1, -1, -1, 127, -1, 54, 56, -1, -1, 262, -1, 187, 234, -1, -1, 116,
+    -1, 221, -1, -1, 124, -1, 73, -1, -1, -1, 190, -1, -1, 210, -1, -1, -1,
+    183, -1, 199, -1, 148, -1, -1, -1, -1, -1, -1, -1, 81, -1, -1, -1, -1,
+    153, -1, -1, -1, 182, 49, 133, 130, 275, 109, -1, -1, 284, -1, -1, -1,
+    117, 26, -1, -1, -1, -1, -1, -1, 255, -1, -1, 88, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 48, -1, 232, -1, 12, -1, -1, -1, 282, -1, -1, -1, -1, -1, -1,
+    -1, 85, 46, -1, -1, -1, -1, -1, -1, 259, -1, -1, -1, -1, -1, -1, 212, 71,
+    197, 224, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 45, -1, 261, -1,
+    176, 28, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 231, -1, -1, -1,
+    129, -1, -1, -1, -1, -1, 70, -1, -1, 155, -1, -1, -1, -1, -1, -1, -1, -1,
+    211, -1, -1, -1, 158, -1, -1, -1, -1, -1, -1, -1, -1, 167, 89, 107, -1,
+    -1, -1, -1, -1, -1, -1, -1, 10, -1, -1, -1, 191, 9, 209, -1, -1, -1, -1,
+    -1, -1, -1, -1, 164, -1, 230, -1, -1, 251, -1, -1, 105, 160, 198, 80, 181,
+    -1, -1, -1, -1, 193, 47, 137, 138, 13, 247, 202, 266, 273, -1, 151, 256,
+    235, -1, -1, -1, -1, -1, -1, -1, -1, -1, 86, -1, -1, 2, 41, -1, -1, 119,
+    264, 6, -1, -1, -1, -1, 244, -1, -1, -1, -1, -1, -1, -1, 222, -1, 157, -1,
+    229, -1, -1, 75, -1, 186, -1, -1, 5, -1, -1, -1, -1, -1, -1, -1, -1, 60,
+    175, 66, -1, -1, -1, -1, -1, -1, -1, -1, -1, 90, -1, 136, 102, -1, -1, 19,
+    20, 21, 22, 267, -1, -1, -1, 236, -1, -1, -1, -1, 237, 100, 238, 23, 24,
+    25, 171, -1, -1, 120, -1, -1, -1, 283, -1, -1, -1, -1, -1, -1, 249, 250,
+    274, -1, -1, -1, -1, -1, -1, 39, -1, -1, -1, -1, -1, -1, 165, -1, -1, -1,
+    -1, -1, -1, -1, 204, 52, -1, -1, -1, -1, -1, -1, 213, -1, -1, -1, -1, -1,
+    -1, -1, 223, -1, 97, -1, -1, -1, -1, -1, 200, -1, -1, 239, -1, -1, -1, -1,
+    -1, -1, -1, -1, 184, -1, -1, -1, -1, -1, -1, -1, -1, 44, -1, -1, 98, -1,
+    -1, -1, -1, 36, -1, -1, -1, 11, -1, 62, 14, 77, -1, -1, 76, -1, 169, -1,
+    162, 108, 42, -1, -1, -1, -1, 161, -1, -1, -1, -1, -1, 131, -1, 96, -1,
+    149, -1, -1, -1, -1, -1, -1, -1, 83, -1, -1, -1, -1, -1, -1, -1, -1, 217,
+    -1, -1, -1, -1, -1, 228, -1, 156, -1, -1, -1, -1, -1, -1, -1, 285, 128,
+    -1, -1, -1, -1, -1, -1, 214, -1, 63, -1, -1, 64, -1, -1, -1, 67, 188, 258,
+    30, -1, -1, -1, -1, -1, -1, -1, -1, 8, 196, -1, -1, -1, -1, -1, -1, -1,
+    16, -1, -1, 65, -1, -1, -1, -1, -1, 115, 113, -1, -1, -1, 240, 57, 242,
+    -1, 180, 34, 146, 280, 93, -1, -1, 185, 194, 254, -1, -1, -1, -1, -1, 84,
+    -1, -1, 150, -1, 144, -1, -1, -1, -1, -1, -1, -1, -1, -1, 219, -1, -1, -1,
+    27, 279, -1, 277, -1, -1, 173, -1, 118, 203, 78, 103, 141, 252, -1, -1,
+    123, -1, -1, -1, 0, 7, -1, -1, -1, -1, -1, 227, 241, -1, 40, -1, -1, -1,
+    -1, -1, -1, 43, 195, -1, 82, -1, 215, -1, -1, -1, -1, 192, -1, -1, 3, 154,
+    -1, -1, 110, -1, 33, -1, 257, 272, -1, -1, -1, -1, 106, -1, -1, -1, 32,
+    -1, -1, -1, -1, -1, 216, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 38, -1, -1, 95, -1, -1, 68, 177, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, 286, -1, 72, -1, -1, -1, 270, -1, -1, 126, -1, 37, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, 166, -1, 125, 112, 122, 111, 189, 263, -1, -1, -1,
+    -1, 168, 92, 174, 265, -1, -1, 4, 178, -1, -1, 94, -1, -1, -1, -1, -1, -1,
+    -1, -1, 55, -1, -1, -1, -1, -1, -1, 58, -1, -1, 104, -1, 101, 139, -1,
+    142, -1, -1, -1, -1, -1, -1, -1, -1, 59, -1, -1, -1, -1, -1, -1, -1, -1,
+    208, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 163, -1, -1, -1, 147, -1, -1,
+    -1, 220, 243, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, 269, 17, 206, 201, -1, -1, -1, -1, 281,
+    -1, -1, -1, -1, -1, -1, -1, -1, 51, -1, -1, -1, -1, 226, -1, -1, -1, -1,
+    -1, -1, -1, -1, 99, 268, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 61,
+    -1, -1, -1, -1, -1, -1, 170, -1, 135, -1, 246, -1, -1, 143, -1, -1, 205,
+    -1, -1, -1, -1, -1, -1, -1, -1, 218, -1, 152, -1, -1, -1, -1, -1, -1, -1,
+    -1, 245, -1, -1, -1, 159, -1, 248, -1, 253, -1, -1, -1, -1, -1, 134, -1,
+    -1, -1, -1, -1, 287, -1, -1, -1, -1, -1, -1, -1, 233, -1, -1, -1, 179, 69,
+    -1, -1, -1, -1, -1, -1, -1, 87, 172, 29, -1, -1, -1, 260, -1, -1, -1, 79,
+    -1, -1, -1,
+};
@@ -49,6 +49,16 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+#               /* nop */
+#elif defined(HAVE_GETTIMEOFDAY)
+#include <sys/time.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_lib_data.h"
 #include "sg_unaligned.h"
@@ -3898,6 +3908,415 @@ fini:
     return ret;
 }
 
+/* Decodes the LBA,NUM pairs in one line of an extent list (see sg_lib.h).
+ * A LBA,NUM pair may straddle two lines. */
+int
+sg_parse_lba_pairs(const char * line, struct sg_lba_pairs_st * sp,
+                   const char * src, int line_num)
+{
+    int k, res;
+    int64_t ll;
+    uint64_t ull;
+    const char * lcp = line;
+
+    lcp += strspn(lcp, " \t\r");
+    if (('\0' == *lcp) || ('#' == *lcp))
+        return 0;
+    /* Accept lines with leading 'HEX' as long as they come _before_ any
+     * LBA,NUM pair. This allows HEX marked lists to be concatenated. */
+    if (((0 == sp->off) || sp->hex_seen) && ('H' == toupper(lcp[0])) &&
+        ('E' == toupper(lcp[1])) && ('X' == toupper(lcp[2]))) {
+        sp->hex_seen = true;
+        if (sp->def_hex)
+            return 0;
+        if (sp->flexible) {
+            sp->def_hex = true;         /* okay, switch to hex parse */
+            return 0;
+        }
+        pr2ws("%s: 'hex' string detected on line %d, expecting decimal\n",
+              src, line_num);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    k = strspn(lcp, "0123456789aAbBcCdDeEfFhHxXiIkKmMgGtTpP, \t\r");
+    if (('\0' != lcp[k]) && ('#' != lcp[k])) {
+        pr2ws("%s: syntax error at line %d, pos %d\n", src, line_num,
+              (int)(lcp - line) + k + 1);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    while (true) {
+        if (sp->def_hex)    /* don't accept multipliers */
+            ll = (1 == sscanf(lcp, "%" SCNx64, &ull)) ? (int64_t)ull : -1;
+        else
+            ll = sg_get_llnum(lcp);
+        if (ll < 0) {
+            pr2ws("%s: bad number at line %d, pos %d\n", src, line_num,
+                  (int)(lcp - line + 1));
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        if (0x1 & sp->off) {
+            res = sp->add_fn(sp->lba, (uint64_t)ll, sp->argp);
+            if (res)
+                return res;
+        } else
+            sp->lba = (uint64_t)ll;
+        ++sp->off;
+        lcp = strpbrk(lcp, " ,\t\r#");
+        if ((NULL == lcp) || ('#' == *lcp))
+            break;
+        lcp += strspn(lcp, " ,\t\r");
+        if (('\0' == *lcp) || ('#' == *lcp))
+            break;
+    }
+    return 0;
+}
+
+/* Working state while building an extent array with sg_parse_lba_pairs() */
+struct sg_lba_ext_st {
+    int num;            /* elements used in arr */
+    int cap;            /* elements allocated in arr */
+    uint64_t max_lba_p1;        /* 0 for no limit */
+    struct sg_lba_extent * arr;
+};
+
+/* Appends lba,num to the extent array growing it as needed. Zero length
+ * extents are dropped, an extent that starts where the previous one ends
+ * is merged into it and a num greater than UINT32_MAX is split. */
+static int
+sg_lba_ext_add(uint64_t lba, uint64_t num, void * argp)
+{
+    uint32_t n;
+    struct sg_lba_ext_st * sp = (struct sg_lba_ext_st *)argp;
+    struct sg_lba_extent * ep;
+
+    if ((sp->max_lba_p1 > 0) &&
+        ((lba > sp->max_lba_p1) || (num > (sp->max_lba_p1 - lba)))) {
+        pr2ws("extent LBA=0x%" PRIx64 ", NUM=%" PRIu64 " exceeds "
+              "LBA limit 0x%" PRIx64 "\n", lba, num, sp->max_lba_p1);
+        return SG_LIB_LBA_OUT_OF_RANGE;
+    }
+    while (num > 0) {
+        if (sp->num > 0) {
+            ep = sp->arr + sp->num - 1;
+            if (((ep->lba + ep->num) == lba) && (ep->num < UINT32_MAX)) {
+                n = (num > (uint64_t)(UINT32_MAX - ep->num)) ?
+                                (UINT32_MAX - ep->num) : (uint32_t)num;
+                ep->num += n;
+                lba += n;
+                num -= n;
+                continue;
+            }
+        }
+        if (sp->num >= sp->cap) {
+            int new_cap = (sp->cap > 0) ? (2 * sp->cap) : 64;
+
+            ep = (struct sg_lba_extent *)realloc(sp->arr,
+                                                 new_cap * sizeof(*ep));
+            if (NULL == ep)
+                return sg_convert_errno(ENOMEM);
+            sp->arr = ep;
+            sp->cap = new_cap;
+        }
+        ep = sp->arr + sp->num;
+        n = (num > UINT32_MAX) ? UINT32_MAX : (uint32_t)num;
+        ep->lba = lba;
+        ep->num = n;
+        ++sp->num;
+        lba += n;
+        num -= n;
+    }
+    return 0;
+}
+
+/* Builds a scatter gather list of LBA extents from arg. If arg starts with
+ * '@' the rest is a filename ("-" for stdin), if it starts with 'H@' the
+ * file's numbers are all hex; otherwise arg itself is the list. Numbers
+ * are LBA,NUM pairs separated by commas or whitespace; in files '#' starts
+ * a comment. Adjacent extents are coalesced. If max_lba_p1 is greater than
+ * 0, each extent's LBA+NUM must not exceed it. On success returns 0, writes
+ * a heap allocated array (that the caller should free) to *sglpp, its
+ * element count to *num_elemsp and, if sum_blksp is non-NULL, the total
+ * number of blocks to *sum_blksp. Otherwise returns an SG_LIB_* error. */
+int
+sg_get_lba_extents(const char * arg, struct sg_lba_extent ** sglpp,
+                   int * num_elemsp, int64_t * sum_blksp,
+                   int64_t max_lba_p1, int verbose)
+{
+    bool has_stdin = false;
+    int k, in_len, err;
+    int ret = 0;
+    int64_t sum;
+    const char * fname = NULL;
+    FILE * fp = NULL;
+    struct sg_lba_pairs_st ps;
+    struct sg_lba_ext_st st;
+    char line[1024];
+
+    if ((NULL == arg) || (NULL == sglpp) || (NULL == num_elemsp)) {
+        pr2ws("%s: bad arguments\n", __func__);
+        return SG_LIB_LOGIC_ERROR;
+    }
+    memset(&st, 0, sizeof(st));
+    st.max_lba_p1 = (max_lba_p1 > 0) ? (uint64_t)max_lba_p1 : 0;
+    memset(&ps, 0, sizeof(ps));
+    ps.flexible = true;
+    ps.add_fn = sg_lba_ext_add;
+    ps.argp = &st;
+    if ('@' == arg[0])
+        fname = arg + 1;
+    else if (('H' == toupper(arg[0])) && ('@' == arg[1])) {
+        fname = arg + 2;
+        ps.def_hex = true;
+    }
+    if (NULL == fname)
+        ret = sg_parse_lba_pairs(arg, &ps, "command line", 1);
+    else {
+        has_stdin = (0 == strcmp(fname, "-"));
+        if (has_stdin)
+            fp = stdin;
+        else if (NULL == (fp = fopen(fname, "r"))) {
+            err = errno;
+            pr2ws("Unable to open %s for reading: %s\n", fname,
+                  safe_strerror(err));
+            return sg_convert_errno(err);
+        }
+        for (k = 1; fgets(line, sizeof(line), fp); ++k) {
+            in_len = strlen(line);
+            if ((in_len > 0) && ('\n' == line[in_len - 1]))
+                line[in_len - 1] = '\0';
+            else if (! feof(fp)) {
+                pr2ws("%s: line %d too long, max %d bytes\n", fname, k,
+                      (int)sizeof(line) - 1);
+                ret = SG_LIB_SYNTAX_ERROR;
+                break;
+            }
+            ret = sg_parse_lba_pairs(line, &ps, fname, k);
+            if (ret)
+                break;
+        }
+        if (! has_stdin)
+            fclose(fp);
+    }
+    if ((0 == ret) && (0x1 & ps.off)) {
+        pr2ws("%s: expect even number of items: LBA0,NUM0,LBA1,NUM1...\n",
+              fname ? fname : __func__);
+        ret = SG_LIB_SYNTAX_ERROR;
+    }
+    if ((0 == ret) && (0 == st.num)) {
+        pr2ws("%s: no extents (with NUM > 0) found\n",
+              fname ? fname : __func__);
+        ret = SG_LIB_SYNTAX_ERROR;
+    }
+    if (ret) {
+        free(st.arr);
+        return ret;
+    }
+    for (k = 0, sum = 0; k < st.num; ++k)
+        sum += st.arr[k].num;
+    if (verbose > 1)
+        pr2ws("%s: %d extent%s (after coalescing), %" PRId64 " blocks\n",
+              fname ? fname : "command line", st.num,
+              (1 == st.num) ? "" : "s", sum);
+    *sglpp = st.arr;
+    *num_elemsp = st.num;
+    if (sum_blksp)
+        *sum_blksp = sum;
+    return 0;
+}
+
+/* Reads names (e.g. of DEVICEs) from the file fn ('-' for stdin), one per
+ * line. Leading and trailing whitespace is removed, then blank lines and
+ * lines starting with '#' are ignored. For each name add_fn() is called with
+ * a heap copy of the name which add_fn() owns if it returns 0. Stops at the
+ * first non-zero value returned by add_fn() and returns it. Returns 0 if
+ * successful, else an SG_LIB_* error. */
+int
+sg_read_name_list(const char * fn, int (*add_fn)(char * name, void * argp),
+                  void * argp)
+{
+    bool have_stdin = ((1 == strlen(fn)) && ('-' == fn[0]));
+    int n, res;
+    int ret = 0;
+    char * cp;
+    char * np;
+    FILE * fp;
+    char line[512];
+
+    fp = have_stdin ? stdin : fopen(fn, "r");
+    if (NULL == fp) {
+        int e = errno;
+
+        pr2ws("unable to open %s: %s\n", fn, safe_strerror(e));
+        return sg_convert_errno(e);
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        for (cp = line; isspace((uint8_t)*cp); ++cp)
+            ;
+        if (('\0' == *cp) || ('#' == *cp))
+            continue;
+        for (n = strlen(cp); (n > 0) && isspace((uint8_t)cp[n - 1]); --n)
+            ;
+        np = (char *)malloc(n + 1);
+        if (NULL == np) {
+            ret = sg_convert_errno(ENOMEM);
+            break;
+        }
+        memcpy(np, cp, n);
+        np[n] = '\0';
+        res = add_fn(np, argp);
+        if (res) {
+            free(np);
+            ret = res;
+            break;
+        }
+    }
+    if (! have_stdin)
+        fclose(fp);
+    return ret;
+}
+
+/* Calls work_fn(argp) from num_thr threads and waits for them to finish.
+ * If fewer threads can be created, continues with those that were; if
+ * none (or num_thr is 1 or less, or there is no pthread support) then
+ * work_fn(argp) is called from this thread. work_fn() is expected to take
+ * items from a list shared via argp, under its own lock, until none
+ * remain. Returns the number of threads used, which is at least 1. */
+int
+sg_run_workers(int num_thr, void * (*work_fn)(void * argp), void * argp)
+{
+#ifdef HAVE_PTHREAD_H
+    int k, res;
+    pthread_t * tid_arr;
+
+    if (num_thr > 1) {
+        tid_arr = (pthread_t *)calloc(num_thr, sizeof(pthread_t));
+        if (NULL == tid_arr)
+            num_thr = 0;
+        for (k = 0; k < num_thr; ++k) {
+            res = pthread_create(tid_arr + k, NULL, work_fn, argp);
+            if (res) {
+                pr2ws("%s: pthread_create: %s, continue with %d "
+                      "threads\n", __func__, safe_strerror(res), k);
+                break;
+            }
+        }
+        num_thr = k;
+        for (k = 0; k < num_thr; ++k)
+            pthread_join(tid_arr[k], NULL);
+        free(tid_arr);
+        if (num_thr > 0)
+            return num_thr;
+    }
+#else
+    if (num_thr) { ; }  /* unused, dummy to suppress warning */
+#endif
+    work_fn(argp);
+    return 1;
+}
+
+/* Places 'h:mm:ss' form of secs in b (or "-" if secs is negative), returns
+ * b. */
+char *
+sg_mdev_hms_str(long secs, char * b, int blen)
+{
+    if (secs < 0)
+        snprintf(b, blen, "-");
+    else
+        snprintf(b, blen, "%ld:%02ld:%02ld", secs / 3600, (secs / 60) % 60,
+                 secs % 60);
+    return b;
+}
+
+/* Estimated seconds until DEVICE completes based on its progress rate
+ * since its command was launched. Returns -1 if no estimate possible. */
+long
+sg_mdev_eta_secs(const struct sg_mdev_st * mdp, time_t now)
+{
+    long elapsed = (long)(now - mdp->start_tm);
+
+    if ((mdp->progress <= 0) || (elapsed <= 0))
+        return -1;
+    return (long)(((int64_t)(65536 - mdp->progress) * elapsed) /
+                  mdp->progress);
+}
+
+/* Outputs (to stdout) one line per DEVICE in mdarr followed by an
+ * aggregate line. start_tm is when the first command was launched. */
+void
+sg_mdev_report(const struct sg_mdev_st * mdarr, int num, time_t start_tm,
+               time_t now)
+{
+    int k, pr, num_act, num_done, num_fail;
+    long eta, max_eta;
+    int64_t sum = 0;
+    const struct sg_mdev_st * mdp;
+    char b[80];
+    char e[32];
+
+    printf("\n  %-20s  %-12s  %8s  %10s\n", "DEVICE", "state", "done",
+           "ETA");
+    for (k = 0, num_act = 0, num_done = 0, num_fail = 0, max_eta = 0;
+         k < num; ++k) {
+        mdp = mdarr + k;
+        if (mdp->active) {
+            ++num_act;
+            sum += (mdp->progress > 0) ? mdp->progress : 0;
+            eta = sg_mdev_eta_secs(mdp, now);
+            if ((eta < 0) || (max_eta < 0))
+                max_eta = -1;
+            else if (eta > max_eta)
+                max_eta = eta;
+            if (mdp->progress >= 0)
+                printf("  %-20s  %-12s  %7d%%  %10s\n", mdp->name,
+                       "in progress", (mdp->progress * 100) / 65536,
+                       sg_mdev_hms_str(eta, e, sizeof(e)));
+            else
+                printf("  %-20s  %-12s  %8s  %10s\n", mdp->name,
+                       "in progress", "-", "-");
+        } else if (mdp->res) {
+            ++num_fail;
+            sg_get_category_sense_str(mdp->res, sizeof(b), b, 0);
+            printf("  %-20s  failed: %s\n", mdp->name, b);
+        } else {
+            ++num_done;
+            sum += 65536;
+            printf("  %-20s  %-12s  %7d%%  after %s\n", mdp->name,
+                   "complete", 100,
+                   sg_mdev_hms_str((long)(mdp->end_tm - start_tm), e,
+                                   sizeof(e)));
+        }
+    }
+    pr = ((num - num_fail) > 0) ?
+         (int)((sum * 100) / ((int64_t)(num - num_fail) * 65536)) : 0;
+    printf("Elapsed %s: %d in progress, %d complete, %d failed; overall "
+           "%d%% done", sg_mdev_hms_str((long)(now - start_tm), e,
+                                        sizeof(e)),
+           num_act, num_done, num_fail, pr);
+    if (num_act > 0)
+        printf(", ETA %s\n", sg_mdev_hms_str(max_eta, e, sizeof(e)));
+    else
+        printf("\n");
+}
+
+/* Returns a monotonic time in microseconds, for timing and scheduling.
+ * Uses gettimeofday() if CLOCK_MONOTONIC is not available, and failing
+ * that time() (so whole seconds). */
+int64_t
+sg_get_monotonic_usecs(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (0 == clock_gettime(CLOCK_MONOTONIC, &ts))
+        return ((int64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#elif defined(HAVE_GETTIMEOFDAY)
+    struct timeval tv;
+
+    if (0 == gettimeofday(&tv, NULL))
+        return ((int64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+#endif
+    return (int64_t)time(NULL) * 1000000;
+}
+
 /* Extract character sequence from ATA words as in the model string
  * in a IDENTIFY DEVICE response. Returns number of characters
  * written to 'ochars' before 0 character is found or 'num' words
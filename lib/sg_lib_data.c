@@ -24,7 +24,7 @@
  * standards. Note the version string below applies to the whole library.
  */
 
-const char * const sg_lib_version_str = "3.17 20260401";
+const char * const sg_lib_version_str = "3.18 20261018";
 /* spc6r11, sbc6r02, zbc3r03 */
 
 
@@ -7,7 +7,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-/* sg_pt_linux version 1.56 20230412 */
+/* sg_pt_linux version 1.57 20261018 */
 
 
 #include <stdio.h>
@@ -35,10 +35,16 @@
 #include <linux/major.h>
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "sg_pt.h"
 #include "sg_lib.h"
 #include "sg_linux_inc.h"
 #include "sg_pt_linux.h"
+#include "sg_pt_trace.h"
+#include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
 
@@ -1058,6 +1064,152 @@ get_pt_nvme_nsid(const struct sg_pt_base * vp)
     return ptp->nvme_nsid;
 }
 
+static bool checked_ev_record = false;
+static FILE * pt_record_fp = NULL;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t pt_record_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void
+sg_lin_trace_lock(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&pt_record_mutex);
+#endif
+}
+
+static void
+sg_lin_trace_unlock(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&pt_record_mutex);
+#endif
+}
+
+/* Opens the trace file named by the SG3_UTILS_PT_RECORD environment
+ * variable, appending to it. Writes the trace header if the file is
+ * empty. Only tried once, on the first command. Caller holds the trace
+ * lock. */
+static void
+sg_lin_trace_open(int verbose)
+{
+    const char * cp = getenv(SG_PT_TRACE_RECORD_EV);
+    uint8_t hdr[SG_PT_TRACE_HDR_LEN];
+
+    checked_ev_record = true;
+    if ((NULL == cp) || ('\0' == *cp))
+        return;
+    pt_record_fp = fopen(cp, "ab");
+    if (NULL == pt_record_fp) {
+        pr2ws("%s: unable to open %s=%s: %s\n", __func__,
+              SG_PT_TRACE_RECORD_EV, cp, safe_strerror(errno));
+        return;
+    }
+    fseek(pt_record_fp, 0, SEEK_END);
+    if (0 == ftell(pt_record_fp)) {
+        memset(hdr, 0, sizeof(hdr));
+        memcpy(hdr, SG_PT_TRACE_MAGIC, sizeof(SG_PT_TRACE_MAGIC));
+        sg_put_unaligned_le16(SG_PT_TRACE_VERSION, hdr + 8);
+        if (fwrite(hdr, sizeof(hdr), 1, pt_record_fp) != 1) {
+            pr2ws("%s: unable to write trace header\n", __func__);
+            fclose(pt_record_fp);
+            pt_record_fp = NULL;
+            return;
+        }
+    }
+    if (verbose > 1)
+        pr2ws("recording pass-through commands to %s\n", cp);
+}
+
+/* If recording (see sg_pt_trace.h), appends a record of the command just
+ * executed on vp that returned 'ret'. The trace lock is held while the
+ * trace file is opened and while each record is written so that threads
+ * sharing the library do not interleave records. Commands that never
+ * reached the device (no cdb) are not recorded. */
+void
+sg_lin_trace_rec(const struct sg_pt_base * vp, int kind, int ret,
+                 int verbose)
+{
+    const struct sg_pt_linux_scsi * ptp = &vp->impl;
+    int cdb_len, sense_len, din_len, dout_len;
+    uint64_t dur_ns;
+    uint8_t * bp;
+    uint8_t * b;
+
+    if (0 == ptp->io_hdr.request)
+        return;
+    sg_lin_trace_lock();
+    if (! checked_ev_record)
+        sg_lin_trace_open(verbose);
+    if (NULL == pt_record_fp)
+        goto fini;
+    cdb_len = ptp->io_hdr.request_len;
+    get_pt_req_lengths(vp, NULL, &dout_len);
+    din_len = 0;
+    sense_len = 0;
+    if (0 == ret) {
+        get_pt_actual_lengths(vp, &din_len, NULL);
+        if (ptp->io_hdr.response) {
+            sense_len = ptp->io_hdr.response_len;
+            if (sense_len > (int)ptp->io_hdr.max_response_len)
+                sense_len = ptp->io_hdr.max_response_len;
+        }
+    }
+    b = (uint8_t *)calloc(1, SG_PT_TRACE_REC_LEN + cdb_len + dout_len +
+                             din_len + sense_len);
+    if (NULL == b) {
+        if (verbose)
+            pr2ws("%s: out of memory, command not recorded\n", __func__);
+        goto fini;
+    }
+    dur_ns = get_pt_duration_ns(vp);
+    if (0 == dur_ns)
+        dur_ns = (uint64_t)get_scsi_pt_duration_ms(vp) * 1000000;
+    b[0] = (uint8_t)kind;
+    b[1] = ptp->is_nvme ? SG_PT_TRACE_F_NVME : 0;
+    sg_put_unaligned_le16(cdb_len, b + 2);
+    sg_put_unaligned_le16(sense_len, b + 4);
+    b[6] = (uint8_t)get_scsi_pt_result_category(vp);
+    sg_put_unaligned_le32((uint32_t)ret, b + 8);
+    sg_put_unaligned_le32(ptp->os_err, b + 12);
+    sg_put_unaligned_le32(get_scsi_pt_status_response(vp), b + 16);
+    sg_put_unaligned_le32(get_pt_result(vp), b + 20);
+    sg_put_unaligned_le32(ptp->io_hdr.transport_status, b + 24);
+    sg_put_unaligned_le32(ptp->io_hdr.driver_status, b + 28);
+    sg_put_unaligned_le32(dout_len, b + 32);
+    sg_put_unaligned_le32(din_len, b + 36);
+    sg_put_unaligned_le32(get_scsi_pt_resid(vp), b + 40);
+    sg_put_unaligned_le32(ptp->nvme_nsid, b + 44);
+    sg_put_unaligned_le64(dur_ns, b + 48);
+    bp = b + SG_PT_TRACE_REC_LEN;
+    memcpy(bp, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.request, cdb_len);
+    bp += cdb_len;
+    if (dout_len > 0) {
+        memcpy(bp, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.dout_xferp,
+               dout_len);
+        bp += dout_len;
+    }
+    if (din_len > 0) {
+        memcpy(bp, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.din_xferp,
+               din_len);
+        bp += din_len;
+    }
+    if (sense_len > 0) {
+        memcpy(bp, (const uint8_t *)(sg_uintptr_t)ptp->io_hdr.response,
+               sense_len);
+        bp += sense_len;
+    }
+    if ((fwrite(b, bp - b, 1, pt_record_fp) != 1) ||
+        fflush(pt_record_fp)) {
+        if (verbose)
+            pr2ws("%s: write to trace failed: %s\n", __func__,
+                  safe_strerror(errno));
+    }
+    free(b);
+fini:
+    sg_lin_trace_unlock();
+}
+
 /* Executes SCSI command using sg v3 interface */
 static int
 do_scsi_pt_v3(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
@@ -1142,11 +1294,8 @@ do_scsi_pt_v4(struct sg_pt_linux_scsi * ptp, int fd, int time_secs,
     return 0;
 }
 
-/* Executes SCSI command (or at least forwards it to lower layers).
- * Returns 0 for success, negative numbers are negated 'errno' values from
- * OS system calls. Positive return values are errors from this package. */
-int
-do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+static int
+do_scsi_pt_low(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
 {
     struct sg_pt_linux_scsi * ptp = &vp->impl;
     bool have_checked_for_type = (ptp->dev_fd >= 0);
@@ -1202,3 +1351,15 @@ do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
     pr2ws("%s: Should never reach this point\n", __func__);
     return 0;
 }
+
+/* Executes SCSI command (or at least forwards it to lower layers).
+ * Returns 0 for success, negative numbers are negated 'errno' values from
+ * OS system calls. Positive return values are errors from this package. */
+int
+do_scsi_pt(struct sg_pt_base * vp, int fd, int time_secs, int verbose)
+{
+    int res = do_scsi_pt_low(vp, fd, time_secs, verbose);
+
+    sg_lin_trace_rec(vp, SG_PT_TRACE_SCSI, res, verbose);
+    return res;
+}
@@ -41,7 +41,7 @@
  *                   MA 02110-1301, USA.
  */
 
-/* sg_pt_linux_nvme version 1.22 20260411 */
+/* sg_pt_linux_nvme version 1.23 20261018 */
 
 /* This file contains a small "SPC-only" SNTL to support the SES pass-through
  * of SEND DIAGNOSTIC and RECEIVE DIAGNOSTIC RESULTS through NVME-MI
@@ -85,6 +85,7 @@
 #include "sg_snt.h"
 #include "sg_linux_inc.h"
 #include "sg_pt_linux.h"
+#include "sg_pt_trace.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
@@ -1718,7 +1719,7 @@ int
 do_nvm_pt(struct sg_pt_base * vp, int submq, int timeout_secs, int vb)
 {
     bool is_read = false;
-    int dlen;
+    int dlen, res;
     struct sg_pt_linux_scsi * ptp = &vp->impl;
     struct sg_nvme_passthru_cmd cmd;
     uint8_t * cmdp = (uint8_t *)&cmd;
@@ -1755,7 +1756,9 @@ do_nvm_pt(struct sg_pt_base * vp, int submq, int timeout_secs, int vb)
         if (dlen > 0)
             dp = (void *)(sg_uintptr_t)ptp->io_hdr.dout_xferp;
     }
-    return do_nvm_pt_low(ptp, &cmd, dp, dlen, is_read, timeout_secs, vb);
+    res = do_nvm_pt_low(ptp, &cmd, dp, dlen, is_read, timeout_secs, vb);
+    sg_lin_trace_rec(vp, SG_PT_TRACE_NVM, res, vb);
+    return res;
 }
 
 #else           /* (HAVE_NVME && (! IGNORE_NVME)) */
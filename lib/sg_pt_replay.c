@@ -0,0 +1,729 @@
+/*
+ * Copyright (c) 2026 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "sg_pt.h"
+#include "sg_lib.h"
+#include "sg_pt_trace.h"
+#include "sg_unaligned.h"
+#include "sg_pr2serr.h"
+
+/* Version 1.02 20261018 */
+
+/* Defines all the functions needed by the pt interface (see sg_pt.h). No
+ * device is accessed, instead each command is answered from a trace
+ * recorded earlier (see sg_pt_trace.h) and named by the SG3_UTILS_PT_REPLAY
+ * environment variable. This allows utilities to be run (e.g. benchmarked
+ * or debugged) without the device that the trace was recorded from.
+ *
+ * A command is matched by its cdb (or 64 byte NVMe command) and by its
+ * data-out (e.g. the data of a WRITE or MODE SELECT command). The
+ * trace is searched from the record after the previous match, wrapping
+ * around at the end, so repeated commands are answered in recorded order.
+ * A SCSI command that is not found yields a CHECK CONDITION with ILLEGAL
+ * REQUEST, invalid command operation code. The trace is assumed to be
+ * from one device. The list of functions with external linkage is at the
+ * top of sg_pt_dummy.c . */
+
+#define REPLAY_FIRST_FD 1024    /* fake file descriptors start here */
+
+#define INVALID_OPCODE 0x20
+
+/* larger data-out or data-in lengths in a record mean it is corrupt */
+#define REPLAY_MAX_DATA_LEN (256 * 1024 * 1024)
+
+struct sg_pt_replay {
+    bool is_nvme;
+    int dev_fd;         /* -1 if not given (yet) */
+    int os_err;
+    int transport_err;
+    int driver_status;
+    int status;
+    int category;
+    int cdb_len;
+    int max_sense_len;
+    int sense_len;
+    int din_len;
+    int din_act;
+    int dout_len;
+    uint32_t result;
+    uint32_t nvme_nsid;
+    uint64_t duration_ns;
+    const uint8_t * cdbp;
+    uint8_t * sensep;
+    uint8_t * dinp;
+    const uint8_t * doutp;
+};
+
+struct sg_pt_base {
+    struct sg_pt_replay impl;
+};
+
+static int replay_state;        /* 0: not loaded, 1: loaded, -1: failed */
+static int replay_num_recs;
+static int replay_next_rec;     /* search for a match starts here */
+static int replay_next_fd = REPLAY_FIRST_FD;
+static uint8_t * replay_buf;    /* whole trace file */
+static const uint8_t ** replay_recs;    /* start of each record */
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t replay_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* The replay_* statics above are shared by every thread in the process, so
+ * loading, searching and fd allocation are done holding replay_mutex. */
+static void
+replay_lock(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&replay_mutex);
+#endif
+}
+
+static void
+replay_unlock(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&replay_mutex);
+#endif
+}
+
+
+/* Reads the whole trace named by SG3_UTILS_PT_REPLAY into memory and
+ * indexes its records. Only tried once. Returns 0 if successful, otherwise
+ * a positive errno value. Caller holds replay_mutex. */
+static int
+replay_load(int verbose)
+{
+    int k, n, len, err;
+    uint32_t dout_len, din_len;
+    long fsz;
+    const char * cp;
+    const uint8_t * bp;
+    FILE * fp;
+
+    if (replay_state)
+        return (replay_state > 0) ? 0 : EINVAL;
+    replay_state = -1;
+    cp = getenv(SG_PT_TRACE_REPLAY_EV);
+    if ((NULL == cp) || ('\0' == *cp)) {
+        pr2ws("replay pass-through: %s environment variable should name a "
+              "trace\n", SG_PT_TRACE_REPLAY_EV);
+        return EINVAL;
+    }
+    fp = fopen(cp, "rb");
+    if (NULL == fp) {
+        err = errno;
+        pr2ws("replay pass-through: unable to open %s: %s\n", cp,
+              safe_strerror(err));
+        return err;
+    }
+    if ((fseek(fp, 0, SEEK_END) < 0) || ((fsz = ftell(fp)) < 0) ||
+        (fseek(fp, 0, SEEK_SET) < 0)) {
+        err = errno;
+        fclose(fp);
+        return err ? err : EIO;
+    }
+    if (fsz > INT32_MAX) {
+        pr2ws("replay pass-through: trace %s is too large\n", cp);
+        fclose(fp);
+        return EFBIG;
+    }
+    replay_buf = (uint8_t *)malloc(fsz + 1);
+    if (NULL == replay_buf) {
+        fclose(fp);
+        return ENOMEM;
+    }
+    n = (int)fread(replay_buf, 1, fsz, fp);
+    fclose(fp);
+    if ((n != fsz) || (n < SG_PT_TRACE_HDR_LEN) ||
+        memcmp(replay_buf, SG_PT_TRACE_MAGIC, sizeof(SG_PT_TRACE_MAGIC)) ||
+        (SG_PT_TRACE_VERSION != sg_get_unaligned_le16(replay_buf + 8))) {
+        pr2ws("replay pass-through: %s is not a pass-through trace\n", cp);
+        goto bad;
+    }
+    /* first pass counts and checks records, second pass indexes them */
+    for (k = 0; k < 2; ++k) {
+        for (bp = replay_buf + SG_PT_TRACE_HDR_LEN, n = 0;
+             bp < replay_buf + fsz; bp += len, ++n) {
+            if (bp + SG_PT_TRACE_REC_LEN > replay_buf + fsz)
+                goto trunc;
+            dout_len = sg_get_unaligned_le32(bp + 32);
+            din_len = sg_get_unaligned_le32(bp + 36);
+            if ((dout_len > REPLAY_MAX_DATA_LEN) ||
+                (din_len > REPLAY_MAX_DATA_LEN))
+                goto trunc;
+            len = SG_PT_TRACE_REC_LEN + sg_get_unaligned_le16(bp + 2) +
+                  sg_get_unaligned_le16(bp + 4) + (int)dout_len +
+                  (int)din_len;
+            if ((len > fsz) ||
+                (bp + len > replay_buf + fsz))
+                goto trunc;
+            if (replay_recs)
+                replay_recs[n] = bp;
+        }
+        if (0 == k) {
+            replay_recs = (const uint8_t **)calloc(n + 1,
+                                                   sizeof(*replay_recs));
+            if (NULL == replay_recs) {
+                free(replay_buf);
+                replay_buf = NULL;
+                return ENOMEM;
+            }
+        }
+    }
+    replay_num_recs = n;
+    replay_state = 1;
+    if (verbose > 1)
+        pr2ws("replay pass-through: %d commands in %s\n", n, cp);
+    return 0;
+trunc:
+    pr2ws("replay pass-through: trace %s is truncated or corrupt\n", cp);
+bad:
+    free(replay_recs);
+    replay_recs = NULL;
+    free(replay_buf);
+    replay_buf = NULL;
+    return EINVAL;
+}
+
+/* Returns the next record of 'kind' whose command and data-out match, or
+ * NULL. Caller holds replay_mutex. */
+static const uint8_t *
+replay_find(int kind, const struct sg_pt_replay * ptp)
+{
+    int k, j;
+    int dout_len = ptp->doutp ? ptp->dout_len : 0;
+    const uint8_t * rp;
+
+    for (k = 0; k < replay_num_recs; ++k) {
+        j = (replay_next_rec + k) % replay_num_recs;
+        rp = replay_recs[j];
+        if ((kind == rp[0]) &&
+            (ptp->cdb_len == sg_get_unaligned_le16(rp + 2)) &&
+            (dout_len == (int)sg_get_unaligned_le32(rp + 32)) &&
+            (0 == memcmp(rp + SG_PT_TRACE_REC_LEN, ptp->cdbp,
+                         ptp->cdb_len)) &&
+            ((0 == dout_len) ||
+             (0 == memcmp(rp + SG_PT_TRACE_REC_LEN + ptp->cdb_len,
+                          ptp->doutp, dout_len)))) {
+            replay_next_rec = (j + 1) % replay_num_recs;
+            return rp;
+        }
+    }
+    return NULL;
+}
+
+/* Returns >= 0 if successful. If error in Unix returns negated errno. */
+int
+scsi_pt_open_device(const char * device_name, bool read_only, int verbose)
+{
+    int oflags = 0 /* O_NONBLOCK*/ ;
+
+    oflags |= (read_only ? O_RDONLY : O_RDWR);
+    return scsi_pt_open_flags(device_name, oflags, verbose);
+}
+
+/* Nothing is opened, device_name is only checked for presence. Returns a
+ * fake file descriptor (>= 0) if the trace can be loaded, otherwise
+ * returns negated errno. */
+int
+scsi_pt_open_flags(const char * device_name, int flags, int verbose)
+{
+    int err, fd;
+
+    if (flags) {}
+    if ((NULL == device_name) || ('\0' == *device_name))
+        return -EINVAL;
+    replay_lock();
+    err = replay_load(verbose);
+    fd = err ? -err : replay_next_fd++;
+    replay_unlock();
+    return fd;
+}
+
+/* Returns 0 if successful. If error in Unix returns negated errno. */
+int
+scsi_pt_close_device(int device_fd)
+{
+    if (device_fd < REPLAY_FIRST_FD)
+        return -EBADF;
+    return 0;
+}
+
+struct sg_pt_base *
+construct_scsi_pt_obj_with_fd(int device_fd, int verbose)
+{
+    struct sg_pt_replay * ptp;
+
+    ptp = (struct sg_pt_replay *)calloc(1, sizeof(struct sg_pt_replay));
+    if (ptp) {
+        ptp->dev_fd = -1;
+        set_pt_file_handle((struct sg_pt_base *)ptp, device_fd, verbose);
+    } else if (verbose)
+        pr2ws("%s: calloc() out of memory\n", __func__);
+    return (struct sg_pt_base *)ptp;
+}
+
+struct sg_pt_base *
+construct_scsi_pt_obj(void)
+{
+    return construct_scsi_pt_obj_with_fd(-1, 0);
+}
+
+void
+destruct_scsi_pt_obj(struct sg_pt_base * vp)
+{
+    if (vp)
+        free(vp);
+}
+
+void
+clear_scsi_pt_obj(struct sg_pt_base * vp)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    if (ptp) {
+        int fd = ptp->dev_fd;
+        bool is_nvme = ptp->is_nvme;
+        uint32_t nsid = ptp->nvme_nsid;
+
+        memset(ptp, 0, sizeof(struct sg_pt_replay));
+        ptp->dev_fd = fd;
+        ptp->is_nvme = is_nvme;
+        ptp->nvme_nsid = nsid;
+    }
+}
+
+void
+partial_clear_scsi_pt_obj(struct sg_pt_base * vp)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    if (NULL == ptp)
+        return;
+    ptp->os_err = 0;
+    ptp->transport_err = 0;
+    ptp->driver_status = 0;
+    ptp->status = 0;
+    ptp->category = 0;
+    ptp->sense_len = 0;
+    ptp->result = 0;
+    ptp->duration_ns = 0;
+    ptp->din_len = 0;
+    ptp->din_act = 0;
+    ptp->dinp = NULL;
+    ptp->dout_len = 0;
+    ptp->doutp = NULL;
+}
+
+void
+set_scsi_pt_cdb(struct sg_pt_base * vp, const uint8_t * cdb,
+                int cdb_len)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    ptp->cdbp = cdb;
+    ptp->cdb_len = cdb ? cdb_len : 0;
+}
+
+int
+get_scsi_pt_cdb_len(const struct sg_pt_base * vp)
+{
+    return vp->impl.cdb_len;
+}
+
+uint8_t *
+get_scsi_pt_cdb_buf(const struct sg_pt_base * vp)
+{
+    return (uint8_t *)vp->impl.cdbp;
+}
+
+void
+set_scsi_pt_sense(struct sg_pt_base * vp, uint8_t * sense,
+                  int max_sense_len)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    if (sense && (max_sense_len > 0))
+        memset(sense, 0, max_sense_len);
+    ptp->sensep = sense;
+    ptp->max_sense_len = sense ? max_sense_len : 0;
+}
+
+/* from device */
+void
+set_scsi_pt_data_in(struct sg_pt_base * vp, uint8_t * dxferp,
+                    int dxfer_len)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    ptp->dinp = dxferp;
+    ptp->din_len = dxferp ? dxfer_len : 0;
+}
+
+/* to device */
+void
+set_scsi_pt_data_out(struct sg_pt_base * vp, const uint8_t * dxferp,
+                     int dxfer_len)
+{
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    ptp->doutp = dxferp;
+    ptp->dout_len = dxferp ? dxfer_len : 0;
+}
+
+void
+set_scsi_pt_packet_id(struct sg_pt_base * vp, int pack_id)
+{
+    if (vp) {}
+    if (pack_id) {}
+}
+
+void
+set_scsi_pt_tag(struct sg_pt_base * vp, uint64_t tag)
+{
+    if (vp) {}
+    if (tag) {}
+}
+
+void
+set_scsi_pt_task_management(struct sg_pt_base * vp, int tmf_code)
+{
+    if (vp) {}
+    if (tmf_code) {}
+}
+
+void
+set_scsi_pt_task_attr(struct sg_pt_base * vp, int attrib, int priority)
+{
+    if (vp) {}
+    if (attrib) {}
+    if (priority) {}
+}
+
+void
+set_scsi_pt_flags(struct sg_pt_base * vp, int flags)
+{
+    if (vp) {}
+    if (flags) {}
+}
+
+/* Copies the outcome held in trace record rp into ptp and returns the
+ * value that do_scsi_pt() or do_nvm_pt() returned when it was recorded. */
+static int
+replay_answer(struct sg_pt_replay * ptp, const uint8_t * rp)
+{
+    int n;
+    int cdb_len = sg_get_unaligned_le16(rp + 2);
+    int sense_len = sg_get_unaligned_le16(rp + 4);
+    int dout_len = (int)sg_get_unaligned_le32(rp + 32);
+    int din_len = (int)sg_get_unaligned_le32(rp + 36);
+    const uint8_t * bp = rp + SG_PT_TRACE_REC_LEN + cdb_len + dout_len;
+
+    ptp->category = rp[6];
+    ptp->os_err = (int)sg_get_unaligned_le32(rp + 12);
+    ptp->status = (int)sg_get_unaligned_le32(rp + 16);
+    ptp->result = sg_get_unaligned_le32(rp + 20);
+    ptp->transport_err = (int)sg_get_unaligned_le32(rp + 24);
+    ptp->driver_status = (int)sg_get_unaligned_le32(rp + 28);
+    ptp->duration_ns = sg_get_unaligned_le64(rp + 48);
+    n = (din_len < ptp->din_len) ? din_len : ptp->din_len;
+    if (n > 0)
+        memcpy(ptp->dinp, bp, n);
+    ptp->din_act = n;
+    bp += din_len;
+    n = (sense_len < ptp->max_sense_len) ? sense_len : ptp->max_sense_len;
+    if (n > 0)
+        memcpy(ptp->sensep, bp, n);
+    ptp->sense_len = n;
+    return (int)sg_get_unaligned_le32(rp + 8);
+}
+
+static int
+replay_do(struct sg_pt_base * vp, int kind, int fd, int verbose)
+{
+    int err;
+    struct sg_pt_replay * ptp = &vp->impl;
+    const uint8_t * rp;
+
+    if (fd >= 0)
+        ptp->dev_fd = fd;
+    else if (ptp->dev_fd < 0) {
+        if (verbose)
+            pr2ws("%s: invalid file descriptors\n", __func__);
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    if ((NULL == ptp->cdbp) || (ptp->cdb_len < 1)) {
+        if (verbose)
+            pr2ws("No command (cdb) given [replay]\n");
+        return SCSI_PT_DO_BAD_PARAMS;
+    }
+    replay_lock();
+    err = replay_load(verbose);
+    rp = err ? NULL : replay_find(kind, ptp);
+    replay_unlock();
+    if (err) {
+        ptp->os_err = err;
+        ptp->category = SCSI_PT_RESULT_OS_ERR;
+        return -err;
+    }
+    if (rp)
+        return replay_answer(ptp, rp);
+    if (verbose > 1) {
+        pr2ws("%s: command not found in trace:\n", __func__);
+        hex2stderr(ptp->cdbp, ptp->cdb_len, -1);
+    }
+    if (SG_PT_TRACE_NVM == kind)
+        return SCSI_PT_DO_NOT_SUPPORTED;
+    ptp->status = SAM_STAT_CHECK_CONDITION;
+    ptp->category = SCSI_PT_RESULT_SENSE;
+    if (ptp->sensep && (ptp->max_sense_len >= 18)) {
+        sg_build_sense_buffer(false, ptp->sensep, SPC_SK_ILLEGAL_REQUEST,
+                              INVALID_OPCODE, 0);
+        ptp->sense_len = 18;
+    }
+    return 0;
+}
+
+int
+do_scsi_pt(struct sg_pt_base * vp, int device_fd, int time_secs, int verbose)
+{
+    if (time_secs) {}
+    return replay_do(vp, SG_PT_TRACE_SCSI, device_fd, verbose);
+}
+
+int
+get_scsi_pt_result_category(const struct sg_pt_base * vp)
+{
+    return vp->impl.category;
+}
+
+int
+get_scsi_pt_resid(const struct sg_pt_base * vp)
+{
+    const struct sg_pt_replay * ptp = &vp->impl;
+
+    return (ptp->din_len > 0) ? (ptp->din_len - ptp->din_act) : 0;
+}
+
+void
+get_pt_req_lengths(const struct sg_pt_base * vp, int * req_dinp,
+                   int * req_doutp)
+{
+    const struct sg_pt_replay * ptp = &vp->impl;
+
+    if (req_dinp)
+        *req_dinp = ptp->din_len;
+    if (req_doutp)
+        *req_doutp = ptp->dout_len;
+}
+
+void
+get_pt_actual_lengths(const struct sg_pt_base * vp, int * act_dinp,
+                      int * act_doutp)
+{
+    const struct sg_pt_replay * ptp = &vp->impl;
+
+    if (act_dinp)
+        *act_dinp = ptp->din_act;
+    if (act_doutp)
+        *act_doutp = ptp->dout_len;
+}
+
+
+int
+get_scsi_pt_status_response(const struct sg_pt_base * vp)
+{
+    return vp->impl.status;
+}
+
+int
+get_scsi_pt_sense_len(const struct sg_pt_base * vp)
+{
+    return vp->impl.sense_len;
+}
+
+uint8_t *
+get_scsi_pt_sense_buf(const struct sg_pt_base * vp)
+{
+    return vp->impl.sensep;
+}
+
+int
+get_scsi_pt_duration_ms(const struct sg_pt_base * vp)
+{
+    return (int)(vp->impl.duration_ns / 1000000);
+}
+
+/* If not available return 0 otherwise return number of nanoseconds that the
+ * lower layers (and hardware) took to execute the command just completed.
+ * Here that is the duration when the trace was recorded. */
+uint64_t
+get_pt_duration_ns(const struct sg_pt_base * vp)
+{
+    return vp->impl.duration_ns;
+}
+
+int
+get_scsi_pt_transport_err(const struct sg_pt_base * vp)
+{
+    return vp->impl.transport_err;
+}
+
+int
+get_scsi_pt_os_err(const struct sg_pt_base * vp)
+{
+    return vp->impl.os_err;
+}
+
+bool
+pt_device_is_nvme(const struct sg_pt_base * vp)
+{
+    return vp->impl.is_nvme;
+}
+
+char *
+get_scsi_pt_transport_err_str(const struct sg_pt_base * vp, int max_b_len,
+                              char * b)
+{
+    const struct sg_pt_replay * ptp = &vp->impl;
+
+    if (max_b_len < 1)
+        return b;
+    b[0] = '\0';
+    if (ptp->transport_err || ptp->driver_status)
+        snprintf(b, max_b_len, "Host_status=0x%02x Driver_status=0x%02x "
+                 "[replayed]\n", ptp->transport_err, ptp->driver_status);
+    return b;
+}
+
+char *
+get_scsi_pt_os_err_str(const struct sg_pt_base * vp, int max_b_len, char * b)
+{
+    const char * cp = safe_strerror(vp->impl.os_err);
+
+    if (max_b_len < 1)
+        return b;
+    strncpy(b, cp, max_b_len);
+    if ((int)strlen(cp) >= max_b_len)
+        b[max_b_len - 1] = '\0';
+    return b;
+}
+
+int
+do_nvm_pt(struct sg_pt_base * vp, int submq, int timeout_secs, int verbose)
+{
+    if (submq) { }
+    if (timeout_secs) { }
+    return replay_do(vp, SG_PT_TRACE_NVM, -1, verbose);
+}
+
+/* Returns 3 (NVMe char device) if the first command in the trace was sent
+ * to a NVMe device, otherwise 1 (SCSI generic device). */
+int
+check_pt_file_handle(int device_fd, const char * device_name, int vb)
+{
+    int err;
+
+    if (device_name) {}
+    if (device_fd < 0)
+        return 0;
+    replay_lock();
+    err = replay_load(vb);
+    replay_unlock();
+    if (err)
+        return -EINVAL;
+    return ((replay_num_recs > 0) &&
+            (SG_PT_TRACE_F_NVME & replay_recs[0][1])) ? 3 : 1;
+}
+
+/* Valid file handles (which is the return value) are >= 0 . Returns -1
+ * if there is no valid file handle. */
+int
+get_pt_file_handle(const struct sg_pt_base * vp)
+{
+    return vp->impl.dev_fd;
+}
+
+/* If a NVMe block device (which includes the NSID) handle is associated
+ * with 'vp', then its NSID is returned (values range from 0x1 to
+ * 0xffffffe). Otherwise 0 is returned. */
+uint32_t
+get_pt_nvme_nsid(const struct sg_pt_base * vp)
+{
+    return vp->impl.nvme_nsid;
+}
+
+uint32_t
+get_pt_result(const struct sg_pt_base * vp)
+{
+    return vp->impl.result;
+}
+
+/* The device type (SCSI or NVMe) and NSID are taken from the first
+ * command in the trace. */
+int
+set_pt_file_handle(struct sg_pt_base * vp, int dev_han, int vb)
+{
+    int err;
+    struct sg_pt_replay * ptp = &vp->impl;
+
+    ptp->dev_fd = dev_han;
+    ptp->is_nvme = false;
+    ptp->nvme_nsid = 0;
+    ptp->os_err = 0;
+    if (dev_han < 0)
+        return 0;
+    replay_lock();
+    err = replay_load(vb);
+    replay_unlock();
+    if (err) {
+        ptp->os_err = EINVAL;
+        return ptp->os_err;
+    }
+    if ((replay_num_recs > 0) && (SG_PT_TRACE_F_NVME & replay_recs[0][1])) {
+        ptp->is_nvme = true;
+        ptp->nvme_nsid = sg_get_unaligned_le32(replay_recs[0] + 44);
+    }
+    return 0;
+}
+
+void
+set_pt_metadata_xfer(struct sg_pt_base * vp, uint8_t * mdxferp,
+                     uint32_t mdxfer_len, bool out_true)
+{
+    if (vp) { }
+    if (mdxferp) { }
+    if (mdxfer_len) { }
+    if (out_true) { }
+}
+
+void
+set_scsi_pt_transport_err(struct sg_pt_base * vp, int err)
+{
+    vp->impl.transport_err = err;
+}
@@ -1,12 +1,12 @@
 /*
- * Copyright (c) 2014-2020 Douglas Gilbert.
+ * Copyright (c) 2014-2026 Douglas Gilbert.
  * All rights reserved.
  * Use of this source code is governed by a BSD-style
  * license that can be found in the BSD_LICENSE file.
  *
  * SPDX-License-Identifier: BSD-2-Clause
  *
- * Version 1.02 [20201124]
+ * Version 1.03 [20261018]
  */
 
 // C headers
@@ -16,11 +16,17 @@
 #include <limits.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 // C++ headers
 #include <array>
+#include <algorithm>
 
 #include "sg_scat_gath.h"
 #include "sg_lib.h"
@@ -54,6 +60,15 @@ scat_gath_list::num_elems() const
     return sgl.size();
 }
 
+/* All additions to the end of sgl come through here so that the cumulative
+ * block index (cum_blks) stays in step with sgl. */
+void
+scat_gath_list::push_elem(const scat_gath_elem & sge)
+{
+    sgl.push_back(sge);
+    cum_blks.push_back(cum_blks.back() + sge.num);
+}
+
 
 /* Read numbers (up to 64 bits in size) from command line (comma (or
  * (single) space **) separated list). Assumed decimal unless prefixed
@@ -102,14 +117,14 @@ scat_gath_list::load_from_cli(const char * cl_p, bool b_vb)
                     sge.num = (uint32_t)max_nbs;
                     prev_lba = sge.lba;
                     large_num -= max_nbs;
-                    sgl.push_back(sge);
+                    push_elem(sge);
                 } else {
                     sge.num = (uint32_t)large_num;
                     split = false;
                     if (b_vb)
                         pr2serr("%s: split large sg elem into %d element%s\n",
                                 __func__, j, (j == 1 ? "" : "s"));
-                    sgl.push_back(sge);
+                    push_elem(sge);
                     goto check_for_next;
                 }
                 continue;
@@ -152,7 +167,7 @@ scat_gath_list::load_from_cli(const char * cl_p, bool b_vb)
                             (int)(lcp - cl_p + 1));
                 goto err_out;
             }
-            sgl.push_back(sge);
+            push_elem(sge);
 check_for_next:
             cp = (char *)strchr(lcp, ',');
             c2p = (char *)strchr(lcp, ' ');
@@ -180,22 +195,86 @@ err_out:
     return false;
 }
 
+/* Callback from sg_parse_lba_pairs() with each LBA,NUM pair. A NUM larger
+ * than MAX_SGL_NUM_VAL is split into several consecutive elements. */
+int
+scat_gath_list::add_lba_pair(uint64_t lba, uint64_t num, void * argp)
+{
+    int h = 0;
+    const uint64_t max_nbs = MAX_SGL_NUM_VAL;
+    struct parse_state * psp = (struct parse_state *)argp;
+    class scat_gath_elem sge;
+
+    sge.lba = lba;
+    while (num > max_nbs) {
+        sge.num = (uint32_t)max_nbs;
+        psp->sglp->push_elem(sge);
+        sge.lba += max_nbs;
+        num -= max_nbs;
+        ++h;
+    }
+    sge.num = (uint32_t)num;
+    psp->sglp->push_elem(sge);
+    if ((h > 0) && psp->b_vb)
+        pr2serr("%s: split large sg elem into %d elements\n", __func__,
+                h + 1);
+    return 0;
+}
+
+void
+scat_gath_list::init_parse(struct parse_state & ps, bool def_hex,
+                           bool flexible, bool b_vb)
+{
+    memset(&ps.lp, 0, sizeof(ps.lp));
+    ps.lp.def_hex = def_hex;
+    ps.lp.flexible = flexible;
+    ps.lp.add_fn = add_lba_pair;
+    ps.lp.argp = &ps;
+    ps.sglp = this;
+    ps.b_vb = b_vb;
+}
+
+/* Parses one line (NUL terminated, without its trailing newline) of a sgl
+ * file with the same parser that sg_get_lba_extents() uses. Numbers are
+ * LBA,NUM pairs but a pair may be split across lines, so the count of
+ * numbers decoded so far is carried in ps.lp.off . line_num is origin 0.
+ * Returns true if ok (including blank and comment lines), else sets m_errno
+ * and returns false. */
+bool
+scat_gath_list::parse_line(const char * line, int line_num, const char * fnp,
+                           struct parse_state & ps)
+{
+    if (sg_parse_lba_pairs(line, &ps.lp, fnp, line_num + 1)) {
+        m_errno = EINVAL;
+        return false;
+    }
+    return true;
+}
+
+bool
+scat_gath_list::parse_fini(const struct parse_state & ps, const char * fnp,
+                           bool b_vb)
+{
+    /* allow one items, but not higher odd number of items */
+    if ((ps.lp.off > 1) && (0x1 & ps.lp.off)) {
+        m_errno = EINVAL;
+        if (b_vb)
+            pr2serr("%s: %s: expect even number of items: "
+                    "LBA0,NUM0,LBA1,NUM1...\n", __func__, fnp);
+        return false;
+    }
+    return true;
+}
+
 bool
 scat_gath_list::file2sgl_helper(FILE * fp, const char * fnp, bool def_hex,
                                 bool flexible, bool b_vb)
 {
-    bool bit0;
-    bool pre_addr1 = true;
-    bool pre_hex_seen = false;
-    int in_len, k, j, m, ind;
-    const int max_nbs = MAX_SGL_NUM_VAL;
-    int off = 0;
-    int64_t ll;
-    uint64_t ull, prev_lba;
-    char * lcp;
-    class scat_gath_elem sge;
+    int in_len, j;
+    struct parse_state ps;
     char line[1024];
 
+    init_parse(ps, def_hex, flexible, b_vb);
     for (j = 0 ; ; ++j) {
         if (NULL == fgets(line, sizeof(line), fp))
             break;
@@ -205,7 +284,9 @@ scat_gath_list::file2sgl_helper(FILE * fp, const char * fnp, bool def_hex,
             if ('\n' == line[in_len - 1]) {
                 --in_len;
                 line[in_len] = '\0';
-            } else {
+            } else if (feof(fp))
+                ;       /* last line without newline is okay */
+            else {
                 m_errno = SG_LIB_SYNTAX_ERROR;
                 if (b_vb)
                     pr2serr("%s: %s: line too long, max %d bytes\n",
@@ -213,126 +294,11 @@ scat_gath_list::file2sgl_helper(FILE * fp, const char * fnp, bool def_hex,
                 goto err_out;
             }
         }
-        if (in_len < 1)
-            continue;
-        lcp = line;
-        m = strspn(lcp, " \t");
-        if (m == in_len)
-            continue;
-        lcp += m;
-        in_len -= m;
-        if ('#' == *lcp)
-            continue;
-        if (pre_addr1 || pre_hex_seen) {
-            /* Accept lines with leading 'HEX' and ignore as long as there
-             * is one _before_ any LBA,NUM lines in the file. This allows
-             * HEX marked sgls to be concaternated together. */
-            if (('H' == toupper(lcp[0])) && ('E' == toupper(lcp[1])) &&
-                ('X' == toupper(lcp[2]))) {
-                pre_hex_seen = true;
-                if (def_hex)
-                    continue; /* bypass 'HEX' marker line if expecting hex */
-                else {
-                    if (flexible) {
-                        def_hex = true; /* okay, switch to hex parse */
-                        continue;
-                    } else {
-                        pr2serr("%s: %s: 'hex' string detected on line %d, "
-                                "expecting decimal\n", __func__, fnp, j + 1);
-                        m_errno = EINVAL;
-                        goto err_out;
-                    }
-                }
-            }
-        }
-        k = strspn(lcp, "0123456789aAbBcCdDeEfFhHxXbBdDiIkKmMgGtTpP, \t");
-        if ((k < in_len) && ('#' != lcp[k])) {
-            m_errno = EINVAL;
-            if (b_vb)
-                pr2serr("%s: %s: syntax error at line %d, pos %d\n",
-                        __func__, fnp, j + 1, m + k + 1);
+        if (! parse_line(line, j, fnp, ps))
             goto err_out;
-        }
-        for (k = 0; k < 256; ++k) {
-            /* limit parseable items on one line to 256 */
-            if (def_hex) {      /* don't accept negatives or multipliers */
-                if (1 == sscanf(lcp, "%" SCNx64, &ull))
-                    ll = (int64_t)ull;
-                else
-                    ll = -1;    /* use (2**64 - 1) as error flag */
-            } else
-                ll = sg_get_llnum(lcp);
-            if (-1 != ll) {
-                ind = ((off + k) >> 1);
-                bit0 = !! (0x1 & (off + k));
-                if (ind >= SG_SGL_MAX_ELEMENTS) {
-                    m_errno = EINVAL;
-                    if (b_vb)
-                        pr2serr("%s: %s: array length exceeded\n", __func__,
-                                fnp);
-                    goto err_out;
-                }
-                if (bit0) {     /* bit0 set when decoding a NUM */
-                    if (ll < 0) {
-                        m_errno = EINVAL;
-                        if (b_vb)
-                            pr2serr("%s: %s: bad number in line %d, at pos "
-                                    "%d\n", __func__, fnp, j + 1,
-                                    (int)(lcp - line + 1));
-                        goto err_out;
-                    }
-                    if (ll > max_nbs) {
-                        int h = 1;
-
-                        /* split up this elem into multiple, smaller elems */
-                        do {
-                            sge.num = (uint32_t)max_nbs;
-                            prev_lba = sge.lba;
-                            sgl.push_back(sge);
-                            sge.lba = prev_lba + (uint64_t)max_nbs;
-                            ++h;
-                            off += 2;
-                            ll -= max_nbs;
-                        } while (ll > max_nbs);
-                        if (b_vb)
-                            pr2serr("%s: split large sg elem into %d "
-                                    "elements\n", __func__, h);
-                    }
-                    sge.num = (uint32_t)ll;
-                    sgl.push_back(sge);
-                } else {        /* bit0 clear when decoding a LBA */
-                    if (pre_addr1)
-                        pre_addr1 = false;
-                    sge.lba = (uint64_t)ll;
-                }
-            } else {    /* failed to decode number on line */
-                if ('#' == *lcp) { /* numbers before #, rest of line comment */
-                    --k;
-                    break;      /* goes to next line */
-                }
-                m_errno = EINVAL;
-                if (b_vb)
-                    pr2serr("%s: %s: error in line %d, at pos %d\n",
-                            __func__, fnp, j + 1, (int)(lcp - line + 1));
-                goto err_out;
-            }
-            lcp = strpbrk(lcp, " ,\t#");
-            if ((NULL == lcp) || ('#' == *lcp))
-                break;
-            lcp += strspn(lcp, " ,\t");
-            if ('\0' == *lcp)
-                break;
-        }       /* <<< end of for(k < 256) loop */
-        off += (k + 1);
     }   /* <<< end of for loop, one iteration per line */
-    /* allow one items, but not higher odd number of items */
-    if ((off > 1) && (0x1 & off)) {
-        m_errno = EINVAL;
-        if (b_vb)
-            pr2serr("%s: %s: expect even number of items: "
-                    "LBA0,NUM0,LBA1,NUM1...\n", __func__, fnp);
+    if (! parse_fini(ps, fnp, b_vb))
         goto err_out;
-    }
     clearerr(fp);    /* even EOF on first pass needs this before rescan */
     return true;
 err_out:
@@ -340,29 +306,67 @@ err_out:
     return false;
 }
 
+/* Like file2sgl_helper() but the whole file is in memory (bp, blen), as is
+ * the case after it has been mmap()-ed. Avoids stdio per line and lets the
+ * arrays be sized once up front. A final line without a trailing newline
+ * is accepted. */
+bool
+scat_gath_list::mem2sgl_helper(const char * bp, int64_t blen,
+                               const char * fnp, bool def_hex, bool flexible,
+                               bool b_vb)
+{
+    int in_len, j;
+    int64_t pos, rem;
+    const char * nlp;
+    struct parse_state ps;
+    char line[1024];
+
+    init_parse(ps, def_hex, flexible, b_vb);
+    /* guess at around 16 bytes per LBA,NUM line; vector grows if more */
+    sgl.reserve(sgl.size() + (blen / 16));
+    cum_blks.reserve(cum_blks.size() + (blen / 16));
+    for (j = 0, pos = 0; pos < blen; ++j) {
+        rem = blen - pos;
+        nlp = (const char *)memchr(bp + pos, '\n', rem);
+        in_len = nlp ? (int)(nlp - (bp + pos)) :
+                       (int)std::min<int64_t>(rem, sizeof(line));
+        if (in_len >= (int)sizeof(line)) {
+            m_errno = SG_LIB_SYNTAX_ERROR;
+            if (b_vb)
+                pr2serr("%s: %s: line %d too long, max %d bytes\n",
+                        __func__, fnp, j + 1, (int)(sizeof(line) - 1));
+            return false;
+        }
+        memcpy(line, bp + pos, in_len);
+        line[in_len] = '\0';
+        pos += in_len + 1;
+        if (! parse_line(line, j, fnp, ps))
+            return false;
+    }
+    return parse_fini(ps, fnp, b_vb);
+}
+
 /* Read numbers from filename (or stdin), line by line (comma (or (single)
- * space) separated list); places starting_LBA,number_of_block pairs in an
- * array of scat_gath_elem elements pointed to by the returned value. If
- * this fails NULL is returned and an error number is written to errp (if it
- * is non-NULL). Assumed decimal (and may have suffix multipliers) when
+ * space) separated list); appends starting_LBA,number_of_block pairs to
+ * this object's sgl. Assumed decimal (and may have suffix multipliers) when
  * def_hex==false; if a number is prefixed by '0x', '0X' or contains trailing
  * 'h' or 'H' that denotes a hex number. When def_hex==true all numbers are
  * assumed to be hex (ignored '0x' prefixes and 'h' suffixes) and multipliers
- * are not permitted. Heap allocates an array just big enough to hold all
- * elements if the file is countable. Pipes and stdin are not considered
- * countable. In the non-countable case an array of MAX_FIXED_SGL_ELEMS
- * elements is pre-allocated; if it is exceeded sg_convert_errno(EDOM) is
- * placed in *errp (if it is non-NULL). One of the first actions is to write
- * 0 to *errp (if it is non-NULL) so the caller does not need to zero it
- * before calling. */
+ * are not permitted. A regular file is mmap()-ed and parsed in place which
+ * suits very large lists (e.g. from filesystem extent maps); stdin, pipes
+ * and anything mmap() refuses are read line by line with stdio. There is
+ * no limit on the number of elements. On failure returns false with
+ * m_errno set. */
 bool
 scat_gath_list::load_from_file(const char * file_name, bool def_hex,
                                bool flexible, bool b_vb)
 {
     bool have_stdin;
     bool have_err = false;
+    int fd;
     FILE * fp;
     const char * fnp;
+    struct stat a_st;
 
     have_stdin = ((1 == strlen(file_name)) && ('-' == file_name[0]));
     if (have_stdin) {
@@ -370,14 +374,41 @@ scat_gath_list::load_from_file(const char * file_name, bool def_hex,
         fnp = "<stdin>";
     } else {
         fnp = file_name;
-        fp = fopen(fnp, "r");
-        if (NULL == fp) {
+        fd = open(fnp, O_RDONLY);
+        if (fd < 0) {
             m_errno = errno;
             if (b_vb)
                 pr2serr("%s: opening %s: %s\n", __func__, fnp,
                         safe_strerror(m_errno));
             return false;
         }
+        if ((0 == fstat(fd, &a_st)) && S_ISREG(a_st.st_mode) &&
+            (a_st.st_size > 0)) {
+            void * vp = mmap(NULL, a_st.st_size, PROT_READ, MAP_PRIVATE,
+                             fd, 0);
+
+            if (MAP_FAILED != vp) {
+                madvise(vp, a_st.st_size, MADV_SEQUENTIAL);
+                if (! mem2sgl_helper((const char *)vp, a_st.st_size, fnp,
+                                     def_hex, flexible, b_vb))
+                    have_err = true;
+                munmap(vp, a_st.st_size);
+                close(fd);
+                return have_err ? false : true;
+            }
+            if (b_vb)
+                pr2serr("%s: mmap(%s) failed, read instead\n", __func__,
+                        fnp);
+        }
+        fp = fdopen(fd, "r");
+        if (NULL == fp) {
+            m_errno = errno;
+            if (b_vb)
+                pr2serr("%s: fdopen %s: %s\n", __func__, fnp,
+                        safe_strerror(m_errno));
+            close(fd);
+            return false;
+        }
     }
     if (! file2sgl_helper(fp, fnp, def_hex, flexible, b_vb))
         have_err = true;
@@ -573,6 +604,7 @@ scat_gath_list::append_1or(int64_t extra_blks, int64_t start_lba)
             else
                 sge.num = max_nbs;
             sgl[o_num - 1] = sge;
+            cum_blks[o_num] = cum_blks[o_num - 1] + sge.num;
             cnt = sge.num;
             sum += cnt;
             sum_hard = true;
@@ -586,7 +618,7 @@ scat_gath_list::append_1or(int64_t extra_blks, int64_t start_lba)
         if (0 == extra_blks) {
             sge.lba = start_lba;
             sge.num = 0;
-            sgl.push_back(sge);
+            push_elem(sge);
             high_lba_p1 = sge.lba;
             return sgl.size();
         }
@@ -597,7 +629,7 @@ scat_gath_list::append_1or(int64_t extra_blks, int64_t start_lba)
             sge.num = extra_blks - cnt;
         else
             sge.num = max_nbs;
-        sgl.push_back(sge);
+        push_elem(sge);
         sum += sge.num;
     }           /* always loops at least once */
     sum_hard = true;
@@ -713,7 +745,8 @@ scat_gath_list::is_pipe_suitable() const
 }
 
 scat_gath_iter::scat_gath_iter(const scat_gath_list & parent)
-    : sglist(parent), it_el_ind(0), it_blk_off(0), blk_idx(0)
+    : sglist(parent), it_el_ind(0), it_blk_off(0), blk_idx(0),
+      extend_last(false)
 {
     int elems = sglist.num_elems();
 
@@ -721,53 +754,45 @@ scat_gath_iter::scat_gath_iter(const scat_gath_list & parent)
         extend_last = (0 == sglist.sgl[elems - 1].num);
 }
 
+/* Positions the iterator _blk_idx blocks from the start of the sgl. Uses a
+ * binary search on the list's cumulative block index so it is O(log n) in
+ * the number of elements, wherever the iterator was before. When _blk_idx
+ * falls on the boundary between two elements the iterator is left at the
+ * end of the earlier one (i.e. it_blk_off == num). Returns true if the
+ * position is valid or is EOL, else returns false. */
 bool
 scat_gath_iter::set_by_blk_idx(int64_t _blk_idx)
 {
-    bool first;
-    int k;
     const int elems = sglist.sgl.size();
     const int last_ind = elems - 1;
+    const std::vector<int64_t> & cum = sglist.cum_blks;
     int64_t bc = _blk_idx;
 
     if (bc < 0)
         return false;
-
     if (bc == blk_idx)
         return true;
-    else if (bc > blk_idx) {
-        k = it_el_ind;
-        bc -= blk_idx;
-    } else
-        k = 0;
-    for (first = true; k < elems; ++k, first = false) {
-        uint32_t num = ((k == last_ind) && extend_last) ? MAX_SGL_NUM_VAL :
-                                                          sglist.sgl[k].num;
-        if (first) {
-            if ((int64_t)(num - it_blk_off) < bc)
-                bc -= (num - it_blk_off);
-            else {
-                it_blk_off = bc + it_blk_off;
-                break;
-            }
-        } else {
-            if ((int64_t)num < bc)
-                bc -= num;
-            else {
-                it_blk_off = (uint32_t)bc;
-                break;
-            }
-        }
-    }
-    it_el_ind = k;
     blk_idx = _blk_idx;
+    if (elems < 1) {
+        it_el_ind = 0;
+        return (0 == it_blk_off);
+    }
+    if (bc <= cum[elems]) {
+        /* first element whose end is at or beyond bc */
+        auto it = std::lower_bound(cum.begin() + 1, cum.end(), bc);
 
-    if (k < elems)
+        it_el_ind = (int)(it - cum.begin()) - 1;
+        it_blk_off = (int)(bc - cum[it_el_ind]);
         return true;
-    else if ((k == elems) && (0 == it_blk_off))
-        return true;    /* EOL */
-    else
-        return false;
+    }
+    if (extend_last && ((bc - cum[last_ind]) <= MAX_SGL_NUM_VAL)) {
+        it_el_ind = last_ind;
+        it_blk_off = (int)(bc - cum[last_ind]);
+        return true;
+    }
+    it_el_ind = elems;
+    it_blk_off = (int)std::min<int64_t>(bc - cum[elems], INT_MAX);
+    return false;
 }
 
 /* Given a blk_count, the iterator (*iter_p) is moved toward the EOL.
@@ -1006,7 +1031,7 @@ int
 diff_between_iters(const class scat_gath_iter & left,
                    const class scat_gath_iter & right)
 {
-    int res, k, r_e_ind, l_e_ind;
+    int res, r_e_ind, l_e_ind;
 
     if (&left.sglist != &right.sglist) {
         pr2serr("%s: bad args\n", __func__);
@@ -1022,14 +1047,9 @@ diff_between_iters(const class scat_gath_iter & left,
     } else if (l_e_ind == r_e_ind)
         return (int)left.it_blk_off - (int)right.it_blk_off;
     /* (l_e_ind > r_e_ind) so (lhs > rhs) */
-    res = (int)right.sglist.sgl[r_e_ind].num - right.it_blk_off;
-    for (k = 1; (r_e_ind + k) < l_e_ind; ++k) {
-        // pr2serr("%s: k=%d, res=%d, num=%d\n", __func__, k, res,
-        //         (int)right.sglist.sgl[r_e_ind + k].num);
-        res += (int)right.sglist.sgl[r_e_ind + k].num;
-    }
+    res = (int)(right.sglist.cum_blks[l_e_ind] -
+                right.sglist.cum_blks[r_e_ind]) - right.it_blk_off;
     res += left.it_blk_off;
-    // pr2serr("%s: at exit res=%d\n", __func__, res);
     return res;
 }
 
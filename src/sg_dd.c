@@ -78,7 +78,7 @@
 #include "sg_pr2serr.h"
 #include "sg_pt.h"              /* used to get to SNTL for NVMe devices */
 
-static const char * version_str = "6.50 20231206";
+static const char * version_str = "6.55 20261018";
 
 static const char * my_name = "sg_dd: ";
 
@@ -116,6 +116,28 @@ static const char * my_name = "sg_dd: ";
 #define VERIFY10 0x2f
 #define VERIFY12 0xaf
 #define VERIFY16 0x8f
+#define SERVICE_ACTION_OUT_16_OP 0x9f   /* WRITE SCATTERED (16) uses this */
+#define WRITE_SCATTERED16_SA 0x12
+#define WRITE_STREAM16_OP 0x9a
+#define STREAM_CONTROL_OPEN 0x1
+#define STREAM_CONTROL_CLOSE 0x2
+#define STREAM_CONTROL_RESP_LEN 8
+#define VPD_BLOCK_LIMITS_EXT 0xb7
+#define VPD_BLE_RESP_LEN 64
+#define SCAT_LBARD_SZ 32        /* LBA range descriptor size */
+#define SCAT_MAX_LBARD 1024     /* cap, header then up to 32 KiB */
+#define ZBC_RZ_RESP_LEN (64 * 1024)     /* room for 1023 zone descriptors */
+#define ZBC_RZ_DESC_LEN 64
+#define ZBC_ZT_SWR 0x2          /* zone type: sequential write required */
+#define ZBC_ZT_SOBR 0x4         /* sequential or before required */
+#define ZBC_ZT_GAP 0x5
+#define ZBC_ZC_EMPTY 0x1        /* zone conditions */
+#define ZBC_ZC_INACTIVE 0x5
+#define ZBC_ZC_READ_ONLY 0xd
+#define ZBC_ZC_FULL 0xe
+#define ZBC_ZC_OFFLINE 0xf
+#define CLOSE_ZONE_SA 0x1
+#define FINISH_ZONE_SA 0x2
 
 #define DEF_TIMEOUT 60000       /* 60,000 millisecs == 60 seconds */
 
@@ -144,6 +166,7 @@ static const char * my_name = "sg_dd: ";
 
 #define SG_DD_BYPASS 999        /* failed but coe set */
 
+
 /* If platform does not support O_DIRECT then define it harmlessly */
 #ifndef O_DIRECT
 #define O_DIRECT 0
@@ -175,6 +198,7 @@ static int num_retries = 0;
 static bool start_tm_valid = false;
 static int max_uas = MAX_UNIT_ATTENTIONS;
 static int max_aborted = MAX_ABORTED_CMDS;
+static int sg_version = 0;
 static uint32_t glob_pack_id = 0;       /* pre-increment */
 static struct timeval start_tm;
 
@@ -200,10 +224,15 @@ struct flags_t {
     bool ff;
     bool fua;
     bool nocreat;
+    bool noscat;
+    bool noshare;
     bool random;
     bool sgio;
     bool sparse;
+    bool stream;
     bool zero;
+    bool zfinish;       /* oflag=zfinish: oflag=zoned then FINISH last zone */
+    bool zoned;
     int cdbsz;
     int cdl;
     int coe;
@@ -213,6 +242,15 @@ struct flags_t {
     int file_type;  /* not user input; from file/device examination: FT_* */
 };
 
+/* A zone of a host managed ZBC OFILE, from REPORT ZONES */
+struct sg_dd_zone {
+    int64_t start;              /* zone start LBA */
+    int64_t len;                /* zone length in blocks */
+    int64_t wp;                 /* write pointer, next LBA to write */
+    uint8_t type;               /* ZBC_ZT_* */
+    uint8_t cond;               /* ZBC_ZC_* */
+};
+
 struct opts_t
 {
     bool bpt_given;
@@ -221,8 +259,10 @@ struct opts_t
     bool do_sync;
     bool do_time;
     bool do_verify;          /* when false: do copy (which is default) */
+    bool dev_timeouts;       /* time=0|1,dev : device recommended */
     bool grpnum_given;
     bool nocopy;
+    bool share_active;       /* READ buffer shared with WRITE, sg v4 drv */
     bool verbose_given;
     bool version_given;
     uint8_t if_grpnum;
@@ -246,6 +286,24 @@ struct opts_t
     int progress;       /* --progress or -p, checked in sig_listen_thread */
     int verbose;
     int dry_run;
+    int i_sgl_elems;            /* number of extents in i_sgl */
+    int o_sgl_elems;            /* number of extents in o_sgl */
+    int64_t i_sgl_sum;          /* sum of blocks in i_sgl */
+    int64_t o_sgl_sum;          /* sum of blocks in o_sgl */
+    struct sg_lba_extent * i_sgl;   /* skip=@SFN or skip=LBA,NUM,... */
+    struct sg_lba_extent * o_sgl;   /* seek=@SFN or seek=LBA,NUM,... */
+    bool of_str_open;           /* oflag=stream: of_str_id is open */
+    uint16_t of_str_id;         /* assigned by STREAM CONTROL (open) */
+    bool scat_ok;               /* a WRITE SCATTERED has succeeded */
+    int scat_max_rd;            /* > 1 -> coalesce o_sgl extents */
+    int scat_lbdof;             /* room for LBA range descriptors in LBs */
+    uint32_t scat_rng_max;      /* max LBs per descriptor, 0 -> no limit */
+    uint32_t scat_xfer_max;     /* max LBs per command, 0 -> no limit */
+    int num_zones;              /* oflag=zoned: elements in zones */
+    int z_ind;                  /* index of zone being written */
+    struct sg_dd_zone * zones;  /* oflag=zoned: zones that copy writes */
+    struct sg_cmd_timeouts * in_ctp;    /* when dev_timeouts and the */
+    struct sg_cmd_timeouts * out_ctp;   /* device supplied them */
     struct sg_pt_base *in_ptp;    /* these two pointers only used if NVMe */
     struct sg_pt_base *out_ptp;   /* ... devices are detected */
     char in_fname[INOUTF_SZ];
@@ -298,6 +356,61 @@ print_stats(const char * str)
         pr2serr("%s%d miscompare error(s)\n", str, miscompare_errs);
 }
 
+/* oflag=stream: asks OFILE for a stream with STREAM CONTROL (open). The
+ * assigned stream id then goes into each WRITE STREAM(16). Returns 0 if
+ * successful. */
+static int
+stream_open(struct opts_t * op)
+{
+    int res, resid;
+    int vb = (op->verbose > 1) ? (op->verbose - 1) : 0;
+    uint8_t b[STREAM_CONTROL_RESP_LEN];
+    char e[80];
+
+    memset(b, 0, sizeof(b));
+    resid = 0;
+    res = sg_ll_stream_control(op->outfd, STREAM_CONTROL_OPEN, 0, b,
+                               sizeof(b), &resid, true, vb);
+    if (0 == res) {
+        if (((int)sizeof(b) - resid) < 6) {
+            pr2serr("%s: Stream control (open) response too short\n",
+                    __func__);
+            return SG_LIB_CAT_MALFORMED;
+        }
+        op->of_str_id = sg_get_unaligned_be16(b + 4);
+        op->of_str_open = true;
+        if (op->verbose)
+            pr2serr("Opened stream id %u on %s\n", op->of_str_id,
+                    op->out_fname);
+        return 0;
+    }
+    if (SG_LIB_CAT_INVALID_OP == res)
+        pr2serr("oflag=stream: %s does not support STREAM CONTROL\n",
+                op->out_fname);
+    else {
+        sg_get_category_sense_str(res, sizeof(e), e, op->verbose);
+        pr2serr("oflag=stream: Stream control (open): %s\n", e);
+    }
+    return res;
+}
+
+/* Closes the stream that stream_open() opened. Returns 0 if successful. */
+static int
+stream_close(struct opts_t * op)
+{
+    int res;
+    int vb = (op->verbose > 1) ? (op->verbose - 1) : 0;
+    uint8_t b[STREAM_CONTROL_RESP_LEN];
+
+    op->of_str_open = false;
+    res = sg_ll_stream_control(op->outfd, STREAM_CONTROL_CLOSE,
+                               op->of_str_id, b, sizeof(b), NULL, true, vb);
+    if (res)
+        pr2serr("Unable to close stream id %u\n", op->of_str_id);
+    else if (op->verbose)
+        pr2serr("Closed stream id %u\n", op->of_str_id);
+    return res;
+}
 
 static void
 interrupt_handler(int sig)
@@ -312,6 +425,8 @@ interrupt_handler(int sig)
     if (fscope_op->do_time)
         calc_duration_throughput(false);
     print_stats("");
+    if (fscope_op->of_str_open)
+        stream_close(fscope_op);
     kill(getpid (), sig);
 }
 
@@ -486,7 +601,7 @@ usage()
             "[grpnum=GN]\n"
             "              [odir=0|1] [of2=OFILE2] [retries=RETR] "
             "[sync=0|1]\n"
-            "              [time=0|1[,TO]] [verbose=VERB] [--compare] "
+            "              [time=0|1[,TO|dev]] [verbose=VERB] [--compare] "
             "[--progress]\n"
             "              [--verify]\n"
             "  where:\n"
@@ -519,7 +634,8 @@ usage()
             "    if          file or device to read from (def: stdin)\n"
             "    iflag       comma separated list from: [00,coe,dio,direct,"
             "dpo,dsync,\n"
-            "                excl,ff,flock,fua,nocache,null,pt,random,sgio]\n"
+            "                excl,ff,flock,fua,nocache,noshare,null,pt,random,"
+            "sgio]\n"
             "    obs         output logical block size (if given must be "
             "same as 'bs=')\n"
             "    odir        1->use O_DIRECT when opening block dev, "
@@ -532,16 +648,24 @@ usage()
             "                normal file or pipe\n"
             "    oflag       comma separated list from: [append,coe,dio,"
             "direct,dpo,\n"
-            "                dsync,excl,flock,fua,nocache,nocreat,null,pt,"
-            "sgio,sparse]\n"
+            "                dsync,excl,flock,fua,nocache,nocreat,noscat,"
+            "noshare,null,\n"
+            "                pt,sgio,sparse,stream,zfinish,zoned]\n"
             "    retries     retry sgio errors RETR times (def: 0)\n"
-            "    seek        block position to start writing to OFILE\n"
-            "    skip        block position to start reading from IFILE\n"
+            "    seek        block position to start writing to OFILE; or "
+            "@SFN (H@SFN\n"
+            "                for hex) or LBA0,NUM0,LBA1,NUM1... is a list "
+            "of extents\n"
+            "    skip        block position to start reading from IFILE; or "
+            "extents\n"
+            "                as for seek=\n"
             "    sync        0->no sync(def), 1->SYNCHRONIZE CACHE on "
             "OFILE after copy\n"
             "    time        0->no timing(def), 1->time plus calculate "
             "throughput;\n"
-            "                TO is command timeout in seconds (def: 60)\n"
+            "                TO is command timeout in seconds (def: 60), "
+            "'dev' for\n"
+            "                device recommended timeouts\n"
             "    verbose     0->quiet(def), 1->some noise, 2->more noise, "
             "etc\n"
             "    --compare|-c    same as --verify, compare IFILE with "
@@ -729,6 +853,19 @@ sg_build_scsi_cdb(uint8_t * cdbp, unsigned int blocks, int64_t start_block,
         break;
     case 16:
         sz_ind = 3;
+        if (write_true && flagp->stream && (! op->do_verify)) {
+            /* WRITE STREAM(16): STR_ID replaces the group number */
+            cdbp[0] = WRITE_STREAM16_OP;
+            sg_put_unaligned_be64(start_block, cdbp + 2);
+            sg_put_unaligned_be16(op->of_str_id, cdbp + 10);
+            sg_put_unaligned_be16(blocks, cdbp + 12);
+            if (blocks & (~0xffff)) {
+                pr2serr("%sfor WRITE STREAM(16), maximum number of blocks "
+                        "is %d\n", my_name, 0xffff);
+                return 1;
+            }
+            break;
+        }
         if (op->do_verify && write_true)
             cdbp[0] = ve_opcode[sz_ind];
         else
@@ -862,6 +999,24 @@ use_sntl(const uint8_t * scsiCdb, uint8_t * buff, int blocks,
     return ret;
 }
 
+/* Returns the timeout in milliseconds for the command in cdbp. When the
+ * device reported a timeout for it (time=0|1,dev) that is used, clamped so
+ * it stays within an int once converted to milliseconds; otherwise
+ * def_ms. */
+static int
+cmd_timeout_ms(const struct sg_cmd_timeouts * ctp, const uint8_t * cdbp,
+               int cdb_len, int def_ms)
+{
+    int secs;
+
+    if (NULL == ctp)
+        return def_ms;
+    secs = sg_cmd_timeout_secs(ctp, cdbp, cdb_len, def_ms / 1000);
+    if (secs > (INT_MAX / 1000))
+        secs = INT_MAX / 1000;
+    return 1000 * secs;
+}
+
 /* Does SCSI READ on IFILE. Returns 0 -> successful,
  * SG_LIB_SYNTAX_ERROR -> unable to build cdb,
  * SG_LIB_CAT_UNIT_ATTENTION -> try again,
@@ -899,10 +1054,13 @@ sg_read_low(uint8_t * buff, int blocks, int64_t from_block,
     io_hdr.dxferp = buff;
     io_hdr.mx_sb_len = SENSE_BUFF_LEN;
     io_hdr.sbp = senseBuff;
-    io_hdr.timeout = op->cmd_timeout;
+    io_hdr.timeout = cmd_timeout_ms(op->in_ctp, rdCmd, ifp->cdbsz,
+                                    op->cmd_timeout);
     io_hdr.pack_id = (int)++glob_pack_id;
     if (diop && *diop)
         io_hdr.flags |= SG_FLAG_DIRECT_IO;
+    if (op->share_active)       /* data stays in the driver for the WRITE */
+        io_hdr.flags |= (SGV4_FLAG_SHARE | SGV4_FLAG_NO_DXFER);
 
     if (op->verbose > 2)
         sg_print_command_len(rdCmd, ifp->cdbsz);
@@ -1281,49 +1439,45 @@ err_out:
 }
 
 
-/* Does a SCSI WRITE or VERIFY (if do_verify set) on OFILE. Returns:
- * 0 -> successful, SG_LIB_SYNTAX_ERROR -> unable to build cdb,
- * SG_LIB_CAT_NOT_READY, SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_MEDIUM_HARD,
+/* Issues the data-out command in wrCmd (WRITE, VERIFY or WRITE SCATTERED)
+ * on OFILE with dlen bytes from dbuff. blocks and to_block are only used
+ * in messages. Returns 0 -> successful, SG_LIB_CAT_NOT_READY,
+ * SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_MEDIUM_HARD,
  * SG_LIB_CAT_ABORTED_COMMAND, -2 -> recoverable (ENOMEM),
  * -1 -> unrecoverable error + others. SG_DD_BYPASS -> failed but coe set. */
 static int
-sg_write(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
-         bool * diop, struct opts_t * op)
+sg_write_low(int sg_fd, uint8_t * wrCmd, int cdb_len, uint8_t * dbuff,
+             int dlen, int blocks, int64_t to_block, bool * diop,
+             struct opts_t * op)
 {
     bool info_valid;
     int res;
     int bs = op->blk_sz;
     uint64_t io_addr = 0;
     const struct flags_t * ofp = &op->oflag;
-    uint8_t wrCmd[MAX_SCSI_CDBSZ];
     uint8_t senseBuff[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
     struct sg_io_hdr io_hdr;
     const char * op_str = op->do_verify ? "verifying" : "writing";
 
-    if (sg_build_scsi_cdb(wrCmd, blocks, to_block, true, op)) {
-        pr2serr("%sbad wr cdb build, to_block=%" PRId64 ", blocks=%d\n",
-                my_name, to_block, blocks);
-        return SG_LIB_SYNTAX_ERROR;
-    }
-    if (FT_NVME & ofp->file_type)
-        return use_sntl(wrCmd, buff, blocks, to_block, true, &io_addr, op);
-
     memset(&io_hdr, 0, sizeof(struct sg_io_hdr));
     io_hdr.interface_id = 'S';
-    io_hdr.cmd_len = ofp->cdbsz;
+    io_hdr.cmd_len = cdb_len;
     io_hdr.cmdp = wrCmd;
     io_hdr.dxfer_direction = SG_DXFER_TO_DEV;
-    io_hdr.dxfer_len = bs * blocks;
-    io_hdr.dxferp = buff;
+    io_hdr.dxfer_len = dlen;
+    io_hdr.dxferp = dbuff;
     io_hdr.mx_sb_len = SENSE_BUFF_LEN;
     io_hdr.sbp = senseBuff;
-    io_hdr.timeout = op->cmd_timeout;
+    io_hdr.timeout = cmd_timeout_ms(op->out_ctp, wrCmd, cdb_len,
+                                    op->cmd_timeout);
     io_hdr.pack_id = (int)++glob_pack_id;
     if (diop && *diop)
         io_hdr.flags |= SG_FLAG_DIRECT_IO;
+    if (op->share_active)       /* data-out is the preceding READ's buffer */
+        io_hdr.flags |= (SGV4_FLAG_SHARE | SGV4_FLAG_NO_DXFER);
 
     if (op->verbose > 2)
-        sg_print_command_len(wrCmd, ofp->cdbsz);
+        sg_print_command_len(wrCmd, cdb_len);
 
     while (((res = ioctl(sg_fd, SG_IO, &io_hdr)) < 0) &&
            ((EINTR == errno) || (EAGAIN == errno) || (EBUSY == errno)))
@@ -1386,7 +1540,7 @@ sg_write(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
     default:
         sg_chk_n_print3(op_str, &io_hdr, op->verbose > 1);
         if ((SG_LIB_CAT_ILLEGAL_REQ == res) && op->verbose)
-            sg_print_command_len(wrCmd, ofp->cdbsz);
+            sg_print_command_len(wrCmd, cdb_len);
         ++unrecovered_errs;
         if (ofp->coe) {
             if (op->verbose > 1)
@@ -1402,6 +1556,120 @@ sg_write(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
     return 0;
 }
 
+/* Does a SCSI WRITE or VERIFY (if do_verify set) on OFILE. Returns:
+ * 0 -> successful, SG_LIB_SYNTAX_ERROR -> unable to build cdb,
+ * SG_LIB_CAT_NOT_READY, SG_LIB_CAT_UNIT_ATTENTION, SG_LIB_CAT_MEDIUM_HARD,
+ * SG_LIB_CAT_ABORTED_COMMAND, -2 -> recoverable (ENOMEM),
+ * -1 -> unrecoverable error + others. SG_DD_BYPASS -> failed but coe set. */
+static int
+sg_write(int sg_fd, uint8_t * buff, int blocks, int64_t to_block,
+         bool * diop, struct opts_t * op)
+{
+    uint64_t io_addr = 0;
+    const struct flags_t * ofp = &op->oflag;
+    uint8_t wrCmd[MAX_SCSI_CDBSZ];
+
+    if (sg_build_scsi_cdb(wrCmd, blocks, to_block, true, op)) {
+        pr2serr("%sbad wr cdb build, to_block=%" PRId64 ", blocks=%d\n",
+                my_name, to_block, blocks);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    if (FT_NVME & ofp->file_type)
+        return use_sntl(wrCmd, buff, blocks, to_block, true, &io_addr, op);
+    return sg_write_low(sg_fd, wrCmd, ofp->cdbsz, buff, op->blk_sz * blocks,
+                        blocks, to_block, diop, op);
+}
+
+/* Writes 'blocks' from buff to the LBAs that the seek= extent list gives
+ * starting at cursor (ind, off). When they span more than one extent a
+ * single WRITE SCATTERED(16) is used, its LBA range descriptors being
+ * built in the op->scat_lbdof blocks that precede buff. If the device
+ * rejects the first WRITE SCATTERED, coalescing is turned off and one
+ * WRITE per extent is done instead. Returns as for sg_write(). */
+static int
+sg_write_scat(int sg_fd, uint8_t * buff, int blocks, int ind, uint32_t off,
+              bool * diop, struct opts_t * op)
+{
+    int k, n, num, res, coe;
+    int bs = op->blk_sz;
+    int hdr_len = op->scat_lbdof * bs;
+    int64_t first_lba = op->o_sgl[ind].lba + off;
+    const struct flags_t * ofp = &op->oflag;
+    uint8_t * up;
+    uint8_t wsCmd[MAX_SCSI_CDBSZ];
+
+    if ((op->scat_max_rd < 2) ||
+        (blocks <= (int64_t)op->o_sgl[ind].num - (int64_t)off))
+        goto per_extent;
+    up = buff - hdr_len;
+    memset(up, 0, hdr_len);     /* first 32 bytes are a reserved header */
+    for (n = 0, k = blocks; (k > 0) && (ind < op->o_sgl_elems);
+         ++n, k -= num, ++ind, off = 0) {
+        if (n >= op->scat_max_rd) {
+            pr2serr("%s: too many LBA range descriptors\n", __func__);
+            return -1;
+        }
+        num = op->o_sgl[ind].num - off;
+        if (num > k)
+            num = k;
+        up += SCAT_LBARD_SZ;
+        sg_put_unaligned_be64(op->o_sgl[ind].lba + off, up + 0);
+        sg_put_unaligned_be32((uint32_t)num, up + 8);
+    }
+    memset(wsCmd, 0, sizeof(wsCmd));
+    wsCmd[0] = SERVICE_ACTION_OUT_16_OP;
+    wsCmd[1] = WRITE_SCATTERED16_SA;
+    if (ofp->dpo)
+        wsCmd[2] |= 0x10;
+    if (ofp->fua)
+        wsCmd[2] |= 0x8;
+    if (ofp->cdl > 0) {
+        if (ofp->cdl & 0x4)
+            wsCmd[2] |= 0x1;
+        if (ofp->cdl & 0x3)
+            wsCmd[14] |= ((ofp->cdl & 0x3) << 6);
+    }
+    sg_put_unaligned_be16((uint16_t)op->scat_lbdof, wsCmd + 4);
+    sg_put_unaligned_be16((uint16_t)n, wsCmd + 8);
+    sg_put_unaligned_be32((uint32_t)blocks, wsCmd + 10);
+    wsCmd[14] |= 0x3f & op->of_grpnum;
+    if (op->verbose > 1)
+        pr2serr("    WRITE SCATTERED(16): %d LBA range descriptors, %d "
+                "blocks, first lba=0x%" PRIx64 "\n", n, blocks,
+                (uint64_t)first_lba);
+    coe = op->oflag.coe;
+    if (! op->scat_ok)
+        op->oflag.coe = 0;      /* so a rejection is seen, not bypassed */
+    res = sg_write_low(sg_fd, wsCmd, 16, buff - hdr_len,
+                       hdr_len + (bs * blocks), blocks, first_lba, diop, op);
+    op->oflag.coe = coe;
+    if (0 == res)
+        op->scat_ok = true;
+    else if ((! op->scat_ok) && ((SG_LIB_CAT_INVALID_OP == res) ||
+                                 (SG_LIB_CAT_ILLEGAL_REQ == res))) {
+        --unrecovered_errs;
+        pr2serr("WRITE SCATTERED rejected, falling back to a WRITE per "
+                "extent\n");
+        op->scat_max_rd = 0;
+        ind -= n;
+        off = (uint32_t)(first_lba - op->o_sgl[ind].lba);
+        goto per_extent;
+    }
+    return res;
+
+per_extent:
+    for (k = blocks; (k > 0) && (ind < op->o_sgl_elems);
+         k -= num, buff += (num * bs), ++ind, off = 0) {
+        num = op->o_sgl[ind].num - off;
+        if (num > k)
+            num = k;
+        res = sg_write(sg_fd, buff, num, op->o_sgl[ind].lba + off, diop, op);
+        if (res)
+            return res;
+    }
+    return 0;
+}
+
 /* Note that duration measurements may be effected by "discontinuous jumps
  * in the system time". */
 static void
@@ -1545,6 +1813,10 @@ process_flags(const char * arg, struct flags_t * fp)
             ++fp->nocache;
         else if (0 == strcmp(cp, "nocreat"))
             fp->nocreat = true;
+        else if (0 == strcmp(cp, "noscat"))
+            fp->noscat = true;
+        else if (0 == strcmp(cp, "noshare"))
+            fp->noshare = true;
         else if (0 == strcmp(cp, "null"))
             ;
         else if (0 == strcmp(cp, "pt"))
@@ -1555,6 +1827,13 @@ process_flags(const char * arg, struct flags_t * fp)
             fp->sgio = true;
         else if (0 == strcmp(cp, "sparse"))
             fp->sparse = true;
+        else if (0 == strcmp(cp, "stream"))
+            fp->stream = true;
+        else if (0 == strcmp(cp, "zfinish")) {
+            fp->zfinish = true;
+            fp->zoned = true;
+        } else if (0 == strcmp(cp, "zoned"))
+            fp->zoned = true;
         else {
             pr2serr("unrecognised flag: %s\n", cp);
             return 1;
@@ -2065,6 +2344,378 @@ check_progress(struct opts_t * op)
 #endif
 }
 
+/* Returns one plus the highest LBA in the extent list. */
+static int64_t
+sgl_high_lba_p1(const struct sg_lba_extent * sgl, int elems)
+{
+    int k;
+    int64_t hi = 0;
+
+    for (k = 0; k < elems; ++k) {
+        if ((int64_t)(sgl[k].lba + sgl[k].num) > hi)
+            hi = sgl[k].lba + sgl[k].num;
+    }
+    return hi;
+}
+
+/* Moves the extent list cursor (*indp, *offp) on by 'blocks' which should
+ * not exceed what remains in the current extent. At the end of an extent
+ * the cursor moves to the start of the next. Returns the LBA that the
+ * cursor then refers to. */
+static int64_t
+sgl_advance(const struct sg_lba_extent * sgl, int elems, int * indp,
+            uint32_t * offp, int blocks)
+{
+    *offp += blocks;
+    if (*offp >= sgl[*indp].num) {
+        ++*indp;
+        *offp = 0;
+    }
+    if (*indp >= elems)
+        return sgl[elems - 1].lba + sgl[elems - 1].num;
+    return sgl[*indp].lba + *offp;
+}
+
+/* When an extent list jumps to a new LBA, files accessed with read(2) and
+ * write(2) need their file offset moved. sg devices take the LBA in the
+ * cdb so need nothing. */
+static int
+sgl_lseek(int fd, int ft, int64_t lba, const char * which,
+          const struct opts_t * op)
+{
+    off64_t offset = (off64_t)lba * op->blk_sz;
+
+    if ((FT_SG | FT_DEV_NULL | FT_RANDOM_0_FF) & ft)
+        return 0;
+    if (lseek64(fd, offset, SEEK_SET) < 0) {
+        int err = errno;
+
+        pr2serr("%s%s: lseek64 to byte offset 0x%" PRIx64 " failed: %s\n",
+                my_name, which, (uint64_t)offset, safe_strerror(err));
+        return sg_convert_errno(err);
+    }
+    if (op->verbose > 2)
+        pr2serr("  >> %s: lseek64 SEEK_SET, byte offset=0x%" PRIx64 "\n",
+                which, (uint64_t)offset);
+    return 0;
+}
+
+static bool
+fd_is_sg_drv(int fd)
+{
+    struct stat a_st;
+
+    return (0 == fstat(fd, &a_st)) && S_ISCHR(a_st.st_mode) &&
+           (SCSI_GENERIC_MAJOR == major(a_st.st_rdev));
+}
+
+/* IFILE and OFILE are both FT_SG. If both are sg driver devices and that
+ * driver supports request sharing then each READ keeps its data in the
+ * driver and the following WRITE sends it from there. Otherwise, or when
+ * an option needs the data in user space, the copy goes via user space. */
+static void
+share_setup(struct opts_t * op)
+{
+    int vb = op->verbose;
+    const struct flags_t * ifp = &op->iflag;
+    const struct flags_t * ofp = &op->oflag;
+    struct sg_extended_info sei;
+
+    if (ifp->noshare || ofp->noshare)
+        return;
+    /* bsg and NVMe devices are FT_SG too but only the sg driver shares */
+    if ((FT_NVME & (ifp->file_type | ofp->file_type)) ||
+        (! fd_is_sg_drv(op->infd)) || (! fd_is_sg_drv(op->outfd)))
+        return;
+    sg_version = sg_linux_driver_version();
+    if (sg_version < SG_LINUX_SHARE_MIN_VERSION) {
+        if (vb)
+            pr2serr("sg driver version %d.%d.%d lacks request sharing, copy "
+                    "via user space\n", sg_version / 10000,
+                    (sg_version / 100) % 100, sg_version % 100);
+        return;
+    }
+    if (ifp->coe || ifp->dio || ofp->dio || ofp->sparse || op->do_verify ||
+        (op->out2fd >= 0) || (op->scat_max_rd > 1)) {
+        /* these need the data in, or from, user space */
+        if (vb)
+            pr2serr("request sharing not used with coe, dio, sparse, "
+                    "--verify, of2= or WRITE SCATTERED\n");
+        return;
+    }
+    memset(&sei, 0, sizeof(sei));
+    sei.sei_wr_mask |= SG_SEIM_SHARE_FD;
+    sei.sei_rd_mask |= SG_SEIM_SHARE_FD;
+    sei.share_fd = op->infd;
+    if (ioctl(op->outfd, SG_SET_GET_EXTENDED, &sei) < 0) {
+        pr2serr("ioctl(EXTENDED(shared_fd=%d)) failed: %s, so copy via user "
+                "space\n", op->infd, safe_strerror(errno));
+        return;
+    }
+    op->share_active = true;
+    if (vb)
+        pr2serr("sg driver version %d.%d.%d: READ buffers shared with WRITEs "
+                "(iflag=noshare to stop)\n", sg_version / 10000,
+                (sg_version / 100) % 100, sg_version % 100);
+}
+
+/* time=0|1,dev : fetches the command timeouts that the device reports
+ * with REPORT SUPPORTED OPERATION CODES. If that fails, *ctpp stays NULL
+ * and the default (60 second) timeout is used. */
+static void
+dev_timeouts_fetch(int fd, const char * fname, struct sg_cmd_timeouts ** ctpp,
+                   const struct opts_t * op)
+{
+    int res;
+    int vb = (op->verbose > 2) ? (op->verbose - 2) : 0;
+
+    res = sg_cmd_timeouts_fetch(fd, ctpp, false, vb);
+    if (res) {
+        char b[80];
+
+        sg_get_category_sense_str(res, sizeof(b), b, op->verbose);
+        pr2serr("Unable to fetch command timeouts from %s, using %d "
+                "seconds: %s\n", fname, op->cmd_timeout / 1000, b);
+    } else if (op->verbose)
+        pr2serr("%s: using device recommended command timeouts\n", fname);
+}
+
+/* Fetches the Block Limits Extension VPD page from OFILE. If it reports
+ * that WRITE SCATTERED takes more than one LBA range descriptor, sets up
+ * op->scat_* so that small seek= extents are written together. Otherwise
+ * op->scat_max_rd stays 0 and each extent gets its own WRITE. */
+static void
+scat_probe(struct opts_t * op)
+{
+    int res, len, max_rd;
+    int bs = op->blk_sz;
+    uint8_t b[VPD_BLE_RESP_LEN];
+
+    memset(b, 0, sizeof(b));
+    res = sg_ll_inquiry(op->outfd, false, true, VPD_BLOCK_LIMITS_EXT, b,
+                        sizeof(b), false, ((op->verbose > 2) ?
+                                           (op->verbose - 2) : 0));
+    if (res || (VPD_BLOCK_LIMITS_EXT != b[1])) {
+        if (op->verbose > 1)
+            pr2serr("No Block Limits Extension VPD page so no WRITE "
+                    "SCATTERED\n");
+        return;
+    }
+    len = sg_get_unaligned_be16(b + 2) + 4;
+    if (len < 28)
+        return;
+    max_rd = sg_get_unaligned_be16(b + 22);
+    if (max_rd > SCAT_MAX_LBARD)
+        max_rd = SCAT_MAX_LBARD;
+    if (max_rd > op->bpt)       /* each descriptor has at least 1 block */
+        max_rd = op->bpt;
+    if (op->verbose)
+        pr2serr("WRITE SCATTERED: maximum LBA range descriptor count=%u%s\n",
+                sg_get_unaligned_be16(b + 22),
+                (max_rd < 2) ? ", not used" : "");
+    if (max_rd < 2)
+        return;
+    op->scat_max_rd = max_rd;
+    op->scat_lbdof = ((max_rd + 1) * SCAT_LBARD_SZ + bs - 1) / bs;
+    op->scat_rng_max = sg_get_unaligned_be32(b + 16);
+    op->scat_xfer_max = sg_get_unaligned_be32(b + 24);
+}
+
+/* Called when the next transfer would overrun the current seek= extent.
+ * Gathers that extent and up to op->scat_max_rd - 1 following ones while
+ * the total stays within 'limit' and the device's scattered limits.
+ * Returns the number of blocks to transfer and sets *use_scatp when they
+ * cover more than one extent. */
+static int
+scat_gather(const struct opts_t * op, int limit, int ind, uint32_t off,
+            bool * use_scatp)
+{
+    bool last = false;
+    int n;
+    int blk_lim = limit;
+    int64_t num;
+    int64_t sum = 0;
+    int64_t first = (int64_t)op->o_sgl[ind].num - off;
+
+    if ((op->scat_xfer_max > 0) && ((uint32_t)limit > op->scat_xfer_max))
+        limit = op->scat_xfer_max;
+    for (n = 0; (n < op->scat_max_rd) && (ind < op->o_sgl_elems) &&
+                (sum < limit) && (! last); ++n, ++ind, off = 0) {
+        num = (int64_t)op->o_sgl[ind].num - off;
+        if ((op->scat_rng_max > 0) && (num > op->scat_rng_max)) {
+            num = op->scat_rng_max;
+            last = true;
+        }
+        if (num > limit - sum)
+            num = limit - sum;
+        sum += num;
+    }
+    *use_scatp = (n > 1);
+    if (*use_scatp)
+        return (int)sum;
+    return (first < blk_lim) ? (int)first : blk_lim;
+}
+
+static inline bool
+zone_is_seq(const struct sg_dd_zone * zp)
+{
+    return (ZBC_ZT_SWR == zp->type) || (ZBC_ZT_SOBR == zp->type);
+}
+
+/* oflag=zoned: reads the zones that the copy will write to with REPORT
+ * ZONES, then checks that each sequential zone can take the copy's data
+ * at its write pointer. Returns 0 if so. */
+static int
+zoned_setup(struct opts_t * op)
+{
+    int k, res, resid, num_zd, rlen;
+    int vb = (op->verbose > 1) ? (op->verbose - 1) : 0;
+    int num_seq = 0;
+    int64_t lba, first;
+    int64_t end = op->seek + op->dd_count;
+    const uint8_t * bp;
+    uint8_t * rzBuff;
+    uint8_t * free_rzBuff = NULL;
+    struct sg_dd_zone * zp;
+    char e[80];
+
+    rzBuff = sg_memalign(ZBC_RZ_RESP_LEN, 0, &free_rzBuff, false);
+    if (NULL == rzBuff)
+        return sg_convert_errno(ENOMEM);
+    res = 0;
+    for (lba = op->seek; lba < end; ) {
+        res = sg_ll_report_zones(op->outfd, lba, true, 0, rzBuff,
+                                 ZBC_RZ_RESP_LEN, &resid, true, vb);
+        if (res) {
+            if (SG_LIB_CAT_INVALID_OP == res)
+                pr2serr("oflag=zoned: %s does not support REPORT ZONES\n",
+                        op->out_fname);
+            else {
+                sg_get_category_sense_str(res, sizeof(e), e, op->verbose);
+                pr2serr("oflag=zoned: Report zones: %s\n", e);
+            }
+            goto fini;
+        }
+        rlen = ZBC_RZ_RESP_LEN - resid;
+        num_zd = (rlen > 64) ? ((rlen - 64) / ZBC_RZ_DESC_LEN) : 0;
+        if (0 == num_zd)
+            break;
+        zp = (struct sg_dd_zone *)realloc(op->zones, (op->num_zones +
+                                          num_zd) * sizeof(*zp));
+        if (NULL == zp) {
+            res = sg_convert_errno(ENOMEM);
+            goto fini;
+        }
+        op->zones = zp;
+        for (k = 0, bp = rzBuff + 64; (k < num_zd) && (lba < end);
+             ++k, bp += ZBC_RZ_DESC_LEN) {
+            zp = op->zones + op->num_zones++;
+            zp->type = bp[0] & 0xf;
+            zp->cond = (bp[1] >> 4) & 0xf;
+            zp->len = sg_get_unaligned_be64(bp + 8);
+            zp->start = sg_get_unaligned_be64(bp + 16);
+            zp->wp = sg_get_unaligned_be64(bp + 24);
+            if ((zp->len < 1) || (zp->start > lba)) {
+                pr2serr("oflag=zoned: bad zone descriptor at LBA 0x%" PRIx64
+                        "\n", (uint64_t)lba);
+                res = SG_LIB_CAT_MALFORMED;
+                goto fini;
+            }
+            lba = zp->start + zp->len;
+        }
+    }
+    if (lba < end) {
+        pr2serr("oflag=zoned: no zones reported from LBA 0x%" PRIx64 "\n",
+                (uint64_t)lba);
+        res = SG_LIB_CAT_MALFORMED;
+        goto fini;
+    }
+    for (k = 0, zp = op->zones; k < op->num_zones; ++k, ++zp) {
+        first = (zp->start > op->seek) ? zp->start : op->seek;
+        if ((ZBC_ZT_GAP == zp->type) || (ZBC_ZC_READ_ONLY == zp->cond) ||
+            (ZBC_ZC_OFFLINE == zp->cond) || (ZBC_ZC_INACTIVE == zp->cond)) {
+            pr2serr("oflag=zoned: zone at LBA 0x%" PRIx64 " can not be "
+                    "written (type=0x%x, condition=0x%x)\n",
+                    (uint64_t)zp->start, zp->type, zp->cond);
+            res = SG_LIB_CONTRADICT;
+            goto fini;
+        }
+        if (! zone_is_seq(zp))
+            continue;
+        ++num_seq;
+        if (ZBC_ZC_FULL == zp->cond)
+            zp->wp = zp->start + zp->len;   /* WP field invalid when full */
+        if ((first == zp->wp) ||
+            ((ZBC_ZT_SOBR == zp->type) && (first < zp->wp)))
+            continue;
+        pr2serr("oflag=zoned: copy would write zone at LBA 0x%" PRIx64
+                " from LBA 0x%" PRIx64 " but its write pointer is %s0x%"
+                PRIx64 "\n", (uint64_t)zp->start, (uint64_t)first,
+                (ZBC_ZC_FULL == zp->cond) ? "(full) " : "",
+                (uint64_t)zp->wp);
+        pr2serr("    set seek= to the write pointer or reset the zone with "
+                "sg_reset_wp\n");
+        res = SG_LIB_CONTRADICT;
+        goto fini;
+    }
+    if (op->verbose)
+        pr2serr("oflag=zoned: copy writes %d zone%s, %d of them "
+                "sequential\n", op->num_zones,
+                (1 == op->num_zones) ? "" : "s", num_seq);
+fini:
+    free(free_rzBuff);
+    return res;
+}
+
+/* oflag=zoned: called before each transfer, returns the number of blocks
+ * (no more than 'blocks') that can be written at op->seek without
+ * crossing the end of its zone */
+static int
+zoned_clamp(struct opts_t * op, int blocks)
+{
+    int64_t rem;
+    const struct sg_dd_zone * zp = op->zones + op->z_ind;
+
+    while ((op->z_ind < (op->num_zones - 1)) &&
+           (op->seek >= zp->start + zp->len))
+        zp = op->zones + ++op->z_ind;
+    rem = zp->start + zp->len - op->seek;
+    return (rem < blocks) ? (int)rem : blocks;
+}
+
+/* oflag=zoned: after the copy, a sequential zone that the copy left
+ * partially written is still open. CLOSE it (or FINISH it when
+ * oflag=zfinish) so it does not hold one of the device's open zone
+ * resources. Zones that filled up went to the full condition by
+ * themselves. Returns 0 if successful. */
+static int
+zoned_end(struct opts_t * op)
+{
+    int res, sa;
+    int vb = (op->verbose > 1) ? (op->verbose - 1) : 0;
+    const struct sg_dd_zone * zp;
+    char e[80];
+
+    if ((NULL == op->zones) || (op->z_ind >= op->num_zones))
+        return 0;
+    zp = op->zones + op->z_ind;
+    if ((! zone_is_seq(zp)) || (op->seek <= zp->start) ||
+        (op->seek >= zp->start + zp->len))
+        return 0;
+    sa = op->oflag.zfinish ? FINISH_ZONE_SA : CLOSE_ZONE_SA;
+    res = sg_ll_zone_out(op->outfd, sa, zp->start, 0, false, 0, true, vb);
+    if (res) {
+        sg_get_category_sense_str(res, sizeof(e), e, op->verbose);
+        pr2serr("oflag=zoned: %s zone at LBA 0x%" PRIx64 ": %s\n",
+                (FINISH_ZONE_SA == sa) ? "Finish" : "Close",
+                (uint64_t)zp->start, e);
+    } else if (op->verbose)
+        pr2serr("%s zone at LBA 0x%" PRIx64 "\n",
+                (FINISH_ZONE_SA == sa) ? "Finished" : "Closed",
+                (uint64_t)zp->start);
+    return res;
+}
+
 static int
 parse_cmd_line(int argc, char * argv[], struct opts_t * op)
 {
@@ -2240,16 +2891,44 @@ parse_cmd_line(int argc, char * argv[], struct opts_t * op)
                 return SG_LIB_SYNTAX_ERROR;
             }
         } else if (0 == strcmp(key, "seek")) {
-            op->seek = sg_get_llnum(buf);
-            if ((op->seek < 0) || (op->seek > MAX_COUNT_SKIP_SEEK)) {
-                pr2serr("%sbad argument to 'seek='\n", my_name);
-                return SG_LIB_SYNTAX_ERROR;
+            if (strchr(buf, ',') || strchr(buf, '@')) {
+                free(op->o_sgl);
+                op->o_sgl = NULL;
+                res = sg_get_lba_extents(buf, &op->o_sgl, &op->o_sgl_elems,
+                                         &op->o_sgl_sum,
+                                         MAX_COUNT_SKIP_SEEK, op->verbose);
+                if (res) {
+                    pr2serr("%sbad extent list given to 'seek='\n",
+                            my_name);
+                    return res;
+                }
+                op->seek = op->o_sgl[0].lba;
+            } else {
+                op->seek = sg_get_llnum(buf);
+                if ((op->seek < 0) || (op->seek > MAX_COUNT_SKIP_SEEK)) {
+                    pr2serr("%sbad argument to 'seek='\n", my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
             }
         } else if (0 == strcmp(key, "skip")) {
-            op->skip = sg_get_llnum(buf);
-            if ((op->skip < 0) || (op->skip > MAX_COUNT_SKIP_SEEK)) {
-                pr2serr("%sbad argument to 'skip='\n", my_name);
-                return SG_LIB_SYNTAX_ERROR;
+            if (strchr(buf, ',') || strchr(buf, '@')) {
+                free(op->i_sgl);
+                op->i_sgl = NULL;
+                res = sg_get_lba_extents(buf, &op->i_sgl, &op->i_sgl_elems,
+                                         &op->i_sgl_sum,
+                                         MAX_COUNT_SKIP_SEEK, op->verbose);
+                if (res) {
+                    pr2serr("%sbad extent list given to 'skip='\n",
+                            my_name);
+                    return res;
+                }
+                op->skip = op->i_sgl[0].lba;
+            } else {
+                op->skip = sg_get_llnum(buf);
+                if ((op->skip < 0) || (op->skip > MAX_COUNT_SKIP_SEEK)) {
+                    pr2serr("%sbad argument to 'skip='\n", my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
             }
         } else if (0 == strcmp(key, "sync"))
             op->do_sync = !! sg_get_num(buf);
@@ -2257,10 +2936,13 @@ parse_cmd_line(int argc, char * argv[], struct opts_t * op)
             const char * cp = strchr(buf, ',');
 
             op->do_time = !! sg_get_num(buf);
-            if (cp) {
+            if (cp && (0 == strcmp(cp + 1, "dev")))
+                op->dev_timeouts = true;
+            else if (cp) {
                 n = sg_get_num(cp + 1);
                 if (n < 0) {
-                    pr2serr("%sbad argument to 'time=0|1,TO'\n", my_name);
+                    pr2serr("%sbad argument to 'time=0|1,TO|dev'\n",
+                            my_name);
                     return SG_LIB_SYNTAX_ERROR;
                 }
                 op->cmd_timeout = n ? (n * 1000) : DEF_TIMEOUT;
@@ -2352,16 +3034,22 @@ parse_cmd_line(int argc, char * argv[], struct opts_t * op)
 int
 main(int argc, char * argv[])
 {
-    bool dio_tmp, first;
+    bool dio_tmp, dio_tmp2, first;
     bool do_sync = false;
+    bool use_scat = false;
     bool penult_sparse_skip = false;
     bool sparse_skip = false;
-    int k, res, buf_sz, blocks_per, bs;
+    int k, res, buf_sz, blocks_per, bs, scat_hdr;
     int retries_tmp, blks_read, bytes_read, bytes_of2, bytes_of;
     int in_sect_sz, out_sect_sz;
     int blocks = 0;
     int penult_blocks = 0;
     int ret = 0;
+    int i_ind = 0;
+    int o_ind = 0;
+    uint32_t i_off = 0;
+    uint32_t o_off = 0;
+    int64_t nxt;
     int64_t in_num_sect = -1;
     int64_t out_num_sect = -1;
     const char * ccp = NULL;
@@ -2425,7 +3113,7 @@ main(int argc, char * argv[])
         pr2serr("skip and seek cannot be negative\n");
         return SG_LIB_CONTRADICT;
     }
-    if (ofp->append && (op->seek > 0)) {
+    if (ofp->append && ((op->seek > 0) || op->o_sgl)) {
         pr2serr("Can't use both append and seek switches\n");
         return SG_LIB_CONTRADICT;
     }
@@ -2541,6 +3229,43 @@ main(int argc, char * argv[])
         if (changed)
             pr2serr(">> increasing cdbsz to 16 due to cdl > 0\n");
     }
+    if (ofp->stream) {
+        if (! (FT_SG & ofp->file_type) || (FT_NVME & ofp->file_type)) {
+            if (op->verbose)
+                pr2serr("oflag=stream ignored as OFILE is not a SCSI "
+                        "device\n");
+            ofp->stream = false;
+        } else if (op->do_verify) {
+            pr2serr("--verify cannot be used with oflag=stream\n");
+            ret = SG_LIB_CONTRADICT;
+            goto bypass_copy;
+        } else if (op->bpt > 0xffff) {
+            pr2serr("oflag=stream: WRITE STREAM(16) takes at most 65535 "
+                    "blocks, reduce bpt\n");
+            ret = SG_LIB_CONTRADICT;
+            goto bypass_copy;
+        } else if (16 != ofp->cdbsz) {
+            if (op->cdbsz_given) {
+                pr2serr("oflag=stream needs cdbsz=16 (WRITE STREAM(16))\n");
+                ret = SG_LIB_CONTRADICT;
+                goto bypass_copy;
+            }
+            ofp->cdbsz = 16;
+        }
+    }
+    if (ofp->zoned) {
+        if (! (FT_SG & ofp->file_type) || (FT_NVME & ofp->file_type)) {
+            pr2serr("oflag=zoned needs OFILE to be a sg device (or a block "
+                    "device with\noflag=sgio)\n");
+            ret = SG_LIB_CONTRADICT;
+            goto bypass_copy;
+        } else if (op->do_verify || ofp->sparse || op->o_sgl) {
+            pr2serr("oflag=zoned cannot be used with --verify, "
+                    "oflag=sparse or a\nseek= extent list\n");
+            ret = SG_LIB_CONTRADICT;
+            goto bypass_copy;
+        }
+    }
     if (op->out2_fname[0]) {
         op->out2_type = dd_filetype(op->out2_fname, op);
         if ((op->out2fd = open(op->out2_fname, O_WRONLY | O_CREAT,
@@ -2566,6 +3291,33 @@ main(int argc, char * argv[])
             return SG_LIB_CONTRADICT;
         }
     }
+    if (op->i_sgl && ((STDIN_FILENO == op->infd) ||
+                      (FT_FIFO & ifp->file_type))) {
+        pr2serr("skip= extent list needs a seekable IFILE\n");
+        return SG_LIB_CONTRADICT;
+    }
+    if (op->o_sgl && ((STDOUT_FILENO == op->outfd) ||
+                      (FT_FIFO & ofp->file_type))) {
+        pr2serr("seek= extent list needs a seekable OFILE\n");
+        return SG_LIB_CONTRADICT;
+    }
+    if (op->i_sgl || op->o_sgl) {
+        /* copy no more than the smaller extent list holds */
+        int64_t sgl_count = op->i_sgl ? op->i_sgl_sum : op->o_sgl_sum;
+
+        if (op->o_sgl && (op->o_sgl_sum < sgl_count))
+            sgl_count = op->o_sgl_sum;
+        if (op->i_sgl && op->o_sgl && (op->i_sgl_sum != op->o_sgl_sum) &&
+            (op->verbose > 0))
+            pr2serr("skip= and seek= extent lists hold %" PRId64 " and %"
+                    PRId64 " blocks, use the smaller\n", op->i_sgl_sum,
+                    op->o_sgl_sum);
+        if (op->dd_count > sgl_count)
+            pr2serr("count=%" PRId64 " reduced to %" PRId64 ", the blocks "
+                    "in the extent list\n", op->dd_count, sgl_count);
+        if ((op->dd_count < 0) || (op->dd_count > sgl_count))
+            op->dd_count = sgl_count;
+    }
 
     bs = op->blk_sz;
     if ((op->dd_count < 0) || ((op->verbose > 0) && (0 == op->dd_count))) {
@@ -2676,37 +3428,77 @@ main(int argc, char * argv[])
         return SG_LIB_CAT_OTHER;
     }
     if (! op->cdbsz_given) {
+        int64_t in_hi = op->i_sgl ?
+                        sgl_high_lba_p1(op->i_sgl, op->i_sgl_elems) :
+                        (op->dd_count + op->skip);
+        int64_t out_hi = op->o_sgl ?
+                         sgl_high_lba_p1(op->o_sgl, op->o_sgl_elems) :
+                         (op->dd_count + op->seek);
+
         if ((FT_SG & ifp->file_type) && (MAX_SCSI_CDBSZ != ifp->cdbsz) &&
-            (((op->dd_count + op->skip) > UINT_MAX) ||
-             (op->bpt > USHRT_MAX))) {
+            ((in_hi > UINT_MAX) || (op->bpt > USHRT_MAX))) {
             pr2serr("Note: SCSI command size increased to 16 bytes (for "
                     "'if')\n");
             ifp->cdbsz = MAX_SCSI_CDBSZ;
         }
         if ((FT_SG & ofp->file_type) && (MAX_SCSI_CDBSZ != ofp->cdbsz) &&
-            (((op->dd_count + op->seek) > UINT_MAX) ||
-             (op->bpt > USHRT_MAX))) {
+            ((out_hi > UINT_MAX) || (op->bpt > USHRT_MAX))) {
             pr2serr("Note: SCSI command size increased to 16 bytes (for "
                     "'of')\n");
             ofp->cdbsz = MAX_SCSI_CDBSZ;
         }
     }
 
+    if (op->dev_timeouts) {
+        if ((FT_SG & ifp->file_type) && (! (FT_NVME & ifp->file_type)))
+            dev_timeouts_fetch(op->infd, op->in_fname, &op->in_ctp, op);
+        if ((FT_SG & ofp->file_type) && (! (FT_NVME & ofp->file_type)))
+            dev_timeouts_fetch(op->outfd, op->out_fname, &op->out_ctp, op);
+    }
+    /* seek= extent list to a SCSI device: try coalescing with WRITE
+     * SCATTERED unless that is turned off or would change semantics */
+    if (op->o_sgl && (FT_SG & ofp->file_type) &&
+        (! (FT_NVME & ofp->file_type)) && (! ofp->noscat) &&
+        (! ofp->stream) &&
+        (! ofp->sparse) && (! op->do_verify))
+        scat_probe(op);
+    /* LBA range descriptors are built in front of the data. That space is
+     * a whole number of pages so the data stays page aligned (for dio and
+     * O_DIRECT); when possible the LBA data offset grows to match so the
+     * WRITE SCATTERED data-out, which starts at the descriptors, does too */
+    scat_hdr = 0;
+    if (op->scat_max_rd > 1) {
+        int psz = (int)sg_get_page_size();
+
+        if (0 == (psz % bs))
+            op->scat_lbdof = ((op->scat_lbdof * bs + psz - 1) / psz) *
+                             (psz / bs);
+        scat_hdr = ((op->scat_lbdof * bs + psz - 1) / psz) * psz;
+    }
+    if ((FT_SG & ifp->file_type) && (FT_SG & ofp->file_type))
+        share_setup(op);
+    if (ofp->zoned && (op->dd_count > 0)) {
+        ret = zoned_setup(op);
+        if (ret)
+            goto bypass_copy;
+    }
+
     if (ifp->dio || ifp->direct || ofp->direct ||
         (FT_RAW & ifp->file_type) || (FT_RAW & ofp->file_type)) {
         /* want heap buffer aligned to page_size */
-        wrkPos = sg_memalign(bs * op->bpt, 0, &wrkBuff, false);
+        wrkPos = sg_memalign(scat_hdr + (bs * op->bpt), 0, &wrkBuff, false);
         if (NULL == wrkPos) {
             pr2serr("sg_memalign: error, out of memory?\n");
             return sg_convert_errno(ENOMEM);
         }
     } else {
-        wrkPos = sg_memalign(bs * op->bpt, 0, &wrkBuff, false);
+        wrkPos = sg_memalign(scat_hdr + (bs * op->bpt), 0, &wrkBuff, false);
         if (0 == wrkPos) {
             pr2serr("Not enough user memory\n");
             return sg_convert_errno(ENOMEM);
         }
     }
+    wrkPos += scat_hdr;
 
     blocks_per = op->bpt;
 #ifdef DEBUG
@@ -2724,6 +3516,11 @@ main(int argc, char * argv[])
         pr2serr("Since --dry-run option given, bypassing copy\n");
         goto bypass_copy;
     }
+    if (ofp->stream) {
+        ret = stream_open(op);
+        if (ret)
+            goto bypass_copy;
+    }
 
     /* <<< main loop that does the copy >>> */
     while (op->dd_count > 0) {
@@ -2734,6 +3531,18 @@ main(int argc, char * argv[])
         penult_blocks = penult_sparse_skip ? blocks : 0;
         sparse_skip = false;
         blocks = (op->dd_count > blocks_per) ? blocks_per : op->dd_count;
+        /* with extent lists, each transfer stays within one extent */
+        if (op->i_sgl && (blocks > (int64_t)op->i_sgl[i_ind].num - i_off))
+            blocks = op->i_sgl[i_ind].num - i_off;
+        use_scat = false;
+        if (op->o_sgl && (blocks > (int64_t)op->o_sgl[o_ind].num - o_off)) {
+            if (op->scat_max_rd > 1)    /* unless a WRITE SCATTERED */
+                blocks = scat_gather(op, blocks, o_ind, o_off, &use_scat);
+            else
+                blocks = op->o_sgl[o_ind].num - o_off;
+        }
+        if (op->zones)  /* oflag=zoned: don't cross a zone boundary */
+            blocks = zoned_clamp(op, blocks);
         if (FT_SG & ifp->file_type) {
             dio_tmp = ifp->dio;
             res = sg_read(wrkPos, blocks, op->skip, &dio_tmp, &blks_read, op);
@@ -2901,8 +3710,24 @@ main(int argc, char * argv[])
             retries_tmp = ofp->retries;
             first = true;
             while (1) {
-                ret = sg_write(op->outfd, wrkPos, blocks, op->seek,
-                               &dio_tmp, op);
+                if (op->share_active && (! first)) {
+                    /* a failed WRITE may have released the shared READ
+                     * buffer, so READ again before retrying the WRITE */
+                    dio_tmp2 = false;
+                    ret = sg_read(wrkPos, blocks, op->skip, &dio_tmp2,
+                                  &blks_read, op);
+                    if (ret) {
+                        pr2serr("re-read for shared write retry failed, "
+                                "lba=%" PRId64 "\n", op->skip);
+                        break;
+                    }
+                }
+                if (use_scat)
+                    ret = sg_write_scat(op->outfd, wrkPos, blocks, o_ind,
+                                        o_off, &dio_tmp, op);
+                else
+                    ret = sg_write(op->outfd, wrkPos, blocks, op->seek,
+                                   &dio_tmp, op);
                 if ((0 == ret) || (SG_DD_BYPASS == ret))
                     break;
                 if ((SG_LIB_CAT_NOT_READY == ret) ||
@@ -3029,6 +3854,35 @@ main(int argc, char * argv[])
             op->dd_count -= blocks;
         op->skip += blocks;
         op->seek += blocks;
+        if (op->i_sgl && (op->dd_count > 0)) {
+            nxt = sgl_advance(op->i_sgl, op->i_sgl_elems, &i_ind, &i_off,
+                              blocks);
+            if (nxt != op->skip) {
+                ret = sgl_lseek(op->infd, ifp->file_type, nxt, "skip", op);
+                if (ret)
+                    break;
+                op->skip = nxt;
+            }
+        }
+        if (op->o_sgl && (op->dd_count > 0)) {
+            int n;
+
+            /* a WRITE SCATTERED may have covered several extents */
+            for (nxt = op->seek, k = blocks;
+                 (k > 0) && (o_ind < op->o_sgl_elems); k -= n) {
+                n = op->o_sgl[o_ind].num - o_off;
+                if (n > k)
+                    n = k;
+                nxt = sgl_advance(op->o_sgl, op->o_sgl_elems, &o_ind,
+                                  &o_off, n);
+            }
+            if (nxt != op->seek) {
+                ret = sgl_lseek(op->outfd, ofp->file_type, nxt, "seek", op);
+                if (ret)
+                    break;
+                op->seek = nxt;
+            }
+        }
         if (op->progress > 0) {
             if (check_progress(op)) {
                 calc_duration_throughput(true);
@@ -3072,6 +3926,16 @@ main(int argc, char * argv[])
                 pr2serr("Unable to synchronize cache\n");
         }
     }
+    if (op->of_str_open) {
+        res = stream_close(op);
+        if (res && (0 == ret))
+            ret = res;
+    }
+    if (op->zones) {
+        res = zoned_end(op);
+        if (res && (0 == ret))
+            ret = res;
+    }
 
 bypass_copy:
     if (op->do_time)
@@ -3081,6 +3945,11 @@ bypass_copy:
 
     if (wrkBuff)
         free(wrkBuff);
+    free(op->i_sgl);
+    free(op->o_sgl);
+    free(op->zones);
+    sg_cmd_timeouts_free(op->in_ctp);
+    sg_cmd_timeouts_free(op->out_ctp);
     if (free_zeros_buff)
         free(free_zeros_buff);
     if (op->in_ptp)
@@ -27,6 +27,7 @@
 #include <errno.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <time.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
@@ -40,7 +41,7 @@
 #include "sg_pr2serr.h"
 #include "sg_pt.h"
 
-static const char * version_str = "1.75 20231015";
+static const char * version_str = "1.76 20261018";
 
 
 #define MY_NAME "sg_format"
@@ -108,7 +109,9 @@ struct opts_t {
         int verbose;            /* -v */
         int64_t blk_count;      /* -c value */
         int64_t total_byte_count;      /* from READ CAPACITY command */
+        int num_devs;           /* number of DEVICE arguments */
         const char * device_name;
+        char ** dev_names;      /* DEVICE arguments (points into argv) */
 };
 
 
@@ -176,7 +179,7 @@ usage()
                "[--size=LB_SZ]\n"
                "            [--tape=FM] [--timeout=SECS] [--verbose] "
                "[--verify] [--version]\n"
-               "            [--wait] DEVICE\n"
+               "            [--wait] DEVICE [DEVICE...]\n"
                "  where:\n"
                "    --cappid|-a     set CAPPID bit in Mode Select if count "
                "change\n"
@@ -263,7 +266,10 @@ usage()
                "This utility formats a SCSI disk [FORMAT UNIT] or resizes "
                "it. Alternatively\nif '--tape=FM' is given formats a tape "
                "[FORMAT MEDIUM]. Another alternative\nis doing the FORMAT "
-               "WITH PRESET command when '--preset=ID' is given.\n\n");
+               "WITH PRESET command when '--preset=ID' is given.\nIf more "
+               "than one DEVICE is given with '--format', FORMAT UNIT is "
+               "started\n(IMMED=1) on each DEVICE then all are polled "
+               "together and an aggregate\nprogress table is output.\n\n");
         printf("WARNING: This utility will destroy all the data on the "
                "DEVICE when\n\t '--format', '--tape=FM' or '--preset=ID' "
                "is given. Double check\n\t that you have specified the "
@@ -497,8 +503,8 @@ scsi_format_unit(int fd, const struct opts_t * op)
         } else if (op->verbose)
                 pr2serr("%s command %s without error\n", fu_s,
                         (immed ? "launched" : "completed"));
-        if (! immed)
-                return 0;
+        if ((! immed) || (op->num_devs > 1))
+                return 0;       /* mdev_format_unit() polls all DEVICEs */
 
         if (! op->dry_run)
                 printf("\n%s has started\n", fu_s);
@@ -1290,6 +1296,153 @@ again_with_long_lba:
         return 0;
 }
 
+/* Called when more than one DEVICE is given with --format. Launches FORMAT
+ * UNIT (IMMED=1) on each DEVICE then polls all of them from one loop, each
+ * DEVICE at an interval that shrinks as its estimated completion nears.
+ * Returns 0 if all DEVICEs completed, else the first error encountered. */
+static int
+mdev_format_unit(struct opts_t * op, uint8_t * inq_resp, int inq_resp_sz)
+{
+        bool changed;
+        int k, res, pdt, num_act, num_fail, poll_wait_secs;
+        int ret = 0;
+        int num = op->num_devs;
+        int vb = op->verbose;
+        int poll_vb = (vb > 1) ? (vb - 1) : 0;
+        time_t now, next_tm, start_tm, report_tm;
+        struct sg_mdev_st * mdarr;
+        struct sg_mdev_st * mdp;
+        char b[160];
+
+        mdarr = (struct sg_mdev_st *)calloc(num,
+                                            sizeof(struct sg_mdev_st));
+        if (NULL == mdarr) {
+                pr2serr("%s: unable to obtain heap\n", __func__);
+                return sg_convert_errno(ENOMEM);
+        }
+        for (k = 0; k < num; ++k)
+                mdarr[k].fd = -1;
+        for (k = 0; k < num; ++k) {
+                mdp = mdarr + k;
+                mdp->name = op->dev_names[k];
+                mdp->progress = -1;
+                mdp->use_rs = op->poll_type;
+                mdp->fd = sg_cmds_open_device(mdp->name, false, vb);
+                if (mdp->fd < 0) {
+                        pr2serr("error opening device file: %s: %s\n",
+                                mdp->name, safe_strerror(-mdp->fd));
+                        ret = sg_convert_errno(-mdp->fd);
+                        goto fini;
+                }
+                if (op->format > 2)
+                        continue;
+                printf("%s:\n", mdp->name);
+                res = print_dev_id(mdp->fd, inq_resp, inq_resp_sz, op);
+                if (res) {
+                        if (! op->dry_run) {
+                                ret = res;
+                                goto fini;
+                        }
+                        pdt = PDT_DISK;
+                } else
+                        pdt = PDT_MASK & inq_resp[0];
+                if ((PDT_DISK != pdt) && (PDT_OPTICAL != pdt) &&
+                    (PDT_RBC != pdt) && (PDT_ZBC != pdt)) {
+                        pr2serr("%s: this format is only defined for disks "
+                                "(using SBC-2+, ZBC or RBC) and MO media\n",
+                                mdp->name);
+                        ret = SG_LIB_CAT_MALFORMED;
+                        goto fini;
+                }
+        }
+        if (! op->quick) {
+                snprintf(b, sizeof(b), "all %d DEVICEs given", num);
+                sg_warn_and_wait("FORMAT UNIT", b, true);
+        }
+        start_tm = time(NULL);
+        for (k = 0, num_act = 0, num_fail = 0; k < num; ++k) {
+                mdp = mdarr + k;
+                if (op->dry_run)
+                        pr2serr("%s: ", mdp->name);
+                res = scsi_format_unit(mdp->fd, op);
+                mdp->start_tm = time(NULL);
+                if (res) {
+                        pr2serr("FORMAT UNIT failed on %s\n", mdp->name);
+                        mdp->res = res;
+                        mdp->end_tm = mdp->start_tm;
+                        ++num_fail;
+                        if (0 == ret)
+                                ret = res;
+                } else if (! op->dry_run) {
+                        mdp->active = true;
+                        mdp->next_tm = mdp->start_tm +
+                                       SG_MDEV_MIN_POLL_SECS;
+                        ++num_act;
+                }
+        }
+        if (op->dry_run) {
+                printf("No point in polling for progress, so exit\n");
+                goto fini;
+        }
+        printf("\n%s has started on %d of %d DEVICEs\n", fu_s, num_act,
+               num);
+        if (op->early) {
+                if (num_act > 0)
+                        printf("%s continuing,\n    request sense or test "
+                               "unit ready can be used to monitor "
+                               "progress\n", fu_s);
+                goto fini;
+        }
+        poll_wait_secs = op->ffmt ? POLL_DURATION_FFMT_SECS :
+                                    POLL_DURATION_SECS;
+        report_tm = start_tm + poll_wait_secs;
+        while (num_act > 0) {
+                now = time(NULL);
+                for (k = 0, next_tm = 0; k < num; ++k) {
+                        mdp = mdarr + k;
+                        if (mdp->active &&
+                            ((0 == next_tm) || (mdp->next_tm < next_tm)))
+                                next_tm = mdp->next_tm;
+                }
+                if (next_tm > now) {
+                        sg_sleep_secs((int)(next_tm - now));
+                        now = time(NULL);
+                }
+                for (k = 0, changed = false; k < num; ++k) {
+                        mdp = mdarr + k;
+                        if ((! mdp->active) || (mdp->next_tm > now))
+                                continue;
+                        if (sg_mdev_poll(mdp, now, poll_wait_secs,
+                                         poll_vb)) {
+                                changed = true;
+                                --num_act;
+                                if (mdp->res) {
+                                        ++num_fail;
+                                        if (0 == ret)
+                                                ret = mdp->res;
+                                }
+                        }
+                }
+                if (changed || (now >= report_tm)) {
+                        sg_mdev_report(mdarr, num, start_tm, now);
+                        report_tm = now + poll_wait_secs;
+                }
+        }
+        printf("FORMAT UNIT Complete on %d of %d DEVICEs\n",
+               num - num_fail, num);
+fini:
+        for (k = 0; k < num; ++k) {
+                mdp = mdarr + k;
+                if (mdp->fd >= 0) {
+                        res = sg_cmds_close_device(mdp->fd);
+                        if ((res < 0) && (0 == ret))
+                                ret = sg_convert_errno(-res);
+                }
+        }
+        free(mdarr);
+        return ret;
+}
+
 static int
 parse_cmd_line(struct opts_t * op, int argc, char **argv)
 {
@@ -1483,17 +1636,9 @@ parse_cmd_line(struct opts_t * op, int argc, char **argv)
                 }
         }
         if (optind < argc) {
-                if (NULL == op->device_name) {
-                        op->device_name = argv[optind];
-                        ++optind;
-                }
-        }
-        if (optind < argc) {
-                for (; optind < argc; ++optind)
-                        pr2serr("Unexpected extra argument: %s\n",
-                                argv[optind]);
-                usage();
-                return SG_LIB_SYNTAX_ERROR;
+                op->device_name = argv[optind];
+                op->dev_names = argv + optind;
+                op->num_devs = argc - optind;
         }
 #ifdef DEBUG
         pr2serr("In DEBUG mode, ");
@@ -1527,6 +1672,21 @@ parse_cmd_line(struct opts_t * op, int argc, char **argv)
                         "'--preset='\n");
                 return SG_LIB_CONTRADICT;
         }
+        if (op->num_devs > 1) {
+                if (! op->format) {
+                        pr2serr("more than one DEVICE only permitted with "
+                                "'--format'\n");
+                        usage();
+                        return SG_LIB_SYNTAX_ERROR;
+                }
+                if (op->fwait || op->resize || (op->blk_count != 0) ||
+                    (op->lblk_sz > 0)) {
+                        pr2serr("with more than one DEVICE: '--wait', "
+                                "'--resize', '--count=' and '--size=' are "
+                                "not permitted\n");
+                        return SG_LIB_CONTRADICT;
+                }
+        }
         if (op->ip_def && op->sec_init) {
                 pr2serr("'--ip_def' and '--security' contradict, choose "
                         "one\n");
@@ -1601,6 +1761,11 @@ main(int argc, char **argv)
                 goto out;
         }
 
+        if (op->num_devs > 1) {
+                ret = mdev_format_unit(op, inq_resp, inq_resp_sz);
+                goto out;
+        }
+
         if ((fd = sg_cmds_open_device(op->device_name, false, vb)) < 0) {
                 pr2serr("error opening device file: %s: %s\n",
                         op->device_name, safe_strerror(-fd));
@@ -0,0 +1,1040 @@
+/*
+ * Copyright (c) 2026 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+#include <time.h>
+#elif defined(HAVE_GETTIMEOFDAY)
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "sg_lib.h"
+#include "sg_pt.h"
+#include "sg_cmds_basic.h"
+#include "sg_json_sg_lib.h"
+#include "sg_unaligned.h"
+#include "sg_pr2serr.h"
+
+/* A utility program originally written for the Linux OS SCSI subsystem.
+ *
+ *
+ * This program periodically samples the health of many SCSI devices. Each
+ * sample is a TEST UNIT READY, a REQUEST SENSE and LOG SENSE commands for
+ * selected log pages. Device state transitions and threshold crossings are
+ * written as line-delimited JSON (one object per line). Each device is
+ * opened once and its file descriptor and pass-through object are kept
+ * for subsequent samples.
+ */
+
+static const char * version_str = "1.01 20261018";
+
+#define MY_NAME "sg_health"
+
+#define DEF_INTERVAL_SECS 60
+#define DEF_JITTER_PERC 10
+#define DEF_NUM_THREADS 4
+#define HM_MAX_WAIT_MS 200      /* poll for stop request this often */
+#define HM_RS_LEN 252
+#define HM_LOG_LEN 1024
+
+/* metric states, for thresholds */
+#define HM_MS_UNKNOWN 0
+#define HM_MS_BELOW 1
+#define HM_MS_ABOVE 2
+#define HM_MS_UNSUP 3   /* log page not supported by this device */
+
+struct hm_metric_t {
+    const char * name;
+    uint8_t pg_code;
+    uint8_t subpg_code;
+    uint16_t param_code;
+    int8_t off;         /* byte offset within parameter, -1: whole counter */
+    bool is_state;      /* report changes rather than threshold crossings */
+    const char * desc;
+};
+
+static const struct hm_metric_t hm_metric_arr[] = {
+    {"temp", 0xd, 0x0, 0x0, 5, false, "temperature [Celsius]"},
+    {"ie", 0x2f, 0x0, 0x0, 4, true, "informational exception asc,ascq"},
+    {"ssd", 0x11, 0x0, 0x1, 7, false, "percentage used endurance "
+     "indicator"},
+    {"werr", 0x2, 0x0, 0x6, -1, false, "write: total uncorrected errors"},
+    {"rerr", 0x3, 0x0, 0x6, -1, false, "read: total uncorrected errors"},
+    {"verr", 0x5, 0x0, 0x6, -1, false, "verify: total uncorrected errors"},
+    {"nme", 0x6, 0x0, 0x0, -1, false, "non-medium error count"},
+    {NULL, 0, 0, 0, 0, false, NULL},
+};
+
+#define HM_NUM_METRICS \
+        ((int)(sizeof(hm_metric_arr) / sizeof(hm_metric_arr[0])) - 1)
+
+static const char * def_log_s = "temp,ie";
+
+struct hm_dev_t {
+    bool name_alloced;
+    int sg_fd;                  /* -1 when not open */
+    int samples;
+    int sense[3];               /* sense key, asc, ascq; -1 when unknown */
+    uint32_t rnd;               /* xorshift32 state, for jitter */
+    int64_t due_us;             /* monotonic time of next sample */
+    const char * name;
+    const char * state;         /* last reported, NULL when unknown */
+    struct sg_pt_base * ptvp;
+    uint8_t mstate[HM_NUM_METRICS];
+    int64_t val[HM_NUM_METRICS];
+};
+
+struct hm_state_t {
+    bool o_readonly;
+    bool sel_arr[HM_NUM_METRICS];
+    bool thresh_given[HM_NUM_METRICS];
+    int64_t thresh[HM_NUM_METRICS];
+    int verbose;
+    int count;                  /* samples per DEVICE, 0 -> forever */
+    int jitter_perc;
+    int64_t interval_us;
+    int num_devs;
+    int mx_devs;
+    int num_done;               /* protected by mutex when threads used */
+    int heap_len;               /* protected by mutex when threads used */
+    int * heap;                 /* dev_arr indexes, earliest due_us first */
+    struct hm_dev_t * dev_arr;
+    FILE * out_fp;
+    sgj_state json_st;          /* template for each output line */
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+    pthread_mutex_t out_mutex;
+#endif
+};
+
+static volatile sig_atomic_t hm_stop;
+
+static const struct option long_options[] = {
+    {"count", required_argument, 0, 'c'},
+    {"help", no_argument, 0, 'h'},
+    {"in", required_argument, 0, 'i'},
+    {"interval", required_argument, 0, 'I'},
+    {"js-file", required_argument, 0, 'J'},
+    {"js_file", required_argument, 0, 'J'},
+    {"jitter", required_argument, 0, 'j'},
+    {"log", required_argument, 0, 'l'},
+    {"readonly", no_argument, 0, 'r'},
+    {"threads", required_argument, 0, 'T'},
+    {"threshold", required_argument, 0, 't'},
+    {"verbose", no_argument, 0, 'v'},
+    {"version", no_argument, 0, 'V'},
+    {0, 0, 0, 0},
+};
+
+
+static void
+usage(int num)
+{
+    const struct hm_metric_t * mp;
+
+    if (num > 1)
+        goto page2;
+    pr2serr("Usage: sg_health [--count=CNT] [--help] [--in=FN] "
+            "[--interval=SECS]\n"
+            "                 [--jitter=PERC] [--js-file=JFN] "
+            "[--log=LNS] [--readonly]\n"
+            "                 [--threads=NT] [--threshold=LN:VAL[,LN:VAL...]]"
+            "\n"
+            "                 [--verbose] [--version] [DEVICE...]\n"
+            "  where:\n"
+            "    --count=CNT|-c CNT    take CNT samples of each DEVICE then "
+            "exit (def: 0\n"
+            "                          -> until interrupted)\n"
+            "    --help|-h          print out usage message, use twice for "
+            "log names\n"
+            "    --in=FN|-i FN      read DEVICE names, one per line, from "
+            "FN ('-' for\n"
+            "                       stdin)\n"
+            "    --interval=SECS|-I SECS    sample each DEVICE every SECS "
+            "seconds\n"
+            "                               (def: %d)\n"
+            "    --jitter=PERC|-j PERC    vary each interval randomly by "
+            "up to PERC\n"
+            "                             percent (def: %d)\n"
+            "    --js-file=JFN|-J JFN    append JSON lines to JFN (def: "
+            "stdout)\n"
+            "    --log=LNS|-l LNS    comma separated list of log names "
+            "to sample\n"
+            "                        (def: %s); '-l none' for no LOG "
+            "SENSE\n"
+            "    --readonly|-r      open DEVICEs read-only (def: "
+            "read-write)\n"
+            "    --threads=NT|-T NT    number of DEVICEs sampled "
+            "concurrently (def: %d)\n"
+            "    --threshold=LN:VAL|-t LN:VAL    report when log name LN "
+            "rises to VAL\n"
+            "                                    or more, and when it falls "
+            "back below\n"
+            "    --verbose|-v       increase verbosity\n"
+            "    --version|-V       print version string and exit\n\n"
+            "Samples the health of each DEVICE with TEST UNIT READY, "
+            "REQUEST SENSE and\nLOG SENSE commands. Only state transitions "
+            "and threshold crossings are\noutput, as one JSON object per "
+            "line. Use '-hh' to list log names.\n", DEF_INTERVAL_SECS,
+            DEF_JITTER_PERC, def_log_s, DEF_NUM_THREADS);
+    return;
+page2:
+    pr2serr("Log names (LN) for --log= and --threshold= options:\n");
+    for (mp = hm_metric_arr; mp->name; ++mp)
+        pr2serr("    %-6s  page 0x%x, parameter 0x%x: %s\n", mp->name,
+                mp->pg_code, mp->param_code, mp->desc);
+}
+
+static void
+hm_sig_handler(int sig_num)
+{
+    if (sig_num) { ; }  /* unused, dummy to suppress warning */
+    hm_stop = 1;
+}
+
+#if defined(SG_LIB_MINGW)
+
+#include <windows.h>
+
+static void
+wait_millisecs(int millisecs)
+{
+    /* MinGW requires pthreads library for nanosleep, use Sleep() instead */
+    Sleep(millisecs);
+}
+
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+
+static void
+wait_millisecs(int millisecs)
+{
+    struct timespec wait_period, rem;
+
+    wait_period.tv_sec = millisecs / 1000;
+    wait_period.tv_nsec = (millisecs % 1000) * 1000000;
+    while ((nanosleep(&wait_period, &rem) < 0) && (EINTR == errno) &&
+           (! hm_stop))
+                wait_period = rem;
+}
+
+#else
+
+static void
+wait_millisecs(int millisecs)
+{
+    struct timeval wait_period;
+
+    wait_period.tv_sec = millisecs / 1000;
+    wait_period.tv_usec = (millisecs % 1000) * 1000;
+    select(0, NULL, NULL, NULL, &wait_period);
+}
+#endif
+
+static void
+hm_lock(struct hm_state_t * hsp)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&hsp->mutex);
+#else
+    if (hsp) { ; }      /* unused, dummy to suppress warning */
+#endif
+}
+
+static void
+hm_unlock(struct hm_state_t * hsp)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&hsp->mutex);
+#else
+    if (hsp) { ; }      /* unused, dummy to suppress warning */
+#endif
+}
+
+static uint32_t
+hm_rand(struct hm_dev_t * dp)
+{
+    uint32_t x = dp->rnd;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    dp->rnd = x;
+    return x;
+}
+
+static const struct hm_metric_t *
+hm_find_metric(const char * cp, int len)
+{
+    const struct hm_metric_t * mp;
+
+    for (mp = hm_metric_arr; mp->name; ++mp) {
+        if (((int)strlen(mp->name) == len) && (0 == memcmp(mp->name, cp, len)))
+            return mp;
+    }
+    return NULL;
+}
+
+/* Parses comma separated log names (e.g. "temp,ie") into sel_arr. "none"
+ * selects no log pages. Returns 0 on success. */
+static int
+hm_parse_log(struct hm_state_t * hsp, const char * arg)
+{
+    int len;
+    const char * cp;
+    const struct hm_metric_t * mp;
+
+    memset(hsp->sel_arr, 0, sizeof(hsp->sel_arr));
+    if (0 == strcmp(arg, "none"))
+        return 0;
+    for (cp = arg; *cp; cp += len + (',' == cp[len])) {
+        len = strcspn(cp, ",");
+        mp = hm_find_metric(cp, len);
+        if (NULL == mp) {
+            pr2serr("--log=: unknown log name '%.*s', try '-hh'\n", len, cp);
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        hsp->sel_arr[mp - hm_metric_arr] = true;
+    }
+    return 0;
+}
+
+/* Parses LN:VAL[,LN:VAL...] for the --threshold= option. Log names given
+ * a threshold are added to those sampled. Returns 0 on success. */
+static int
+hm_parse_threshold(struct hm_state_t * hsp, const char * arg)
+{
+    int k, len, nlen;
+    int64_t ll;
+    const char * cp;
+    const char * colp;
+    const struct hm_metric_t * mp;
+
+    for (cp = arg; *cp; cp += len + (',' == cp[len])) {
+        len = strcspn(cp, ",");
+        colp = (const char *)memchr(cp, ':', len);
+        if (NULL == colp)
+            goto bad;
+        nlen = colp - cp;
+        mp = hm_find_metric(cp, nlen);
+        if ((NULL == mp) || mp->is_state) {
+            pr2serr("--threshold=: '%.*s' is not a log name with a value, "
+                    "try '-hh'\n", nlen, cp);
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        ll = sg_get_llnum(colp + 1);
+        if (ll < 0)
+            goto bad;
+        k = mp - hm_metric_arr;
+        hsp->thresh[k] = ll;
+        hsp->thresh_given[k] = true;
+        hsp->sel_arr[k] = true;
+    }
+    return 0;
+bad:
+    pr2serr("--threshold= expects LN:VAL where VAL is a non-negative "
+            "number\n");
+    return SG_LIB_SYNTAX_ERROR;
+}
+
+static int
+hm_add_dev(struct hm_state_t * hsp, const char * name, bool alloced)
+{
+    struct hm_dev_t * dp;
+
+    if (hsp->num_devs >= hsp->mx_devs) {
+        int mx = hsp->mx_devs ? (2 * hsp->mx_devs) : 64;
+
+        dp = (struct hm_dev_t *)realloc(hsp->dev_arr, mx * sizeof(*dp));
+        if (NULL == dp) {
+            pr2serr("%s: out of memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        hsp->dev_arr = dp;
+        hsp->mx_devs = mx;
+    }
+    dp = hsp->dev_arr + hsp->num_devs++;
+    memset(dp, 0, sizeof(*dp));
+    dp->name = name;
+    dp->name_alloced = alloced;
+    dp->sg_fd = -1;
+    dp->sense[0] = -1;
+    return 0;
+}
+
+/* Called by sg_read_name_list() with each name in the --in=FN file */
+static int
+hm_add_in_dev(char * name, void * v_hsp)
+{
+    return hm_add_dev((struct hm_state_t *)v_hsp, name, true);
+}
+
+/* Binary min-heap of dev_arr indexes ordered by due_us. Caller holds the
+ * mutex. */
+static void
+hm_heap_push(struct hm_state_t * hsp, int ind)
+{
+    int k, parent;
+    int * hp = hsp->heap;
+    const struct hm_dev_t * dap = hsp->dev_arr;
+
+    for (k = hsp->heap_len++; k > 0; k = parent) {
+        parent = (k - 1) / 2;
+        if (dap[hp[parent]].due_us <= dap[ind].due_us)
+            break;
+        hp[k] = hp[parent];
+    }
+    hp[k] = ind;
+}
+
+static int
+hm_heap_pop(struct hm_state_t * hsp)
+{
+    int k, child, last;
+    int * hp = hsp->heap;
+    int ret = hp[0];
+    const struct hm_dev_t * dap = hsp->dev_arr;
+
+    last = hp[--hsp->heap_len];
+    for (k = 0; (child = (2 * k) + 1) < hsp->heap_len; k = child) {
+        if ((child + 1 < hsp->heap_len) &&
+            (dap[hp[child + 1]].due_us < dap[hp[child]].due_us))
+            ++child;
+        if (dap[last].due_us <= dap[hp[child]].due_us)
+            break;
+        hp[k] = hp[child];
+    }
+    hp[k] = last;
+    return ret;
+}
+
+/* Sets the next sample time of dp to one interval (plus or minus jitter)
+ * after the previous one. If sampling has fallen behind by more than an
+ * interval, restart from now rather than trying to catch up. */
+static void
+hm_next_due(struct hm_state_t * hsp, struct hm_dev_t * dp)
+{
+    int64_t now = sg_get_monotonic_usecs();
+    int64_t j_us = (hsp->interval_us * hsp->jitter_perc) / 100;
+
+    dp->due_us += hsp->interval_us;
+    if (j_us > 0)
+        dp->due_us += (int64_t)(hm_rand(dp) % (2 * j_us + 1)) - j_us;
+    if (dp->due_us < now - hsp->interval_us)
+        dp->due_us = now;
+}
+
+/* Starts one output line: a JSON object streamed to hsp->out_fp holding
+ * the members common to all events (time, device and event). Holds the
+ * output lock until the matching hm_line_end(). */
+static sgj_opaque_p
+hm_line_start(struct hm_state_t * hsp, sgj_state * jsp,
+              const struct hm_dev_t * dp, const char * event)
+{
+    sgj_opaque_p jop;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&hsp->out_mutex);
+#endif
+    memcpy(jsp, &hsp->json_st, sizeof(*jsp));
+    jop = sgj_start_stream_r(NULL, NULL, 0, NULL, hsp->out_fp, jsp);
+    sgj_js_nv_i(jsp, jop, "time", (int64_t)time(NULL));
+    sgj_js_nv_s(jsp, jop, "device", dp->name);
+    sgj_js_nv_s(jsp, jop, "event", event);
+    return jop;
+}
+
+/* Terminates (with a LF) and flushes the line begun by hm_line_start(). */
+static void
+hm_line_end(struct hm_state_t * hsp, sgj_state * jsp)
+{
+    sgj_js2file_estr(jsp, NULL, 0, NULL, hsp->out_fp);
+    sgj_finish(jsp);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&hsp->out_mutex);
+#endif
+}
+
+static void
+hm_new_state(struct hm_state_t * hsp, struct hm_dev_t * dp,
+             const char * state)
+{
+    sgj_state js;
+    sgj_opaque_p jop;
+
+    if (dp->state == state)
+        return;
+    jop = hm_line_start(hsp, &js, dp, "state");
+    sgj_js_nv_s(&js, jop, "from", dp->state ? dp->state : "unknown");
+    sgj_js_nv_s(&js, jop, "to", state);
+    hm_line_end(hsp, &js);
+    dp->state = state;
+}
+
+/* Reports when the sense key, asc or ascq (from REQUEST SENSE) changes.
+ * On the first sample only sense data other than "no sense" is reported.
+ */
+static void
+hm_new_sense(struct hm_state_t * hsp, struct hm_dev_t * dp, int sk, int asc,
+             int ascq)
+{
+    sgj_state js;
+    sgj_opaque_p jop;
+    char d[160];
+
+    if (dp->sense[0] < 0) {
+        if ((0 == sk) && (0 == asc) && (0 == ascq))
+            goto fini;
+    } else if ((dp->sense[0] == sk) && (dp->sense[1] == asc) &&
+               (dp->sense[2] == ascq))
+        return;
+    jop = hm_line_start(hsp, &js, dp, "sense");
+    sgj_js_nv_i(&js, jop, "sense_key", sk);
+    sgj_js_nv_i(&js, jop, "asc", asc);
+    sgj_js_nv_i(&js, jop, "ascq", ascq);
+    sgj_js_nv_s(&js, jop, "sense_key_str",
+                sg_get_sense_key_str(sk, sizeof(d), d));
+    sgj_js_nv_s(&js, jop, "additional_sense",
+                sg_get_additional_sense_str(asc, ascq, false, sizeof(d), d));
+    hm_line_end(hsp, &js);
+fini:
+    dp->sense[0] = sk;
+    dp->sense[1] = asc;
+    dp->sense[2] = ascq;
+}
+
+/* Called with each value fetched for metric k. Reports informational
+ * exception changes and crossings of the --threshold= value. */
+static void
+hm_new_value(struct hm_state_t * hsp, struct hm_dev_t * dp, int k,
+             int64_t val)
+{
+    int ms, asc, ascq;
+    const struct hm_metric_t * mp = hm_metric_arr + k;
+    sgj_state js;
+    sgj_opaque_p jop;
+    char d[160];
+
+    if (hsp->verbose > 1)
+        pr2serr("%s: %s=%" PRId64 "\n", dp->name, mp->name, val);
+    if (mp->is_state) {
+        if ((HM_MS_UNKNOWN == dp->mstate[k]) ? (0 != val)
+                                             : (dp->val[k] != val)) {
+            asc = (int)(val >> 8) & 0xff;
+            ascq = (int)val & 0xff;
+            jop = hm_line_start(hsp, &js, dp, "exception");
+            sgj_js_nv_s(&js, jop, "log", mp->name);
+            sgj_js_nv_i(&js, jop, "asc", asc);
+            sgj_js_nv_i(&js, jop, "ascq", ascq);
+            sgj_js_nv_s(&js, jop, "additional_sense",
+                        sg_get_additional_sense_str(asc, ascq, false,
+                                                    sizeof(d), d));
+            hm_line_end(hsp, &js);
+        }
+        dp->mstate[k] = HM_MS_BELOW;
+    } else if (hsp->thresh_given[k]) {
+        ms = (val >= hsp->thresh[k]) ? HM_MS_ABOVE : HM_MS_BELOW;
+        if ((ms != dp->mstate[k]) &&
+            ! ((HM_MS_UNKNOWN == dp->mstate[k]) && (HM_MS_BELOW == ms))) {
+            jop = hm_line_start(hsp, &js, dp, "threshold");
+            sgj_js_nv_s(&js, jop, "log", mp->name);
+            sgj_js_nv_i(&js, jop, "value", val);
+            sgj_js_nv_i(&js, jop, "threshold", hsp->thresh[k]);
+            sgj_js_nv_s(&js, jop, "direction",
+                        (HM_MS_ABOVE == ms) ? "above" : "below");
+            hm_line_end(hsp, &js);
+        }
+        dp->mstate[k] = ms;
+    } else
+        dp->mstate[k] = HM_MS_BELOW;
+    dp->val[k] = val;
+}
+
+/* Fetches log page pg_code (and subpg_code) then extracts the value of
+ * each selected metric found in it. vb is the verbosity passed to the
+ * LOG SENSE command, as for the other commands hm_sample() issues. */
+static void
+hm_log_page(struct hm_state_t * hsp, struct hm_dev_t * dp, int pg_code,
+            int subpg_code, int vb)
+{
+    int k, res, resid, len, num, pc, pl;
+    int64_t val;
+    const uint8_t * bp;
+    const struct hm_metric_t * mp;
+    uint8_t b[HM_LOG_LEN];
+
+    resid = 0;
+    res = sg_ll_log_sense_v2(dp->sg_fd, false, false, 1 /* cumulative */,
+                             pg_code, subpg_code, 0, b, sizeof(b), 0,
+                             &resid, false, vb);
+    if ((SG_LIB_CAT_INVALID_OP == res) || (SG_LIB_CAT_ILLEGAL_REQ == res)) {
+        /* don't ask again */
+        for (k = 0, mp = hm_metric_arr; k < HM_NUM_METRICS; ++k, ++mp) {
+            if (hsp->sel_arr[k] && (mp->pg_code == pg_code) &&
+                (mp->subpg_code == subpg_code))
+                dp->mstate[k] = HM_MS_UNSUP;
+        }
+        if (hsp->verbose)
+            pr2serr("%s: log page 0x%x not supported\n", dp->name, pg_code);
+        return;
+    } else if (res) {
+        if (hsp->verbose) {
+            char e[80];
+
+            sg_get_category_sense_str(res, sizeof(e), e, hsp->verbose);
+            pr2serr("%s: LOG SENSE(0x%x): %s\n", dp->name, pg_code, e);
+        }
+        return;
+    }
+    num = (int)sizeof(b) - resid;
+    if ((num < 4) || ((b[0] & 0x3f) != pg_code)) {
+        if (hsp->verbose)
+            pr2serr("%s: bad response to LOG SENSE(0x%x)\n", dp->name,
+                    pg_code);
+        return;
+    }
+    len = sg_get_unaligned_be16(b + 2) + 4;
+    if (len > num)
+        len = num;
+    for (bp = b + 4; bp + 4 <= b + len; bp += pl) {
+        pc = sg_get_unaligned_be16(bp);
+        pl = bp[3] + 4;
+        if (bp + pl > b + len)
+            break;
+        for (k = 0, mp = hm_metric_arr; k < HM_NUM_METRICS; ++k, ++mp) {
+            if ((! hsp->sel_arr[k]) || (mp->pg_code != pg_code) ||
+                (mp->subpg_code != subpg_code) || (mp->param_code != pc))
+                continue;
+            if (mp->is_state) {
+                if (pl < mp->off + 2)
+                    continue;
+                val = sg_get_unaligned_be16(bp + mp->off);
+            } else if (mp->off >= 0) {
+                if (pl <= mp->off)
+                    continue;
+                val = bp[mp->off];
+                if ((0xd == pg_code) && (0xff == val))
+                    continue;   /* temperature not available */
+            } else {
+                if ((pl < 5) || (pl > 12))
+                    continue;
+                val = (int64_t)sg_get_unaligned_be(pl - 4, bp + 4);
+            }
+            hm_new_value(hsp, dp, k, val);
+        }
+    }
+}
+
+static const char *
+hm_tur_state(int res)
+{
+    switch (res) {
+    case 0:
+        return "ready";
+    case SG_LIB_CAT_NOT_READY:
+        return "not_ready";
+    case SG_LIB_CAT_STANDBY:
+        return "standby";
+    case SG_LIB_CAT_UNAVAILABLE:
+        return "unavailable";
+    case SG_LIB_CAT_UNIT_ATTENTION:
+        return "unit_attention";
+    case SG_LIB_CAT_MEDIUM_HARD:
+    case SG_LIB_CAT_MEDIUM_HARD_WITH_INFO:
+        return "medium_hardware_error";
+    case SG_LIB_CAT_ABORTED_COMMAND:
+        return "aborted_command";
+    case SG_LIB_CAT_BUSY:
+    case SG_LIB_CAT_TS_FULL:
+        return "busy";
+    case SG_LIB_CAT_TIMEOUT:
+        return "timeout";
+    case -1:
+        return "transport_error";
+    default:
+        return "error";
+    }
+}
+
+static void
+hm_close_dev(struct hm_dev_t * dp)
+{
+    if (dp->ptvp) {
+        destruct_scsi_pt_obj(dp->ptvp);
+        dp->ptvp = NULL;
+    }
+    if (dp->sg_fd >= 0) {
+        sg_cmds_close_device(dp->sg_fd);
+        dp->sg_fd = -1;
+    }
+}
+
+/* One sample of dp: TEST UNIT READY, REQUEST SENSE then LOG SENSE for each
+ * selected log page. The DEVICE stays open between samples; it is closed
+ * (and reopened on the next sample) after a transport or OS error. */
+static void
+hm_sample(struct hm_state_t * hsp, struct hm_dev_t * dp)
+{
+    bool seen;
+    int k, j, res;
+    int vb = (hsp->verbose > 2) ? hsp->verbose - 2 : 0;
+    const struct hm_metric_t * mp;
+    struct sg_scsi_sense_hdr ssh;
+    uint8_t rs_b[HM_RS_LEN];
+
+    if (dp->sg_fd < 0) {
+        dp->sg_fd = sg_cmds_open_device(dp->name, hsp->o_readonly, vb);
+        if (dp->sg_fd < 0) {
+            if (hsp->verbose)
+                pr2serr("%s: open error: %s\n", dp->name,
+                        safe_strerror(-dp->sg_fd));
+            hm_new_state(hsp, dp, "open_failed");
+            return;
+        }
+        dp->ptvp = construct_scsi_pt_obj_with_fd(dp->sg_fd, vb);
+        if ((NULL == dp->ptvp) || get_scsi_pt_os_err(dp->ptvp)) {
+            pr2serr("%s: unable to construct pt object\n", dp->name);
+            hm_close_dev(dp);
+            hm_new_state(hsp, dp, "open_failed");
+            return;
+        }
+    }
+    res = sg_ll_test_unit_ready_pt(dp->ptvp, 0, false, vb);
+    if (SG_LIB_CAT_UNIT_ATTENTION == res)   /* usually reported once */
+        res = sg_ll_test_unit_ready_pt(dp->ptvp, 0, false, vb);
+    hm_new_state(hsp, dp, hm_tur_state(res));
+    if (-1 == res) {
+        hm_close_dev(dp);
+        return;
+    }
+    memset(rs_b, 0, sizeof(rs_b));
+    res = sg_ll_request_sense_pt(dp->ptvp, false, rs_b, sizeof(rs_b), false,
+                                 vb);
+    if (0 == res) {
+        if (sg_scsi_normalize_sense(rs_b, sizeof(rs_b), &ssh))
+            hm_new_sense(hsp, dp, ssh.sense_key, ssh.asc, ssh.ascq);
+        else
+            hm_new_sense(hsp, dp, 0, 0, 0);
+    } else if (hsp->verbose) {
+        char e[80];
+
+        sg_get_category_sense_str(res, sizeof(e), e, hsp->verbose);
+        pr2serr("%s: REQUEST SENSE: %s\n", dp->name, e);
+    }
+    /* one LOG SENSE per log page holding selected (supported) metrics */
+    for (k = 0, mp = hm_metric_arr; k < HM_NUM_METRICS; ++k, ++mp) {
+        if ((! hsp->sel_arr[k]) || (HM_MS_UNSUP == dp->mstate[k]))
+            continue;
+        for (j = 0, seen = false; j < k; ++j) {
+            if (hsp->sel_arr[j] &&
+                (hm_metric_arr[j].pg_code == mp->pg_code) &&
+                (hm_metric_arr[j].subpg_code == mp->subpg_code)) {
+                seen = true;
+                break;
+            }
+        }
+        if (! seen)
+            hm_log_page(hsp, dp, mp->pg_code, mp->subpg_code, vb);
+    }
+}
+
+/* Worker (thread) function. Each takes the DEVICE with the earliest due
+ * time from the heap, sleeping until it is due, samples it then puts it
+ * back with its next due time. Returns when all DEVICEs have taken
+ * --count= samples or when interrupted. */
+static void *
+hm_worker(void * v_hsp)
+{
+    int k;
+    int64_t now, wait_us;
+    struct hm_state_t * hsp = (struct hm_state_t *)v_hsp;
+    struct hm_dev_t * dp;
+
+    while (! hm_stop) {
+        k = -1;
+        wait_us = HM_MAX_WAIT_MS * 1000;
+        hm_lock(hsp);
+        if (hsp->num_done >= hsp->num_devs) {
+            hm_unlock(hsp);
+            break;
+        }
+        if (hsp->heap_len > 0) {
+            now = sg_get_monotonic_usecs();
+            dp = hsp->dev_arr + hsp->heap[0];
+            if (dp->due_us <= now)
+                k = hm_heap_pop(hsp);
+            else if (dp->due_us - now < wait_us)
+                wait_us = dp->due_us - now;
+        }
+        hm_unlock(hsp);
+        if (k < 0) {
+            wait_millisecs((int)((wait_us + 999) / 1000));
+            continue;
+        }
+        dp = hsp->dev_arr + k;
+        hm_sample(hsp, dp);
+        hm_lock(hsp);
+        if ((hsp->count > 0) && (++dp->samples >= hsp->count))
+            ++hsp->num_done;
+        else {
+            hm_next_due(hsp, dp);
+            hm_heap_push(hsp, k);
+        }
+        hm_unlock(hsp);
+    }
+    return NULL;
+}
+
+/* Schedules the first sample of each DEVICE at a random offset within one
+ * interval, so samples of many DEVICEs are spread out, then runs num_thr
+ * workers. A single sample (--count=1) of each DEVICE starts at once. */
+static int
+hm_work(struct hm_state_t * hsp, int num_thr)
+{
+    int k;
+    int64_t now;
+    struct hm_dev_t * dp;
+
+    hsp->heap = (int *)calloc(hsp->num_devs, sizeof(int));
+    if (NULL == hsp->heap) {
+        pr2serr("%s: out of memory\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+    now = sg_get_monotonic_usecs();
+    for (k = 0, dp = hsp->dev_arr; k < hsp->num_devs; ++k, ++dp) {
+        dp->rnd = ((uint32_t)(k + 1) * 2654435761U) ^ (uint32_t)time(NULL);
+        if (0 == dp->rnd)
+            dp->rnd = 1;
+        dp->due_us = now;
+        if ((hsp->num_devs > 1) && (1 != hsp->count))
+            dp->due_us += hm_rand(dp) % hsp->interval_us;
+        hm_heap_push(hsp, k);
+    }
+    if (num_thr > hsp->num_devs)
+        num_thr = hsp->num_devs;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&hsp->mutex, NULL);
+    pthread_mutex_init(&hsp->out_mutex, NULL);
+#endif
+    sg_run_workers(num_thr, hm_worker, hsp);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&hsp->out_mutex);
+    pthread_mutex_destroy(&hsp->mutex);
+#endif
+    for (k = 0, dp = hsp->dev_arr; k < hsp->num_devs; ++k, ++dp)
+        hm_close_dev(dp);
+    return 0;
+}
+
+int
+main(int argc, char * argv[])
+{
+    bool verbose_given = false;
+    bool version_given = false;
+    int k, c, res;
+    int help = 0;
+    int ret = 0;
+    int num_thr = DEF_NUM_THREADS;
+    int64_t ll;
+    const char * in_fn = NULL;
+    const char * js_file = NULL;
+    const char * log_arg = def_log_s;
+    const char * thresh_arg = NULL;
+    struct hm_state_t hm_state;
+    struct hm_state_t * hsp = &hm_state;
+
+    memset(hsp, 0, sizeof(hm_state));
+    hsp->interval_us = (int64_t)DEF_INTERVAL_SECS * 1000000;
+    hsp->jitter_perc = DEF_JITTER_PERC;
+    hsp->out_fp = stdout;
+    /* each event is one JSON object, streamed on a single packed line */
+    sgj_init_state(&hsp->json_st, NULL);
+    hsp->json_st.pr_cbor = false;
+    hsp->json_st.pr_exit_status = false;
+    hsp->json_st.pr_leadin = false;
+    hsp->json_st.pr_out_hr = false;
+    hsp->json_st.pr_packed = true;
+    hsp->json_st.pr_pretty = false;
+    hsp->json_st.pr_stream = true;
+    hsp->json_st.arena_sz = 0;
+    if (getenv("SG3_UTILS_INVOCATION"))
+        sg_rep_invocation(MY_NAME, version_str, argc, argv, NULL);
+    while (1) {
+        int option_index = 0;
+
+        c = getopt_long(argc, argv, "c:hi:I:j:J:l:rt:T:vV", long_options,
+                        &option_index);
+        if (c == -1)
+            break;
+
+        switch (c) {
+        case 'c':
+            hsp->count = sg_get_num(optarg);
+            if (hsp->count < 0) {
+                pr2serr("bad argument to --count=\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 'h':
+        case '?':
+            ++help;
+            break;
+        case 'i':
+            in_fn = optarg;
+            break;
+        case 'I':
+            ll = sg_get_llnum(optarg);
+            if ((ll < 1) || (ll > 86400)) {
+                pr2serr("--interval= expects a value from 1 to 86400 "
+                        "seconds\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            hsp->interval_us = ll * 1000000;
+            break;
+        case 'j':
+            hsp->jitter_perc = sg_get_num(optarg);
+            if ((hsp->jitter_perc < 0) || (hsp->jitter_perc > 50)) {
+                pr2serr("--jitter= expects a percentage from 0 to 50\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 'J':
+            js_file = optarg;
+            break;
+        case 'l':
+            log_arg = optarg;
+            break;
+        case 'r':
+            hsp->o_readonly = true;
+            break;
+        case 't':
+            thresh_arg = optarg;
+            break;
+        case 'T':
+            num_thr = sg_get_num(optarg);
+            if ((num_thr < 1) || (num_thr > 1024)) {
+                pr2serr("--threads= expects a value from 1 to 1024\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
+        case 'v':
+            verbose_given = true;
+            ++hsp->verbose;
+            break;
+        case 'V':
+            version_given = true;
+            break;
+        default:
+            pr2serr("unrecognised option code 0x%x ??\n", c);
+            usage(1);
+            return SG_LIB_SYNTAX_ERROR;
+        }
+    }
+    if (help > 0) {
+        usage(help);
+        return 0;
+    }
+#ifdef DEBUG
+    pr2serr("In DEBUG mode, ");
+    if (verbose_given && version_given) {
+        pr2serr("but override: '-vV' given, zero verbose and continue\n");
+        /* verbose_given = false; */
+        version_given = false;
+        hsp->verbose = 0;
+    } else if (! verbose_given) {
+        pr2serr("set '-vv'\n");
+        hsp->verbose = 2;
+    } else
+        pr2serr("keep verbose=%d\n", hsp->verbose);
+#else
+    if (verbose_given && version_given)
+        pr2serr("Not in DEBUG mode, so '-vV' has no special action\n");
+#endif
+    if (version_given) {
+        pr2serr("Version: %s\n", version_str);
+        return 0;
+    }
+    res = hm_parse_log(hsp, log_arg);
+    if (res)
+        return res;
+    if (thresh_arg) {
+        res = hm_parse_threshold(hsp, thresh_arg);
+        if (res)
+            return res;
+    }
+    for (k = optind; k < argc; ++k) {
+        ret = hm_add_dev(hsp, argv[k], false);
+        if (ret)
+            goto fini;
+    }
+    if (in_fn) {
+        ret = sg_read_name_list(in_fn, hm_add_in_dev, hsp);
+        if (ret)
+            goto fini;
+    }
+    if (0 == hsp->num_devs) {
+        pr2serr("no DEVICE given\n\n");
+        usage(1);
+        ret = SG_LIB_SYNTAX_ERROR;
+        goto fini;
+    }
+    if (js_file) {
+        hsp->out_fp = fopen(js_file, "a");
+        if (NULL == hsp->out_fp) {
+            int e = errno;
+
+            pr2serr("unable to open --js-file=%s: %s\n", js_file,
+                    safe_strerror(e));
+            ret = sg_convert_errno(e);
+            goto fini;
+        }
+    }
+    signal(SIGINT, hm_sig_handler);
+    signal(SIGTERM, hm_sig_handler);
+    ret = hm_work(hsp, num_thr);
+    if (js_file)
+        fclose(hsp->out_fp);
+fini:
+    if (hsp->dev_arr) {
+        for (k = 0; k < hsp->num_devs; ++k) {
+            if (hsp->dev_arr[k].name_alloced)
+                free((void *)hsp->dev_arr[k].name);
+        }
+        free(hsp->dev_arr);
+    }
+    free(hsp->heap);
+    if (0 == hsp->verbose) {
+        if (! sg_if_can2stderr("sg_health failed: ", ret))
+            pr2serr("Some error occurred, try again with '-v' "
+                    "or '-vv' for more information\n");
+    }
+    return (ret >= 0) ? ret : SG_LIB_CAT_OTHER;
+}
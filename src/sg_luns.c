@@ -7,6 +7,10 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1   /* for readlink() and PATH_MAX */
+#endif
+
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
@@ -16,12 +20,22 @@
 #include <errno.h>
 #include <ctype.h>
 #include <getopt.h>
+#include <limits.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+
+#ifdef SG_LIB_LINUX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>      /* for major() + minor() */
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#endif
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
 #include "sg_unaligned.h"
@@ -35,17 +49,23 @@
  * and decodes the response.
  */
 
-static const char * version_str = "1.58 20230519";      /* spc6r08 */
+static const char * version_str = "1.59 20261018";      /* spc6r08 */
 
 #define MY_NAME "sg_luns"
 
 #define MAX_RLUNS_BUFF_LEN (1024 * 1024)
 #define DEF_RLUNS_BUFF_LEN (1024 * 8)
 
+#define VPD_DEVICE_ID 0x83
+#define PROBE_INQ_LEN 36
+#define PROBE_VPD83_LEN 1024
+#define PROBE_NUM_THREADS 16
+
 struct opts_t {
     bool do_json;
 #ifdef SG_LIB_LINUX
     bool do_linux;
+    bool do_probe;
 #endif
     bool do_quiet;
     bool do_raw;
@@ -73,6 +93,41 @@ struct opts_t {
     sgj_state json_st;
 };
 
+#ifdef SG_LIB_LINUX
+/* Per LU state for --probe */
+struct probe_lu_t {
+    bool lu_cong;       /* LU_CONG bit from standard INQUIRY */
+    bool is_admin;      /* administrative LU of a conglomerate */
+    int parent;         /* index of administrative LU, -1 for top level */
+    int res_open;       /* 0 or SG_LIB_* error from each step */
+    int res_inq;
+    int res_rcap;
+    int res_vpd83;
+    int res_sub_rl;     /* REPORT LUNS (SELECT REPORT=0x12) on admin LU */
+    int rcap_len;       /* 32 for READ CAPACITY(16), 8 for (10), else 0 */
+    int vpd83_len;
+    uint64_t linux_lun;
+    uint8_t lun[8];
+    uint8_t inq[PROBE_INQ_LEN];
+    uint8_t rcap[32];
+    uint8_t vpd83[PROBE_VPD83_LEN];
+    char dev_name[272]; /* bsg or sg device node, "" if none found */
+};
+
+struct probe_state_t {
+    int hct[3];         /* host, channel and target of DEVICE */
+    int num_lu;
+    int max_lu;         /* number of elements allocated in lu_arr */
+    int next_lu;        /* protected by mutex when threads are used */
+    int end_lu;
+    struct probe_lu_t * lu_arr;
+    struct opts_t * op;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
+#endif
+
 
 static const struct option long_options[] = {
     {"decode", no_argument, 0, 'd'},
@@ -90,6 +145,9 @@ static const struct option long_options[] = {
     {"lu_cong", no_argument, 0, 'L'},
     {"lu-cong", no_argument, 0, 'L'},
     {"maxlen", required_argument, 0, 'm'},
+#ifdef SG_LIB_LINUX
+    {"probe", no_argument, 0, 'p'},
+#endif
     {"quiet", no_argument, 0, 'q'},
     {"raw", no_argument, 0, 'r'},
     {"readonly", no_argument, 0, 'R'},
@@ -113,7 +171,7 @@ usage()
             "[--inner-hex]\n"
             "                  [--json[=JO]] [--js-file=JFN] [--linux] "
             "[--lu_cong]\n"
-            "                  [--maxlen=LEN] [--quiet] [--raw] "
+            "                  [--maxlen=LEN] [--probe] [--quiet] [--raw] "
             "[--readonly]\n"
             "                  [--select=SR] [--sinq_inraw=RFN] [--verbose] "
             "[--version]\n"
@@ -160,6 +218,12 @@ usage()
             "    --maxlen=LEN|-m LEN    max response length (allocation "
             "length in cdb)\n"
             "                           (def: 0 -> %d bytes)\n"
+#ifdef SG_LIB_LINUX
+            "    --probe|-p         send INQUIRY, READ CAPACITY and VPD "
+            "0x83 to each\n"
+            "                       reported lun (and subsidiary luns), "
+            "JSON output\n"
+#endif
             "    --quiet|-q         output only ASCII hex lun values\n"
             "    --raw|-r           output response in binary\n"
             "    --readonly|-R      open DEVICE read-only (def: read-write)\n"
@@ -449,6 +513,386 @@ t10_2linux_lun(const uint8_t t10_lun[])
         res = (res << 16) + sg_get_unaligned_be16(cp);
     return res;
 }
+/* --probe support follows. Each LUN in the REPORT LUNS response is mapped
+ * to the Linux bsg or sg device node of the same host:channel:target, then
+ * INQUIRY, READ CAPACITY and the Device Identification VPD page are fetched
+ * by a pool of worker threads. Responses are kept in the per LU element and
+ * the JSON tree is only built after the workers are finished, since the
+ * JSON functions are not thread safe. */
+
+static char *
+probe_lun_node(const int hct[3], uint64_t lin_lun, char * b, int blen)
+{
+    struct stat a_stat;
+    DIR * dirp;
+    struct dirent * dep;
+    char d[128];
+
+    snprintf(b, blen, "/dev/bsg/%d:%d:%d:%" PRIu64, hct[0], hct[1], hct[2],
+             lin_lun);
+    if (0 == stat(b, &a_stat))
+        return b;
+    snprintf(d, sizeof(d), "/sys/class/scsi_device/%d:%d:%d:%" PRIu64
+             "/device/scsi_generic", hct[0], hct[1], hct[2], lin_lun);
+    b[0] = '\0';
+    dirp = opendir(d);
+    if (NULL == dirp)
+        return b;
+    while ((dep = readdir(dirp))) {
+        if ('.' != dep->d_name[0]) {
+            snprintf(b, blen, "/dev/%s", dep->d_name);
+            break;
+        }
+    }
+    closedir(dirp);
+    return b;
+}
+
+/* Finds host, channel and target numbers of device_name, via its sysfs
+ * path which ends with a H:C:T:L directory (sd, sg and bsg nodes). Returns
+ * 0 if found, else SG_LIB_FILE_ERROR */
+static int
+probe_find_hct(const char * device_name, int hct[3], int vb)
+{
+    int k, n;
+    uint64_t ull;
+    struct stat a_stat;
+    char * cp;
+    char b[128];
+    char path[PATH_MAX];
+
+    if (stat(device_name, &a_stat) < 0) {
+        pr2serr("%s: unable to stat %s: %s\n", __func__, device_name,
+                safe_strerror(errno));
+        return SG_LIB_FILE_ERROR;
+    }
+    if (! (S_ISCHR(a_stat.st_mode) || S_ISBLK(a_stat.st_mode))) {
+        pr2serr("%s: %s is not a device node\n", __func__, device_name);
+        return SG_LIB_FILE_ERROR;
+    }
+    snprintf(b, sizeof(b), "/sys/dev/%s/%u:%u",
+             (S_ISCHR(a_stat.st_mode) ? "char" : "block"),
+             major(a_stat.st_rdev), minor(a_stat.st_rdev));
+    n = readlink(b, path, sizeof(path) - 1);
+    if (n <= 0) {
+        pr2serr("%s: readlink(%s) failed: %s\n", __func__, b,
+                safe_strerror(errno));
+        return SG_LIB_FILE_ERROR;
+    }
+    path[n] = '\0';
+    if (vb > 1)
+        pr2serr("%s: %s --> %s\n", __func__, b, path);
+    /* want the last path component of the form H:C:T:L */
+    for (k = 0, cp = path; (cp = strchr(cp, '/')); ++cp) {
+        int h, c, t;
+
+        if (4 == sscanf(cp + 1, "%d:%d:%d:%" SCNu64, &h, &c, &t, &ull)) {
+            hct[0] = h;
+            hct[1] = c;
+            hct[2] = t;
+            ++k;
+        }
+    }
+    if (0 == k) {
+        pr2serr("%s: no H:C:T:L found in %s\n", __func__, path);
+        return SG_LIB_FILE_ERROR;
+    }
+    return 0;
+}
+
+static void
+probe_one_lu(struct probe_lu_t * plup, const struct opts_t * op)
+{
+    int fd, pdt, res;
+    int vb = (op->verbose > 1) ? (op->verbose - 1) : 0;
+
+    fd = sg_cmds_open_device(plup->dev_name, op->o_readonly, vb);
+    if (fd < 0) {
+        plup->res_open = sg_convert_errno(-fd);
+        return;
+    }
+    res = sg_ll_inquiry(fd, false, false, 0, plup->inq, PROBE_INQ_LEN,
+                        false, vb);
+    plup->res_inq = res;
+    if (res)
+        goto fini;
+    plup->lu_cong = !!(0x40 & plup->inq[1]);
+    /* LU_CONG set and zero subsidiary element: an administrative LU */
+    plup->is_admin = plup->lu_cong && (0 == plup->lun[2]) &&
+                     (0 == plup->lun[3]);
+    pdt = PDT_MASK & plup->inq[0];
+    if ((PDT_DISK == pdt) || (PDT_WO == pdt) || (PDT_OPTICAL == pdt) ||
+        (PDT_RBC == pdt) || (PDT_ZBC == pdt)) {
+        res = sg_ll_readcap_16(fd, false, 0, plup->rcap, 32, false, vb);
+        if (0 == res)
+            plup->rcap_len = 32;
+        else if ((SG_LIB_CAT_INVALID_OP == res) ||
+                 (SG_LIB_CAT_ILLEGAL_REQ == res)) {
+            res = sg_ll_readcap_10(fd, false, 0, plup->rcap, 8, false, vb);
+            if (0 == res)
+                plup->rcap_len = 8;
+        }
+        plup->res_rcap = res;
+    }
+    res = sg_ll_inquiry(fd, false, true, VPD_DEVICE_ID, plup->vpd83,
+                        PROBE_VPD83_LEN, false, vb);
+    plup->res_vpd83 = res;
+    if (0 == res) {
+        plup->vpd83_len = sg_get_unaligned_be16(plup->vpd83 + 2) + 4;
+        if (plup->vpd83_len > PROBE_VPD83_LEN)
+            plup->vpd83_len = PROBE_VPD83_LEN;
+    }
+fini:
+    sg_cmds_close_device(fd);
+}
+
+static void *
+probe_worker(void * v_psp)
+{
+    int k;
+    struct probe_state_t * psp = (struct probe_state_t *)v_psp;
+
+    while (true) {
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&psp->mutex);
+#endif
+        k = psp->next_lu++;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&psp->mutex);
+#endif
+        if (k >= psp->end_lu)
+            break;
+        if (psp->lu_arr[k].dev_name[0])
+            probe_one_lu(psp->lu_arr + k, psp->op);
+    }
+    return NULL;
+}
+
+/* Probes elements [start, end) of psp->lu_arr concurrently */
+static void
+probe_range(struct probe_state_t * psp, int start, int end)
+{
+    int num_thr = end - start;
+
+    psp->next_lu = start;
+    psp->end_lu = end;
+    if (num_thr > PROBE_NUM_THREADS)
+        num_thr = PROBE_NUM_THREADS;
+    sg_run_workers(num_thr, probe_worker, psp);
+}
+
+/* Appends LUNs from REPORT LUNS response (rl_bp points to first LUN) to
+ * psp->lu_arr, skipping any already present. Returns 0 or error. */
+static int
+probe_add_luns(struct probe_state_t * psp, const uint8_t * rl_bp, int luns,
+               int parent)
+{
+    int k, j;
+    struct probe_lu_t * plup;
+
+    for (k = 0; k < luns; ++k, rl_bp += 8) {
+        for (j = 0; j < psp->num_lu; ++j) {
+            if (0 == memcmp(psp->lu_arr[j].lun, rl_bp, 8))
+                break;
+        }
+        if (j < psp->num_lu) {  /* already known, maybe nest under parent */
+            if ((parent >= 0) && (j != parent) &&
+                (psp->lu_arr[j].parent < 0))
+                psp->lu_arr[j].parent = parent;
+            continue;
+        }
+        if (psp->num_lu >= psp->max_lu) {
+            int n = psp->max_lu ? (2 * psp->max_lu) : 64;
+
+            plup = (struct probe_lu_t *)realloc(psp->lu_arr, n *
+                                                sizeof(struct probe_lu_t));
+            if (NULL == plup)
+                return sg_convert_errno(ENOMEM);
+            psp->lu_arr = plup;
+            psp->max_lu = n;
+        }
+        plup = psp->lu_arr + psp->num_lu++;
+        memset(plup, 0, sizeof(*plup));
+        memcpy(plup->lun, rl_bp, 8);
+        plup->parent = parent;
+        plup->linux_lun = t10_2linux_lun(rl_bp);
+        probe_lun_node(psp->hct, plup->linux_lun, plup->dev_name,
+                       sizeof(plup->dev_name));
+    }
+    return 0;
+}
+
+static void
+probe_js_err(sgj_state * jsp, sgj_opaque_p jop, const char * name, int res)
+{
+    char b[80];
+
+    sg_get_category_sense_str(res, sizeof(b), b, 0);
+    sgj_js_nv_ihexstr(jsp, jop, name, res, NULL, b);
+}
+
+/* Adds a JSON object for element k of psp->lu_arr to array jap, followed
+ * (recursively) by the subsidiary LUs of an administrative LU */
+static void
+probe_js_lu(struct probe_state_t * psp, int k, sgj_opaque_p jap)
+{
+    int j, off, len;
+    const struct probe_lu_t * plup = psp->lu_arr + k;
+    sgj_state * jsp = &psp->op->json_st;
+    sgj_opaque_p jop, jo2p, ja2p;
+    char b[64];
+
+    jop = sgj_new_unattached_object_r(jsp);
+    sgj_js_nv_hex_bytes(jsp, jop, "lun", plup->lun, 8);
+    sgj_js_nv_ihex(jsp, jop, "linux_lun", plup->linux_lun);
+    if ('\0' == plup->dev_name[0]) {
+        sgj_js_nv_s(jsp, jop, "os_device", "");
+        sgj_js_nv_s(jsp, jop, "error", "no bsg or sg device node found");
+        goto fini;
+    }
+    sgj_js_nv_s(jsp, jop, "os_device", plup->dev_name);
+    if (plup->res_open) {
+        probe_js_err(jsp, jop, "open_error", plup->res_open);
+        goto fini;
+    }
+    if (plup->res_inq) {
+        probe_js_err(jsp, jop, "inquiry_error", plup->res_inq);
+        goto fini;
+    }
+    jo2p = sgj_named_subobject_r(jsp, jop, "standard_inquiry_data");
+    sgj_js_nv_ihex(jsp, jo2p, "peripheral_qualifier", plup->inq[0] >> 5);
+    sgj_js_nv_ihexstr(jsp, jo2p, "peripheral_device_type",
+                      PDT_MASK & plup->inq[0], NULL,
+                      sg_get_pdt_str(PDT_MASK & plup->inq[0], sizeof(b),
+                                     b));
+    sgj_js_nv_ihex(jsp, jo2p, "lu_cong", (int)plup->lu_cong);
+    sgj_js_nv_s_len(jsp, jo2p, "t10_vendor_identification",
+                    (const char *)plup->inq + 8, 8);
+    sgj_js_nv_s_len(jsp, jo2p, "product_identification",
+                    (const char *)plup->inq + 16, 16);
+    sgj_js_nv_s_len(jsp, jo2p, "product_revision_level",
+                    (const char *)plup->inq + 32, 4);
+    sgj_js_nv_ihex(jsp, jop, "administrative_lu", (int)plup->is_admin);
+    if (32 == plup->rcap_len) {
+        jo2p = sgj_named_subobject_r(jsp, jop, "read_capacity");
+        sgj_js_nv_ihex(jsp, jo2p, "number_of_logical_blocks",
+                       sg_get_unaligned_be64(plup->rcap + 0) + 1);
+        sgj_js_nv_ihex(jsp, jo2p, "logical_block_length_in_bytes",
+                       sg_get_unaligned_be32(plup->rcap + 8));
+    } else if (8 == plup->rcap_len) {
+        jo2p = sgj_named_subobject_r(jsp, jop, "read_capacity");
+        sgj_js_nv_ihex(jsp, jo2p, "number_of_logical_blocks",
+                       (uint64_t)sg_get_unaligned_be32(plup->rcap + 0) + 1);
+        sgj_js_nv_ihex(jsp, jo2p, "logical_block_length_in_bytes",
+                       sg_get_unaligned_be32(plup->rcap + 4));
+    } else if (plup->res_rcap)
+        probe_js_err(jsp, jop, "read_capacity_error", plup->res_rcap);
+    if (plup->res_vpd83)
+        probe_js_err(jsp, jop, "device_identification_error",
+                     plup->res_vpd83);
+    else if (plup->vpd83_len > 4) {
+        ja2p = sgj_named_subarray_r(jsp, jop,
+                                    "designation_descriptor_list");
+        for (off = 4; (off + 4) <= plup->vpd83_len; off += len) {
+            len = plup->vpd83[off + 3] + 4;
+            if ((off + len) > plup->vpd83_len)
+                break;
+            jo2p = sgj_new_unattached_object_r(jsp);
+            sgj_js_designation_descriptor(jsp, jo2p, plup->vpd83 + off, len);
+            sgj_js_nv_o(jsp, ja2p, NULL /* name */, jo2p);
+        }
+    }
+    if (plup->is_admin) {
+        if (plup->res_sub_rl)
+            probe_js_err(jsp, jop, "report_luns_error", plup->res_sub_rl);
+        ja2p = sgj_named_subarray_r(jsp, jop, "subsidiary_lu_list");
+        for (j = 0; j < psp->num_lu; ++j) {
+            if (k == psp->lu_arr[j].parent)
+                probe_js_lu(psp, j, ja2p);
+        }
+    }
+fini:
+    sgj_js_nv_o(jsp, jap, NULL /* name */, jop);
+}
+
+/* Walks the luns (at rl_bp) reported by DEVICE, probing each one. Any
+ * administrative LUs found are asked (REPORT LUNS, SELECT REPORT=0x12) for
+ * their subsidiary LUs which are then probed in turn. */
+static int
+probe_luns(const uint8_t * rl_bp, int luns, struct opts_t * op,
+           sgj_opaque_p jop)
+{
+    int k, start, end, ret, res, fd, n_luns, rl_len;
+    struct probe_lu_t * plup;
+    uint8_t * rl_buff = NULL;
+    uint8_t * free_rl_buff = NULL;
+    sgj_state * jsp = &op->json_st;
+    sgj_opaque_p jo2p, jap;
+    struct probe_state_t ps SG_C_CPP_ZERO_INIT;
+    char b[64];
+
+    ps.op = op;
+    ret = probe_find_hct(op->device_name, ps.hct, op->verbose);
+    if (ret)
+        return ret;
+    jo2p = sgj_named_subobject_r(jsp, jop, "lun_probe");
+    snprintf(b, sizeof(b), "%d:%d:%d", ps.hct[0], ps.hct[1], ps.hct[2]);
+    sgj_js_nv_s(jsp, jo2p, "host_channel_target", b);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&ps.mutex, NULL);
+#endif
+    ret = probe_add_luns(&ps, rl_bp, luns, -1);
+    for (start = 0; (0 == ret) && (start < ps.num_lu); start = end) {
+        end = ps.num_lu;
+        probe_range(&ps, start, end);
+        /* fetch subsidiary LUs of newly probed administrative LUs */
+        for (k = start; k < end; ++k) {
+            plup = ps.lu_arr + k;
+            if ((! plup->is_admin) || (plup->res_open) || plup->res_inq)
+                continue;
+            if (NULL == rl_buff) {
+                rl_buff = sg_memalign(op->maxlen, 0, &free_rl_buff, false);
+                if (NULL == rl_buff) {
+                    ret = sg_convert_errno(ENOMEM);
+                    break;
+                }
+            }
+            fd = sg_cmds_open_device(plup->dev_name, op->o_readonly,
+                                     op->verbose);
+            if (fd < 0) {
+                plup->res_sub_rl = sg_convert_errno(-fd);
+                continue;
+            }
+            res = sg_ll_report_luns(fd, 0x12, rl_buff, op->maxlen, false,
+                                    op->verbose);
+            sg_cmds_close_device(fd);
+            if (res) {
+                plup->res_sub_rl = res;
+                continue;
+            }
+            rl_len = sg_get_unaligned_be32(rl_buff + 0) + 8;
+            if (rl_len > op->maxlen)
+                rl_len = op->maxlen;
+            n_luns = (rl_len - 8) / 8;
+            ret = probe_add_luns(&ps, rl_buff + 8, n_luns, k);
+            if (ret)
+                break;
+        }
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&ps.mutex);
+#endif
+    sgj_js_nv_i(jsp, jo2p, "number_of_lus_probed", ps.num_lu);
+    jap = sgj_named_subarray_r(jsp, jo2p, "lu_list");
+    for (k = 0; k < ps.num_lu; ++k) {
+        if (ps.lu_arr[k].parent < 0)
+            probe_js_lu(&ps, k, jap);
+    }
+    free(ps.lu_arr);
+    if (free_rl_buff)
+        free(free_rl_buff);
+    return ret;
+}
 #endif  /* SG_LIB_LINUX */
 
 static void
@@ -493,6 +937,11 @@ chk_short_opts(const char sopt_ch, struct opts_t * op)
         ++op->lu_cong_arg;
         op->lu_cong_arg_given = true;
         break;
+#ifdef SG_LIB_LINUX
+    case 'p':
+        op->do_probe = true;
+        break;
+#endif
     case 'q':
         op->do_quiet = true;
         break;
@@ -550,7 +999,7 @@ main(int argc, char * argv[])
         int option_index = 0;
 
 #ifdef SG_LIB_LINUX
-        c = getopt_long(argc, argv, "^dhHi:Ij::J:lLm:qQ:rRs:t:vV",
+        c = getopt_long(argc, argv, "^dhHi:Ij::J:lLm:pqQ:rRs:t:vV",
                         long_options, &option_index);
 #else
         c = getopt_long(argc, argv, "^dhHi:Ij::J:Lm:qQ:rRs:t:vV",
@@ -624,6 +1073,11 @@ main(int argc, char * argv[])
                 op->maxlen = 4;
             }
             break;
+#ifdef SG_LIB_LINUX
+        case 'p':
+            op->do_probe = true;
+            break;
+#endif
         case 'q':
             op->do_quiet = true;
             break;
@@ -691,6 +1145,16 @@ main(int argc, char * argv[])
         pr2serr("version: %s\n", version_str);
         return 0;
     }
+#ifdef SG_LIB_LINUX
+    if (op->do_probe) {
+        if (op->test_arg || op->inhex_fn || op->do_raw || op->do_hex) {
+            pr2serr("--probe needs a DEVICE and is not compatible with "
+                    "--test=, --inhex=, --raw or --hex\n");
+            return SG_LIB_CONTRADICT;
+        }
+        op->do_json = true;     /* probe results only output as JSON */
+    }
+#endif
     jsp = &op->json_st;
     if (op->do_json) {
         if (! sgj_init_state(jsp, op->json_arg)) {
@@ -977,6 +1441,10 @@ main(int argc, char * argv[])
                 decode_lun("      ", reportLunsBuff + off, op, jo3p);
             sgj_js_nv_o(jsp, jap, NULL /* name */, jo3p);
         }
+#ifdef SG_LIB_LINUX
+        if (op->do_probe)
+            ret = probe_luns(reportLunsBuff + 8, luns, op, jop);
+#endif
     } else if (SG_LIB_CAT_INVALID_OP == ret)
         pr2serr("Report Luns command not supported (support mandatory in "
                 "SPC-3)\n");
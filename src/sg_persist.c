@@ -20,6 +20,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
 #include <getopt.h>
 #define __STDC_FORMAT_MACROS 1
 
@@ -29,13 +30,17 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
 #include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
-static const char * version_str = "0.73 20230622";
+static const char * version_str = "0.74 20261018";
 static const char * my_name = "sg_persist: ";
 
 
@@ -55,6 +60,9 @@ static const char * my_name = "sg_persist: ";
 #define MX_ALLOC_LEN 8192
 #define MX_TIDS 32
 #define MX_TID_LEN 256
+#define DEF_NUM_THREADS 16      /* for --dev-list=FN */
+#define MX_NUM_THREADS 1024
+#define MX_UA_RETRIES 4         /* per device, for --dev-list=FN */
 
 
 #define SG_PERSIST_IN_RDONLY "SG_PERSIST_IN_RDONLY"
@@ -71,6 +79,7 @@ struct opts_t {
     bool verbose_given;
     bool version_given;
     int hex;
+    int num_threads;    /* --threads=NT, only used with --dev-list=FN */
     int num_transportids;
     int prin_sa;
     int prout_sa;
@@ -80,14 +89,40 @@ struct opts_t {
     uint32_t prout_type;
     uint64_t param_rk;
     uint64_t param_sark;
+    const char * dev_list_fn;   /* --dev-list=FN */
     uint8_t transportid_arr[MX_TIDS * MX_TID_LEN];
 };
 
+/* Per device state for the --dev-list=FN (multiple device) mode */
+struct mdev_elem_t {
+    char * dev_name;
+    int res;            /* 0 for success, else SG_LIB_CAT_* or errno based */
+    int ua_retries;     /* number of Unit Attentions retried */
+    int64_t elapsed_usecs;
+};
+
+/* Shared by all worker threads in the --dev-list=FN mode. Each worker takes
+ * the next unvisited device (next_dev) until none are left. */
+struct mdev_state_t {
+    struct opts_t * op;
+    uint8_t * pr_buff;  /* PR Out parameter list, only read by workers */
+    int pr_len;
+    int num_devs;
+    int mx_devs;
+    int next_dev;       /* protected by mutex when threads are used */
+    struct mdev_elem_t * dev_arr;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
+
 
 static const struct option long_options[] = {
     {"alloc-length", required_argument, 0, 'l'},
     {"alloc_length", required_argument, 0, 'l'},
     {"clear", no_argument, 0, 'C'},
+    {"dev-list", required_argument, 0, 'D'},
+    {"dev_list", required_argument, 0, 'D'},
     {"device", required_argument, 0, 'd'},
     {"help", no_argument, 0, 'h'},
     {"hex", no_argument, 0, 'H'},
@@ -133,6 +168,7 @@ static const struct option long_options[] = {
     {"report-capabilities", no_argument, 0, 'c'},
     {"report_capabilities", no_argument, 0, 'c'},
     {"reserve", no_argument, 0, 'R'},
+    {"threads", required_argument, 0, 't'},
     {"transport-id", required_argument, 0, 'X'},
     {"transport_id", required_argument, 0, 'X'},
     {"unreg", no_argument, 0, 'U'},
@@ -234,6 +270,10 @@ usage(int help)
                 "value (used with\n"
                 "                                 PR In only) (default: 8192 "
                 "(2000 in hex))\n"
+                "    --dev-list=FN|-D FN        send the PR Out command to "
+                "each device\n"
+                "                               named in file FN (one per "
+                "line)\n"
                 "    --device=DEVICE|-d DEVICE    supply DEVICE as an option "
                 "rather than\n"
                 "                                 an argument\n"
@@ -253,6 +293,10 @@ usage(int help)
                 "    --relative-target-port=RTPI|-Q RTPI    relative target "
                 "port "
                 "identifier\n"
+                "    --threads=NT|-t NT         maximum number of devices "
+                "worked on\n"
+                "                               concurrently with "
+                "--dev-list=FN (def: 16)\n"
                 "    --transport-id=TIDS|-X TIDS    one or more "
                 "TransportIDs can\n"
                 "                                   be given in several "
@@ -478,37 +522,63 @@ compact_transportid_array(struct opts_t * op)
     return compact_len;
 }
 
+/* Builds the PR Out parameter list for op->prout_sa in pr_buff, which is
+ * assumed to be zeroed and at least op->alloc_len bytes long. Compacts the
+ * TransportID array so should only be called once. Returns the parameter
+ * list length. */
 static int
-prout_work(int sg_fd, struct opts_t * op)
+build_prout_param(struct opts_t * op, uint8_t * pr_buff)
 {
     int len, t_arr_len;
-    int res = 0;
-    uint8_t * pr_buff = NULL;
-    uint8_t * free_pr_buff = NULL;
-    char b[64];
-    char bb[80];
 
     t_arr_len = compact_transportid_array(op);
-    pr_buff = sg_memalign(op->alloc_len, 0 /* page aligned */, &free_pr_buff,
-                          false);
-    if (NULL == pr_buff) {
-        pr2serr("%s: unable to allocate %d bytes on heap\n", __func__,
-                op->alloc_len);
-        return sg_convert_errno(ENOMEM);
-    }
     sg_put_unaligned_be64(op->param_rk, pr_buff + 0);
     sg_put_unaligned_be64(op->param_sark, pr_buff + 8);
+    len = 24;
+    if (PROUT_REG_MOVE_SA == op->prout_sa) {
+        if (op->param_unreg)
+            pr_buff[17] |= 0x2;
+        if (op->param_aptpl)
+            pr_buff[17] |= 0x1;
+        sg_put_unaligned_be16(op->param_rtp, pr_buff + 18);
+        if (t_arr_len > 0) {
+            memcpy(&pr_buff[24], op->transportid_arr, t_arr_len);
+            len += t_arr_len;
+            sg_put_unaligned_be32((uint32_t)t_arr_len, pr_buff + 20);
+        }
+        return len;
+    }
     if (op->param_alltgpt)
         pr_buff[20] |= 0x4;
     if (op->param_aptpl)
         pr_buff[20] |= 0x1;
-    len = 24;
     if (t_arr_len > 0) {
         pr_buff[20] |= 0x8;     /* set SPEC_I_PT bit */
         memcpy(&pr_buff[28], op->transportid_arr, t_arr_len);
         len += (t_arr_len + 4);
         sg_put_unaligned_be32((uint32_t)t_arr_len, pr_buff + 24);
     }
+    return len;
+}
+
+static int
+prout_work(int sg_fd, struct opts_t * op)
+{
+    int len;
+    int res = 0;
+    uint8_t * pr_buff = NULL;
+    uint8_t * free_pr_buff = NULL;
+    char b[64];
+    char bb[80];
+
+    pr_buff = sg_memalign(op->alloc_len, 0 /* page aligned */, &free_pr_buff,
+                          false);
+    if (NULL == pr_buff) {
+        pr2serr("%s: unable to allocate %d bytes on heap\n", __func__,
+                op->alloc_len);
+        return sg_convert_errno(ENOMEM);
+    }
+    len = build_prout_param(op, pr_buff);
     res = sg_ll_persistent_reserve_out(sg_fd, op->prout_sa, 0 /* rq_scope */,
                                        op->prout_type, pr_buff, len, true,
                                        op->verbose);
@@ -542,13 +612,12 @@ fini:
 static int
 prout_reg_move_work(int sg_fd, struct opts_t * op)
 {
-    int len, t_arr_len;
+    int len;
     int res = 0;
     uint8_t * pr_buff = NULL;
     uint8_t * free_pr_buff = NULL;
     static const char * ram_s = "register and move";
 
-    t_arr_len = compact_transportid_array(op);
     pr_buff = sg_memalign(op->alloc_len, 0 /* page aligned */, &free_pr_buff,
                           false);
     if (NULL == pr_buff) {
@@ -556,19 +625,7 @@ prout_reg_move_work(int sg_fd, struct opts_t * op)
                 op->alloc_len);
         return sg_convert_errno(ENOMEM);
     }
-    sg_put_unaligned_be64(op->param_rk, pr_buff + 0);
-    sg_put_unaligned_be64(op->param_sark, pr_buff + 8);
-    if (op->param_unreg)
-        pr_buff[17] |= 0x2;
-    if (op->param_aptpl)
-        pr_buff[17] |= 0x1;
-    sg_put_unaligned_be16(op->param_rtp, pr_buff + 18);
-    len = 24;
-    if (t_arr_len > 0) {
-        memcpy(&pr_buff[24], op->transportid_arr, t_arr_len);
-        len += t_arr_len;
-        sg_put_unaligned_be32((uint32_t)t_arr_len, pr_buff + 20);
-    }
+    len = build_prout_param(op, pr_buff);
     res = sg_ll_persistent_reserve_out(sg_fd, PROUT_REG_MOVE_SA,
                                        0 /* rq_scope */, op->prout_type,
                                        pr_buff, len, true, op->verbose);
@@ -595,6 +652,176 @@ fini:
     return res;
 }
 
+/* Called by sg_read_name_list() with each name in the --dev-list=FN file.
+ * Appends a device, whose name is owned by msp, to msp->dev_arr . */
+static int
+mdev_add_dev(char * name, void * v_msp)
+{
+    int mx;
+    struct mdev_state_t * msp = (struct mdev_state_t *)v_msp;
+    struct mdev_elem_t * t_arr;
+
+    if (msp->num_devs >= msp->mx_devs) {
+        mx = msp->mx_devs ? (2 * msp->mx_devs) : 64;
+        t_arr = (struct mdev_elem_t *)realloc(msp->dev_arr,
+                                              mx * sizeof(*t_arr));
+        if (NULL == t_arr) {
+            pr2serr("%s: out of memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        msp->dev_arr = t_arr;
+        msp->mx_devs = mx;
+    }
+    memset(msp->dev_arr + msp->num_devs, 0, sizeof(*t_arr));
+    msp->dev_arr[msp->num_devs++].dev_name = name;
+    return 0;
+}
+
+/* Sends the PR Out command to one device, retrying on Unit Attention.
+ * Output is suppressed (unless verbose) since many of these may run
+ * concurrently; results are collected in *mep and reported later. */
+static void
+mdev_one(const struct mdev_state_t * msp, struct mdev_elem_t * mep)
+{
+    int k, sg_fd, res;
+    int vb = msp->op->verbose;
+    int64_t start_usecs = sg_get_monotonic_usecs();
+    const struct opts_t * op = msp->op;
+
+    sg_fd = sg_cmds_open_device(mep->dev_name, false /* rw */, vb);
+    if (sg_fd < 0) {
+        if (vb)
+            pr2serr("%s: error opening %s: %s\n", __func__, mep->dev_name,
+                    safe_strerror(-sg_fd));
+        mep->res = sg_convert_errno(-sg_fd);
+        goto fini;
+    }
+    for (k = 0; ; ++k) {
+        res = sg_ll_persistent_reserve_out(sg_fd, op->prout_sa,
+                                           0 /* rq_scope */, op->prout_type,
+                                           msp->pr_buff, msp->pr_len,
+                                           vb > 0, vb);
+        if ((SG_LIB_CAT_UNIT_ATTENTION == res) && (k < MX_UA_RETRIES)) {
+            ++mep->ua_retries;
+            continue;
+        }
+        break;
+    }
+    mep->res = res;
+    sg_cmds_close_device(sg_fd);
+fini:
+    mep->elapsed_usecs = sg_get_monotonic_usecs() - start_usecs;
+}
+
+/* Worker (thread) function, each takes the next unvisited device until
+ * there are none left. */
+static void *
+mdev_worker(void * v_msp)
+{
+    int k;
+    struct mdev_state_t * msp = (struct mdev_state_t *)v_msp;
+
+    while (true) {
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&msp->mutex);
+#endif
+        k = msp->next_dev++;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&msp->mutex);
+#endif
+        if (k >= msp->num_devs)
+            break;
+        mdev_one(msp, msp->dev_arr + k);
+    }
+    return NULL;
+}
+
+/* Sends the PR Out command given on the command line to each device named
+ * in the --dev-list=FN file using up to op->num_threads concurrent workers.
+ * When all have completed, a result line for each device and a summary are
+ * output. Returns 0 if all devices succeeded, else the first error. */
+static int
+mdev_prout_work(struct opts_t * op)
+{
+    int k, num_devs, num_thr;
+    int ret = 0;
+    int num_good = 0;
+    int num_ua = 0;
+    int64_t start_usecs, elapsed_usecs;
+    uint8_t * free_pr_buff = NULL;
+    struct mdev_elem_t * mep;
+    struct mdev_state_t ms;
+    struct mdev_state_t * msp = &ms;
+    char b[80];
+    char bb[80];
+
+    memset(msp, 0, sizeof(*msp));
+    ret = sg_read_name_list(op->dev_list_fn, mdev_add_dev, msp);
+    num_devs = msp->num_devs;
+    if (ret)
+        goto fini;
+    if (0 == num_devs) {
+        pr2serr("no devices found in %s\n", op->dev_list_fn);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    msp->op = op;
+    msp->pr_buff = sg_memalign(op->alloc_len, 0 /* page aligned */,
+                               &free_pr_buff, false);
+    if (NULL == msp->pr_buff) {
+        pr2serr("%s: unable to allocate %d bytes on heap\n", __func__,
+                op->alloc_len);
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    msp->pr_len = build_prout_param(op, msp->pr_buff);
+    num_thr = (op->num_threads < num_devs) ? op->num_threads : num_devs;
+    start_usecs = sg_get_monotonic_usecs();
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&msp->mutex, NULL);
+#endif
+    num_thr = sg_run_workers(num_thr, mdev_worker, msp);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&msp->mutex);
+#endif
+    elapsed_usecs = sg_get_monotonic_usecs() - start_usecs;
+
+    if (op->prout_sa < num_prout_sa_strs)
+        snprintf(b, sizeof(b), "%s", prout_sa_strs[op->prout_sa]);
+    else
+        snprintf(b, sizeof(b), "service action=0x%x", op->prout_sa);
+    printf("%s (%s) on %d devices:\n", prout_s, b, num_devs);
+    for (k = 0, mep = msp->dev_arr; k < num_devs; ++k, ++mep) {
+        if (0 == mep->res) {
+            ++num_good;
+            snprintf(bb, sizeof(bb), "good");
+        } else {
+            sg_get_category_sense_str(mep->res, sizeof(bb), bb,
+                                      op->verbose);
+            if (0 == ret)
+                ret = mep->res;
+        }
+        num_ua += mep->ua_retries;
+        printf("  %s: %s", mep->dev_name, bb);
+        if (mep->ua_retries > 0)
+            printf(" [%d UA retries]", mep->ua_retries);
+        printf(" (%" PRId64 ".%03d ms)\n", mep->elapsed_usecs / 1000,
+               (int)(mep->elapsed_usecs % 1000));
+    }
+    printf("Summary: %d good, %d failed, %d Unit Attentions retried; %d "
+           "worker%s\n", num_good, num_devs - num_good, num_ua, num_thr,
+           ((1 == num_thr) ? "" : "s"));
+    if (elapsed_usecs > 0)
+        printf("  time to complete: %" PRId64 ".%06d seconds\n",
+               elapsed_usecs / 1000000, (int)(elapsed_usecs % 1000000));
+fini:
+    for (k = 0; k < num_devs; ++k)
+        free(msp->dev_arr[k].dev_name);
+    free(msp->dev_arr);
+    if (free_pr_buff)
+        free(free_pr_buff);
+    return ret;
+}
+
 /* Decode various symbolic forms of TransportIDs into SPC-4 format.
  * Returns 1 if one found, else returns 0. */
 static int
@@ -973,6 +1200,7 @@ main(int argc, char * argv[])
     op->prout_sa = -1;
     op->inquiry = true;
     op->alloc_len = MX_ALLOC_LEN;
+    op->num_threads = DEF_NUM_THREADS;
    if (getenv("SG3_UTILS_INVOCATION"))
         sg_rep_invocation(my_name, version_str, argc, argv, stderr);
 
@@ -980,7 +1208,7 @@ main(int argc, char * argv[])
         int option_index = 0;
 
         c = getopt_long(argc, argv,
-                        "AcCd:GHhiIkK:l:Lm:MnoPQ:rRsS:T:UvVX:yYzZ",
+                        "AcCd:D:GHhiIkK:l:Lm:MnoPQ:rRsS:t:T:UvVX:yYzZ",
                         long_options, &option_index);
         if (c == -1)
             break;
@@ -1001,6 +1229,9 @@ main(int argc, char * argv[])
         case 'd':
             device_name = optarg;
             break;
+        case 'D':
+            op->dev_list_fn = optarg;
+            break;
         case 'G':
             op->prout_sa = PROUT_REG_SA;
             ++num_prout_sa;
@@ -1097,6 +1328,15 @@ main(int argc, char * argv[])
             }
             ++num_prout_param;
             break;
+        case 't':
+            op->num_threads = sg_get_num(optarg);
+            if ((op->num_threads < 1) ||
+                (op->num_threads > MX_NUM_THREADS)) {
+                pr2serr("argument to '--threads=' should be 1 to %d\n",
+                        MX_NUM_THREADS);
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
         case 'T':
             if (1 != sscanf(optarg, "%x", &op->prout_type)) {
                 pr2serr("bad argument to '--prout-type'\n");
@@ -1189,7 +1429,13 @@ main(int argc, char * argv[])
         return 0;
     }
 
-    if (NULL == device_name) {
+    if (op->dev_list_fn) {
+        if (device_name) {
+            pr2serr("give either --dev-list=FN or DEVICE, not both\n");
+            usage(1);
+            return SG_LIB_CONTRADICT;
+        }
+    } else if (NULL == device_name) {
         pr2serr("No device name given\n");
         usage(1);
         return SG_LIB_SYNTAX_ERROR;
@@ -1263,6 +1509,17 @@ main(int argc, char * argv[])
         }
     }
 
+    if (op->dev_list_fn) {
+        if (op->pr_in) {
+            pr2serr("--dev-list=FN only supported with PR Out (i.e. --out) "
+                    "service actions\n");
+            return SG_LIB_CONTRADICT;
+        }
+        ret = mdev_prout_work(op);
+        flagged = true;         /* each device's result already reported */
+        goto fini;
+    }
+
     if (op->inquiry) {
         if ((sg_fd = sg_cmds_open_device(device_name, true /* ro */,
                                          op->verbose)) < 0) {
@@ -26,6 +26,10 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_lib_data.h"
 #include "sg_cmds_basic.h"
@@ -39,7 +43,7 @@
  * device.
  */
 
-static const char * version_str = "1.36 20230622";      /* spc6r06 */
+static const char * version_str = "1.37 20261018";      /* spc6r06 */
 
 #ifndef SG_READ_BUFFER_10_CMD
 #define SG_READ_BUFFER_10_CMD 0x3c
@@ -64,12 +68,15 @@ static const char * version_str = "1.36 20230622";      /* spc6r06 */
 #define SENSE_BUFF_LEN  64      /* Arbitrary, could be larger */
 #define DEF_PT_TIMEOUT  60      /* 60 seconds */
 #define DEF_RESPONSE_LEN 4      /* increased to 64 for MODE_ERR_HISTORY */
+#define EH_DIR_MAX_LEN (32 + (256 * 8))
+#define DEF_EH_CHUNK_LEN (1024 * 1024)  /* --dump= per command, bytes */
 
 
 static const struct option long_options[] = {
     {"16", no_argument, 0, 'L'},
     {"eh_code", required_argument, 0, 'e'},
     {"eh-code", required_argument, 0, 'e'},
+    {"dump", required_argument, 0, 'd'},
     {"help", no_argument, 0, 'h'},
     {"hex", no_argument, 0, 'H'},
     {"id", required_argument, 0, 'i'},
@@ -111,22 +118,40 @@ struct opts_t {
     uint64_t rb_offset;
     const char * device_name;
     const char * inhex_name;
+    const char * dump_dir;
+};
+
+/* State of the thread writing one chunk of an error history buffer to its
+ * file while the next chunk is being fetched from the device. */
+struct eh_wr_t {
+    bool active;
+    int fd;
+    int len;
+    int err;            /* errno value from write(), 0 if none */
+    const uint8_t * bp;
+#ifdef HAVE_PTHREAD_H
+    pthread_t tid;
+#endif
 };
 
 
 static void
 usage()
 {
-    pr2serr("Usage: sg_read_buffer [--16] [--eh_code=EHC] [--help] [--hex] "
-            "[--id=ID]\n"
-            "                      [--inhex=FN] [--length=LEN] [--long] "
-            "[--mode=MO]\n"
+    pr2serr("Usage: sg_read_buffer [--16] [--dump=DIR] [--eh_code=EHC] "
+            "[--help] [--hex]\n"
+            "                      [--id=ID] [--inhex=FN] [--length=LEN] "
+            "[--long] [--mode=MO]\n"
             "                      [--no_output] [--offset=OFF] [--raw] "
             "[--readonly]\n"
             "                      [--specific=MS] [--verbose] [--version] "
             "DEVICE\n"
             "  where:\n"
             "    --16|-L             issue READ BUFFER(16) (def: 10)\n"
+            "    --dump=DIR|-d DIR    read error history directory then "
+            "each buffer\n"
+            "                         it lists into files in DIR; resumes "
+            "partial files\n"
             "    --eh_code=EHC|-e EHC    same as '-m eh -i EHC' where "
             "EHC is the\n"
             "                            error history code\n"
@@ -485,6 +510,315 @@ decode_error_history(const uint8_t * resp, const struct opts_t * op)
 
 }
 
+/* Fetches len bytes at offset off of error history buffer id into bp.
+ * Tries READ BUFFER(16) first, falling back to READ BUFFER(10) if the
+ * device does not support the former. Returns 0 on success with *residp
+ * set, else an SG_LIB_* value. */
+static int
+eh_read_chunk(int id, uint64_t off, uint8_t * bp, int len, int * residp,
+              struct opts_t * op)
+{
+    int res;
+
+    op->rb_mode = MODE_ERR_HISTORY;
+    op->rb_mode_sp = 0;
+    op->rb_id = id;
+    op->rb_offset = off;
+    op->rb_len = len;
+    *residp = 0;
+    if (op->do_long) {
+        res = sg_ll_read_buffer_16(bp, residp, op->verbose > 0, op);
+        if (SG_LIB_CAT_INVALID_OP != res)
+            return res;
+        if (op->verbose)
+            pr2serr("READ BUFFER(16) not supported, try READ BUFFER(10)\n");
+        op->do_long = false;
+    }
+    if ((off > 0xffffff) || (len > 0xffffff)) {
+        pr2serr("buffer ID 0x%x offset 0x%" PRIx64 " beyond reach of READ "
+                "BUFFER(10)\n", id, off);
+        return SG_LIB_CAT_OTHER;
+    }
+    return sg_ll_read_buffer_10(bp, residp, op->verbose > 0, op);
+}
+
+static void *
+eh_wr_worker(void * v_wp)
+{
+    int n;
+    int rem;
+    struct eh_wr_t * wp = (struct eh_wr_t *)v_wp;
+    const uint8_t * bp = wp->bp;
+
+    wp->err = 0;
+    for (rem = wp->len; rem > 0; rem -= n, bp += n) {
+        n = write(wp->fd, bp, rem);
+        if (n < 0) {
+            if (EINTR == errno) {
+                n = 0;
+                continue;
+            }
+            wp->err = errno;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Starts writing wp->len bytes at wp->bp to wp->fd. With pthreads this
+ * happens in another thread, otherwise it is done before returning. */
+static void
+eh_wr_start(struct eh_wr_t * wp)
+{
+#ifdef HAVE_PTHREAD_H
+    if (0 == pthread_create(&wp->tid, NULL, eh_wr_worker, wp)) {
+        wp->active = true;
+        return;
+    }
+#endif
+    eh_wr_worker(wp);
+}
+
+/* Waits for the write started by eh_wr_start(), if any. Returns 0 if it
+ * succeeded, else SG_LIB_FILE_ERROR. */
+static int
+eh_wr_finish(struct eh_wr_t * wp, const char * fn)
+{
+#ifdef HAVE_PTHREAD_H
+    if (wp->active) {
+        pthread_join(wp->tid, NULL);
+        wp->active = false;
+    }
+#endif
+    if (wp->err) {
+        pr2serr("write to %s: %s\n", fn, safe_strerror(wp->err));
+        wp->err = 0;
+        return SG_LIB_FILE_ERROR;
+    }
+    return 0;
+}
+
+/* Copies error history buffer id, up to max_len bytes long, into a file
+ * named eh_<id>.bin in the --dump= directory. Unless fresh is set, an
+ * existing file is assumed to hold the start of that buffer so fetching
+ * resumes at its size. The next chunk is fetched from the device while the
+ * previous one is being written, alternating between the two buffers in
+ * buf_arr. */
+static int
+eh_dump_id(int id, uint32_t max_len, bool fresh, uint8_t * buf_arr[2],
+           int chunk, struct opts_t * op)
+{
+    int fd, k, n, res, resid;
+    int ret = 0;
+    uint64_t off, start_off;
+    struct stat st;
+    struct eh_wr_t wr;
+    char fn[512];
+
+    memset(&wr, 0, sizeof(wr));
+    snprintf(fn, sizeof(fn), "%s/eh_%02x.bin", op->dump_dir, id);
+    fd = open(fn, O_WRONLY | O_CREAT | (fresh ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        res = errno;
+        pr2serr("unable to open %s: %s\n", fn, safe_strerror(res));
+        return sg_convert_errno(res);
+    }
+    if (fstat(fd, &st) < 0) {
+        res = errno;
+        pr2serr("fstat on %s: %s\n", fn, safe_strerror(res));
+        close(fd);
+        return sg_convert_errno(res);
+    }
+    start_off = (uint64_t)st.st_size;
+    off = start_off;
+    if (off >= max_len) {
+        printf("Buffer ID 0x%x: already complete, %" PRIu64 " bytes in "
+               "%s\n", id, off, fn);
+        close(fd);
+        return 0;
+    }
+    if ((off > 0) && (lseek(fd, (off_t)off, SEEK_SET) < 0)) {
+        res = errno;
+        pr2serr("lseek on %s: %s\n", fn, safe_strerror(res));
+        close(fd);
+        return sg_convert_errno(res);
+    }
+    wr.fd = fd;
+    for (k = 0; off < max_len; k ^= 1) {
+        n = ((max_len - off) < (uint64_t)chunk) ? (int)(max_len - off) :
+                                                  chunk;
+        if (op->verbose > 1)
+            pr2serr("buffer ID 0x%x: fetch %d bytes at offset 0x%" PRIx64
+                    "\n", id, n, off);
+        res = eh_read_chunk(id, off, buf_arr[k], n, &resid, op);
+        /* buf_arr[k ^ 1] may have been written meanwhile */
+        ret = eh_wr_finish(&wr, fn);
+        if (res) {
+            char b[80];
+
+            if (res > 0) {
+                sg_get_category_sense_str(res, sizeof(b), b, op->verbose);
+                pr2serr("Read buffer(%d) of buffer ID 0x%x failed: %s\n",
+                        (op->do_long ? 16 : 10), id, b);
+            }
+            ret = res;
+        }
+        if (ret)
+            break;
+        if ((resid > 0) && (resid <= n))
+            n -= resid;
+        if (n > 0) {
+            wr.bp = buf_arr[k];
+            wr.len = n;
+            eh_wr_start(&wr);
+            off += n;
+        }
+        if (resid > 0)
+            break;      /* short read: device has no more */
+    }
+    res = eh_wr_finish(&wr, fn);
+    if (0 == ret)
+        ret = res;
+    if (close(fd) < 0) {
+        res = errno;
+        pr2serr("close of %s: %s\n", fn, safe_strerror(res));
+        if (0 == ret)
+            ret = sg_convert_errno(res);
+    }
+    if (0 == ret) {
+        printf("Buffer ID 0x%x: %" PRIu64 " bytes in %s", id, off, fn);
+        if (start_off > 0)
+            printf(" (resumed at %" PRIu64 ")", start_off);
+        printf("\n");
+    } else
+        pr2serr("Buffer ID 0x%x: stopped at offset %" PRIu64 " in %s, run "
+                "again to resume\n", id, off, fn);
+    return ret;
+}
+
+/* Implements --dump=DIR . Reads the error history directory then copies
+ * each buffer it lists into a file in DIR. The directory is kept in
+ * DIR/eh_dir.bin ; if it matches the one the device now returns then
+ * partially copied buffers are resumed, otherwise they are started again
+ * since the device has a different error history snapshot. */
+static int
+eh_dump(struct opts_t * op)
+{
+    bool fresh = true;
+    int k, n, fd, res, resid, dir_len, chunk, num;
+    int ret = 0;
+    int dir_id = op->rb_id_given ? op->rb_id : 0;
+    uint32_t max_len;
+    uint8_t * dirp = NULL;
+    uint8_t * free_dirp = NULL;
+    uint8_t * oldp = NULL;
+    uint8_t * free_oldp = NULL;
+    uint8_t * free_buf = NULL;
+    uint8_t * buf_arr[2];
+    const uint8_t * up;
+    struct stat st;
+    char fn[512];
+
+    if ((stat(op->dump_dir, &st) < 0) || (! S_ISDIR(st.st_mode))) {
+        pr2serr("--dump=%s: expected an existing directory\n", op->dump_dir);
+        return SG_LIB_FILE_ERROR;
+    }
+    chunk = op->rb_len_given ? op->rb_len : DEF_EH_CHUNK_LEN;
+    if (chunk <= 0)
+        chunk = DEF_EH_CHUNK_LEN;
+    dirp = (uint8_t *)sg_memalign(EH_DIR_MAX_LEN, 0, &free_dirp, false);
+    oldp = (uint8_t *)sg_memalign(EH_DIR_MAX_LEN, 0, &free_oldp, false);
+    buf_arr[0] = (uint8_t *)sg_memalign(2 * chunk, 0, &free_buf, false);
+    if ((NULL == dirp) || (NULL == oldp) || (NULL == buf_arr[0])) {
+        pr2serr("%s: unable to allocate buffers\n", __func__);
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    buf_arr[1] = buf_arr[0] + chunk;
+
+    ret = eh_read_chunk(dir_id, 0, dirp, EH_DIR_MAX_LEN, &resid, op);
+    if (ret) {
+        char b[80];
+
+        if (ret > 0) {
+            sg_get_category_sense_str(ret, sizeof(b), b, op->verbose);
+            pr2serr("Read buffer(%d) of error history directory failed: "
+                    "%s\n", (op->do_long ? 16 : 10), b);
+        }
+        goto fini;
+    }
+    n = EH_DIR_MAX_LEN - resid;
+    if (n < 32) {
+        pr2serr("Error history directory too short [%d bytes]\n", n);
+        ret = SG_LIB_CAT_MALFORMED;
+        goto fini;
+    }
+    dir_len = 32 + sg_get_unaligned_be16(dirp + 30);
+    if (dir_len > n) {
+        pr2serr("Error history directory truncated, %d bytes, expected "
+                "%d\n", n, dir_len);
+        dir_len = n;
+    }
+
+    snprintf(fn, sizeof(fn), "%s/eh_dir.bin", op->dump_dir);
+    fd = open(fn, O_RDONLY);
+    if (fd >= 0) {
+        n = read(fd, oldp, EH_DIR_MAX_LEN);
+        if ((n == dir_len) && (0 == memcmp(oldp, dirp, dir_len)))
+            fresh = false;
+        else
+            pr2serr("Error history directory has changed, start again\n");
+        close(fd);
+    }
+    if (fresh) {
+        fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            res = errno;
+            pr2serr("unable to open %s: %s\n", fn, safe_strerror(res));
+            ret = sg_convert_errno(res);
+            goto fini;
+        }
+        n = write(fd, dirp, dir_len);
+        res = errno;
+        close(fd);
+        if (n != dir_len) {
+            pr2serr("write to %s: %s\n", fn,
+                    (n < 0) ? safe_strerror(res) : "short write");
+            ret = SG_LIB_FILE_ERROR;
+            goto fini;
+        }
+    }
+    if (op->verbose)
+        pr2serr("Error history directory: %d bytes, %s\n", dir_len,
+                fresh ? "new" : "unchanged so resuming");
+
+    num = (dir_len - 32) / 8;
+    for (k = 0, up = dirp + 32; k < num; ++k, up += 8) {
+        if ((up[0] < 0x10) || (up[0] > 0xef)) {
+            if (op->verbose)
+                pr2serr("skip directory entry with buffer ID 0x%x\n",
+                        up[0]);
+            continue;
+        }
+        max_len = sg_get_unaligned_be32(up + 4);
+        if (0 == max_len)
+            continue;
+        res = eh_dump_id(up[0], max_len, fresh, buf_arr, chunk, op);
+        if (res) {
+            ret = res;
+            break;
+        }
+    }
+fini:
+    if (free_buf)
+        free(free_buf);
+    if (free_oldp)
+        free(free_oldp);
+    if (free_dirp)
+        free(free_dirp);
+    return ret;
+}
+
 static void
 dStrRaw(const uint8_t * str, int len)
 {
@@ -515,12 +849,15 @@ main(int argc, char * argv[])
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "e:hHi:I:l:Lm:No:rRS:vV", long_options,
+        c = getopt_long(argc, argv, "d:e:hHi:I:l:Lm:No:rRS:vV", long_options,
                         &option_index);
         if (c == -1)
             break;
 
         switch (c) {
+        case 'd':
+            op->dump_dir = optarg;
+            break;
         case 'e':
             if (op->rb_mode_given && (MODE_ERR_HISTORY != op->rb_mode)) {
                 pr2serr("mode incompatible with --eh_code= option\n");
@@ -708,6 +1045,24 @@ main(int argc, char * argv[])
             return SG_LIB_CONTRADICT;
         }
         op->rb_id = op->eh_code;
+        op->rb_id_given = true;
+    }
+    if (op->dump_dir) {
+        if (op->rb_mode_given && (MODE_ERR_HISTORY != op->rb_mode)) {
+            pr2serr("mode incompatible with --dump= option\n");
+            return SG_LIB_CONTRADICT;
+        }
+        if (op->rb_id_given && (op->rb_id > 3)) {
+            pr2serr("with --dump= the Buffer ID must select a directory "
+                    "variant (0 to 3)\n");
+            return SG_LIB_CONTRADICT;
+        }
+        if (op->inhex_name || op->do_raw || op->no_output || op->rb_offset) {
+            pr2serr("--dump= option contradicts --inhex=, --no_output, "
+                    "--offset= and --raw\n");
+            return SG_LIB_CONTRADICT;
+        }
+        op->do_long = true;     /* falls back to READ BUFFER(10) */
     }
 
     if (op->device_name && op->inhex_name) {
@@ -766,6 +1121,10 @@ main(int argc, char * argv[])
         ret = sg_convert_errno(-op->sg_fd);
         goto fini;
     }
+    if (op->dump_dir) {
+        ret = eh_dump(op);
+        goto fini;
+    }
 
     if (op->do_long)
         res = sg_ll_read_buffer_16(resp, &resid, true, op);
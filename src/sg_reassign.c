@@ -17,6 +17,7 @@
 #include <ctype.h>
 #include <getopt.h>
 #include <limits.h>
+#include <errno.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
@@ -39,19 +40,37 @@
  * vendor specific data is written.
  */
 
-static const char * version_str = "1.29 20230622";
+static const char * version_str = "1.30 20261018";
 
 #define DEF_DEFECT_LIST_FORMAT 4        /* bytes from index */
 
 #define MAX_NUM_ADDR 1024
 
+#define RDD12_HDR_LEN 8
+#define RDD12_PAGE_LEN (256 * 1024)     /* allocation length of each fetch */
+#define MAX_GEN_RETRIES 3
+#define DL_SNAP_HDR_LEN 16
+#define DL_SNAP_VERSION 1
+
 #ifndef UINT32_MAX
 #define UINT32_MAX ((uint32_t)-1)
 #endif
 
 
+static const char * dl_snap_magic = "SGDL";
+
+/* Defect list, as fetched or as read from a snapshot file */
+struct dl_snap_t {
+    int dl_format;      /* defect list format (0 to 5) */
+    int desc_len;       /* 4 or 8 bytes per address descriptor */
+    uint32_t num;       /* number of address descriptors in arr */
+    uint16_t generation;
+    uint8_t * arr;      /* sorted, duplicates removed */
+};
+
 static const struct option long_options[] = {
     {"address", required_argument, 0, 'a'},
+    {"compare", required_argument, 0, 'c'},
     {"dummy", no_argument, 0, 'd'},
     {"eight", required_argument, 0, 'e'},
     {"grown", no_argument, 0, 'g'},
@@ -59,6 +78,7 @@ static const struct option long_options[] = {
     {"hex", no_argument, 0, 'H'},
     {"longlist", required_argument, 0, 'l'},
     {"primary", no_argument, 0, 'p'},
+    {"save", required_argument, 0, 's'},
     {"verbose", no_argument, 0, 'v'},
     {"version", no_argument, 0, 'V'},
     {0, 0, 0, 0},
@@ -68,11 +88,12 @@ static const struct option long_options[] = {
 static void
 usage()
 {
-    pr2serr("Usage: sg_reassign [--address=A,A...] [--dummy] [--eight=0|1] "
-            "[--grown]\n"
-            "                   [--help] [--hex] [--longlist=0|1] "
-            "[--primary] [--verbose]\n"
-            "                   [--version] DEVICE\n"
+    pr2serr("Usage: sg_reassign [--address=A,A...] [--compare=PFN] [--dummy] "
+            "[--eight=0|1]\n"
+            "                   [--grown] [--help] [--hex] [--longlist=0|1] "
+            "[--primary]\n"
+            "                   [--save=SFN] [--verbose] [--version] "
+            "DEVICE\n"
             "  where:\n"
             "    --address=A,A...|-a A,A...    comma separated logical block "
             "addresses\n"
@@ -80,6 +101,10 @@ usage()
             "decimal\n"
             "    --address=-|-a -    read stdin for logical block "
             "addresses\n"
+            "    --compare=PFN|-c PFN    fetch whole defect list and compare "
+            "with\n"
+            "                            snapshot in PFN, list new "
+            "elements\n"
             "    --dummy|-d          prepare but do not execute REASSIGN "
             "BLOCKS command\n"
             "    --eight=0|1\n"
@@ -98,9 +123,15 @@ usage()
             "                        (def: 0 (2 byte list length))\n"
             "    --primary|-p        fetch primary defect list length, "
             "don't reassign\n"
+            "    --save=SFN|-s SFN    fetch whole defect list (def: grown) "
+            "with READ\n"
+            "                         DEFECT DATA(12), save sorted "
+            "snapshot in SFN\n"
             "    --verbose|-v        increase verbosity\n"
             "    --version|-V        print version string and exit\n\n"
-            "Perform a SCSI REASSIGN BLOCKS command (or READ DEFECT LIST)\n");
+            "Perform a SCSI REASSIGN BLOCKS command (or READ DEFECT LIST). "
+            "When new\nelements are found by '--compare=PFN' the exit "
+            "status is 36.\n");
 }
 
 /* Read numbers (up to 64 bits in size) from command line (comma (or
@@ -218,6 +249,306 @@ build_lba_arr(const char * inp, uint64_t * lba_arr,
 }
 
 
+/* Returns length of address descriptors in given defect list format, or 0
+ * if vendor specific or unknown. */
+static int
+dl_desc_len(int dl_format)
+{
+    switch (dl_format) {
+    case 0:     /* short block */
+        return 4;
+    case 1:     /* extended bytes from index */
+    case 2:     /* extended physical sector */
+    case 3:     /* long block */
+    case 4:     /* bytes from index */
+    case 5:     /* physical sector */
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+static int dl_cmp_len;  /* qsort() comparator needs descriptor length */
+
+static int
+dl_desc_cmp(const void * a, const void * b)
+{
+    /* address descriptors are big endian so memcmp() gives address order */
+    return memcmp(a, b, dl_cmp_len);
+}
+
+/* Sorts address descriptors in dlp then removes duplicates */
+static void
+dl_sort(struct dl_snap_t * dlp)
+{
+    uint32_t k, j;
+    int dlen = dlp->desc_len;
+
+    if (dlp->num < 2)
+        return;
+    dl_cmp_len = dlen;
+    qsort(dlp->arr, dlp->num, dlen, dl_desc_cmp);
+    for (k = 1, j = 0; k < dlp->num; ++k) {
+        if (memcmp(dlp->arr + (k * dlen), dlp->arr + (j * dlen), dlen)) {
+            ++j;
+            if (j != k)
+                memcpy(dlp->arr + (j * dlen), dlp->arr + (k * dlen), dlen);
+        }
+    }
+    dlp->num = j + 1;
+}
+
+/* Fetches whole defect list using READ DEFECT DATA(12), a page at a time
+ * using the address descriptor index. If the generation code changes
+ * between pages then starts again. Returns 0 if successful. */
+static int
+fetch_defect_list12(int sg_fd, bool primary, bool grown, int dl_format,
+                    struct dl_snap_t * dlp, int verbose)
+{
+    bool gen_changed = false;
+    int res, resid, tries, dlen, avail;
+    int n = 0;
+    uint32_t got, total, dl_len;
+    uint8_t * buff;
+    uint8_t * free_buff = NULL;
+    char b[80];
+
+    buff = sg_memalign(RDD12_PAGE_LEN, 0, &free_buff, false);
+    if (NULL == buff)
+        return sg_convert_errno(ENOMEM);
+    for (tries = 0, res = 0; tries < MAX_GEN_RETRIES; ++tries) {
+        gen_changed = false;
+        for (got = 0, total = 0, dlen = 0; (0 == got) || (got < total);
+             got += n) {
+            res = sg_ll_read_defect12(sg_fd, primary, grown, dl_format, got,
+                                      buff, RDD12_PAGE_LEN, &resid, false,
+                                      verbose);
+            if (res) {
+                sg_get_category_sense_str(res, sizeof(b), b, verbose);
+                pr2serr("READ DEFECT DATA(12): %s\n", b);
+                goto fini;
+            }
+            dl_len = sg_get_unaligned_be32(buff + 4);
+            if (0 == got) {
+                dlp->dl_format = buff[1] & 0x7;
+                dlen = dl_desc_len(dlp->dl_format);
+                if (0 == dlen) {
+                    pr2serr("defect list format %d not supported for "
+                            "snapshots\n", dlp->dl_format);
+                    res = SG_LIB_CAT_MALFORMED;
+                    goto fini;
+                }
+                dlp->desc_len = dlen;
+                dlp->generation = sg_get_unaligned_be16(buff + 2);
+                total = dl_len / dlen;
+                free(dlp->arr);
+                dlp->arr = (uint8_t *)calloc((total > 0) ? total : 1, dlen);
+                if (NULL == dlp->arr) {
+                    res = sg_convert_errno(ENOMEM);
+                    goto fini;
+                }
+            } else if (sg_get_unaligned_be16(buff + 2) != dlp->generation) {
+                if (verbose)
+                    pr2serr("defect list generation code changed, start "
+                            "again\n");
+                gen_changed = true;
+                break;
+            }
+            if (got >= total)
+                break;
+            avail = RDD12_PAGE_LEN - RDD12_HDR_LEN - resid;
+            if ((uint32_t)avail > dl_len)
+                avail = dl_len;
+            n = avail / dlen;
+            if ((uint32_t)n > (total - got))
+                n = total - got;
+            if (n <= 0) {
+                pr2serr("READ DEFECT DATA(12): no address descriptors "
+                        "at index %u, expected %u\n", got, total);
+                break;
+            }
+            if ((got > 0) && (0 == memcmp(buff + RDD12_HDR_LEN, dlp->arr,
+                                          dlen))) {
+                pr2serr("address descriptor index ignored by device, only "
+                        "have first %u of %u descriptors\n", got, total);
+                break;
+            }
+            memcpy(dlp->arr + (got * dlen), buff + RDD12_HDR_LEN, n * dlen);
+            if (verbose > 1)
+                pr2serr("    fetched %d address descriptors from index "
+                        "%u\n", n, got);
+        }
+        if (! gen_changed)
+            break;
+    }
+    if (got != total) {
+        /* a partial list would be saved or compared as if complete */
+        if (gen_changed)
+            pr2serr("defect list generation code still changing after %d "
+                    "tries\n", MAX_GEN_RETRIES);
+        pr2serr("READ DEFECT DATA(12): fetched %u of %u address "
+                "descriptors\n", got, total);
+        res = SG_LIB_CAT_MALFORMED;
+        goto fini;
+    }
+    dlp->num = got;
+    dl_sort(dlp);
+fini:
+    if (free_buff)
+        free(free_buff);
+    return res;
+}
+
+/* Snapshot file: 16 byte header then sorted address descriptors */
+static int
+dl_snap_write(const char * fn, const struct dl_snap_t * dlp)
+{
+    int err;
+    size_t n;
+    FILE * fp;
+    uint8_t hdr[DL_SNAP_HDR_LEN];
+
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, dl_snap_magic, 4);
+    hdr[4] = DL_SNAP_VERSION;
+    hdr[5] = (uint8_t)dlp->dl_format;
+    hdr[6] = (uint8_t)dlp->desc_len;
+    sg_put_unaligned_be32(dlp->num, hdr + 8);
+    sg_put_unaligned_be16(dlp->generation, hdr + 12);
+    fp = fopen(fn, "wb");
+    if (NULL == fp) {
+        err = errno;
+        pr2serr("unable to open %s for writing: %s\n", fn,
+                safe_strerror(err));
+        return sg_convert_errno(err);
+    }
+    n = (size_t)dlp->num * dlp->desc_len;
+    if ((1 != fwrite(hdr, sizeof(hdr), 1, fp)) ||
+        ((n > 0) && (1 != fwrite(dlp->arr, n, 1, fp)))) {
+        err = errno;
+        pr2serr("failed writing to %s: %s\n", fn, safe_strerror(err));
+        fclose(fp);
+        return sg_convert_errno(err);
+    }
+    if (fclose(fp)) {
+        err = errno;
+        pr2serr("close of %s failed: %s\n", fn, safe_strerror(err));
+        return sg_convert_errno(err);
+    }
+    return 0;
+}
+
+static int
+dl_snap_read(const char * fn, struct dl_snap_t * dlp)
+{
+    int err;
+    size_t n;
+    FILE * fp;
+    uint8_t hdr[DL_SNAP_HDR_LEN];
+
+    fp = fopen(fn, "rb");
+    if (NULL == fp) {
+        err = errno;
+        pr2serr("unable to open %s for reading: %s\n", fn,
+                safe_strerror(err));
+        return sg_convert_errno(err);
+    }
+    if ((1 != fread(hdr, sizeof(hdr), 1, fp)) ||
+        memcmp(hdr, dl_snap_magic, 4) || (DL_SNAP_VERSION != hdr[4]) ||
+        (hdr[6] != dl_desc_len(hdr[5]))) {
+        pr2serr("%s is not a defect list snapshot\n", fn);
+        fclose(fp);
+        return SG_LIB_FILE_ERROR;
+    }
+    dlp->dl_format = hdr[5];
+    dlp->desc_len = hdr[6];
+    dlp->num = sg_get_unaligned_be32(hdr + 8);
+    dlp->generation = sg_get_unaligned_be16(hdr + 12);
+    n = (size_t)dlp->num * dlp->desc_len;
+    dlp->arr = (uint8_t *)malloc(n > 0 ? n : 1);
+    if (NULL == dlp->arr) {
+        fclose(fp);
+        return sg_convert_errno(ENOMEM);
+    }
+    if ((n > 0) && (1 != fread(dlp->arr, n, 1, fp))) {
+        pr2serr("%s: truncated, expected %u address descriptors\n", fn,
+                dlp->num);
+        fclose(fp);
+        return SG_LIB_FILE_ERROR;
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void
+dl_pr_desc(const char * leadin, int dl_format, const uint8_t * bp)
+{
+    switch (dl_format) {
+    case 0:
+        printf("%slba=0x%x\n", leadin, sg_get_unaligned_be32(bp));
+        break;
+    case 3:
+        printf("%slba=0x%" PRIx64 "\n", leadin, sg_get_unaligned_be64(bp));
+        break;
+    case 1:
+    case 4:
+        printf("%scylinder=%u, head=%u, bytes_from_index=0x%x\n", leadin,
+               sg_get_unaligned_be24(bp), bp[3],
+               sg_get_unaligned_be32(bp + 4));
+        break;
+    default:    /* 2 and 5 */
+        printf("%scylinder=%u, head=%u, sector=0x%x\n", leadin,
+               sg_get_unaligned_be24(bp), bp[3],
+               sg_get_unaligned_be32(bp + 4));
+        break;
+    }
+}
+
+/* Walks two sorted lists together outputting address descriptors in cur
+ * but not in prev (new) and, if verbose, those in prev but not in cur.
+ * Returns number of new address descriptors. */
+static uint32_t
+dl_snap_diff(const struct dl_snap_t * prev, const struct dl_snap_t * cur,
+             int verbose)
+{
+    int c;
+    int dlen = cur->desc_len;
+    uint32_t p, q;
+    uint32_t num_new = 0;
+    uint32_t num_gone = 0;
+    const uint8_t * pp;
+    const uint8_t * cp;
+
+    for (p = 0, q = 0; (p < prev->num) || (q < cur->num); ) {
+        pp = prev->arr + (p * dlen);
+        cp = cur->arr + (q * dlen);
+        if (p >= prev->num)
+            c = 1;
+        else if (q >= cur->num)
+            c = -1;
+        else
+            c = memcmp(pp, cp, dlen);
+        if (0 == c) {
+            ++p;
+            ++q;
+        } else if (c > 0) {
+            if (0 == num_new)
+                printf("New address descriptors:\n");
+            dl_pr_desc("  + ", cur->dl_format, cp);
+            ++num_new;
+            ++q;
+        } else {
+            if (verbose)
+                dl_pr_desc("  - ", prev->dl_format, pp);
+            ++num_gone;
+            ++p;
+        }
+    }
+    printf(">> Compared with snapshot of %u elements: %u new, %u no longer "
+           "present\n", prev->num, num_new, num_gone);
+    return num_new;
+}
+
 int
 main(int argc, char * argv[])
 {
@@ -236,6 +567,8 @@ main(int argc, char * argv[])
     int do_hex = 0;
     int verbose = 0;
     const char * device_name = NULL;
+    const char * cmp_fn = NULL;
+    const char * save_fn = NULL;
     uint64_t addr_arr[MAX_NUM_ADDR];
     uint8_t param_arr[4 + (MAX_NUM_ADDR * 8)];
     char b[80];
@@ -245,7 +578,7 @@ main(int argc, char * argv[])
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "a:de:ghHl:pvV", long_options,
+        c = getopt_long(argc, argv, "a:c:de:ghHl:ps:vV", long_options,
                         &option_index);
         if (c == -1)
             break;
@@ -260,6 +593,9 @@ main(int argc, char * argv[])
             }
             got_addr = true;
             break;
+        case 'c':
+            cmp_fn = optarg;
+            break;
         case 'd':
             dummy = true;
             break;
@@ -295,6 +631,9 @@ main(int argc, char * argv[])
         case 'p':
             primary = true;
             break;
+        case 's':
+            save_fn = optarg;
+            break;
         case 'v':
             verbose_given = true;
             ++verbose;
@@ -346,9 +685,12 @@ main(int argc, char * argv[])
         usage();
         return SG_LIB_SYNTAX_ERROR;
     }
+    if ((cmp_fn || save_fn) && (! primary))
+        grown = true;   /* snapshots default to the grown defect list */
     if (grown || primary) {
         if (got_addr) {
-            pr2serr("can't have '--address=' with '--grown' or '--primary'\n");
+            pr2serr("can't have '--address=' with '--grown', '--primary', "
+                    "'--compare=' or\n'--save='\n");
             usage();
             return SG_LIB_CONTRADICT;
         }
@@ -418,6 +760,37 @@ main(int argc, char * argv[])
             pr2serr("REASSIGN BLOCKS: %s\n", b);
             goto err_out;
         }
+    } else if (cmp_fn || save_fn) {
+        struct dl_snap_t cur SG_C_CPP_ZERO_INIT;
+        struct dl_snap_t prev SG_C_CPP_ZERO_INIT;
+
+        ret = fetch_defect_list12(sg_fd, primary, grown,
+                                  DEF_DEFECT_LIST_FORMAT, &cur, verbose);
+        if (0 == ret) {
+            printf(">> Elements in %s defect list: %u\n",
+                   (primary ? (grown ? "grown and primary" : "primary") :
+                              "grown"), cur.num);
+            if (cmp_fn) {
+                ret = dl_snap_read(cmp_fn, &prev);
+                if (ret)
+                    pr2serr("unable to use snapshot: %s\n", cmp_fn);
+                else if ((prev.dl_format != cur.dl_format) ||
+                         (prev.desc_len != cur.desc_len)) {
+                    pr2serr("snapshot in %s has defect list format %d, "
+                            "device gave %d\n", cmp_fn, prev.dl_format,
+                            cur.dl_format);
+                    ret = SG_LIB_CONTRADICT;
+                } else if (dl_snap_diff(&prev, &cur, verbose) > 0)
+                    ret = SG_LIB_OK_FALSE;
+            }
+            if (save_fn && ((0 == ret) || (SG_LIB_OK_FALSE == ret))) {
+                res = dl_snap_write(save_fn, &cur);
+                if (res)
+                    ret = res;
+            }
+        }
+        free(cur.arr);
+        free(prev.arr);
     } else /* if (grown || primary) */ {
         int dl_format = DEF_DEFECT_LIST_FORMAT;
         int div = 0;
@@ -500,7 +873,7 @@ err_out:
                 ret = sg_convert_errno(-res);
         }
     }
-    if (0 == verbose) {
+    if ((0 == verbose) && (SG_LIB_OK_FALSE != ret)) {
         if (! sg_if_can2stderr("sg_reassign failed: ", ret))
             pr2serr("Some error occurred, try again with '-v' "
                     "or '-vv' for more information\n");
@@ -27,8 +27,8 @@
 
 #include "sg_lib.h"
 #include "sg_lib_data.h"
-#include "sg_pt.h"
 #include "sg_cmds_basic.h"
+#include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 #include "sg_json_sg_lib.h"
@@ -41,7 +41,7 @@
  * Based on zbc2r12.pdf
  */
 
-static const char * version_str = "1.51 20230622";
+static const char * version_str = "1.52 20261018";
 
 #define MY_NAME "sg_rep_zones"
 
@@ -50,10 +50,7 @@ static const char * version_str = "1.51 20230622";
 #define DEF_RZONES_BUFF_LEN (1024 * 16)
 #define RCAP16_REPLY_LEN 32
 
-#define SG_ZONING_IN_CMDLEN 16
 #define REPORT_ZONES_DESC_LEN 64
-#define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
-#define DEF_PT_TIMEOUT  60      /* 60 seconds */
 
 /* Three zone service actions supported by this utility */
 enum zone_report_sa_e {
@@ -263,67 +260,6 @@ h_twoormore:
     prn_zone_type_abbrevs();
 }
 
-/* Invokes a SCSI REPORT ZONES, REPORT ZONE DOMAINS or REPORT REALMS command
- * (see ZBC and ZBC-2).  Return of 0 -> success, various SG_LIB_CAT_* positive
- * values or -1 -> other errors */
-static int
-sg_ll_report_zzz(int sg_fd, enum zone_report_sa_e serv_act, uint64_t zs_lba,
-                 bool partial, int report_opts, void * resp, int mx_resp_len,
-                 int * residp, bool noisy, int vb)
-{
-    int ret, res, sense_cat;
-    uint8_t rz_cdb[SG_ZONING_IN_CMDLEN] =
-          {SG_ZONING_IN, REPORT_ZONES_SA, 0, 0,  0, 0, 0, 0, 0, 0, 0, 0,
-           0, 0, 0, 0};
-    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
-    struct sg_pt_base * ptvp;
-
-    rz_cdb[1] = (uint8_t)serv_act;
-    sg_put_unaligned_be64(zs_lba, rz_cdb + 2);
-    sg_put_unaligned_be32((uint32_t)mx_resp_len, rz_cdb + 10);
-    rz_cdb[14] = report_opts & 0x3f;
-    if (partial)
-        rz_cdb[14] |= 0x80;
-    if (vb) {
-        char b[128];
-
-        pr2serr("    %s\n", sg_get_command_str(rz_cdb, SG_ZONING_IN_CMDLEN,
-                                               true, sizeof(b), b));
-    }
-    ptvp = construct_scsi_pt_obj();
-    if (NULL == ptvp) {
-        pr2serr("%s: out of memory\n", __func__);
-        return -1;
-    }
-    set_scsi_pt_cdb(ptvp, rz_cdb, sizeof(rz_cdb));
-    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
-    set_scsi_pt_data_in(ptvp, (uint8_t *)resp, mx_resp_len);
-    res = do_scsi_pt(ptvp, sg_fd, DEF_PT_TIMEOUT, vb);
-    ret = sg_cmds_process_resp(ptvp, "report zone/domain/realm", res, noisy,
-                               vb, &sense_cat);
-    if (-1 == ret) {
-        if (get_scsi_pt_transport_err(ptvp))
-            ret = SG_LIB_TRANSPORT_ERROR;
-        else
-            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
-    } else if (-2 == ret) {
-        switch (sense_cat) {
-        case SG_LIB_CAT_RECOVERED:
-        case SG_LIB_CAT_NO_SENSE:
-            ret = 0;
-            break;
-        default:
-            ret = sense_cat;
-            break;
-        }
-    } else
-        ret = 0;
-    if (residp)
-        *residp = get_scsi_pt_resid(ptvp);
-    destruct_scsi_pt_obj(ptvp);
-    return ret;
-}
-
 static void
 dStrRaw(const uint8_t * str, int len)
 {
@@ -736,9 +672,9 @@ find_report_zones(int sg_fd, uint8_t * rzBuff, const char * cmd_name,
     for ( ; num_rem > 0; num_rem -= num_zd) {
         resid = 0;
         if (sg_fd >= 0) {
-            res = sg_ll_report_zzz(sg_fd, REPORT_ZONES_SA, slba,
-                                   true /* set partial */, op->reporting_opt,
-                                   rzBuff, op->maxlen, &resid, true, op->vb);
+            res = sg_ll_report_zones(sg_fd, slba, true /* set partial */,
+                                     op->reporting_opt, rzBuff, op->maxlen,
+                                     &resid, true, op->vb);
             if (res) {
                 if (SG_LIB_CAT_INVALID_OP == res)
                     pr2serr("%s: %s%u, %s command not supported\n", __func__,
@@ -879,9 +815,9 @@ gather_statistics(int sg_fd, uint8_t * rzBuff, const char * cmd_name,
     for ( ; num_rem > 0; num_rem -= num_zd) {
         resid = 0;
         if (sg_fd >= 0) {
-            res = sg_ll_report_zzz(sg_fd, REPORT_ZONES_SA, slba,
-                                   true /* set partial */, op->reporting_opt,
-                                   rzBuff, op->maxlen, &resid, true, op->vb);
+            res = sg_ll_report_zones(sg_fd, slba, true /* set partial */,
+                                     op->reporting_opt, rzBuff, op->maxlen,
+                                     &resid, true, op->vb);
             if (res) {
                 if (SG_LIB_CAT_INVALID_OP == res)
                     pr2serr("%s: %s%u, %s command not supported\n", __func__,
@@ -1232,6 +1168,7 @@ main(int argc, char * argv[])
     const char * cmd_name = "Report zones";
     sgj_state * jsp;
     sgj_opaque_p jop = NULL;
+    FILE * js_fp = stdout;
     char b[80];
     struct opts_t opts SG_C_CPP_ZERO_INIT;
     struct opts_t * op = &opts;
@@ -1429,6 +1366,17 @@ main(int argc, char * argv[])
         usage(op->do_help);
         return 0;
     }
+    if (op->do_zdomains && op->do_realms) {
+        pr2serr("Can't have both --domain and --realm\n");
+        return SG_LIB_SYNTAX_ERROR;
+    } else if (op->do_zdomains)
+        cmd_name = "Report zone domains";
+    else if (op->do_realms)
+        cmd_name = "Report realms";
+    if ((op->serv_act != REPORT_ZONES_SA) && op->do_partial) {
+        pr2serr("Can only use --partial with REPORT ZONES\n");
+        return SG_LIB_SYNTAX_ERROR;
+    }
     jsp = &op->json_st;
     if (op->do_json) {
        if (! sgj_init_state(jsp, op->json_arg)) {
@@ -1444,23 +1392,27 @@ main(int argc, char * argv[])
             ret = SG_LIB_SYNTAX_ERROR;
             goto the_end;
         }
-        jop = sgj_start_r(MY_NAME, version_str, argc, argv, jsp);
+        if (op->js_file) {
+            if ((1 != strlen(op->js_file)) || ('-' != op->js_file[0])) {
+                js_fp = fopen(op->js_file, "w");   /* truncate if exists */
+                if (NULL == js_fp) {
+                    int e = errno;
+
+                    pr2serr("unable to open file: %s [%s]\n", op->js_file,
+                            safe_strerror(e));
+                    return sg_convert_errno(e);
+                }
+            }
+            /* '--js-file=-' will send JSON output to stdout */
+        }
+        /* zone descriptors are only added in order, so can be streamed */
+        jop = sgj_start_stream_r(MY_NAME, version_str, argc, argv, js_fp,
+                                 jsp);
     }
     as_json = jsp->pr_as_json;
 
-    if (op->do_zdomains && op->do_realms) {
-        pr2serr("Can't have both --domain and --realm\n");
-        return SG_LIB_SYNTAX_ERROR;
-    } else if (op->do_zdomains)
-        cmd_name = "Report zone domains";
-    else if (op->do_realms)
-        cmd_name = "Report realms";
     if (as_json)
         sgj_js_nv_s(jsp, jop, "scsi_command_name", cmd_name);
-    if ((op->serv_act != REPORT_ZONES_SA) && op->do_partial) {
-        pr2serr("Can only use --partial with REPORT ZONES\n");
-        return SG_LIB_SYNTAX_ERROR;
-    }
     if (device_name && op->in_fn) {
         pr2serr("ignoring DEVICE, best to give DEVICE or --inhex=FN, but "
                 "not both\n");
@@ -1471,7 +1423,8 @@ main(int argc, char * argv[])
     rzBuff = (uint8_t *)sg_memalign(op->maxlen, 0, &free_rzbp, op->vb > 3);
     if (NULL == rzBuff) {
         pr2serr("unable to sg_memalign %d bytes\n", op->maxlen);
-        return sg_convert_errno(ENOMEM);
+        ret = sg_convert_errno(ENOMEM);
+        goto the_end;
     }
 
     if (NULL == device_name) {
@@ -1540,9 +1493,9 @@ main(int argc, char * argv[])
         ret = gather_statistics(sg_fd, rzBuff, cmd_name, op);
         goto the_end;
     }
-    res = sg_ll_report_zzz(sg_fd, op->serv_act, op->st_lba, op->do_partial,
-                           op->reporting_opt, rzBuff, op->maxlen, &resid,
-                           true, op->vb);
+    res = sg_ll_zoning_in(sg_fd, (int)op->serv_act, op->st_lba,
+                          op->do_partial, op->reporting_opt, rzBuff,
+                          op->maxlen, &resid, true, op->vb);
     ret = res;
 start_response:
     if (0 == res) {
@@ -1630,26 +1583,10 @@ the_end:
     }
     ret = (ret >= 0) ? ret : SG_LIB_CAT_OTHER;
     if (as_json) {
-        FILE * fp = stdout;
-
-        if (op->js_file) {
-            if ((1 != strlen(op->js_file)) || ('-' != op->js_file[0])) {
-                fp = fopen(op->js_file, "w");   /* truncate if exists */
-                if (NULL == fp) {
-                    int e = errno;
-
-                    pr2serr("unable to open file: %s [%s]\n", op->js_file,
-                            safe_strerror(e));
-                    ret = sg_convert_errno(e);
-                }
-            }
-            /* '--js-file=-' will send JSON output to stdout */
-        }
-        if (fp)
-            sgj_js2file(jsp, NULL, ret, fp);
-        if (op->js_file && fp && (stdout != fp))
-            fclose(fp);
+        sgj_js2file(jsp, NULL, ret, js_fp);
         sgj_finish(jsp);
+        if (stdout != js_fp)
+            fclose(js_fp);
     }
     return ret;
 }
@@ -14,17 +14,24 @@
 #include <stdarg.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
 #include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
+#include "sg_json_sg_lib.h"
 
 /* A utility program for the Linux OS SCSI subsystem.
  *
@@ -33,9 +40,15 @@
  * to the given SCSI device.
  */
 
-static const char * version_str = "1.29 20230622";
+static const char * version_str = "1.30 20261018";
+
+#define MY_NAME "sg_rtpg"
 
 #define REPORT_TGT_GRP_BUFF_LEN 1024
+#define VPD_DEVICE_ID 0x83
+#define RB_VPD83_LEN 1024
+#define RB_DES_LEN 260          /* longest LU designator as a string */
+#define DEF_NUM_THREADS 8
 
 #define TPGS_STATE_OPTIMIZED 0x0
 #define TPGS_STATE_NONOPTIMIZED 0x1
@@ -54,8 +67,14 @@ static const struct option long_options[] = {
     {"extended", no_argument, 0, 'e'},
     {"help", no_argument, 0, 'h'},
     {"hex", no_argument, 0, 'H'},
+    {"in", required_argument, 0, 'i'},
+    {"json", optional_argument, 0, '^'},    /* short option is '-j' */
+    {"js-file", required_argument, 0, 'J'},
+    {"js_file", required_argument, 0, 'J'},
     {"raw", no_argument, 0, 'r'},
     {"readonly", no_argument, 0, 'R'},
+    {"state", required_argument, 0, 's'},
+    {"threads", required_argument, 0, 'T'},
     {"verbose", no_argument, 0, 'v'},
     {"version", no_argument, 0, 'V'},
     {0, 0, 0, 0},
@@ -66,19 +85,45 @@ static void
 usage()
 {
     pr2serr("Usage: sg_rtpg   [--decode] [--extended] [--help] [--hex] "
-            "[--raw] [--readonly]\n"
-            "                 [--verbose] [--version] DEVICE\n"
+            "[--in=FN]\n"
+            "                 [--json[=JO]] [--js-file=JFN] [--raw] "
+            "[--readonly]\n"
+            "                 [--state=SF] [--threads=NT] [--verbose] "
+            "[--version]\n"
+            "                 [DEVICE...]\n"
             "  where:\n"
             "    --decode|-d        decode status and asym. access state\n"
             "    --extended|-e      use extended header parameter data "
             "format\n"
             "    --help|-h          print out usage message\n"
             "    --hex|-H           print out response in hex\n"
+            "    --in=FN|-i FN      read DEVICE names, one per line, from "
+            "FN ('-' for\n"
+            "                       stdin); selects batch mode\n"
+            "    --json[=JO]|-j[=JO]    batch mode output in JSON; use "
+            "--json=? for\n"
+            "                           JSON help\n"
+            "    --js-file=JFN|-J JFN    JFN is a filename to which JSON "
+            "output is\n"
+            "                            written (def: stdout)\n"
             "    --raw|-r           output response in binary to stdout\n"
             "    --readonly|-R      open DEVICE read-only (def: read-write)\n"
+            "    --state=SF|-s SF    compare path states with those saved in "
+            "SF, then\n"
+            "                        update SF. Exit status is 36 if they "
+            "changed,\n"
+            "                        else 0\n"
+            "    --threads=NT|-T NT    batch mode: number of DEVICEs "
+            "probed\n"
+            "                          concurrently (def: %d)\n"
             "    --verbose|-v       increase verbosity\n"
             "    --version|-V       print version string and exit\n\n"
-            "Performs a SCSI REPORT TARGET PORT GROUPS command\n");
+            "Performs a SCSI REPORT TARGET PORT GROUPS command. Batch mode "
+            "is selected\nwhen more than one DEVICE is given, or by --in=, "
+            "--json or --state=. It\nprobes each DEVICE (path) and outputs "
+            "target port group states once per\nlogical unit, then the "
+            "target port group and state of each DEVICE.\n",
+            DEF_NUM_THREADS);
 
 }
 
@@ -112,59 +157,547 @@ decode_status(const int st)
     }
 }
 
-static void
-decode_tpgs_state(const int st)
+static const char *
+tpgs_state_str(const int st)
 {
     switch (st) {
     case TPGS_STATE_OPTIMIZED:
-        printf(" (active/optimized)");
-        break;
+        return "active/optimized";
     case TPGS_STATE_NONOPTIMIZED:
-        printf(" (active/non optimized)");
-        break;
+        return "active/non optimized";
     case TPGS_STATE_STANDBY:
-        printf(" (standby)");
-        break;
+        return "standby";
     case TPGS_STATE_UNAVAILABLE:
-        printf(" (unavailable)");
-        break;
+        return "unavailable";
     case TPGS_STATE_LB_DEPENDENT:
-        printf(" (logical block dependent)");
-        break;
+        return "logical block dependent";
     case TPGS_STATE_OFFLINE:
-        printf(" (offline)");
-        break;
+        return "offline";
     case TPGS_STATE_TRANSITIONING:
-        printf(" (transitioning between states)");
+        return "transitioning between states";
+    default:
+        return "unknown";
+    }
+}
+
+static void
+decode_tpgs_state(const int st)
+{
+    printf(" (%s)", tpgs_state_str(st));
+}
+
+/* Fetches the REPORT TARGET PORT GROUPS response into a heap buffer which
+ * is grown when the device reports more data than fits. On success *bufpp
+ * is set (caller frees it) and the response length is written to *lenp. */
+static int
+fetch_rtpg(int sg_fd, bool extended, uint8_t ** bufpp, int * lenp,
+           bool noisy, int verbose)
+{
+    int res, report_len;
+    int buff_len = REPORT_TGT_GRP_BUFF_LEN;
+    uint8_t * bp;
+
+    *bufpp = NULL;
+    *lenp = 0;
+    while (true) {
+        bp = (uint8_t *)calloc(1, buff_len);
+        if (NULL == bp) {
+            pr2serr("    Out of memory (ram)\n");
+            return sg_convert_errno(ENOMEM);
+        }
+        res = sg_ll_report_tgt_prt_grp2(sg_fd, bp, buff_len, extended,
+                                        noisy, verbose);
+        if (res) {
+            free(bp);
+            return res;
+        }
+        report_len = sg_get_unaligned_be32(bp + 0) + 4;
+        if (report_len <= buff_len)
+            break;
+        free(bp);
+        buff_len = report_len;
+    }
+    *bufpp = bp;
+    *lenp = report_len;
+    return 0;
+}
+
+/* Batch mode state for one DEVICE (path) */
+struct rb_dev_t {
+    bool name_alloced;
+    int res;            /* 0 or SG_LIB_* error */
+    int lu_ind;         /* index of first path to the same LU */
+    int tpg_id;         /* this path's target port group, -1 if unknown */
+    int rel_tp_id;      /* relative target port id, -1 if unknown */
+    int aas;            /* asymmetric access state, -1 if unknown */
+    int rtpg_len;
+    uint8_t * rtpg;     /* REPORT TARGET PORT GROUPS response */
+    const char * name;
+    char lu_des[RB_DES_LEN];    /* e.g. "naa.600a0b8000..." */
+};
+
+struct rb_state_t {
+    bool extended;
+    bool o_readonly;
+    int verbose;
+    int num_devs;
+    int mx_devs;
+    int next_dev;       /* protected by mutex when threads are used */
+    struct rb_dev_t * dev_arr;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
+
+static int
+rb_add_dev(struct rb_state_t * rbp, const char * name, bool alloced)
+{
+    struct rb_dev_t * dp;
+
+    if (rbp->num_devs >= rbp->mx_devs) {
+        int mx = rbp->mx_devs ? (2 * rbp->mx_devs) : 64;
+
+        dp = (struct rb_dev_t *)realloc(rbp->dev_arr, mx * sizeof(*dp));
+        if (NULL == dp) {
+            pr2serr("%s: out of memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        rbp->dev_arr = dp;
+        rbp->mx_devs = mx;
+    }
+    dp = rbp->dev_arr + rbp->num_devs++;
+    memset(dp, 0, sizeof(*dp));
+    dp->name = name;
+    dp->name_alloced = alloced;
+    return 0;
+}
+
+/* Called by sg_read_name_list() with each name in the --in=FN file */
+static int
+rb_add_in_dev(char * name, void * v_rbp)
+{
+    return rb_add_dev((struct rb_state_t *)v_rbp, name, true);
+}
+
+/* Picks the LU designator (NAA, then EUI-64, then SCSI name string, then
+ * T10 vendor ID) and this path's target port group and relative target
+ * port from the Device Identification VPD page in bp. */
+static void
+rb_decode_dev_id(const uint8_t * bp, int len, struct rb_dev_t * dp)
+{
+    int k, off, dlen, best;
+    int best_off = -1;
+    int best_rank = 0;
+    const uint8_t * ddp;
+    char * cp;
+    static const int lu_des_pref[] = {3, 2, 8, 1};  /* designator types */
+    static const int num_pref = SG_ARRAY_SIZE(lu_des_pref);
+
+    len = ((len - 4) < sg_get_unaligned_be16(bp + 2)) ? (len - 4) :
+                                            sg_get_unaligned_be16(bp + 2);
+    for (off = -1; 0 == sg_vpd_dev_id_iter(bp + 4, len, &off, -1, -1, -1); ) {
+        ddp = bp + 4 + off;
+        dlen = ddp[3];
+        if (1 == ((ddp[1] >> 4) & 0x3)) {       /* target port */
+            if ((4 == (ddp[1] & 0xf)) && (dlen >= 4))
+                dp->rel_tp_id = sg_get_unaligned_be16(ddp + 6);
+            else if ((5 == (ddp[1] & 0xf)) && (dlen >= 4))
+                dp->tpg_id = sg_get_unaligned_be16(ddp + 6);
+            continue;
+        }
+        if (0 != ((ddp[1] >> 4) & 0x3))         /* want LU association */
+            continue;
+        for (k = 0; k < num_pref; ++k) {
+            if ((ddp[1] & 0xf) == lu_des_pref[k])
+                break;
+        }
+        best = num_pref - k;
+        if (best > best_rank) {
+            best_rank = best;
+            best_off = off;
+        }
+    }
+    if (best_off < 0)
+        return;
+    ddp = bp + 4 + best_off;
+    dlen = ddp[3];
+    cp = dp->lu_des;
+    switch (ddp[1] & 0xf) {
+    case 3:
+        k = snprintf(cp, RB_DES_LEN, "naa.");
+        break;
+    case 2:
+        k = snprintf(cp, RB_DES_LEN, "eui.");
+        break;
+    case 1:
+        k = snprintf(cp, RB_DES_LEN, "t10.");
         break;
     default:
-        printf(" (unknown)");
+        k = 0;
         break;
     }
+    if ((3 == (ddp[0] & 0xf)) || (2 == (ddp[0] & 0xf))) {   /* UTF-8, ASCII */
+        for (off = 0; (off < dlen) && (k < (RB_DES_LEN - 1)); ++off) {
+            if (isprint(ddp[4 + off]))
+                cp[k++] = ddp[4 + off];
+            else if ('\0' == ddp[4 + off])
+                break;
+        }
+        while ((k > 0) && (' ' == cp[k - 1]))
+            --k;
+        cp[k] = '\0';
+    } else {
+        for (off = 0; (off < dlen) && (k < (RB_DES_LEN - 2)); ++off)
+            k += snprintf(cp + k, RB_DES_LEN - k, "%02x", ddp[4 + off]);
+    }
+}
+
+/* Finds this path's target port group descriptor in its own REPORT TARGET
+ * PORT GROUPS response, first by target port group id, then by relative
+ * target port id, and notes its asymmetric access state. */
+static void
+rb_find_own_tpg(struct rb_dev_t * dp, bool extended)
+{
+    int k, j, off, cnt;
+    const uint8_t * bp = dp->rtpg + 4;
+    const uint8_t * endp = dp->rtpg + dp->rtpg_len;
+
+    if (extended)
+        bp += 4;
+    for ( ; (bp + 8) <= endp; bp += off) {
+        cnt = bp[7];
+        off = 8 + (4 * cnt);
+        if (dp->tpg_id >= 0) {
+            if (sg_get_unaligned_be16(bp + 2) == dp->tpg_id) {
+                dp->aas = bp[0] & 0xf;
+                return;
+            }
+            continue;
+        }
+        for (k = 0, j = 8; (k < cnt) && ((bp + j + 4) <= endp);
+             ++k, j += 4) {
+            if (sg_get_unaligned_be16(bp + j + 2) == dp->rel_tp_id) {
+                dp->tpg_id = sg_get_unaligned_be16(bp + 2);
+                dp->aas = bp[0] & 0xf;
+                return;
+            }
+        }
+    }
+}
+
+static void
+rb_one(struct rb_state_t * rbp, struct rb_dev_t * dp)
+{
+    int sg_fd, res;
+    int vb = (rbp->verbose > 1) ? rbp->verbose - 1 : 0;
+    uint8_t * bp;
+    uint8_t vpd[RB_VPD83_LEN];
+
+    dp->tpg_id = -1;
+    dp->rel_tp_id = -1;
+    dp->aas = -1;
+    sg_fd = sg_cmds_open_device(dp->name, rbp->o_readonly, vb);
+    if (sg_fd < 0) {
+        dp->res = sg_convert_errno(-sg_fd);
+        return;
+    }
+    res = sg_ll_inquiry_v2(sg_fd, true, VPD_DEVICE_ID, vpd, sizeof(vpd), 0,
+                           NULL, false, vb);
+    if ((0 == res) && (VPD_DEVICE_ID == vpd[1]))
+        rb_decode_dev_id(vpd, sizeof(vpd), dp);
+    res = fetch_rtpg(sg_fd, rbp->extended, &bp, &dp->rtpg_len, false, vb);
+    if (0 == res) {
+        dp->rtpg = bp;
+        if ((dp->tpg_id >= 0) || (dp->rel_tp_id >= 0))
+            rb_find_own_tpg(dp, rbp->extended);
+    }
+    dp->res = res;
+    res = sg_cmds_close_device(sg_fd);
+    if ((res < 0) && (0 == dp->res))
+        dp->res = sg_convert_errno(-res);
+}
+
+/* Worker (thread) function, each takes the next unvisited DEVICE until
+ * there are none left. */
+static void *
+rb_worker(void * v_rbp)
+{
+    int k;
+    struct rb_state_t * rbp = (struct rb_state_t *)v_rbp;
+
+    while (true) {
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&rbp->mutex);
+#endif
+        k = rbp->next_dev++;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&rbp->mutex);
+#endif
+        if (k >= rbp->num_devs)
+            break;
+        rb_one(rbp, rbp->dev_arr + k);
+    }
+    return NULL;
+}
+
+static int
+rb_cmp_name(const void * a, const void * b)
+{
+    return strcmp(((const struct rb_dev_t *)a)->name,
+                  ((const struct rb_dev_t *)b)->name);
+}
+
+/* Builds one line per DEVICE, sorted by name, holding the state that a
+ * path checker cares about. Returns a heap buffer (caller frees). */
+static char *
+rb_state_str(const struct rb_state_t * rbp, int * lenp)
+{
+    int k, n;
+    int len = 0;
+    int mx = rbp->num_devs * (RB_DES_LEN + 128) + 1;
+    char * cp = (char *)malloc(mx);
+    const struct rb_dev_t * dp;
+
+    if (NULL == cp)
+        return NULL;
+    cp[0] = '\0';
+    for (k = 0, dp = rbp->dev_arr; k < rbp->num_devs; ++k, ++dp) {
+        n = snprintf(cp + len, mx - len, "%.100s %s %d %d %d\n", dp->name,
+                     (dp->lu_des[0] ? dp->lu_des : "-"), dp->tpg_id,
+                     dp->aas, dp->res);
+        len += n;
+    }
+    *lenp = len;
+    return cp;
+}
+
+/* Compares the new state against that held in the file sf, and replaces
+ * sf when they differ. Sets *changedp. */
+static int
+rb_state_file(const struct rb_state_t * rbp, const char * sf,
+              bool * changedp)
+{
+    int len, e, n;
+    int ret = 0;
+    char * sp;
+    char * op = NULL;
+    FILE * fp;
+    char tmp_fn[1024];
+
+    *changedp = true;
+    sp = rb_state_str(rbp, &len);
+    if (NULL == sp)
+        return sg_convert_errno(ENOMEM);
+    fp = fopen(sf, "r");
+    if (fp) {
+        op = (char *)malloc(len + 2);
+        if (op) {
+            n = fread(op, 1, len + 1, fp);
+            if ((n == len) && (0 == memcmp(op, sp, len)))
+                *changedp = false;
+            free(op);
+        }
+        fclose(fp);
+    }
+    if (! *changedp)
+        goto fini;
+    /* write to a temporary file then rename, so readers never see a
+     * partially written state file */
+    snprintf(tmp_fn, sizeof(tmp_fn), "%s.tmp", sf);
+    fp = fopen(tmp_fn, "w");
+    if (NULL == fp) {
+        e = errno;
+        pr2serr("unable to open %s: %s\n", tmp_fn, safe_strerror(e));
+        ret = sg_convert_errno(e);
+        goto fini;
+    }
+    n = fwrite(sp, 1, len, fp);
+    e = errno;
+    if (fclose(fp) || (n != len)) {
+        pr2serr("unable to write %s: %s\n", tmp_fn, safe_strerror(e));
+        ret = SG_LIB_FILE_ERROR;
+    } else if (rename(tmp_fn, sf) < 0) {
+        e = errno;
+        pr2serr("unable to rename %s to %s: %s\n", tmp_fn, sf,
+                safe_strerror(e));
+        ret = sg_convert_errno(e);
+    }
+fini:
+    free(sp);
+    return ret;
+}
+
+/* Outputs the target port groups of one LU, taken from the REPORT TARGET
+ * PORT GROUPS response of its first path that answered. */
+static void
+rb_out_lu(sgj_state * jsp, sgj_opaque_p jop, const struct rb_dev_t * dp,
+          int num_paths, bool extended)
+{
+    int off;
+    const uint8_t * bp = dp->rtpg + 4;
+    const uint8_t * endp = dp->rtpg + dp->rtpg_len;
+    sgj_opaque_p jo2p = NULL;
+    sgj_opaque_p jo3p;
+    sgj_opaque_p jap = NULL;
+
+    sgj_pr_hr(jsp, "%s, %d path%s:", dp->lu_des[0] ? dp->lu_des : dp->name,
+              num_paths, (1 == num_paths) ? "" : "s");
+    if (jsp->pr_as_json) {
+        jo2p = sgj_named_subobject_r(jsp, jop,
+                                     dp->lu_des[0] ? dp->lu_des : dp->name);
+        sgj_js_nv_i(jsp, jo2p, "path_count", num_paths);
+        jap = sgj_named_subarray_r(jsp, jo2p, "target_port_group");
+    }
+    if (extended)
+        bp += 4;
+    for ( ; (bp + 8) <= endp; bp += off) {
+        off = 8 + (4 * bp[7]);
+        sgj_pr_hr(jsp, "  tpg=0x%x %s%s", sg_get_unaligned_be16(bp + 2),
+                  tpgs_state_str(bp[0] & 0xf), (bp[0] & 0x80) ? ",pref" : "");
+        if (jsp->pr_as_json) {
+            jo3p = sgj_new_unattached_object_r(jsp);
+            sgj_js_nv_i(jsp, jo3p, "id", sg_get_unaligned_be16(bp + 2));
+            sgj_js_nv_i(jsp, jo3p, "asymmetric_access_state", bp[0] & 0xf);
+            sgj_js_nv_b(jsp, jo3p, "pref", !! (bp[0] & 0x80));
+            sgj_js_nv_i(jsp, jo3p, "status_code", bp[5]);
+            sgj_js_nv_i(jsp, jo3p, "target_port_count", bp[7]);
+            sgj_js_nv_o(jsp, jap, NULL /* name */, jo3p);
+        }
+    }
+    sgj_pr_hr(jsp, "\n");
+}
+
+/* Batch mode: REPORT TARGET PORT GROUPS (and the Device Identification VPD
+ * page) on every DEVICE using up to num_thr concurrent workers. Output is
+ * de-duplicated: target port group states once per LU designator, then
+ * each DEVICE's own target port group and state. */
+static int
+rb_work(struct rb_state_t * rbp, int num_thr, const char * state_fn,
+        sgj_state * jsp, sgj_opaque_p jop)
+{
+    bool changed = false;
+    int k, j, res, num_paths;
+    int ret = 0;
+    struct rb_dev_t * dp;
+    sgj_opaque_p jo2p = NULL;
+    sgj_opaque_p jo3p;
+    char b[80];
+
+    if (num_thr > rbp->num_devs)
+        num_thr = rbp->num_devs;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&rbp->mutex, NULL);
+#endif
+    sg_run_workers(num_thr, rb_worker, rbp);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&rbp->mutex);
+#endif
+    qsort(rbp->dev_arr, rbp->num_devs, sizeof(struct rb_dev_t),
+          rb_cmp_name);
+
+    /* group paths to the same LU, the first good path holds its TPGs */
+    for (k = 0, dp = rbp->dev_arr; k < rbp->num_devs; ++k, ++dp) {
+        dp->lu_ind = k;
+        if ((0 == dp->res) && dp->lu_des[0]) {
+            for (j = 0; j < k; ++j) {
+                if ((0 == rbp->dev_arr[j].res) &&
+                    (0 == strcmp(rbp->dev_arr[j].lu_des, dp->lu_des))) {
+                    dp->lu_ind = rbp->dev_arr[j].lu_ind;
+                    break;
+                }
+            }
+        }
+    }
+    if (jsp->pr_as_json)
+        jo2p = sgj_named_subobject_r(jsp, jop, "logical_unit");
+    for (k = 0, dp = rbp->dev_arr; k < rbp->num_devs; ++k, ++dp) {
+        if ((0 != dp->res) || (dp->lu_ind != k))
+            continue;
+        for (j = k, num_paths = 0; j < rbp->num_devs; ++j)
+            num_paths += (rbp->dev_arr[j].lu_ind == k);
+        rb_out_lu(jsp, jo2p, dp, num_paths, rbp->extended);
+    }
+    if (jsp->pr_as_json)
+        jo2p = sgj_named_subobject_r(jsp, jop, "device");
+    for (k = 0, dp = rbp->dev_arr; k < rbp->num_devs; ++k, ++dp) {
+        if (dp->res) {
+            if (0 == ret)
+                ret = dp->res;
+            sg_get_category_sense_str(dp->res, sizeof(b), b, rbp->verbose);
+            sgj_pr_hr(jsp, "%s: %s\n", dp->name, b);
+        } else if (dp->aas >= 0)
+            sgj_pr_hr(jsp, "%s: lu=%s tpg=0x%x rtp=0x%x %s\n", dp->name,
+                      (dp->lu_des[0] ? dp->lu_des : "-"), dp->tpg_id,
+                      dp->rel_tp_id, tpgs_state_str(dp->aas));
+        else
+            sgj_pr_hr(jsp, "%s: lu=%s, own target port group not found\n",
+                      dp->name, (dp->lu_des[0] ? dp->lu_des : "-"));
+        if (jsp->pr_as_json) {
+            jo3p = sgj_named_subobject_r(jsp, jo2p, dp->name);
+            if (dp->lu_des[0])
+                sgj_js_nv_s(jsp, jo3p, "lu", dp->lu_des);
+            if (dp->tpg_id >= 0)
+                sgj_js_nv_i(jsp, jo3p, "target_port_group", dp->tpg_id);
+            if (dp->rel_tp_id >= 0)
+                sgj_js_nv_i(jsp, jo3p, "relative_target_port",
+                            dp->rel_tp_id);
+            if (dp->aas >= 0)
+                sgj_js_nv_i(jsp, jo3p, "asymmetric_access_state", dp->aas);
+            sgj_js_nv_i(jsp, jo3p, "exit_status", dp->res);
+        }
+    }
+    if (state_fn) {
+        res = rb_state_file(rbp, state_fn, &changed);
+        if (res)
+            return res;
+        if (jsp->pr_as_json)
+            sgj_js_nv_b(jsp, jop, "state_changed", changed);
+        else if (rbp->verbose)
+            pr2serr("state %schanged\n", changed ? "" : "un");
+        /* with --state=SF the exit status only reports a change */
+        return changed ? SG_LIB_OK_FALSE : 0;
+    }
+    return ret;
 }
 
 int
 main(int argc, char * argv[])
 {
     bool decode = false;
+    bool do_json = false;
     bool hex = false;
     bool raw = false;
     bool o_readonly = false;
     bool extended = false;
     bool verbose_given = false;
     bool version_given = false;
-    int k, j, off, res, c, report_len, buff_len, tgt_port_count;
+    int k, j, off, res, c, report_len, tgt_port_count;
     int sg_fd = -1;
     int ret = 0;
     int verbose = 0;
+    int num_thr = DEF_NUM_THREADS;
     uint8_t * reportTgtGrpBuff = NULL;
     uint8_t * bp;
     const char * device_name = NULL;
-
+    const char * in_fn = NULL;
+    const char * json_arg = NULL;
+    const char * js_file = NULL;
+    const char * state_fn = NULL;
+    sgj_state * jsp;
+    sgj_opaque_p jop = NULL;
+    struct rb_state_t rb_state;
+    struct rb_state_t * rbp = &rb_state;
+    sgj_state json_st SG_C_CPP_ZERO_INIT;
+    char b[80];
+
+    memset(rbp, 0, sizeof(rb_state));
+    jsp = &json_st;
+    if (getenv("SG3_UTILS_INVOCATION"))
+        sg_rep_invocation(MY_NAME, version_str, argc, argv, NULL);
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "dehHrRvV", long_options,
+        c = getopt_long(argc, argv, "dehHi:j::J:rRs:T:vV", long_options,
                         &option_index);
         if (c == -1)
             break;
@@ -183,12 +716,41 @@ main(int argc, char * argv[])
         case 'H':
             hex = true;
             break;
+        case 'i':
+            in_fn = optarg;
+            break;
+        case 'j':       /* for: -j[=JO] */
+        case '^':       /* for: --json[=JO] */
+            do_json = true;
+            /* Now want '=' to precede all JSON optional arguments */
+            if (optarg) {
+                if (('j' == c) && ('=' == *optarg))
+                    json_arg = optarg + 1;
+                else
+                    json_arg = optarg;
+            } else
+                json_arg = NULL;
+            break;
+        case 'J':
+            do_json = true;
+            js_file = optarg;
+            break;
         case 'r':
             raw = true;
             break;
         case 'R':
             o_readonly = true;
             break;
+        case 's':
+            state_fn = optarg;
+            break;
+        case 'T':
+            num_thr = sg_get_num(optarg);
+            if ((num_thr < 1) || (num_thr > 1024)) {
+                pr2serr("--threads= expects a value from 1 to 1024\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
         case 'v':
             verbose_given = true;
             ++verbose;
@@ -207,12 +769,7 @@ main(int argc, char * argv[])
             device_name = argv[optind];
             ++optind;
         }
-        if (optind < argc) {
-            for (; optind < argc; ++optind)
-                pr2serr("Unexpected extra argument: %s\n", argv[optind]);
-            usage();
-            return SG_LIB_SYNTAX_ERROR;
-        }
+        /* more than one DEVICE selects batch mode */
     }
 #ifdef DEBUG
     pr2serr("In DEBUG mode, ");
@@ -234,6 +791,83 @@ main(int argc, char * argv[])
         pr2serr("Version: %s\n", version_str);
         return 0;
     }
+    if ((optind < argc) || in_fn || do_json || state_fn) {
+        if (raw || hex) {
+            pr2serr("--raw and --hex are not supported in batch mode\n");
+            return SG_LIB_CONTRADICT;
+        }
+        rbp->extended = extended;
+        rbp->o_readonly = o_readonly;
+        rbp->verbose = verbose;
+        if (do_json) {
+            if (! sgj_init_state(jsp, json_arg)) {
+                int bad_char = jsp->first_bad_char;
+                char e[1500];
+
+                if (bad_char) {
+                    pr2serr("bad argument to --json= option, unrecognized "
+                            "character '%c'\n\n", bad_char);
+                }
+                sg_json_usage(0, e, sizeof(e));
+                pr2serr("%s", e);
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            jop = sgj_start_r(MY_NAME, version_str, argc, argv, jsp);
+        }
+        for (k = optind - (device_name ? 1 : 0); k < argc; ++k) {
+            ret = rb_add_dev(rbp, argv[k], false);
+            if (ret)
+                goto rb_fini;
+        }
+        if (in_fn) {
+            ret = sg_read_name_list(in_fn, rb_add_in_dev, rbp);
+            if (ret)
+                goto rb_fini;
+        }
+        if (0 == rbp->num_devs) {
+            pr2serr("no DEVICE given\n\n");
+            ret = SG_LIB_SYNTAX_ERROR;
+            goto rb_fini;
+        }
+        ret = rb_work(rbp, num_thr, state_fn, jsp, jop);
+rb_fini:
+        if (jsp->pr_as_json) {
+            FILE * fp = stdout;
+
+            if (js_file) {
+                if ((1 != strlen(js_file)) || ('-' != js_file[0])) {
+                    fp = fopen(js_file, "w");   /* truncate if exists */
+                    if (NULL == fp) {
+                        int e = errno;
+
+                        pr2serr("unable to open file: %s [%s]\n", js_file,
+                                safe_strerror(e));
+                        ret = sg_convert_errno(e);
+                    }
+                }
+                /* '--js-file=-' will send JSON output to stdout */
+            }
+            if (fp) {
+                const char * estr = NULL;
+
+                if (sg_exit2str(ret, jsp->verbose, sizeof(b), b)) {
+                    if (strlen(b) > 0)
+                        estr = b;
+                }
+                sgj_js2file_estr(jsp, NULL, ret, estr, fp);
+            }
+            if (js_file && fp && (stdout != fp))
+                fclose(fp);
+            sgj_finish(jsp);
+        }
+        for (k = 0; k < rbp->num_devs; ++k) {
+            if (rbp->dev_arr[k].name_alloced)
+                free((char *)rbp->dev_arr[k].name);
+            free(rbp->dev_arr[k].rtpg);
+        }
+        free(rbp->dev_arr);
+        return (ret >= 0) ? ret : SG_LIB_CAT_OTHER;
+    }
     if (NULL == device_name) {
         pr2serr("Missing device name!\n\n");
         usage();
@@ -255,27 +889,10 @@ main(int argc, char * argv[])
         goto err_out;
     }
 
-    buff_len = REPORT_TGT_GRP_BUFF_LEN;
-
-retry:
-    reportTgtGrpBuff = (uint8_t *)malloc(buff_len);
-    if (NULL == reportTgtGrpBuff) {
-        pr2serr("    Out of memory (ram)\n");
-        goto err_out;
-    }
-    memset(reportTgtGrpBuff, 0x0, buff_len);
-
-    res = sg_ll_report_tgt_prt_grp2(sg_fd, reportTgtGrpBuff,
-                                    buff_len,
-                                    extended, true, verbose);
+    res = fetch_rtpg(sg_fd, extended, &reportTgtGrpBuff, &report_len, true,
+                     verbose);
     ret = res;
     if (0 == res) {
-        report_len = sg_get_unaligned_be32(reportTgtGrpBuff + 0) + 4;
-        if (report_len > buff_len) {
-            free(reportTgtGrpBuff);
-            buff_len = report_len;
-            goto retry;
-        }
         if (raw) {
             dStrRaw(reportTgtGrpBuff, report_len);
             goto err_out;
@@ -345,8 +962,6 @@ retry:
         pr2serr("bad field in Report Target Port Groups cdb including "
                 "unsupported service action\n");
     else {
-        char b[80];
-
         sg_get_category_sense_str(res, sizeof(b), b, verbose);
         pr2serr("Report Target Port Groups: %s\n", b);
     }
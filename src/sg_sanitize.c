@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <getopt.h>
+#include <time.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
@@ -33,7 +34,7 @@
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
-static const char * version_str = "1.22 20230622";
+static const char * version_str = "1.23 20261018";
 
 #define ME "sg_sanitize: "
 
@@ -116,7 +117,7 @@ usage()
           "[--test=TE]\n"
           "                   [--timeout=SECS] [--verbose] [--version] "
           "[--wait]\n"
-          "                   [--zero] [--znr] DEVICE\n"
+          "                   [--zero] [--znr] DEVICE [DEVICE...]\n"
           "  where:\n"
           "    --ause|-A            set AUSE bit in cdb\n"
           "    --block|-B           do BLOCK ERASE sanitize\n"
@@ -162,7 +163,9 @@ usage()
           "reconsider; then execute SANITIZE\ncommand with IMMED bit set; "
           "then use REQUEST SENSE command every 60\nseconds to poll for a "
           "progress indication; then exit when there is no\nmore progress "
-          "indication.\n"
+          "indication. If more than one DEVICE is given, SANITIZE is "
+          "started\n(IMMED set) on each DEVICE then all are polled together "
+          "and an aggregate\nprogress table is output.\n"
           );
 }
 
@@ -440,6 +443,123 @@ print_dev_id(int fd, uint8_t * sinq_resp, int max_rlen, int verbose)
 }
 
 
+/* Called when more than one DEVICE is given. Launches SANITIZE (IMMED set)
+ * on each DEVICE then polls all of them from one loop, each DEVICE at an
+ * interval that shrinks as its estimated completion nears. Returns 0 if all
+ * DEVICEs completed, else the first error encountered. */
+static int
+mdev_sanitize(struct opts_t * op, char ** dev_names, int num,
+              const void * param_lstp, int param_lst_len)
+{
+    bool changed;
+    int k, res, num_act, num_fail;
+    int ret = 0;
+    int vb = op->verbose;
+    int poll_vb = (vb > 1) ? (vb - 1) : 0;
+    time_t now, next_tm, start_tm, report_tm;
+    struct sg_mdev_st * mdarr;
+    struct sg_mdev_st * mdp;
+    uint8_t inq_resp[SAFE_STD_INQ_RESP_LEN];
+    char b[80];
+
+    mdarr = (struct sg_mdev_st *)calloc(num, sizeof(struct sg_mdev_st));
+    if (NULL == mdarr) {
+        pr2serr("%s: unable to obtain heap\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+    for (k = 0; k < num; ++k)
+        mdarr[k].fd = -1;
+    for (k = 0; k < num; ++k) {
+        mdp = mdarr + k;
+        mdp->name = dev_names[k];
+        mdp->progress = -1;
+        mdp->desc = op->desc;
+        mdp->fd = sg_cmds_open_device(mdp->name, false /* rw */, vb);
+        if (mdp->fd < 0) {
+            pr2serr(ME "open error: %s: %s\n", mdp->name,
+                    safe_strerror(-mdp->fd));
+            ret = sg_convert_errno(-mdp->fd);
+            goto fini;
+        }
+        printf("%s:\n", mdp->name);
+        ret = print_dev_id(mdp->fd, inq_resp, sizeof(inq_resp), vb);
+        if (ret)
+            goto fini;
+    }
+    if ((! op->quick) && (! op->fail)) {
+        snprintf(b, sizeof(b), "all %d DEVICEs given", num);
+        sg_warn_and_wait("SANITIZE", b, true);
+    }
+    start_tm = time(NULL);
+    for (k = 0, num_act = 0, num_fail = 0; k < num; ++k) {
+        mdp = mdarr + k;
+        res = do_sanitize(mdp->fd, op, param_lstp, param_lst_len);
+        mdp->start_tm = time(NULL);
+        if (res) {
+            sg_get_category_sense_str(res, sizeof(b), b, vb);
+            pr2serr("Sanitize failed on %s: %s\n", mdp->name, b);
+            mdp->res = res;
+            mdp->end_tm = mdp->start_tm;
+            ++num_fail;
+            if (0 == ret)
+                ret = res;
+        } else if (! op->dry_run) {
+            mdp->active = true;
+            mdp->next_tm = mdp->start_tm + SG_MDEV_MIN_POLL_SECS;
+            ++num_act;
+        }
+    }
+    if (op->dry_run)
+        goto fini;
+    printf("\nSanitize has started on %d of %d DEVICEs\n", num_act, num);
+    if (op->early)
+        goto fini;
+    report_tm = start_tm + POLL_DURATION_SECS;
+    while (num_act > 0) {
+        now = time(NULL);
+        for (k = 0, next_tm = 0; k < num; ++k) {
+            mdp = mdarr + k;
+            if (mdp->active && ((0 == next_tm) || (mdp->next_tm < next_tm)))
+                next_tm = mdp->next_tm;
+        }
+        if (next_tm > now) {
+            sg_sleep_secs((int)(next_tm - now));
+            now = time(NULL);
+        }
+        for (k = 0, changed = false; k < num; ++k) {
+            mdp = mdarr + k;
+            if ((! mdp->active) || (mdp->next_tm > now))
+                continue;
+            if (sg_mdev_poll(mdp, now, POLL_DURATION_SECS, poll_vb)) {
+                changed = true;
+                --num_act;
+                if (mdp->res) {
+                    ++num_fail;
+                    if (0 == ret)
+                        ret = mdp->res;
+                }
+            }
+        }
+        if (changed || (now >= report_tm)) {
+            sg_mdev_report(mdarr, num, start_tm, now);
+            report_tm = now + POLL_DURATION_SECS;
+        }
+    }
+    printf("Sanitize complete on %d of %d DEVICEs\n", num - num_fail, num);
+fini:
+    for (k = 0; k < num; ++k) {
+        mdp = mdarr + k;
+        if (mdp->fd >= 0) {
+            res = sg_cmds_close_device(mdp->fd);
+            if ((res < 0) && (0 == ret))
+                ret = sg_convert_errno(-res);
+        }
+    }
+    free(mdarr);
+    return ret;
+}
+
+
 int
 main(int argc, char * argv[])
 {
@@ -447,8 +567,10 @@ main(int argc, char * argv[])
     int k, res, c, infd, progress, vb, n, resp_len, err;
     int sg_fd = -1;
     int param_lst_len = 0;
+    int num_devs = 0;
     int ret = -1;
     const char * device_name = NULL;
+    char ** dev_names = NULL;
     char ebuff[EBUFF_SZ];
     char b[80];
     uint8_t rsBuff[DEF_REQS_RESP_LEN];
@@ -559,16 +681,9 @@ main(int argc, char * argv[])
         }
     }
     if (optind < argc) {
-        if (NULL == device_name) {
-            device_name = argv[optind];
-            ++optind;
-        }
-        if (optind < argc) {
-            for (; optind < argc; ++optind)
-                pr2serr("Unexpected extra argument: %s\n", argv[optind]);
-            usage();
-            return SG_LIB_SYNTAX_ERROR;
-        }
+        device_name = argv[optind];
+        dev_names = argv + optind;
+        num_devs = argc - optind;
     }
 #ifdef DEBUG
     pr2serr("In DEBUG mode, ");
@@ -603,6 +718,10 @@ main(int argc, char * argv[])
                 "'--overwrite' please\n");
         return SG_LIB_CONTRADICT;
     }
+    if ((num_devs > 1) && op->wait) {
+        pr2serr("'--wait' not permitted with more than one DEVICE\n");
+        return SG_LIB_CONTRADICT;
+    }
     if (op->overwrite) {
         if (op->zero) {
             if (op->pattern_fn) {
@@ -644,19 +763,6 @@ main(int argc, char * argv[])
         }
     }
 
-    sg_fd = sg_cmds_open_device(device_name, false /* rw */, vb);
-    if (sg_fd < 0) {
-        if (op->verbose)
-            pr2serr(ME "open error: %s: %s\n", device_name,
-                    safe_strerror(-sg_fd));
-        ret = sg_convert_errno(-sg_fd);
-        goto err_out;
-    }
-
-    ret = print_dev_id(sg_fd, inq_resp, sizeof(inq_resp), op->verbose);
-    if (ret)
-        goto err_out;
-
     if (op->overwrite) {
         param_lst_len = op->ipl + 4;
         wBuff = (uint8_t*)sg_memalign(op->ipl + 4, 0, &free_wBuff, false);
@@ -714,6 +820,24 @@ main(int argc, char * argv[])
         sg_put_unaligned_be16((uint16_t)op->ipl, wBuff + 2);
     }
 
+    if (num_devs > 1) {
+        ret = mdev_sanitize(op, dev_names, num_devs, wBuff, param_lst_len);
+        goto err_out;
+    }
+
+    sg_fd = sg_cmds_open_device(device_name, false /* rw */, vb);
+    if (sg_fd < 0) {
+        if (op->verbose)
+            pr2serr(ME "open error: %s: %s\n", device_name,
+                    safe_strerror(-sg_fd));
+        ret = sg_convert_errno(-sg_fd);
+        goto err_out;
+    }
+
+    ret = print_dev_id(sg_fd, inq_resp, sizeof(inq_resp), op->verbose);
+    if (ret)
+        goto err_out;
+
     if ((! op->quick) && (! op->fail))
         sg_warn_and_wait("SANITIZE", device_name, true);
 
@@ -16,6 +16,10 @@
 #include <string.h>
 #include <errno.h>
 #include <getopt.h>
+#define __STDC_FORMAT_MACROS 1
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -24,8 +28,10 @@
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
 #include "sg_cmds_extra.h"
+#include "sg_pt.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
+#include "sg_json_sg_lib.h"
 
 /* This program uses a ATA PASS-THROUGH SCSI command. This usage is
  * defined in the SCSI to ATA Translation (SAT) drafts and standards.
@@ -58,18 +64,42 @@
 #define ATA_SMART_READ_LOG 0xb0
 #define ATA_SMART_READ_LOG_FEATURE 0xd5
 #define DIRECTORY_LOG_ADDR 0x0
+#define DEVICE_STATS_LOG_ADDR 0x4
 
 #define DEF_PPT 64
+#define DEF_ARCH_PPT 2048       /* 1 MiB, --archive mode halves on error */
 #define DEF_TIMEOUT 20
 
 #define MAX_LAR_LIST_ELEMS 8
 
-static const char * version_str = "1.30 20230622";
+/* --archive=AF file layout, all integers are little endian:
+ *   16 byte header: "SGGPLOG\0", version (2 bytes), ATA command used to
+ *   read the logs (1 byte), reserved (1 byte), number of records (4 bytes)
+ *   followed by that many records, each with an 8 byte header: log address
+ *   (1 byte), status (1 byte, 0 is good), number of pages in the log
+ *   directory (2 bytes), number of data bytes that follow (4 bytes) */
+#define GPL_ARCH_MAGIC "SGGPLOG"
+#define GPL_ARCH_VERSION 1
+#define GPL_ARCH_HDR_LEN 16
+#define GPL_ARCH_REC_HDR_LEN 8
+
+/* Device Statistics log (ACS-4), each statistic is a 64 bit quantity */
+#define DEV_STAT_NUM_PAGES 8
+#define DEV_STAT_TEMPERATURE_PG 5
+#define DEV_STAT_SUPPORTED (1ULL << 63)
+#define DEV_STAT_VALID (1ULL << 62)
+#define DEV_STAT_NORMALIZED (1ULL << 61)
+#define DEV_STAT_VALUE_MASK 0xffffffffffffULL
+
+static const char * version_str = "1.31 20261018";
 
 struct opts_t {
     bool ck_cond;
     bool do_multiple;
+    bool do_json;
     bool do_smart;
+    bool la_given;      /* --log=LA_L or --address=LA_L given */
+    bool ppt_given;
     bool rdonly;
     bool no_output;
     int cdb_len;
@@ -81,16 +111,88 @@ struct opts_t {
     uint8_t la_lo_a[MAX_LAR_LIST_ELEMS];
     uint8_t la_hi_a[MAX_LAR_LIST_ELEMS];
     const char * device_name;
+    const char * archive_fn;    /* --archive=AF */
+    const char * json_arg;      /* carries [JO] if present */
+    const char * js_file;       /* --js-file= argument */
+    sgj_state json_st;
+};
+
+struct dev_stat_t {
+    uint8_t pg;         /* Device Statistics log page number */
+    uint8_t off;        /* byte offset of statistic within that page */
+    const char * name;
+};
+
+static const char * const dev_stat_pg_name[DEV_STAT_NUM_PAGES] = {
+    "List of supported pages",
+    "General statistics",
+    "Free-fall statistics",
+    "Rotating media statistics",
+    "General errors statistics",
+    "Temperature statistics",
+    "Transport statistics",
+    "Solid state device statistics",
+};
+
+static const struct dev_stat_t dev_stat_arr[] = {
+    {1, 0x8, "Lifetime power-on resets"},
+    {1, 0x10, "Power-on hours"},
+    {1, 0x18, "Logical sectors written"},
+    {1, 0x20, "Number of write commands"},
+    {1, 0x28, "Logical sectors read"},
+    {1, 0x30, "Number of read commands"},
+    {1, 0x38, "Date and time timestamp"},
+    {1, 0x40, "Pending error count"},
+    {1, 0x48, "Workload utilization"},
+    {1, 0x50, "Utilization usage rate"},
+    {1, 0x58, "Resource availability"},
+    {1, 0x60, "Random write resources used"},
+    {2, 0x8, "Number of free-fall events detected"},
+    {2, 0x10, "Overlimit shock events"},
+    {3, 0x8, "Spindle motor power-on hours"},
+    {3, 0x10, "Head flying hours"},
+    {3, 0x18, "Head load events"},
+    {3, 0x20, "Number of reallocated logical sectors"},
+    {3, 0x28, "Read recovery attempts"},
+    {3, 0x30, "Number of mechanical start failures"},
+    {3, 0x38, "Number of reallocation candidate logical sectors"},
+    {3, 0x40, "Number of high priority unload events"},
+    {4, 0x8, "Number of reported uncorrectable errors"},
+    {4, 0x10, "Number of resets between command acceptance and "
+              "completion"},
+    {4, 0x18, "Physical element status changed"},
+    {5, 0x8, "Current temperature"},
+    {5, 0x10, "Average short term temperature"},
+    {5, 0x18, "Average long term temperature"},
+    {5, 0x20, "Highest temperature"},
+    {5, 0x28, "Lowest temperature"},
+    {5, 0x30, "Highest average short term temperature"},
+    {5, 0x38, "Lowest average short term temperature"},
+    {5, 0x40, "Highest average long term temperature"},
+    {5, 0x48, "Lowest average long term temperature"},
+    {5, 0x50, "Time in over-temperature"},
+    {5, 0x58, "Specified maximum operating temperature"},
+    {5, 0x60, "Time in under-temperature"},
+    {5, 0x68, "Specified minimum operating temperature"},
+    {6, 0x8, "Number of hardware resets"},
+    {6, 0x10, "Number of ASR events"},
+    {6, 0x18, "Number of interface CRC errors"},
+    {7, 0x8, "Percentage used endurance indicator"},
+    {0, 0, NULL},
 };
 
 static const struct option long_options[] = {
     {"address", required_argument, 0, 'a'},
+    {"archive", required_argument, 0, 'A'},
     {"count", required_argument, 0, 'c'},
     {"ck_cond", no_argument, 0, 'C'},
     {"ck-cond", no_argument, 0, 'C'},
     {"dma", no_argument, 0, 'd'},
     {"help", no_argument, 0, 'h'},
     {"hex", no_argument, 0, 'H'},
+    {"json", optional_argument, 0, '^'},    /* short option is '-j' */
+    {"js-file", required_argument, 0, 'J'},
+    {"js_file", required_argument, 0, 'J'},
     {"len", required_argument, 0, 'l'},
     {"log", required_argument, 0, 'L'},
     {"page", required_argument, 0, 'p'},
@@ -107,15 +209,22 @@ static void
 usage()
 {
     pr2serr("Usage: "
-          "sg_sat_read_gplog [--address=LA_L] [--ck_cond] [--count=CO] "
-          "[--dma]\n"
-          "                         [--help] [--hex] [--len=CDB_LEN] "
+          "sg_sat_read_gplog [--address=LA_L] [--archive=AF] "
+          "[--ck_cond]\n"
+          "                         [--count=CO] [--dma] [--help] [--hex] "
+          "[--json[=JO]]\n"
+          "                         [--js-file=JFN] [--len=CDB_LEN] "
           "[--log=LA_L]\n"
           "                         [--ppt=PPT] [--readonly] [--smart] "
           "[--verbose]\n"
-          "                         [--version] DEVICE\n"
+          "                         [--version] DEVICE [DEVICE...]\n"
           "  where:\n"
           "    --address=LA_L | -a LA_L    same as --log=LA_L option below\n"
+          "    --archive=AF | -A AF    fetch every log in the log directory "
+          "(or in\n"
+          "                            LA_L) into archive file AF; if AF is "
+          "a\n"
+          "                            directory: AF/<DEVICE_base>.gplog\n"
           "    --ck_cond | -C          set ck_cond field in pass-through "
           "(def: 0)\n"
           "    --count=CO | -c CO      count of page numbers to fetch "
@@ -127,6 +236,14 @@ usage()
           "yields hex\n"
           "                            words + ASCII (def), -HHH hex words "
           "only\n"
+          "    --json[=JO] | -j[=JO]    output --archive summary and Device "
+          "Statistics\n"
+          "                             decode in JSON; use --json=? for "
+          "JSON help\n"
+          "    --js-file=JFN | -J JFN    JFN is a filename to which JSON "
+          "output is\n"
+          "                              written (def: stdout); truncates "
+          "then writes\n"
           "    --len=CDB_LEN | -l CDB_LEN    cdb length: 12, 16 or 32 bytes "
           "(def: 16)\n"
           "    --log=LA_L | -L LA_L    Log address, log address range or "
@@ -134,7 +251,10 @@ usage()
           "                            See below for syntax\n"
           "    --page=PN|-p PN         Log page number within address (def: "
           "0)\n"
-          "    --ppt=PPT|-P PPT        pages per transfer (def: %d)\n"
+          "    --ppt=PPT|-P PPT        pages per transfer (def: %d; with "
+          "--archive: %d\n"
+          "                            reduced if too large for the "
+          "transport)\n"
           "    --readonly | -r         open DEVICE read-only (def: "
           "read-write)\n"
           "    --smart | -s            send the ATA SMART READ LOG command "
@@ -150,8 +270,11 @@ usage()
           "--address= and --log= options. It may contain a comma\nseparated "
           "list with each element either being a single LA or a range with\n"
           "this format: 'lo:hi'. LA_R syntax summary: "
-          "lo:hi,lo2:hi2,lo3:hi3,...\n",
-           DEF_PPT);
+          "lo:hi,lo2:hi2,lo3:hi3,...\n"
+          "With --archive=AF, more than one DEVICE may be given and each "
+          "log is fetched\nin as few commands as possible with READ LOG "
+          "DMA EXT (unless --smart).\n",
+           DEF_PPT, DEF_ARCH_PPT);
 }
 
 static void
@@ -174,15 +297,18 @@ show_x_log_directory(int ata_cmd, const uint8_t * buff, int num_bytes)
     }
 }
 
-/* Return of 0 is good. If read broken into multiple pieces due to
- * --count=CO being > --ppt=PPT then inbuff will contain the last piece
- * read and *inbuff_wr_bytesp will hold its length in bytes. */
+/* Sends one ATA READ LOG (DMA) EXT or SMART READ LOG command, tunnelled
+ * through an ATA PASS-THROUGH command on ptvp, to fetch ppt pages starting
+ * at page number pn of log address la. Return of 0 is good in which case
+ * *got_bytesp holds the number of bytes written to inbuff. */
 static int
-do_read_gplog(int sg_fd, int ata_cmd, uint8_t la, uint8_t * inbuff,
-              int * inbuff_wr_bytesp, const struct opts_t * op)
+read_gplog_pages(struct sg_pt_base * ptvp, int ata_cmd, uint8_t la, int pn,
+                 int ppt, uint8_t * inbuff, int * got_bytesp,
+                 const struct opts_t * op)
 {
     bool got_ard = false;      /* got ATA result descriptor */
-    int k, ppt, res, ret, protocol, num_bytes, num_words, max;
+    int res, ret, protocol;
+    int num_bytes = ppt * 512;
     int resid = 0;
     const int vb = op->verbose;
     const int vb_1 = (vb > 0) ? vb - 1 : vb;
@@ -220,6 +346,233 @@ do_read_gplog(int sg_fd, int ata_cmd, uint8_t la, uint8_t * inbuff,
         if (ata_cmd == ATA_SMART_READ_LOG)
             ata_cmd_name = "SMART READ LOG";
     }
+    *got_bytesp = 0;
+    memset(inbuff, 0, num_bytes);
+    if (vb > 1)
+        pr2serr("Building ATA %s command; la=0x%x, pn=0x%x, "
+                "this_count=%d\n", ata_cmd_name, la, pn, ppt);
+    switch (op->cdb_len) {
+    case 32:    /* SAT-4 revision 5 or later */
+        if (ATA_SMART_READ_LOG == ata_cmd) {
+            apt32_cdb[21] = ATA_SMART_READ_LOG_FEATURE;
+            apt32_cdb[18] = 0x4f;
+            apt32_cdb[17] = 0xc2;
+        } else {    /* ugly split for page number */
+            apt32_cdb[15] = (pn >> 8) & 0xff;
+            apt32_cdb[18] = pn & 0xff;
+        }
+        sg_put_unaligned_be16(ppt, apt32_cdb + 22);/* this xfer's count */
+        apt32_cdb[19] = la;
+        apt32_cdb[25] = ata_cmd;
+        apt32_cdb[10] = (protocol << 1);
+        if (extend)
+            apt32_cdb[10] |= 0x1;
+        apt32_cdb[11] = t_length;
+        if (op->ck_cond)
+            apt32_cdb[11] |= 0x20;
+        if (t_type)
+            apt32_cdb[11] |= 0x10;
+        if (t_dir)
+            apt32_cdb[11] |= 0x8;
+        if (byte_block)
+            apt32_cdb[11] |= 0x4;
+        /* following call fixes all bytes below offset 10 in cdb */
+        res = sg_ll_ata_pt_pt(ptvp, apt32_cdb, op->cdb_len, DEF_TIMEOUT,
+                              inbuff, NULL /* doutp */, num_bytes,
+                              sense_buffer, sb_sz, ata_ret_desc,
+                              ard_sz, &resid, vb_1);
+        break;
+    case 16:
+        /* Prepare ATA PASS-THROUGH COMMAND (16) command */
+        apt_cdb[14] = ata_cmd;
+        if (ATA_SMART_READ_LOG == ata_cmd) {
+            apt_cdb[4] = ATA_SMART_READ_LOG_FEATURE;
+            apt_cdb[10] = 0x4f;
+            apt_cdb[12] = 0xc2;
+        } else
+            sg_put_unaligned_be16((uint16_t)pn, apt_cdb + 9);
+        sg_put_unaligned_be16((uint16_t)ppt, apt_cdb + 5);
+        apt_cdb[8] = la;
+        apt_cdb[1] = (protocol << 1) | extend;
+        if (extend)
+            apt_cdb[1] |= 0x1;
+        apt_cdb[2] = t_length;
+        if (op->ck_cond)
+            apt_cdb[2] |= 0x20;
+        if (t_type)
+            apt_cdb[2] |= 0x10;
+        if (t_dir)
+            apt_cdb[2] |= 0x8;
+        if (byte_block)
+            apt_cdb[2] |= 0x4;
+        res = sg_ll_ata_pt_pt(ptvp, apt_cdb, op->cdb_len, DEF_TIMEOUT,
+                              inbuff, NULL, num_bytes, sense_buffer,
+                              sb_sz, ata_ret_desc, ard_sz, &resid, vb_1);
+        break;
+    case 12:
+        /* Prepare ATA PASS-THROUGH COMMAND (12) command */
+        /* Cannot map upper 8 bits of the pn since no LBA (39:32) field */
+        apt12_cdb[9] = ata_cmd;
+        if (ATA_SMART_READ_LOG == ata_cmd) {
+            apt12_cdb[3] = ATA_SMART_READ_LOG_FEATURE;
+            apt12_cdb[6] = 0x4f;
+            apt12_cdb[7] = 0xc2;
+        } else
+            apt12_cdb[6] = pn & 0xff;
+        apt12_cdb[4] = ppt;
+        apt12_cdb[5] = la;
+        apt12_cdb[1] = (protocol << 1);
+        apt12_cdb[2] = t_length;
+        if (op->ck_cond)
+            apt12_cdb[2] |= 0x20;
+        if (t_type)
+            apt12_cdb[2] |= 0x10;
+        if (t_dir)
+            apt12_cdb[2] |= 0x8;
+        if (byte_block)
+            apt12_cdb[2] |= 0x4;
+        res = sg_ll_ata_pt_pt(ptvp, apt12_cdb, op->cdb_len, DEF_TIMEOUT,
+                              inbuff, NULL, num_bytes, sense_buffer,
+                              sb_sz, ata_ret_desc, ard_sz, &resid, vb_1);
+        break;
+    default:
+        pr2serr("%s: logic error\n", __func__);
+        return SG_LIB_SYNTAX_ERROR;
+    }
+    if (0 == res) {
+        if (vb > 2) {
+            pr2serr("SCSI %s command completed with GOOD status\n",
+                    pt_name);
+            if (vb > 3)
+                pr2serr("    requested_bytes=%d, resid=%d\n", num_bytes,
+                        resid);
+        }
+        if (resid > 0) {
+            num_bytes -= resid;
+            if (vb > 0)
+                pr2serr(">>> resid=%d leaving num_bytes=%d\n", resid,
+                        num_bytes);
+        }
+        *got_bytesp = num_bytes;
+    } else if ((res > 0) && (res & SAM_STAT_CHECK_CONDITION)) {
+        if (vb > 1) {
+            pr2serr("ATA pass through:\n");
+            sg_print_sense(NULL, sense_buffer, sb_sz,
+                           ((vb > 2) ? 1 : 0));
+        }
+        if (sg_scsi_normalize_sense(sense_buffer, sb_sz, &ssh)) {
+            switch (ssh.sense_key) {
+            case SPC_SK_ILLEGAL_REQUEST:
+                if ((0x20 == ssh.asc) && (0x0 == ssh.ascq)) {
+                    ret = SG_LIB_CAT_INVALID_OP;
+                    if (vb < 2)
+                        pr2serr("%s not supported\n", pt_name);
+                } else {
+                    ret = SG_LIB_CAT_ILLEGAL_REQ;
+                    if (vb < 2)
+                        pr2serr("%s, bad field in cdb\n", pt_name);
+                }
+                return ret;
+            case SPC_SK_NO_SENSE:
+            case SPC_SK_RECOVERED_ERROR:
+                if ((0x0 == ssh.asc) &&
+                    (ASCQ_ATA_PT_INFO_AVAILABLE == ssh.ascq)) {
+                    if (SAT_ATA_RETURN_DESC != ata_ret_desc[0]) {
+                        if (vb)
+                            pr2serr("did not find ATA Return (sense) "
+                                    "Descriptor\n");
+                        return SG_LIB_CAT_RECOVERED;
+                    }
+                    got_ard = true;
+                    break;
+                } else if (SPC_SK_RECOVERED_ERROR == ssh.sense_key)
+                    return SG_LIB_CAT_RECOVERED;
+                else {
+                    if ((0x0 == ssh.asc) && (0x0 == ssh.ascq))
+                        break;
+                    return SG_LIB_CAT_SENSE;
+                }
+            case SPC_SK_UNIT_ATTENTION:
+                if (vb < 2)
+                    pr2serr("%s, Unit Attention detected\n", pt_name);
+                return SG_LIB_CAT_UNIT_ATTENTION;
+            case SPC_SK_NOT_READY:
+                if (vb < 2)
+                    pr2serr("%s, device not ready\n", pt_name);
+                return SG_LIB_CAT_NOT_READY;
+            case SPC_SK_MEDIUM_ERROR:
+            case SPC_SK_HARDWARE_ERROR:
+                if (vb < 2)
+                    pr2serr("%s, medium or hardware error\n", pt_name);
+                return SG_LIB_CAT_MEDIUM_HARD;
+            case SPC_SK_ABORTED_COMMAND:
+                if (0x10 == ssh.asc) {
+                    pr2serr("Aborted command: protection information\n");
+                    return SG_LIB_CAT_PROTECTION;
+                } else {
+                    pr2serr("Aborted command\n");
+                    return SG_LIB_CAT_ABORTED_COMMAND;
+                }
+            case SPC_SK_DATA_PROTECT:
+                pr2serr("%s: data protect, read only media?\n", pt_name);
+                return SG_LIB_CAT_DATA_PROTECT;
+            default:
+                if (vb < 2)
+                    pr2serr("%s, some sense data, use '-v' for more "
+                            "information\n", pt_name);
+                return SG_LIB_CAT_SENSE;
+            }
+        } else {
+            pr2serr("CHECK CONDITION without response code ??\n");
+            return SG_LIB_CAT_SENSE;
+        }
+        if (0x72 != (sense_buffer[0] & 0x7f)) {
+            pr2serr("expected descriptor sense format, response "
+                    "code=0x%x\n", sense_buffer[0]);
+            return SG_LIB_CAT_MALFORMED;
+        }
+    } else if (res > 0) {
+        if (SAM_STAT_RESERVATION_CONFLICT == res) {
+            pr2serr("SCSI status: RESERVATION CONFLICT\n");
+            return SG_LIB_CAT_RES_CONFLICT;
+        } else {
+            pr2serr("Unexpected SCSI status=0x%x\n", res);
+            return SG_LIB_CAT_MALFORMED;
+        }
+    } else {
+        /* --archive mode retries with fewer pages per transfer */
+        if (vb || (NULL == op->archive_fn) || (1 == ppt) ||
+            (ATA_SMART_READ_LOG == ata_cmd)) {
+            pr2serr("%s failed\n", pt_name);
+            if (vb < 2)
+                pr2serr("    try adding '-v' for more information\n");
+        }
+        return -1;
+    }
+
+    if ((SAT_ATA_RETURN_DESC == ata_ret_desc[0]) && (! got_ard))
+        pr2serr("Seem to have got ATA Result Descriptor but it was not "
+                "indicated\n");
+    if (got_ard) {
+        if (ata_ret_desc[3] & 0x4) {
+                pr2serr("error indication in returned FIS: aborted "
+                        "command\n");
+                return SG_LIB_CAT_ABORTED_COMMAND;
+        }
+    }
+    return 0;
+}
+
+/* Return of 0 is good. If read broken into multiple pieces due to
+ * --count=CO being > --ppt=PPT then inbuff will contain the last piece
+ * read and *inbuff_wr_bytesp will hold its length in bytes. */
+static int
+do_read_gplog(struct sg_pt_base * ptvp, int ata_cmd, uint8_t la,
+              uint8_t * inbuff, int * inbuff_wr_bytesp,
+              const struct opts_t * op)
+{
+    int k, ppt, ret, num_bytes, num_words, max;
+
     if ((! op->no_output) && (op->hex > 4))
         printf("\n# Log address: 0x%x, page number: %d, count: %d\n",
                la, op->pn, op->count);
@@ -230,236 +583,300 @@ do_read_gplog(int sg_fd, int ata_cmd, uint8_t la, uint8_t * inbuff,
     /* k should not exceed 255 for the ATA_SMART_READ_LOG command */
     for (k = op->pn; k < max; k += op->ppt) {
         ppt = ((k + op->ppt) > max) ? max - k : op->ppt;
-        num_bytes = ppt * 512;
-        num_words = ppt * 256;
-        memset(inbuff, 0, num_bytes);
-        if (vb > 1)
-            pr2serr("Building ATA %s command; la=0x%x, pn=0x%x, "
-                    "this_count=%d\n", ata_cmd_name, la, k, ppt);
-        switch (op->cdb_len) {
-        case 32:    /* SAT-4 revision 5 or later */
-            if (ATA_SMART_READ_LOG == ata_cmd) {
-                apt32_cdb[21] = ATA_SMART_READ_LOG_FEATURE;
-                apt32_cdb[18] = 0x4f;
-                apt32_cdb[17] = 0xc2;
-            } else {    /* ugly split for page number */
-                apt32_cdb[15] = (k >> 8) & 0xff;
-                apt32_cdb[18] = k & 0xff;
-            }
-            sg_put_unaligned_be16(ppt, apt32_cdb + 22);/* this xfer's count */
-            apt32_cdb[19] = la;
-            apt32_cdb[25] = ata_cmd;
-            apt32_cdb[10] = (protocol << 1);
-            if (extend)
-                apt32_cdb[10] |= 0x1;
-            apt32_cdb[11] = t_length;
-            if (op->ck_cond)
-                apt32_cdb[11] |= 0x20;
-            if (t_type)
-                apt32_cdb[11] |= 0x10;
-            if (t_dir)
-                apt32_cdb[11] |= 0x8;
-            if (byte_block)
-                apt32_cdb[11] |= 0x4;
-            /* following call fixes all bytes below offset 10 in cdb */
-            res = sg_ll_ata_pt(sg_fd, apt32_cdb, op->cdb_len, DEF_TIMEOUT,
-                               inbuff, NULL /* doutp */, num_bytes,
-                               sense_buffer, sb_sz, ata_ret_desc,
-                               ard_sz, &resid, vb_1);
-            break;
-        case 16:
-            /* Prepare ATA PASS-THROUGH COMMAND (16) command */
-            apt_cdb[14] = ata_cmd;
-            if (ATA_SMART_READ_LOG == ata_cmd) {
-                apt_cdb[4] = ATA_SMART_READ_LOG_FEATURE;
-                apt_cdb[10] = 0x4f;
-                apt_cdb[12] = 0xc2;
-            } else
-                sg_put_unaligned_be16((uint16_t)k, apt_cdb + 9);
-            sg_put_unaligned_be16((uint16_t)ppt, apt_cdb + 5);
-            apt_cdb[8] = la;
-            apt_cdb[1] = (protocol << 1) | extend;
-            if (extend)
-                apt_cdb[1] |= 0x1;
-            apt_cdb[2] = t_length;
-            if (op->ck_cond)
-                apt_cdb[2] |= 0x20;
-            if (t_type)
-                apt_cdb[2] |= 0x10;
-            if (t_dir)
-                apt_cdb[2] |= 0x8;
-            if (byte_block)
-                apt_cdb[2] |= 0x4;
-            res = sg_ll_ata_pt(sg_fd, apt_cdb, op->cdb_len, DEF_TIMEOUT,
-                               inbuff, NULL, num_bytes, sense_buffer, sb_sz,
-                               ata_ret_desc, ard_sz, &resid, vb_1);
-            break;
-        case 12:
-            /* Prepare ATA PASS-THROUGH COMMAND (12) command */
-            /* Cannot map upper 8 bits of the pn since no LBA (39:32) field */
-            apt12_cdb[9] = ata_cmd;
-            if (ATA_SMART_READ_LOG == ata_cmd) {
-                apt12_cdb[3] = ATA_SMART_READ_LOG_FEATURE;
-                apt12_cdb[6] = 0x4f;
-                apt12_cdb[7] = 0xc2;
-            } else
-                apt12_cdb[6] = k & 0xff;
-            apt12_cdb[4] = ppt;
-            apt12_cdb[5] = la;
-            apt12_cdb[1] = (protocol << 1);
-            apt12_cdb[2] = t_length;
-            if (op->ck_cond)
-                apt12_cdb[2] |= 0x20;
-            if (t_type)
-                apt12_cdb[2] |= 0x10;
-            if (t_dir)
-                apt12_cdb[2] |= 0x8;
-            if (byte_block)
-                apt12_cdb[2] |= 0x4;
-            res = sg_ll_ata_pt(sg_fd, apt12_cdb, op->cdb_len, DEF_TIMEOUT,
-                               inbuff, NULL, num_bytes, sense_buffer, sb_sz,
-                               ata_ret_desc, ard_sz, &resid, vb_1);
+        ret = read_gplog_pages(ptvp, ata_cmd, la, k, ppt, inbuff,
+                               &num_bytes, op);
+        if (ret)
+            return ret;
+        num_words = num_bytes >> 1;
+        if (inbuff_wr_bytesp)
+            *inbuff_wr_bytesp = num_bytes;
+
+        if (op->no_output)
+            ;
+        else if ((DIRECTORY_LOG_ADDR == la) && (0 == op->hex))
+            show_x_log_directory(ata_cmd, inbuff, num_bytes);
+        else if ((0 == op->hex) || (2 == op->hex))
+            dWordHex((const unsigned short *)inbuff, num_words, 0,
+                     sg_is_big_endian());
+        else if (1 == op->hex)
+            hex2stdout(inbuff, num_bytes, 0);
+        else if (3 == op->hex)  /* '-HHH' suitable for "hdparm --Istdin" */
+            dWordHex((const unsigned short *)inbuff, num_words, -2,
+                     sg_is_big_endian());
+        else    /* '-HHHH' hex bytes only */
+            hex2stdout(inbuff, num_bytes, -1);
+    }
+    return 0;
+}
+
+/* Decodes the Device Statistics log (log address 04h, ACS-4) held in bp,
+ * which is num_bytes long, and outputs the supported statistics. */
+static void
+decode_dev_stats(const uint8_t * bp, int num_bytes, sgj_opaque_p jop,
+                 struct opts_t * op)
+{
+    bool valid, normalized, pg_shown;
+    int pg, k, off;
+    int64_t val;
+    uint64_t q;
+    const uint8_t * pp;
+    const struct dev_stat_t * dsp;
+    sgj_state * jsp = &op->json_st;
+    sgj_opaque_p jo2p = NULL;
+    sgj_opaque_p jo3p;
+    sgj_opaque_p jap = NULL;
+
+    sgj_pr_hr(jsp, "  Device statistics:\n");
+    if (jsp->pr_as_json) {
+        jo2p = sgj_named_subobject_r(jsp, jop, "device_statistics");
+        jap = sgj_named_subarray_r(jsp, jo2p, "statistic");
+    }
+    for (pg = 1; pg < DEV_STAT_NUM_PAGES; ++pg) {
+        if (((pg + 1) * 512) > num_bytes)
             break;
-        default:
-            pr2serr("%s: logic error\n", __func__);
-            return SG_LIB_SYNTAX_ERROR;
-        }
-        if (0 == res) {
-            if (vb > 2) {
-                pr2serr("SCSI %s command completed with GOOD status\n",
-                        pt_name);
-                if (vb > 3)
-                    pr2serr("    requested_bytes=%d, resid=%d\n", num_bytes,
-                            resid);
-            }
-            if (resid > 0) {
-                num_bytes -= resid;
-                if (vb > 0)
-                    pr2serr(">>> resid=%d leaving num_bytes=%d\n", resid,
-                            num_bytes);
-                num_words >>= 1;
-            }
-            if (inbuff_wr_bytesp)
-                *inbuff_wr_bytesp = num_bytes;
-
-            if (op->no_output)
-                ;
-            else if ((DIRECTORY_LOG_ADDR == la) && (0 == op->hex))
-                show_x_log_directory(ata_cmd, inbuff, num_bytes);
-            else if ((0 == op->hex) || (2 == op->hex))
-                dWordHex((const unsigned short *)inbuff, num_words, 0,
-                         sg_is_big_endian());
-            else if (1 == op->hex)
-                hex2stdout(inbuff, num_bytes, 0);
-            else if (3 == op->hex)  /* '-HHH' suitable for "hdparm --Istdin" */
-                dWordHex((const unsigned short *)inbuff, num_words, -2,
-                         sg_is_big_endian());
-            else    /* '-HHHH' hex bytes only */
-                hex2stdout(inbuff, num_bytes, -1);
-        } else if ((res > 0) && (res & SAM_STAT_CHECK_CONDITION)) {
-            if (vb > 1) {
-                pr2serr("ATA pass through:\n");
-                sg_print_sense(NULL, sense_buffer, sb_sz,
-                               ((vb > 2) ? 1 : 0));
-            }
-            if (sg_scsi_normalize_sense(sense_buffer, sb_sz, &ssh)) {
-                switch (ssh.sense_key) {
-                case SPC_SK_ILLEGAL_REQUEST:
-                    if ((0x20 == ssh.asc) && (0x0 == ssh.ascq)) {
-                        ret = SG_LIB_CAT_INVALID_OP;
-                        if (vb < 2)
-                            pr2serr("%s not supported\n", pt_name);
-                    } else {
-                        ret = SG_LIB_CAT_ILLEGAL_REQ;
-                        if (vb < 2)
-                            pr2serr("%s, bad field in cdb\n", pt_name);
-                    }
-                    return ret;
-                case SPC_SK_NO_SENSE:
-                case SPC_SK_RECOVERED_ERROR:
-                    if ((0x0 == ssh.asc) &&
-                        (ASCQ_ATA_PT_INFO_AVAILABLE == ssh.ascq)) {
-                        if (SAT_ATA_RETURN_DESC != ata_ret_desc[0]) {
-                            if (vb)
-                                pr2serr("did not find ATA Return (sense) "
-                                        "Descriptor\n");
-                            return SG_LIB_CAT_RECOVERED;
-                        }
-                        got_ard = true;
-                        break;
-                    } else if (SPC_SK_RECOVERED_ERROR == ssh.sense_key)
-                        return SG_LIB_CAT_RECOVERED;
-                    else {
-                        if ((0x0 == ssh.asc) && (0x0 == ssh.ascq))
-                            break;
-                        return SG_LIB_CAT_SENSE;
-                    }
-                case SPC_SK_UNIT_ATTENTION:
-                    if (vb < 2)
-                        pr2serr("%s, Unit Attention detected\n", pt_name);
-                    return SG_LIB_CAT_UNIT_ATTENTION;
-                case SPC_SK_NOT_READY:
-                    if (vb < 2)
-                        pr2serr("%s, device not ready\n", pt_name);
-                    return SG_LIB_CAT_NOT_READY;
-                case SPC_SK_MEDIUM_ERROR:
-                case SPC_SK_HARDWARE_ERROR:
-                    if (vb < 2)
-                        pr2serr("%s, medium or hardware error\n", pt_name);
-                    return SG_LIB_CAT_MEDIUM_HARD;
-                case SPC_SK_ABORTED_COMMAND:
-                    if (0x10 == ssh.asc) {
-                        pr2serr("Aborted command: protection information\n");
-                        return SG_LIB_CAT_PROTECTION;
-                    } else {
-                        pr2serr("Aborted command\n");
-                        return SG_LIB_CAT_ABORTED_COMMAND;
-                    }
-                case SPC_SK_DATA_PROTECT:
-                    pr2serr("%s: data protect, read only media?\n", pt_name);
-                    return SG_LIB_CAT_DATA_PROTECT;
-                default:
-                    if (vb < 2)
-                        pr2serr("%s, some sense data, use '-v' for more "
-                                "information\n", pt_name);
-                    return SG_LIB_CAT_SENSE;
-                }
-            } else {
-                pr2serr("CHECK CONDITION without response code ??\n");
-                return SG_LIB_CAT_SENSE;
+        pp = bp + (pg * 512);
+        /* header: revision number (2 bytes) then page number */
+        if ((0 == sg_get_unaligned_le16(pp)) || (pg != pp[2]))
+            continue;
+        pg_shown = false;
+        for (dsp = dev_stat_arr; dsp->name; ++dsp) {
+            if (dsp->pg != pg)
+                continue;
+            off = dsp->off;
+            q = sg_get_unaligned_le64(pp + off);
+            if (! (q & DEV_STAT_SUPPORTED))
+                continue;
+            if (! pg_shown) {
+                sgj_pr_hr(jsp, "    %s:\n", dev_stat_pg_name[pg]);
+                pg_shown = true;
             }
-            if (0x72 != (sense_buffer[0] & 0x7f)) {
-                pr2serr("expected descriptor sense format, response "
-                        "code=0x%x\n", sense_buffer[0]);
-                return SG_LIB_CAT_MALFORMED;
+            valid = !! (q & DEV_STAT_VALID);
+            normalized = !! (q & DEV_STAT_NORMALIZED);
+            if (DEV_STAT_TEMPERATURE_PG == pg)  /* signed, degrees C */
+                val = (int8_t)(q & 0xff);
+            else
+                val = (int64_t)(q & DEV_STAT_VALUE_MASK);
+            sgj_pr_hr(jsp, "      %s: %" PRId64 "%s\n", dsp->name, val,
+                      (valid ? "" : "  [invalid]"));
+            if (jsp->pr_as_json) {
+                jo3p = sgj_new_unattached_object_r(jsp);
+                sgj_js_nv_ihex(jsp, jo3p, "page_number", pg);
+                sgj_js_nv_ihex(jsp, jo3p, "offset", off);
+                sgj_js_nv_s(jsp, jo3p, "name", dsp->name);
+                sgj_js_nv_b(jsp, jo3p, "valid", valid);
+                sgj_js_nv_b(jsp, jo3p, "normalized", normalized);
+                sgj_js_nv_i(jsp, jo3p, "value", val);
+                sgj_js_nv_o(jsp, jap, NULL /* name */, jo3p);
             }
-        } else if (res > 0) {
-            if (SAM_STAT_RESERVATION_CONFLICT == res) {
-                pr2serr("SCSI status: RESERVATION CONFLICT\n");
-                return SG_LIB_CAT_RES_CONFLICT;
-            } else {
-                pr2serr("Unexpected SCSI status=0x%x\n", res);
-                return SG_LIB_CAT_MALFORMED;
-            }
-        } else {
-            pr2serr("%s failed\n", pt_name);
-            if (vb < 2)
-                pr2serr("    try adding '-v' for more information\n");
-            return -1;
         }
+    }
+    k = bp[8];          /* number of entries in list of supported pages */
+    if ((k > 0) && (num_bytes >= 512) && (op->verbose > 1)) {
+        pr2serr("  Device statistics supported page list:");
+        for (off = 0; (off < k) && ((9 + off) < 512); ++off)
+            pr2serr(" %xh", bp[9 + off]);
+        pr2serr("\n");
+    }
+}
 
-        if ((SAT_ATA_RETURN_DESC == ata_ret_desc[0]) && (! got_ard))
-            pr2serr("Seem to have got ATA Result Descriptor but it was not "
-                    "indicated\n");
-        if (got_ard) {
-            if (ata_ret_desc[3] & 0x4) {
-                    pr2serr("error indication in returned FIS: aborted "
-                            "command\n");
-                    return SG_LIB_CAT_ABORTED_COMMAND;
+static bool
+la_in_list(int la, const struct opts_t * op)
+{
+    int k;
+
+    if (! op->la_given)
+        return true;
+    for (k = 0; k < MAX_LAR_LIST_ELEMS; ++k) {
+        if ((k > 0) && (0 == op->la_lo_a[k]))
+            break;
+        if ((la >= op->la_lo_a[k]) && (la <= op->la_hi_a[k]))
+            return true;
+    }
+    return false;
+}
+
+/* Writes one archive record: header followed by num_bytes from bp. */
+static bool
+write_arch_rec(FILE * fp, int la, int status, int num_pages,
+               const uint8_t * bp, int num_bytes)
+{
+    uint8_t rh[GPL_ARCH_REC_HDR_LEN];
+
+    memset(rh, 0, sizeof(rh));
+    rh[0] = (uint8_t)la;
+    rh[1] = (uint8_t)((status < 0) ? 0xff : status);
+    sg_put_unaligned_le16((uint16_t)num_pages, rh + 2);
+    sg_put_unaligned_le32((uint32_t)num_bytes, rh + 4);
+    if (1 != fwrite(rh, sizeof(rh), 1, fp))
+        return false;
+    if ((num_bytes > 0) && (1 != fwrite(bp, num_bytes, 1, fp)))
+        return false;
+    return true;
+}
+
+/* Fetches the log directory and then every log it lists (optionally
+ * restricted by --log=LA_L) reusing the pt object ptvp, and writes them to
+ * the archive file afn. Each log is read with as few commands as possible;
+ * the number of pages per command starts at --ppt=PPT (or DEF_ARCH_PPT)
+ * and is halved when the OS or HBA rejects the transfer size. Returns 0 if
+ * all went well, else the first error seen. Logs that can not be read are
+ * recorded in the archive with a non-zero status. */
+static int
+archive_logs(struct sg_pt_base * ptvp, const char * dev_name,
+             const char * afn, int ata_cmd, sgj_opaque_p jap,
+             struct opts_t * op)
+{
+    int k, la, n, res, got, off, num_recs, max_pages;
+    int ret = 0;
+    int xfer = op->ppt_given ? op->ppt : DEF_ARCH_PPT;
+    const int vb = op->verbose;
+    uint16_t w;
+    uint8_t * buf = NULL;
+    uint8_t * free_buf = NULL;
+    FILE * fp = NULL;
+    sgj_state * jsp = &op->json_st;
+    sgj_opaque_p jop = NULL;
+    sgj_opaque_p jo2p;
+    sgj_opaque_p ja2p = NULL;
+    uint8_t d[512];
+    uint8_t fh[GPL_ARCH_HDR_LEN];
+
+    op->no_output = true;
+    res = read_gplog_pages(ptvp, ata_cmd, DIRECTORY_LOG_ADDR, 0, 1, d, &got,
+                           op);
+    if (((SG_LIB_CAT_ILLEGAL_REQ == res) || (SG_LIB_CAT_INVALID_OP == res))
+        && (ATA_READ_LOG_DMA_EXT == ata_cmd)) {
+        if (vb)
+            pr2serr("%s: READ LOG DMA EXT rejected, try READ LOG EXT\n",
+                    dev_name);
+        ata_cmd = ATA_READ_LOG_EXT;
+        res = read_gplog_pages(ptvp, ata_cmd, DIRECTORY_LOG_ADDR, 0, 1, d,
+                               &got, op);
+    }
+    if (res)
+        return res;
+    if (got < 512)
+        memset(d + got, 0, 512 - got);
+
+    for (max_pages = 1, la = 1; la < 256; ++la) {
+        w = sg_get_unaligned_le16(d + (la << 1));
+        if ((w > max_pages) && la_in_list(la, op))
+            max_pages = w;
+    }
+    if (ATA_SMART_READ_LOG == ata_cmd) {
+        if (max_pages > 0xff)
+            max_pages = 0xff;
+        xfer = max_pages;   /* SMART READ LOG has no page number field */
+    }
+    buf = (uint8_t *)sg_memalign(max_pages * 512, 0, &free_buf, vb > 3);
+    if (NULL == buf) {
+        pr2serr("Cannot allocate buffer of %d bytes\n", max_pages * 512);
+        return sg_convert_errno(ENOMEM);
+    }
+    fp = fopen(afn, "wb");      /* truncate if exists */
+    if (NULL == fp) {
+        int e = errno;
+
+        pr2serr("unable to open archive file: %s [%s]\n", afn,
+                safe_strerror(e));
+        ret = sg_convert_errno(e);
+        goto fini;
+    }
+    memset(fh, 0, sizeof(fh));
+    memcpy(fh, GPL_ARCH_MAGIC, sizeof(GPL_ARCH_MAGIC));
+    sg_put_unaligned_le16(GPL_ARCH_VERSION, fh + 8);
+    fh[10] = (uint8_t)ata_cmd;
+    if ((1 != fwrite(fh, sizeof(fh), 1, fp)) ||
+        (! write_arch_rec(fp, DIRECTORY_LOG_ADDR, 0, 1, d, 512)))
+        goto file_err;
+    num_recs = 1;
+
+    sgj_pr_hr(jsp, "%s --> %s  [%s]\n", dev_name, afn,
+              (ATA_READ_LOG_DMA_EXT == ata_cmd) ? "READ LOG DMA EXT" :
+              ((ATA_SMART_READ_LOG == ata_cmd) ? "SMART READ LOG" :
+                                                 "READ LOG EXT"));
+    if (jsp->pr_as_json) {
+        jop = sgj_new_unattached_object_r(jsp);
+        sgj_js_nv_s(jsp, jop, "device_name", dev_name);
+        sgj_js_nv_s(jsp, jop, "archive_file", afn);
+        sgj_js_nv_ihex(jsp, jop, "ata_command", ata_cmd);
+        ja2p = sgj_named_subarray_r(jsp, jop, "log");
+    }
+    for (la = 1; la < 256; ++la) {
+        w = sg_get_unaligned_le16(d + (la << 1));
+        if ((0 == w) || (! la_in_list(la, op)))
+            continue;
+        if (w > max_pages)
+            w = max_pages;
+        res = 0;
+        for (k = 0, off = 0; k < w; ) {
+            n = ((w - k) > xfer) ? xfer : (w - k);
+            res = read_gplog_pages(ptvp, ata_cmd, la, k, n, buf + off, &got,
+                                   op);
+            if ((-1 == res) && (n > 1) && (ATA_SMART_READ_LOG != ata_cmd)) {
+                xfer = n >> 1;      /* transfer probably too large */
+                if (vb)
+                    pr2serr("  la=0x%x: reducing pages per transfer to "
+                            "%d\n", la, xfer);
+                continue;
             }
+            if (res)
+                break;
+            off += got;
+            k += n;
+            if (got < (n * 512))
+                break;      /* short read, keep what was fetched */
+        }
+        if ((! write_arch_rec(fp, la, res, w, buf, off)))
+            goto file_err;
+        ++num_recs;
+        sgj_pr_hr(jsp, "  log address %02xh: %u pages, fetched %d bytes%s\n",
+                  la, w, off, (res ? "  [error]" : ""));
+        if (jsp->pr_as_json) {
+            jo2p = sgj_new_unattached_object_r(jsp);
+            sgj_js_nv_ihex(jsp, jo2p, "log_address", la);
+            sgj_js_nv_ihex(jsp, jo2p, "number_of_pages", w);
+            sgj_js_nv_ihex(jsp, jo2p, "bytes_fetched", off);
+            sgj_js_nv_ihex(jsp, jo2p, "status", (res < 0) ? 0xff : res);
+            sgj_js_nv_o(jsp, ja2p, NULL /* name */, jo2p);
+        }
+        if ((0 == res) && (DEVICE_STATS_LOG_ADDR == la) &&
+            (ATA_SMART_READ_LOG != ata_cmd))
+            decode_dev_stats(buf, off, jop, op);
+        if (res) {
+            if (0 == ret)
+                ret = res;
+            if (-1 == res)
+                break;  /* OS or transport error even for one page: stop */
         }
     }
-    return 0;
+    sg_put_unaligned_le32((uint32_t)num_recs, fh + 12);
+    if (fseek(fp, 0, SEEK_SET) || (1 != fwrite(fh, sizeof(fh), 1, fp)))
+        goto file_err;
+    if (fclose(fp)) {
+        fp = NULL;
+        goto file_err;
+    }
+    fp = NULL;
+    goto fini;
+
+file_err:
+    {
+        int e = errno;
+
+        pr2serr("error writing archive file: %s [%s]\n", afn,
+                safe_strerror(e));
+        ret = SG_LIB_FILE_ERROR;
+    }
+fini:
+    if (jop)
+        sgj_js_nv_o(jsp, jap, NULL /* name */, jop);
+    if (fp)
+        fclose(fp);
+    if (free_buf)
+        free(free_buf);
+    op->no_output = false;
+    return ret;
 }
 
 /* Expects list like: 'lo:hi,lo2:hi2,....' where commas separate range
@@ -604,25 +1021,51 @@ get_next_la(int * prev_la_indp, int * prev_la_valp, const struct opts_t * op)
 }
 
 
+/* Returns the archive file name to use for dev_name in b. If --archive=AF
+ * names a directory (or more than one DEVICE is given) the file name is
+ * AF/<last component of dev_name>.gplog */
+static const char *
+archive_name(const char * dev_name, bool multi_dev, int blen, char * b,
+             const struct opts_t * op)
+{
+    const char * cp;
+    struct stat a_st;
+
+    if ((! multi_dev) && ((stat(op->archive_fn, &a_st) < 0) ||
+                          (! S_ISDIR(a_st.st_mode))))
+        return op->archive_fn;
+    cp = strrchr(dev_name, '/');
+    cp = cp ? (cp + 1) : dev_name;
+    snprintf(b, blen, "%s/%s.gplog", op->archive_fn, cp);
+    return b;
+}
+
+
 int
 main(int argc, char * argv[])
 {
     bool verbose_given = false;
     bool version_given = false;
     uint8_t la = 0;
-    int c, k, res, n, bytes_fetched;
+    int c, k, n, res, bytes_fetched, dev_ind, num_devs;
     int ret = 0;
     int sg_fd = -1;
     int ata_cmd = ATA_READ_LOG_EXT;
     const char *ccp;
     uint8_t *inbuff = NULL;
     uint8_t *free_inbuff = NULL;
+    struct sg_pt_base * ptvp = NULL;
     struct opts_t opts;
     struct opts_t * op;
+    sgj_state * jsp;
+    sgj_opaque_p jop = NULL;
+    sgj_opaque_p jap = NULL;
     char b[80];
+    char afn[512];
 
     op = &opts;
     memset(op, 0, sizeof(opts));
+    jsp = &op->json_st;
     op->cdb_len = SAT_ATA_PASS_THROUGH16_LEN;
     op->ppt = DEF_PPT;
     op->count = 1;
@@ -632,8 +1075,8 @@ main(int argc, char * argv[])
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "a:c:CdhHl:L:p:P:rsvV", long_options,
-                        &option_index);
+        c = getopt_long(argc, argv, "a:A:c:CdhHj::J:l:L:p:P:rsvV",
+                        long_options, &option_index);
         if (c == -1)
             break;
 
@@ -643,10 +1086,14 @@ main(int argc, char * argv[])
             ccp = ('a' == c) ? "--address=" : "--log=";
             if (! decode_la_list(ccp, optarg, op))
                 return SG_LIB_SYNTAX_ERROR;
+            op->la_given = true;
             la = op->la_hi_a[0];
             if ((op->la_lo_a[0] < la) || (la < op->la_lo_a[1]))
                 op->do_multiple = true;
             break;
+        case 'A':
+            op->archive_fn = optarg;
+            break;
         case 'c':
             op->count = sg_get_num(optarg);
             if ((op->count < 1) || (op->count > 0xffff)) {
@@ -672,6 +1119,22 @@ main(int argc, char * argv[])
         case 'H':
             ++op->hex;
             break;
+        case 'j':       /* for: -j[=JO] */
+        case '^':       /* for: --json[=JO] */
+            op->do_json = true;
+            /* Now want '=' to precede all JSON optional arguments */
+            if (optarg) {
+                if (('j' == c) && ('=' == *optarg))
+                    op->json_arg = optarg + 1;
+                else
+                    op->json_arg = optarg;
+            } else
+                op->json_arg = NULL;
+            break;
+        case 'J':
+            op->do_json = true;
+            op->js_file = optarg;
+            break;
         case 'l':
            op->cdb_len = sg_get_num(optarg);
            if (! ((op->cdb_len == 12) || (op->cdb_len == 16) ||
@@ -693,6 +1156,7 @@ main(int argc, char * argv[])
                 pr2serr("bad argument for '--ppt=', expect 1 to 0xffff\n");
                 return SG_LIB_SYNTAX_ERROR;
             }
+            op->ppt_given = true;
             break;
         case 'r':
             op->rdonly = true;
@@ -719,12 +1183,14 @@ main(int argc, char * argv[])
             return SG_LIB_SYNTAX_ERROR;
         }
     }
+    dev_ind = optind;
+    num_devs = argc - optind;
     if (optind < argc) {
         if (NULL == op->device_name) {
             op->device_name = argv[optind];
             ++optind;
         }
-        if (optind < argc) {
+        if ((optind < argc) && (NULL == op->archive_fn)) {
             for (; optind < argc; ++optind)
                 pr2serr("Unexpected extra argument: %s\n",
                         argv[optind]);
@@ -759,6 +1225,36 @@ main(int argc, char * argv[])
         usage();
         return SG_LIB_FILE_ERROR;
     }
+    if (op->archive_fn) {
+        if (12 == op->cdb_len) {
+            pr2serr("--archive needs a 16 or 32 byte cdb since logs may "
+                    "exceed 255 pages\n");
+            return SG_LIB_CONTRADICT;
+        }
+        if (ATA_SMART_READ_LOG != ata_cmd)
+            ata_cmd = ATA_READ_LOG_DMA_EXT;
+    }
+    if (op->do_json) {
+        if (! sgj_init_state(jsp, op->json_arg)) {
+            int bad_char = jsp->first_bad_char;
+            char e[1500];
+
+            if (bad_char) {
+                pr2serr("bad argument to --json= option, unrecognized "
+                        "character '%c'\n\n", bad_char);
+            }
+            sg_json_usage(0, e, sizeof(e));
+            pr2serr("%s", e);
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        if (NULL == op->archive_fn) {
+            pr2serr("--json is only supported together with "
+                    "--archive=AF\n");
+            return SG_LIB_CONTRADICT;
+        }
+        jop = sgj_start_r(MY_NAME, version_str, argc, argv, jsp);
+        jap = sgj_named_subarray_r(jsp, jop, "sat_gplog_archive");
+    }
 
     if ((op->count > 0xff) && (12 == op->cdb_len)) {
         op->cdb_len = 16;
@@ -770,14 +1266,51 @@ main(int argc, char * argv[])
         if (op->count > 0xff) {
             pr2serr("The ATA SMART READ LOG command can only accept count "
                     "values to 255\n");
-            return SG_LIB_SYNTAX_ERROR;
+            ret = SG_LIB_SYNTAX_ERROR;
+            goto fini;
         }
         if ((! op->do_multiple) && (op->pn > 0)) {
             pr2serr("For a single ATA SMART READ LOG command the page "
                     "number is always 0\n");
-            return SG_LIB_SYNTAX_ERROR;
+            ret = SG_LIB_SYNTAX_ERROR;
+            goto fini;
+        }
+    }
+
+    if (op->archive_fn) {
+        for (k = dev_ind; k < argc; ++k) {
+            op->device_name = argv[k];
+            sg_fd = sg_cmds_open_device(op->device_name, op->rdonly,
+                                        op->verbose);
+            if (sg_fd < 0) {
+                pr2serr("error opening file: %s: %s\n", op->device_name,
+                        safe_strerror(-sg_fd));
+                if (0 == ret)
+                    ret = sg_convert_errno(-sg_fd);
+                continue;
+            }
+            ptvp = construct_scsi_pt_obj_with_fd(sg_fd, op->verbose);
+            if (NULL == ptvp) {
+                pr2serr("%s: unable to construct pt object\n", __func__);
+                ret = sg_convert_errno(ENOMEM);
+                goto fini;
+            }
+            res = archive_logs(ptvp, op->device_name,
+                               archive_name(op->device_name, num_devs > 1,
+                                            sizeof(afn), afn, op),
+                               ata_cmd, jap, op);
+            if (res && (0 == ret))
+                ret = res;
+            destruct_scsi_pt_obj(ptvp);
+            ptvp = NULL;
+            res = sg_cmds_close_device(sg_fd);
+            sg_fd = -1;
+            if ((res < 0) && (0 == ret))
+                ret = sg_convert_errno(-res);
         }
+        goto fini;
     }
+
     n = op->ppt * 512;
     inbuff = (uint8_t *)sg_memalign(n, 0, &free_inbuff, op->verbose > 3);
     if (!inbuff) {
@@ -794,6 +1327,13 @@ main(int argc, char * argv[])
         ret = sg_convert_errno(-sg_fd);
         goto fini;
     }
+    /* one pt object is reused for every ATA PASS-THROUGH command */
+    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, op->verbose);
+    if (NULL == ptvp) {
+        pr2serr("%s: unable to construct pt object\n", __func__);
+        ret = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
     if (op->do_multiple) {
         int hold_pn = op->pn;
         int la_val;
@@ -815,7 +1355,7 @@ main(int argc, char * argv[])
         la = DIRECTORY_LOG_ADDR;
         op->pn = 0;
         /* read log directory page */
-        ret = do_read_gplog(sg_fd, ata_cmd, la, inbuff, &bytes_fetched, op);
+        ret = do_read_gplog(ptvp, ata_cmd, la, inbuff, &bytes_fetched, op);
         if (0 == ret) {
             uint8_t d[512];
 
@@ -841,7 +1381,7 @@ main(int argc, char * argv[])
                     op->count = w;  /* --ppt=PPT may break into smaller */
                     la = la_val;
                     op->pn = 0;
-                    ret = do_read_gplog(sg_fd, ata_cmd, la, inbuff, NULL, op);
+                    ret = do_read_gplog(ptvp, ata_cmd, la, inbuff, NULL, op);
                     if (ret)
                         break;
                 }
@@ -851,10 +1391,12 @@ main(int argc, char * argv[])
         }
     } else {
         la = op->la_lo_a[0];
-        ret = do_read_gplog(sg_fd, ata_cmd, la, inbuff, NULL, op);
+        ret = do_read_gplog(ptvp, ata_cmd, la, inbuff, NULL, op);
     }
 
 fini:
+    if (ptvp)
+        destruct_scsi_pt_obj(ptvp);
     if (sg_fd >= 0) {
         res = sg_cmds_close_device(sg_fd);
         if (res < 0) {
@@ -871,5 +1413,35 @@ fini:
     }
     if (free_inbuff)
         free(free_inbuff);
-    return (ret >= 0) ? ret : SG_LIB_CAT_OTHER;
+    ret = (ret >= 0) ? ret : SG_LIB_CAT_OTHER;
+    if (jsp->pr_as_json) {
+        FILE * fp = stdout;
+
+        if (op->js_file) {
+            if ((1 != strlen(op->js_file)) || ('-' != op->js_file[0])) {
+                fp = fopen(op->js_file, "w");   /* truncate if exists */
+                if (NULL == fp) {
+                    int e = errno;
+
+                    pr2serr("unable to open file: %s [%s]\n", op->js_file,
+                            safe_strerror(e));
+                    ret = sg_convert_errno(e);
+                }
+            }
+            /* '--js-file=-' will send JSON output to stdout */
+        }
+        if (fp) {
+            const char * estr = NULL;
+
+            if (sg_exit2str(ret, jsp->verbose, sizeof(b), b)) {
+                if (strlen(b) > 0)
+                    estr = b;
+            }
+            sgj_js2file_estr(jsp, NULL, ret, estr, fp);
+        }
+        if (op->js_file && fp && (stdout != fp))
+            fclose(fp);
+        sgj_finish(jsp);
+    }
+    return ret;
 }
@@ -41,7 +41,7 @@
  * commands tailored for SES (enclosure) devices.
  */
 
-static const char * version_str = "2.86 20230623";    /* ses4r04 */
+static const char * version_str = "2.87 20261018";    /* ses4r04 */
 
 #define MY_NAME "sg_ses"
 
@@ -63,6 +63,7 @@ static const char * version_str = "2.86 20230623";    /* ses4r04 */
                                  * can bypassed with sub-enclosure numbers.
                                  * So try higher figure. */
 #define MX_DATA_IN_DESCS 32
+#define MON_MAX_JOIN_TRIES 8    /* --monitor: consecutive failed joins */
 #define NUM_ACTIVE_ET_AESP_ARR 32
 
 #define TEMPERAT_OFF 20         /* 8 bits represents -19 C to +235 C */
@@ -186,6 +187,7 @@ struct opts_t {
     int ind_et_inst;    /* ETs can have multiple type header instances */
     int inner_hex;      /* -i, incremented if multiple */
     int maxlen;         /* -m LEN */
+    int monitor_secs;   /* --monitor=SECS, 0 (def) for no monitoring */
     int seid;
     int page_code;      /* recognised abbreviations converted to dpage num */
     int verbose;
@@ -202,6 +204,7 @@ struct opts_t {
     const char * json_arg;
     const char * js_file;
     sgj_state json_st;
+    sgj_state mon_json_st;      /* --monitor: template for each event */
     struct cgs_cl_t cgs_cl_arr[CGS_CL_ARR_MAX_SZ];
     uint8_t sas_addr[8];  /* Big endian byte sequence */
     char tmp_arr[8];
@@ -472,6 +475,7 @@ static const struct option long_options[] = {
     {"notime", no_argument, 0, 'y'},
     {"mask", required_argument, 0, 'M'},
     {"maxlen", required_argument, 0, 'm'},
+    {"monitor", required_argument, 0, 'P'},
     {"page", required_argument, 0, 'p'},
     {"quiet", no_argument, 0, 'q'},
     {"raw", no_argument, 0, 'r'},
@@ -933,19 +937,21 @@ static void gen_usage(bool long_opt)
             "[--hex]\n"
             "            [--index=IIA | =TIA,II] [--inner-hex] [--join] "
             "[--json[=JO]]\n"
-            "            [--js-file=JFN] [--maxlen=LEN] [--no-config] "
-            "[--no-time]\n"
-            "            [--page=PG] [--quiet] [--raw] [--readonly] "
-            "[--sas-addr=SA]\n"
-            "            [--status] [--verbose] [--warn] DEVICE\n"
+            "            [--js-file=JFN] [--maxlen=LEN] [--monitor=SECS] "
+            "[--no-config]\n"
+            "            [--no-time] [--page=PG] [--quiet] [--raw] "
+            "[--readonly]\n"
+            "            [--sas-addr=SA] [--status] [--verbose] [--warn] "
+            "DEVICE\n"
             );
     else
         pr2serr(
             "    sg_ses  [-a] [-z] [-D DES] [-x SN] [-E A_F] [-f] [-G STR] "
             "[-H]\n"
-            "            [-I IIA|TIA,II] [-i] [-j] [-m LEN] [-F] [-y] "
-            "[-p PG] [-q]\n"
-            "            [-r] [-R] [-A SA] [-s] [-v] [-w] DEVICE\n"
+            "            [-I IIA|TIA,II] [-i] [-j] [-m LEN] [-P SECS] [-F] "
+            "[-y]\n"
+            "            [-p PG] [-q] [-r] [-R] [-A SA] [-s] [-v] [-w] "
+            "DEVICE\n"
             );
 
 }
@@ -1146,6 +1152,14 @@ usage(int help_num)
             "    --list|-l           same as '--enumerate' option\n"
             "    --maxlen=LEN|-m LEN    max response length (allocation "
             "length in cdb)\n"
+            "    --monitor=SECS|-P SECS    poll Enclosure Status and "
+            "Additional\n"
+            "                              Element Status dpages every SECS "
+            "seconds;\n"
+            "                              output JSON line for each element "
+            "that\n"
+            "                              changes. Runs until error or "
+            "interrupted\n"
             "    --no-config|-F      output without depending on config "
             "dpage\n"
             "    --no-time|-y        skip Report timestamp command\n"
@@ -1476,7 +1490,7 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
         int option_index = 0;
 
         c = getopt_long(argc, argv, "^aA:b:cC:d:D:eE:fFG:hHiI:jJ::ln:N:m:Mp:"
-                        "qQ:rRsS:vVwx:X:yz", long_options, &option_index);
+                        "P:qQ:rRsS:vVwx:X:yz", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -1677,6 +1691,14 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
             }
             op->page_code_given = true;
             break;
+        case 'P':
+            op->monitor_secs = sg_get_num_nomult(optarg);
+            if (op->monitor_secs < 1) {
+                pr2serr("bad argument to '--monitor=SECS' (expect 1 or "
+                        "more)\n");
+                goto err_fini;
+            }
+            break;
         case 'q':
             op->quiet = true;
             break;
@@ -1868,6 +1890,20 @@ parse_cmd_line(struct opts_t *op, int argc, char *argv[])
         pr2serr("cannot have '--join' and '--control'\n");
         goto err_help;
     }
+    if (op->monitor_secs > 0) {
+        if (op->do_control || op->data_or_inhex || (op->num_cgs > 0) ||
+            op->nickname_str) {
+            pr2serr("--monitor=SECS needs a DEVICE and only fetches status "
+                    "dpages\n");
+            res = SG_LIB_CONTRADICT;
+            goto err_fini;
+        }
+        if (op->no_config) {
+            pr2serr("--monitor=SECS needs the configuration dpage\n");
+            res = SG_LIB_CONTRADICT;
+            goto err_fini;
+        }
+    }
     if (op->index_str) {
         ret = parse_index(op);
         if (ret != 0) {
@@ -7051,7 +7087,8 @@ join_work(struct sg_pt_base * ptvp, bool display, struct opts_t * op,
 
     /* check if we want to add the AES page to the join */
     if (display || (ADD_ELEM_STATUS_DPC == op->page_code) ||
-        (op->dev_slot_num >= 0) || saddr_non_zero(op->sas_addr)) {
+        (op->dev_slot_num >= 0) || saddr_non_zero(op->sas_addr) ||
+        (op->monitor_secs > 0)) {
         mlen = add_elem_rsp_sz;
         if (mlen > op->maxlen)
             mlen = op->maxlen;
@@ -7154,6 +7191,265 @@ fini:
 
 }
 
+/* Starts one --monitor event: a JSON object, built with a copy of
+ * op->mon_json_st, that is streamed to fp on a single line. Caller adds
+ * any further fields then calls mon_event_end(). */
+static sgj_opaque_p
+mon_event_start(sgj_state * jsp, const struct opts_t * op, FILE * fp,
+                const char * ev_name, uint64_t poll_num, uint32_t gen_code)
+{
+    sgj_opaque_p jop;
+
+    memcpy(jsp, &op->mon_json_st, sizeof(*jsp));
+    jop = sgj_start_stream_r(NULL, NULL, 0, NULL, fp, jsp);
+    sgj_js_nv_s(jsp, jop, "event", ev_name);
+    sgj_js_nv_i(jsp, jop, "time", (int64_t)time(NULL));
+    sgj_js_nv_i(jsp, jop, "poll", (int64_t)poll_num);
+    sgj_js_nv_i(jsp, jop, "generation_code", gen_code);
+    return jop;
+}
+
+/* Terminates (with a LF) the line begun by mon_event_start(). */
+static void
+mon_event_end(sgj_state * jsp, FILE * fp)
+{
+    sgj_js2file_estr(jsp, NULL, 0, NULL, fp);
+    sgj_finish(jsp);
+}
+
+/* Emits one 'element_changed' event for the join row pointed to by jrp.
+ * prev_es_bp and prev_ae_bp point to the same element's status bytes
+ * from the previous poll, the latter may be NULL. */
+static void
+mon_element_event(const struct join_row_t * jrp, const uint8_t * prev_es_bp,
+                  const uint8_t * prev_ae_bp, uint64_t poll_num,
+                  uint32_t gen_code, const struct opts_t * op, FILE * fp)
+{
+    int desc_len;
+    const uint8_t * ed_bp = jrp->elem_descp;
+    sgj_state js;
+    sgj_state * jsp = &js;
+    sgj_opaque_p jop;
+    char b[144];
+    static const int blen = sizeof(b);
+
+    jop = mon_event_start(jsp, op, fp, "element_changed", poll_num,
+                          gen_code);
+    sgj_js_nv_i(jsp, jop, "type_header_index", jrp->th_i);
+    sgj_js_nv_i(jsp, jop, "element_index", jrp->indiv_i);
+    sgj_js_nv_s(jsp, jop, et_sn, etype_str(jrp->etype, b, blen));
+    if (ed_bp) {
+        desc_len = sg_get_unaligned_be16(ed_bp + 2);
+        while (desc_len && ('\0' == ed_bp[4 + desc_len - 1]))
+            --desc_len;
+        if (desc_len > 0)
+            sgj_js_nv_s_len_chk(jsp, jop, "descriptor", ed_bp + 4,
+                                desc_len);
+    }
+    if (jrp->dev_slot_num >= 0)
+        sgj_js_nv_i(jsp, jop, "device_slot_number", jrp->dev_slot_num);
+    if (saddr_non_zero(jrp->sas_addr)) {
+        snprintf(b, blen, "0x%" PRIx64,
+                 sg_get_unaligned_be64(jrp->sas_addr + 0));
+        sgj_js_nv_s(jsp, jop, "sas_address", b);
+    }
+    sgj_js_nv_s(jsp, jop, "element_status_code",
+                elem_status_code_desc[0xf & jrp->enc_statp[0]]);
+    sgj_js_nv_s(jsp, jop, "previous_element_status_code",
+                elem_status_code_desc[0xf & prev_es_bp[0]]);
+    sgj_js_nv_hex_bytes(jsp, jop, "status_element", jrp->enc_statp, 4);
+    sgj_js_nv_hex_bytes(jsp, jop, "previous_status_element", prev_es_bp, 4);
+    if (jrp->ae_statp && prev_ae_bp) {
+        desc_len = jrp->ae_statp[1] + 2;
+        sgj_js_nv_hex_bytes(jsp, jop, aesd_sn, jrp->ae_statp, desc_len);
+        sgj_js_nv_hex_bytes(jsp, jop,
+                            "previous_additional_element_status_descriptor",
+                            prev_ae_bp, desc_len);
+    }
+    mon_event_end(jsp, fp);
+}
+
+/* Fetches dpage 'page_code' into rsp (size rsp_sz) and checks it has a
+ * header. Places generation code in *gen_codep. Returns 0 for success. */
+static int
+mon_fetch_dpage(struct sg_pt_base * ptvp, int page_code, uint8_t * rsp,
+                unsigned rsp_sz, int * rsp_lenp, uint32_t * gen_codep,
+                struct opts_t * op)
+{
+    int res;
+    int mlen = rsp_sz;
+
+    if (mlen > op->maxlen)
+        mlen = op->maxlen;
+    res = do_rec_diag(ptvp, page_code, rsp, mlen, op, rsp_lenp);
+    if (res)
+        return res;
+    if (*rsp_lenp < 8) {
+        pr2serr("%s: dpage 0x%x %s\n", __func__, page_code, rts_s);
+        return SG_LIB_CAT_MALFORMED;
+    }
+    *gen_codep = sg_get_unaligned_be32(rsp + 4);
+    return 0;
+}
+
+/* Implements the --monitor=SECS option. The topology (i.e. the join of the
+ * Configuration, Enclosure Status, Element Descriptor and Additional Element
+ * Status dpages) is built by join_work() at startup and whenever the
+ * generation code changes. Between those reloads only the Enclosure Status
+ * and (if available) the Additional Element Status dpages are fetched each
+ * SECS seconds. Since the topology is unchanged the join_arr[] pointers
+ * remain valid, so each element's status bytes are compared with a copy of
+ * the previous poll. Only differences are output, as one JSON object per
+ * line on stdout (or appended to the --js-file= file). Runs until an error
+ * occurs, the join fails MON_MAX_JOIN_TRIES times in a row, or the process
+ * is killed. */
+static int
+monitor_work(struct sg_pt_base * ptvp, struct opts_t * op)
+{
+    bool reload = true;
+    bool have_aes = false;
+    int k, res, es_len, aes_len, off, d_len;
+    int join_tries = 0;
+    int prev_es_len = 0;
+    int prev_aes_len = 0;
+    uint32_t ref_gen_code = 0;
+    uint32_t gen_code;
+    uint64_t poll_num;
+    uint64_t num_changed;
+    const char * reason = "start";
+    uint8_t * prev_es_rsp;
+    uint8_t * prev_aes_rsp;
+    uint8_t * free_prev_es_rsp = NULL;
+    uint8_t * free_prev_aes_rsp = NULL;
+    const uint8_t * prev_ae_bp;
+    struct join_row_t * jrp;
+    FILE * fp = stdout;
+    sgj_state js;
+    sgj_opaque_p jop;
+
+    if (op->js_file && (0 != strcmp(op->js_file, "-"))) {
+        fp = fopen(op->js_file, "a");
+        if (NULL == fp) {
+            k = errno;
+            pr2serr("unable to open file: %s [%s]\n", op->js_file,
+                    safe_strerror(k));
+            return sg_convert_errno(k);
+        }
+    }
+    prev_es_rsp = sg_memalign(enc_stat_rsp_sz, 0, &free_prev_es_rsp, false);
+    prev_aes_rsp = sg_memalign(add_elem_rsp_sz, 0, &free_prev_aes_rsp,
+                               false);
+    if ((NULL == prev_es_rsp) || (NULL == prev_aes_rsp)) {
+        pr2serr("%s: %s\n", __func__, oohm);
+        res = sg_convert_errno(ENOMEM);
+        goto fini;
+    }
+    for (poll_num = 0; ; ++poll_num) {
+        if (reload) {
+            if (config_dp_resp) {  /* force re-read of Configuration dpage */
+                free(free_config_dp_resp);
+                free_config_dp_resp = NULL;
+                config_dp_resp = NULL;
+            }
+            /* join_juggle_aes() assumes rows start zeroed */
+            memset(join_arr, 0, sizeof(join_arr));
+            res = join_work(ptvp, false, op, NULL);
+            if (-1 == res) {    /* most likely generation code changed */
+                if (++join_tries >= MON_MAX_JOIN_TRIES) {
+                    pr2serr("%s: join failed %d times in a row, give up\n",
+                            __func__, join_tries);
+                    res = SG_LIB_CAT_OTHER;
+                    goto fini;
+                }
+                if (op->verbose)
+                    pr2serr("%s: join failed, retry in %d seconds\n",
+                            __func__, op->monitor_secs);
+                sg_sleep_secs(op->monitor_secs);
+                continue;
+            } else if (res)
+                goto fini;
+            join_tries = 0;
+            ref_gen_code = sg_get_unaligned_be32(enc_stat_rsp + 4);
+            have_aes = (add_elem_rsp_len > 0);
+            prev_es_len = enc_stat_rsp_len;
+            memcpy(prev_es_rsp, enc_stat_rsp, prev_es_len);
+            prev_aes_len = add_elem_rsp_len;
+            if (have_aes)
+                memcpy(prev_aes_rsp, add_elem_rsp, prev_aes_len);
+            for (k = 0, jrp = join_arr; (k < MX_JOIN_ROWS) && jrp->enc_statp;
+                 ++k, ++jrp)
+                ;
+            jop = mon_event_start(&js, op, fp, "topology_loaded", poll_num,
+                                  ref_gen_code);
+            sgj_js_nv_s(&js, jop, "reason", reason);
+            sgj_js_nv_i(&js, jop, "number_of_elements", k);
+            sgj_js_nv_b(&js, jop, "additional_element_status", have_aes);
+            mon_event_end(&js, fp);
+            reload = false;
+        } else {
+            res = mon_fetch_dpage(ptvp, ENC_STATUS_DPC, enc_stat_rsp,
+                                  enc_stat_rsp_sz, &es_len, &gen_code, op);
+            if (res)
+                goto fini;
+            if ((gen_code != ref_gen_code) || (es_len != prev_es_len)) {
+                reason = "generation code changed";
+                reload = true;
+                continue;       /* reload topology without waiting */
+            }
+            aes_len = 0;
+            if (have_aes) {
+                res = mon_fetch_dpage(ptvp, ADD_ELEM_STATUS_DPC,
+                                      add_elem_rsp, add_elem_rsp_sz,
+                                      &aes_len, &gen_code, op);
+                if (res)
+                    goto fini;
+                if ((gen_code != ref_gen_code) || (aes_len != prev_aes_len)) {
+                    reason = "generation code changed";
+                    reload = true;
+                    continue;
+                }
+            }
+            num_changed = 0;
+            for (k = 0, jrp = join_arr; (k < MX_JOIN_ROWS) && jrp->enc_statp;
+                 ++k, ++jrp) {
+                off = jrp->enc_statp - enc_stat_rsp;
+                prev_ae_bp = NULL;
+                d_len = 0;
+                if (jrp->ae_statp) {
+                    prev_ae_bp = prev_aes_rsp + (jrp->ae_statp -
+                                                 add_elem_rsp);
+                    d_len = jrp->ae_statp[1] + 2;
+                }
+                if ((0 == memcmp(jrp->enc_statp, prev_es_rsp + off, 4)) &&
+                    ((NULL == prev_ae_bp) ||
+                     (0 == memcmp(jrp->ae_statp, prev_ae_bp, d_len))))
+                    continue;
+                mon_element_event(jrp, prev_es_rsp + off, prev_ae_bp,
+                                  poll_num, gen_code, op, fp);
+                ++num_changed;
+            }
+            if (num_changed > 0) {
+                memcpy(prev_es_rsp, enc_stat_rsp, es_len);
+                if (have_aes)
+                    memcpy(prev_aes_rsp, add_elem_rsp, aes_len);
+            }
+            if (op->verbose > 1)
+                pr2serr("%s: poll %" PRIu64 ", %" PRIu64 " element(s) "
+                        "changed\n", __func__, poll_num, num_changed);
+        }
+        fflush(fp);
+        sg_sleep_secs(op->monitor_secs);
+    }
+fini:
+    if (free_prev_es_rsp)
+        free(free_prev_es_rsp);
+    if (free_prev_aes_rsp)
+        free(free_prev_aes_rsp);
+    if (stdout != fp)
+        fclose(fp);
+    return res;
+}
+
 /* Returns 1 if strings equal (same length, characters same or only differ
  * by case), else returns 0. Assumes 7 bit ASCII (English alphabet). */
 static int
@@ -7787,9 +8083,13 @@ main(int argc, char * argv[])
         enumerate_work(op);
         goto early_out;
     }
-    if (op->do_json) {
-        if (! sgj_init_state(jsp, op->json_arg)) {
-            int bad_char = jsp->first_bad_char;
+    if (op->do_json || (op->monitor_secs > 0)) {
+        /* --monitor builds each event from its own state (see
+         * mon_event_start()) so none of the usual JSON is output */
+        sgj_state * tjsp = (op->monitor_secs > 0) ? &op->mon_json_st : jsp;
+
+        if (! sgj_init_state(tjsp, op->json_arg)) {
+            int bad_char = tjsp->first_bad_char;
             char e[1500];
 
             if (bad_char) {
@@ -7801,7 +8101,18 @@ main(int argc, char * argv[])
             ret = SG_LIB_SYNTAX_ERROR;
             goto early_out;
         }
-        jop = sgj_start_r(MY_NAME, version_str, argc, argv, jsp);
+        if (op->monitor_secs > 0) {
+            /* each event is one JSON object, streamed on a single line */
+            tjsp->pr_cbor = false;
+            tjsp->pr_exit_status = false;
+            tjsp->pr_leadin = false;
+            tjsp->pr_out_hr = false;
+            tjsp->pr_packed = true;
+            tjsp->pr_pretty = false;
+            tjsp->pr_stream = true;
+            tjsp->arena_sz = 0;
+        } else
+            jop = sgj_start_r(MY_NAME, version_str, argc, argv, jsp);
     }
     as_json = jsp->pr_as_json;
 
@@ -7910,7 +8221,8 @@ main(int argc, char * argv[])
             ret = sg_convert_errno(ENOMEM);
             goto err_out;
         }
-        if (! (op->do_raw || have_cgs || (op->do_hex > 2))) {
+        if (! (op->do_raw || have_cgs || (op->do_hex > 2) ||
+               (op->monitor_secs > 0))) {
             uint8_t inq_rsp[36];
             static const int i_rlen = sizeof(inq_rsp);
 
@@ -8014,7 +8326,8 @@ main(int argc, char * argv[])
                 pr2serr("Request sense failed (res=%d), most likely "
                         " problems ahead\n", ret);
         }
-        if (! (op->do_raw || have_cgs || (op->do_hex > 2))) {
+        if (! (op->do_raw || have_cgs || (op->do_hex > 2) ||
+               (op->monitor_secs > 0))) {
             if (! op->no_time)
                 fetch_decode_timestamp(ptvp, op);
         }
@@ -8031,7 +8344,9 @@ main(int argc, char * argv[])
             if (ret)
                 break;
         }
-    } else if (op->do_join)
+    } else if (op->monitor_secs > 0)
+        ret = monitor_work(ptvp, op);
+    else if (op->do_join)
         ret = join_work(ptvp, true, op, jop);
     else if (op->do_status)
         ret = process_1ormore_status_dpages(ptvp, op, jop);
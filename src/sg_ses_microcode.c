@@ -20,6 +20,7 @@
 #include <getopt.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
 
@@ -27,12 +28,27 @@
 #include "config.h"
 #endif
 
+/* Multiple DEVICEs are driven via the Linux sg driver's asynchronous
+ * interface (sg_io_linux) which is absent from dummy and replay builds */
+#if defined(SG_LIB_LINUX) && (! defined(SG_LIB_PT_DUMMY))
+#define SES_MC_SG_ASYNC 1
+#endif
+
+#ifdef SES_MC_SG_ASYNC
+#include <poll.h>
+#include <sys/sysmacros.h>      /* for major() */
+#include <linux/major.h>        /* for SCSI_GENERIC_MAJOR */
+#endif
+
 #include "sg_lib.h"
 #include "sg_lib_data.h"
 #include "sg_cmds_basic.h"
 #include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
+#ifdef SES_MC_SG_ASYNC
+#include "sg_io_linux.h"
+#endif
 
 #ifdef SG_LIB_WIN32
 #ifdef SG_LIB_WIN32_DIRECT
@@ -45,7 +61,7 @@
  * RESULTS commands in order to send microcode to the given SES device.
  */
 
-static const char * version_str = "1.22 20260321";    /* ses4r02 */
+static const char * version_str = "1.23 20261018";    /* ses4r02 */
 
 #define ME "sg_ses_microcode: "
 #define MAX_XFER_LEN (256 * 1024 * 1024)
@@ -54,6 +70,12 @@ static const char * version_str = "1.22 20260321";    /* ses4r02 */
 #define EBUFF_SZ 256
 
 #define DPC_DOWNLOAD_MICROCODE 0xe
+#define SEND_DIAGNOSTIC_CMD 0x1d
+#define RECEIVE_DIAGNOSTICS_CMD 0x1c
+#define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
+#define DEF_PT_TIMEOUT 60       /* 60 seconds */
+#define LONG_PT_TIMEOUT 7200    /* SEND DIAGNOSTIC with long duration */
+#define MDEV_TABLE_SECS 10      /* multiple DEVICEs: status table period */
 
 struct opts_t {
     bool dry_run;
@@ -173,7 +195,7 @@ usage()
             "[--subenc=SEID]\n"
             "                        [--tlength=TLEN] [--verbose] "
             "[--version]\n"
-            "                        DEVICE\n"
+            "                        DEVICE [DEVICE...]\n"
             "  where:\n"
             "    --bpw=CS|-b CS         CS is chunk size: bytes per send "
             "diagnostic\n"
@@ -216,7 +238,9 @@ usage()
             "Does one or more SCSI SEND DIAGNOSTIC followed by RECEIVE "
             "DIAGNOSTIC\nRESULTS command sequences in order to download "
             "microcode. Use '-m xxx'\nto list available modes. With only "
-            "DEVICE given, the Download Microcode\nStatus dpage is output.\n"
+            "DEVICE given, the Download Microcode\nStatus dpage is output. "
+            "If more than one DEVICE is given, all are worked on\n"
+            "together and a status table is output.\n"
           );
 }
 
@@ -291,21 +315,19 @@ truncated:
     return;
 }
 
+/* Builds the Download microcode control dpage for mode in wp, growing it
+ * as needed. If copy_data is false only the 24 byte header is placed in
+ * wp (the caller supplies the microcode from elsewhere). Returns the
+ * length of the dpage (a multiple of 4) or a negated SG_LIB_* error. */
 static int
-send_then_receive(int sg_fd, uint32_t gen_code, int off_off,
-                  const uint8_t * dmp, int dmp_len,
-                  struct dout_buff_t * wp, uint8_t * dip,
-                  int din_len, bool last, const struct opts_t * op)
+build_dout(struct dout_buff_t * wp, int mode, uint32_t gen_code,
+           int off_off, const uint8_t * dmp, int dmp_len, bool copy_data,
+           const struct opts_t * op)
 {
     bool send_data = false;
-    int do_len, rem, res, rsp_len, k, n, num, mc_status, resid, act_len, verb;
-    int ret = 0;
-    uint32_t rec_gen_code;
-    const uint8_t * bp;
-    const char * cp;
+    int do_len, rem, n;
 
-    verb = (op->verbose > 1) ? op->verbose - 1 : 0;
-    switch (op->mc_mode) {
+    switch (mode) {
     case MODE_DNLD_MC_OFFS:
     case MODE_DNLD_MC_OFFS_SAVE:
     case MODE_DNLD_MC_OFFS_DEFER:
@@ -320,56 +342,112 @@ send_then_receive(int sg_fd, uint32_t gen_code, int off_off,
         do_len = 24;
         break;
     default:
-        pr2serr("%s: unexpected mc_mode=0x%x\n", __func__, op->mc_mode);
-        return SG_LIB_SYNTAX_ERROR;
+        pr2serr("%s: unexpected mc_mode=0x%x\n", __func__, mode);
+        return -SG_LIB_SYNTAX_ERROR;
     }
-    if (do_len > wp->dout_len) {
-        if (wp->doutp)
-            free(wp->doutp);
-        wp->doutp = sg_memalign(do_len, 0, &wp->free_doutp, op->verbose > 3);
+    n = copy_data ? do_len : 24;
+    if (n > wp->dout_len) {
+        if (wp->free_doutp)
+            free(wp->free_doutp);
+        wp->doutp = sg_memalign(n, 0, &wp->free_doutp, op->verbose > 3);
         if (! wp->doutp) {
-            pr2serr("%s: unable to alloc %d bytes\n", __func__, do_len);
-            return SG_LIB_CAT_OTHER;
+            pr2serr("%s: unable to alloc %d bytes\n", __func__, n);
+            wp->dout_len = 0;
+            return -SG_LIB_CAT_OTHER;
         }
-        wp->dout_len = do_len;
+        wp->dout_len = n;
     } else
-        memset(wp->doutp, 0, do_len);
+        memset(wp->doutp, 0, n);
     wp->doutp[0] = DPC_DOWNLOAD_MICROCODE;
     wp->doutp[1] = op->mc_subenc;
     sg_put_unaligned_be16(do_len - 4, wp->doutp + 2);
     sg_put_unaligned_be32(gen_code, wp->doutp + 4);
-    wp->doutp[8] = op->mc_mode;
+    wp->doutp[8] = mode;
     wp->doutp[11] = op->mc_id;
     if (send_data)
         sg_put_unaligned_be32(op->mc_offset + off_off, wp->doutp + 12);
     sg_put_unaligned_be32(op->mc_tlen, wp->doutp + 16);
     sg_put_unaligned_be32(dmp_len, wp->doutp + 20);
-    if (send_data && (dmp_len > 0))
+    if (copy_data && send_data && (dmp_len > 0))
         memcpy(wp->doutp + 24, dmp, dmp_len);
     if ((op->verbose > 2) || (op->dry_run && op->verbose)) {
         pr2serr("send diag: sub-enc id=%u exp_gen=%u download_mc_code=%u "
-                "buff_id=%u\n", op->mc_subenc, gen_code, op->mc_mode,
-                op->mc_id);
+                "buff_id=%u\n", op->mc_subenc, gen_code, mode, op->mc_id);
         pr2serr("    buff_off=%u image_len=%u this_mc_data_len=%u "
                 "dout_len=%u\n", op->mc_offset + off_off, op->mc_tlen,
                 dmp_len, do_len);
     }
+    return do_len;
+}
+
+/* With --dry-run, updates dummy_rd_resp as if the device had accepted a
+ * Download microcode control dpage for mode ending at image offset s. */
+static void
+dry_run_rd_update(int mode, int s, bool last, const struct opts_t * op)
+{
+    bool send_data = ((MODE_ACTIVATE_MC != mode) && (MODE_ABORT_MC != mode));
+    int n;
+
+    if (op->mc_subenc >= 4)
+        return;
+    n = 8 + (op->mc_subenc * 16);
+    dummy_rd_resp[n + 11] = op->mc_id;
+    sg_put_unaligned_be32(((send_data && (! last)) ? s : 0),
+                          dummy_rd_resp + n + 12);
+    if (MODE_ABORT_MC == mode)
+        dummy_rd_resp[n + 2] = 0x80;
+    else if (MODE_ACTIVATE_MC == mode)
+        dummy_rd_resp[n + 2] = 0x0;     /* done */
+    else
+        dummy_rd_resp[n + 2] = (s >= op->mc_tlen) ? 0x13 : 0x1;
+}
+
+/* Checks the length of a Download microcode status dpage response held in
+ * dip. Returns its usable length, or -1 if it is too short. */
+static int
+dl_mc_rsp_len(const uint8_t * dip, int din_len, int resid)
+{
+    int rsp_len = sg_get_unaligned_be16(dip + 2) + 4;
+    int act_len = din_len - resid;
+
+    if (rsp_len > din_len) {
+        pr2serr("<<< warning response buffer too small [%d but need "
+                "%d]>>>\n", din_len, rsp_len);
+        rsp_len = din_len;
+    }
+    if (rsp_len > act_len) {
+        pr2serr("<<< warning response too short [actually got %d but need "
+                "%d]>>>\n", act_len, rsp_len);
+        rsp_len = act_len;
+    }
+    if (rsp_len < 8) {
+        pr2serr("Download microcode status dpage too short [%d]\n", rsp_len);
+        return -1;
+    }
+    return rsp_len;
+}
+
+static int
+send_then_receive(int sg_fd, uint32_t gen_code, int off_off,
+                  const uint8_t * dmp, int dmp_len,
+                  struct dout_buff_t * wp, uint8_t * dip,
+                  int din_len, bool last, const struct opts_t * op)
+{
+    int do_len, res, rsp_len, k, n, num, mc_status, resid, verb;
+    int ret = 0;
+    uint32_t rec_gen_code;
+    const uint8_t * bp;
+    const char * cp;
+
+    verb = (op->verbose > 1) ? op->verbose - 1 : 0;
+    do_len = build_dout(wp, op->mc_mode, gen_code, off_off, dmp, dmp_len,
+                        true, op);
+    if (do_len < 0)
+        return -do_len;
     /* select long duration timeout (7200 seconds) */
     if (op->dry_run) {
-        if (op->mc_subenc < 4) {
-            int s = op->mc_offset + off_off + dmp_len;
-
-            n = 8 + (op->mc_subenc * 16);
-            dummy_rd_resp[n + 11] = op->mc_id;
-            sg_put_unaligned_be32(((send_data && (! last)) ? s : 0),
-                                  dummy_rd_resp + n + 12);
-            if (MODE_ABORT_MC == op->mc_mode)
-                dummy_rd_resp[n + 2] = 0x80;
-            else if (MODE_ACTIVATE_MC == op->mc_mode)
-                dummy_rd_resp[n + 2] = 0x0;     /* done */
-            else
-                dummy_rd_resp[n + 2] = (s >= op->mc_tlen) ? 0x13 : 0x1;
-        }
+        dry_run_rd_update(op->mc_mode, op->mc_offset + off_off + dmp_len,
+                          last, op);
         res = 0;
     } else
         res = sg_ll_send_diag(sg_fd, 0 /* st_code */, true /* pf */,
@@ -425,22 +503,9 @@ send_then_receive(int sg_fd, uint32_t gen_code, int off_off,
                                     verb);
     if (res)
         return ret ? ret : res;
-    rsp_len = sg_get_unaligned_be16(dip + 2) + 4;
-    act_len = din_len - resid;
-    if (rsp_len > din_len) {
-        pr2serr("<<< warning response buffer too small [%d but need "
-                "%d]>>>\n", din_len, rsp_len);
-        rsp_len = din_len;
-    }
-    if (rsp_len > act_len) {
-        pr2serr("<<< warning response too short [actually got %d but need "
-                "%d]>>>\n", act_len, rsp_len);
-        rsp_len = act_len;
-    }
-    if (rsp_len < 8) {
-        pr2serr("Download microcode status dpage too short [%d]\n", rsp_len);
+    rsp_len = dl_mc_rsp_len(dip, din_len, resid);
+    if (rsp_len < 0)
         return ret ? ret : SG_LIB_CAT_OTHER;
-    }
     rec_gen_code = sg_get_unaligned_be32(dip + 4);
     if ((op->verbose > 2) || (op->dry_run && op->verbose)) {
         n = 8 + (op->mc_subenc * 16);
@@ -475,6 +540,515 @@ send_then_receive(int sg_fd, uint32_t gen_code, int off_off,
     return ret;
 }
 
+/* Per DEVICE state when more than one DEVICE is given. Each DEVICE runs
+ * its own download state machine; all are driven from mdev_work(). */
+struct mdev_t {
+    bool async;         /* Linux sg driver: write() now, read() later */
+    bool busy;          /* async command in flight */
+    bool sd_failed;     /* SEND DIAGNOSTIC failed, fetching status only */
+    int fd;
+    int state;          /* MDEV_ST_* value */
+    int mode;           /* op->mc_mode then maybe MODE_ACTIVATE_MC */
+    int res;            /* 0 or first error (SG_LIB_* value) */
+    int off;            /* bytes of the image accepted so far */
+    int n;              /* bytes of the image in the command in flight */
+    int mc_status;      /* from Download microcode status dpage, -1 */
+    int add_status;
+    int num_cmds;
+    uint32_t gen_code;
+    const char * name;
+    uint8_t * dip;
+    uint8_t * free_dip;
+    struct dout_buff_t dout;
+#ifdef SES_MC_SG_ASYNC
+    uint8_t cdb[6];
+    uint8_t sense_b[SENSE_BUFF_LEN];
+    sg_iovec_t iov[3];
+    struct sg_io_hdr io_hdr;
+#endif
+};
+
+enum mdev_state_e {
+    MDEV_ST_GEN_CODE = 0,       /* RDR for generation code */
+    MDEV_ST_SEND,               /* SEND DIAGNOSTIC with the next chunk */
+    MDEV_ST_STATUS,             /* RDR for status after SEND DIAGNOSTIC */
+    MDEV_ST_DONE,
+    MDEV_ST_FAILED,
+};
+
+static const char * mdev_state_arr[] = {
+    "starting", "sending", "checking", "done", "failed",
+};
+
+static void
+mdev_fail(struct mdev_t * mdp, int res)
+{
+    if (0 == mdp->res)
+        mdp->res = res ? res : SG_LIB_CAT_OTHER;
+    mdp->state = MDEV_ST_FAILED;
+}
+
+static bool
+mdev_is_data_mode(int mode)
+{
+    return ((MODE_DNLD_MC_OFFS == mode) || (MODE_DNLD_MC_OFFS_SAVE == mode) ||
+            (MODE_DNLD_MC_OFFS_DEFER == mode));
+}
+
+/* Picks up this DEVICE's descriptor from the Download microcode status
+ * dpage in mdp->dip. Returns false if it reports an error. */
+static bool
+mdev_parse_status(struct mdev_t * mdp, int rsp_len, const struct opts_t * op)
+{
+    int k, num;
+    uint32_t rec_gen_code = sg_get_unaligned_be32(mdp->dip + 4);
+    const uint8_t * bp;
+
+    if ((MDEV_ST_GEN_CODE != mdp->state) && (rec_gen_code != mdp->gen_code)
+        && op->verbose)
+        pr2serr("%s: gen_code changed from %" PRIu32 " to %" PRIu32 "\n",
+                mdp->name, mdp->gen_code, rec_gen_code);
+    num = (rsp_len - 8) / 16;
+    for (k = 0, bp = mdp->dip + 8; k < num; ++k, bp += 16) {
+        if ((unsigned int)op->mc_subenc == (unsigned int)bp[1]) {
+            mdp->mc_status = bp[2];
+            mdp->add_status = bp[3];
+            if (op->verbose > 1)
+                pr2serr("%s: status 0x%x, additional 0x%x, expected "
+                        "offset 0x%" PRIx32 "\n", mdp->name, bp[2], bp[3],
+                        sg_get_unaligned_be32(bp + 12));
+            return (mdp->mc_status < 0x80);
+        }
+    }
+    if (op->verbose)
+        pr2serr("%s: no descriptor for subenclosure %d\n", mdp->name,
+                op->mc_subenc);
+    return true;
+}
+
+/* After a good SEND DIAGNOSTIC and (if done) RDR, selects what to send
+ * next: the next chunk, an activate, or nothing. */
+static void
+mdev_next(struct mdev_t * mdp, const struct opts_t * op)
+{
+    if (mdev_is_data_mode(mdp->mode)) {
+        if (mdp->off < op->mc_len) {
+            mdp->state = MDEV_ST_SEND;
+            return;
+        }
+        if ((MODE_DNLD_MC_OFFS_DEFER == mdp->mode) &&
+            op->bpw_then_activate) {
+            mdp->mode = MODE_ACTIVATE_MC;
+            mdp->state = MDEV_ST_SEND;
+            return;
+        }
+    }
+    mdp->state = MDEV_ST_DONE;
+}
+
+/* Called when the command for the current state has completed with res
+ * (and resid for RDR). Moves that DEVICE's state machine on, following
+ * the same rules as send_then_receive(). */
+static void
+mdev_done(struct mdev_t * mdp, int res, int resid, const struct opts_t * op)
+{
+    bool last, data_mode;
+    int rsp_len;
+
+    mdp->busy = false;
+    ++mdp->num_cmds;
+    switch (mdp->state) {
+    case MDEV_ST_GEN_CODE:
+        if (res) {
+            mdev_fail(mdp, res);
+            break;
+        }
+        rsp_len = dl_mc_rsp_len(mdp->dip, DEF_DIN_LEN, resid);
+        if (rsp_len < 0) {
+            mdev_fail(mdp, SG_LIB_CAT_OTHER);
+            break;
+        }
+        mdev_parse_status(mdp, rsp_len, op);
+        mdp->gen_code = sg_get_unaligned_be32(mdp->dip + 4);
+        mdp->state = (MODE_DNLD_STATUS == mdp->mode) ? MDEV_ST_DONE :
+                                                       MDEV_ST_SEND;
+        break;
+    case MDEV_ST_SEND:
+        data_mode = mdev_is_data_mode(mdp->mode);
+        if (res) {
+            mdp->res = res;
+            if (op->mc_non || (! data_mode)) {
+                mdp->sd_failed = true;  /* RDR but report SD's error */
+                mdp->state = MDEV_ST_STATUS;
+            } else
+                mdev_fail(mdp, res);
+            break;
+        }
+        if (data_mode)
+            mdp->off += mdp->n;
+        last = (! data_mode) || (mdp->off >= op->mc_len);
+        if (op->mc_non || (op->ealsd && last &&
+                           (MODE_DNLD_MC_OFFS_DEFER != mdp->mode)))
+            mdev_next(mdp, op);     /* skip RDR */
+        else
+            mdp->state = MDEV_ST_STATUS;
+        break;
+    case MDEV_ST_STATUS:
+        if (res) {
+            mdev_fail(mdp, mdp->sd_failed ? mdp->res : res);
+            break;
+        }
+        rsp_len = dl_mc_rsp_len(mdp->dip, DEF_DIN_LEN, resid);
+        if (rsp_len < 0) {
+            mdev_fail(mdp, SG_LIB_CAT_OTHER);
+            break;
+        }
+        if ((! mdev_parse_status(mdp, rsp_len, op)) || mdp->sd_failed)
+            mdev_fail(mdp, mdp->res);
+        else
+            mdev_next(mdp, op);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Issues the command for the current state of one DEVICE. For the Linux
+ * sg driver it is queued with write() and mdev_done() is called later from
+ * mdev_work() when it completes; otherwise the command is done now. With
+ * the sg driver the microcode is not copied: the dpage header and the
+ * shared image are given as separate elements of an iovec. */
+static void
+mdev_start(struct mdev_t * mdp, const uint8_t * dmp, const struct opts_t * op)
+{
+    bool is_sd = (MDEV_ST_SEND == mdp->state);
+    int res, resid, do_len;
+    int n = 0;
+    int vb = (op->verbose > 1) ? op->verbose - 1 : 0;
+
+    if (is_sd) {
+        if (mdev_is_data_mode(mdp->mode)) {
+            n = op->mc_len - mdp->off;
+            if ((op->bpw > 0) && (n > op->bpw))
+                n = op->bpw;
+        }
+        mdp->n = n;
+        do_len = build_dout(&mdp->dout, mdp->mode, mdp->gen_code, mdp->off,
+                            dmp + mdp->off, n, ! mdp->async, op);
+        if (do_len < 0) {
+            mdev_fail(mdp, -do_len);
+            return;
+        }
+    } else
+        do_len = DEF_DIN_LEN;
+    if (op->dry_run) {
+        resid = 0;
+        if (! is_sd) {
+            if (MDEV_ST_STATUS == mdp->state)
+                dry_run_rd_update(mdp->mode, op->mc_offset + mdp->off,
+                                  ((! mdev_is_data_mode(mdp->mode)) ||
+                                   (mdp->off >= op->mc_len)), op);
+            res = sizeof(dummy_rd_resp);
+            memcpy(mdp->dip, dummy_rd_resp, res);
+            resid = DEF_DIN_LEN - res;
+        }
+        mdev_done(mdp, 0, resid, op);
+        return;
+    }
+#ifdef SES_MC_SG_ASYNC
+    if (mdp->async) {
+        struct sg_io_hdr * hp = &mdp->io_hdr;
+        static uint8_t pad_b[4];
+
+        memset(hp, 0, sizeof(*hp));
+        memset(mdp->cdb, 0, sizeof(mdp->cdb));
+        hp->interface_id = 'S';
+        hp->cmd_len = sizeof(mdp->cdb);
+        hp->cmdp = mdp->cdb;
+        hp->mx_sb_len = sizeof(mdp->sense_b);
+        hp->sbp = mdp->sense_b;
+        hp->usr_ptr = mdp;
+        if (is_sd) {
+            int k = 0;
+
+            mdp->cdb[0] = SEND_DIAGNOSTIC_CMD;
+            mdp->cdb[1] = 0x10;         /* PF */
+            sg_put_unaligned_be16(do_len, mdp->cdb + 3);
+            mdp->iov[k].iov_base = mdp->dout.doutp;
+            mdp->iov[k++].iov_len = 24;
+            if (n > 0) {
+                mdp->iov[k].iov_base = (void *)(dmp + mdp->off);
+                mdp->iov[k++].iov_len = n;
+            }
+            if (do_len > (24 + n)) {
+                mdp->iov[k].iov_base = pad_b;
+                mdp->iov[k++].iov_len = do_len - (24 + n);
+            }
+            hp->dxfer_direction = SG_DXFER_TO_DEV;
+            hp->iovec_count = k;
+            hp->dxferp = mdp->iov;
+            hp->dxfer_len = do_len;
+            hp->timeout = LONG_PT_TIMEOUT * 1000;
+        } else {
+            mdp->cdb[0] = RECEIVE_DIAGNOSTICS_CMD;
+            mdp->cdb[1] = 0x1;          /* PCV */
+            mdp->cdb[2] = DPC_DOWNLOAD_MICROCODE;
+            sg_put_unaligned_be16(DEF_DIN_LEN, mdp->cdb + 3);
+            hp->dxfer_direction = SG_DXFER_FROM_DEV;
+            hp->dxferp = mdp->dip;
+            hp->dxfer_len = DEF_DIN_LEN;
+            hp->timeout = DEF_PT_TIMEOUT * 1000;
+        }
+        if (vb > 1) {
+            char b[128];
+
+            pr2serr("%s: queue cdb: %s\n", mdp->name,
+                    sg_get_command_str(mdp->cdb, 6, false, sizeof(b), b));
+        }
+        while (((res = write(mdp->fd, hp, sizeof(*hp))) < 0) &&
+               (EINTR == errno))
+            ;
+        if (res < 0) {
+            res = errno;
+            pr2serr("%s: sg write(): %s\n", mdp->name, safe_strerror(res));
+            mdev_done(mdp, sg_convert_errno(res), 0, op);
+        } else
+            mdp->busy = true;
+        return;
+    }
+#endif
+    resid = 0;
+    if (is_sd)
+        res = sg_ll_send_diag(mdp->fd, 0 /* st_code */, true /* pf */,
+                              false /* st */, false /* devofl */,
+                              false /* unitofl */, 1 /* long_duration */,
+                              mdp->dout.doutp, do_len, vb > 0, vb);
+    else
+        res = sg_ll_receive_diag_v2(mdp->fd, true /* pcv */,
+                                    DPC_DOWNLOAD_MICROCODE, mdp->dip,
+                                    DEF_DIN_LEN, 0 /* default timeout */,
+                                    &resid, vb > 0, vb);
+    mdev_done(mdp, res, resid, op);
+}
+
+#ifdef SES_MC_SG_ASYNC
+/* Fetches the completed command of an async DEVICE and processes it */
+static void
+mdev_reap(struct mdev_t * mdp, const struct opts_t * op)
+{
+    int res, cat;
+    int vb = (op->verbose > 1) ? op->verbose - 1 : 0;
+    struct sg_io_hdr * hp = &mdp->io_hdr;
+
+    while (((res = read(mdp->fd, hp, sizeof(*hp))) < 0) && (EINTR == errno))
+        ;
+    if (res < 0) {
+        if (EAGAIN == errno)
+            return;             /* spurious wakeup, still in flight */
+        res = errno;
+        pr2serr("%s: sg read(): %s\n", mdp->name, safe_strerror(res));
+        mdev_done(mdp, sg_convert_errno(res), 0, op);
+        return;
+    }
+    cat = sg_err_category3(hp);
+    switch (cat) {
+    case SG_LIB_CAT_CLEAN:
+    case SG_LIB_CAT_RECOVERED:
+    case SG_LIB_CAT_CONDITION_MET:
+    case SG_LIB_CAT_NO_SENSE:
+        cat = 0;
+        break;
+    default:
+        if (vb)
+            sg_chk_n_print3(mdp->name, hp, vb > 1);
+        break;
+    }
+    mdev_done(mdp, cat, hp->resid, op);
+}
+#endif
+
+static void
+mdev_print_table(const struct mdev_t * mdp_arr, int num_devs, time_t elapsed,
+                 const struct opts_t * op)
+{
+    int k, num_done = 0, num_failed = 0;
+    const struct mdev_t * mdp;
+    const char * cp;
+    char b[80];
+
+    printf("%-20s %-9s %21s  %s\n", "DEVICE", "state", "sent/total bytes",
+           "download microcode status");
+    for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+        if (MDEV_ST_DONE == mdp->state)
+            ++num_done;
+        else if (MDEV_ST_FAILED == mdp->state)
+            ++num_failed;
+        if (mdp->mc_status >= 0) {
+            cp = get_mc_status_str(mdp->mc_status);
+            snprintf(b, sizeof(b), "%s [0x%x,0x%x]", (*cp ? cp : "?"),
+                     mdp->mc_status, mdp->add_status);
+        } else if (mdp->res)
+            sg_get_category_sense_str(mdp->res, sizeof(b), b, op->verbose);
+        else
+            snprintf(b, sizeof(b), "-");
+        printf("%-20s %-9s %10d/%-10d  %s\n", mdp->name,
+               mdev_state_arr[mdp->state], mdp->off, op->mc_len, b);
+        if (mdp->res && (mdp->mc_status >= 0)) {
+            sg_get_category_sense_str(mdp->res, sizeof(b), b, op->verbose);
+            printf("%-20s %-9s %21s  %s\n", "", "", "", b);
+        }
+    }
+    printf("%d done, %d failed, %d in progress; elapsed %ld seconds\n",
+           num_done, num_failed, num_devs - num_done - num_failed,
+           (long)elapsed);
+}
+
+/* Downloads (or activates, aborts, reports status) on all DEVICEs at once.
+ * Each DEVICE has its own state machine, all driven from this one loop:
+ * sg driver DEVICEs have their commands queued together and completions
+ * are collected with poll(); other DEVICEs are stepped in turn. The image
+ * at dmp is shared by all DEVICEs. A status table is output every
+ * MDEV_TABLE_SECS seconds and at the end. Returns 0 if all DEVICEs
+ * succeeded, else the first error. */
+static int
+mdev_work(char ** dev_names, int num_devs, const uint8_t * dmp,
+          struct opts_t * op)
+{
+    int k, num_active, num_busy, res;
+    int ret = 0;
+    time_t start_tm, next_tbl_tm, now;
+    struct mdev_t * mdp;
+    struct mdev_t * mdp_arr;
+#ifdef SES_MC_SG_ASYNC
+    struct pollfd * pfd_arr;
+    struct mdev_t ** busy_arr;
+#endif
+
+    mdp_arr = (struct mdev_t *)calloc(num_devs, sizeof(struct mdev_t));
+#ifdef SES_MC_SG_ASYNC
+    pfd_arr = (struct pollfd *)calloc(num_devs, sizeof(struct pollfd));
+    busy_arr = (struct mdev_t **)calloc(num_devs, sizeof(struct mdev_t *));
+    if ((NULL == mdp_arr) || (NULL == pfd_arr) || (NULL == busy_arr)) {
+        pr2serr("%s: out of memory\n", __func__);
+        free(mdp_arr);
+        free(pfd_arr);
+        free(busy_arr);
+        return sg_convert_errno(ENOMEM);
+    }
+#else
+    if (NULL == mdp_arr) {
+        pr2serr("%s: out of memory\n", __func__);
+        return sg_convert_errno(ENOMEM);
+    }
+#endif
+    for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+        mdp->name = dev_names[k];
+        mdp->mode = op->mc_mode;
+        mdp->mc_status = -1;
+        mdp->state = MDEV_ST_GEN_CODE;
+        mdp->fd = sg_cmds_open_device(mdp->name, false /* rw */,
+                                      op->verbose);
+        if (mdp->fd < 0) {
+            pr2serr("%s: open error: %s\n", mdp->name,
+                    safe_strerror(-mdp->fd));
+            mdev_fail(mdp, sg_convert_errno(-mdp->fd));
+            continue;
+        }
+        mdp->dip = sg_memalign(DEF_DIN_LEN, 0, &mdp->free_dip, false);
+        if (NULL == mdp->dip) {
+            mdev_fail(mdp, sg_convert_errno(ENOMEM));
+            continue;
+        }
+#ifdef SES_MC_SG_ASYNC
+        if (! op->dry_run) {
+            struct stat a_st;
+
+            if ((0 == fstat(mdp->fd, &a_st)) && S_ISCHR(a_st.st_mode) &&
+                (SCSI_GENERIC_MAJOR == major(a_st.st_rdev)))
+                mdp->async = true;
+        }
+#endif
+        if (op->verbose)
+            pr2serr("%s: %s\n", mdp->name, mdp->async ? "sg driver, "
+                    "commands queued" : "commands issued in turn");
+    }
+
+    start_tm = time(NULL);
+    next_tbl_tm = start_tm + MDEV_TABLE_SECS;
+    while (true) {
+        num_active = 0;
+        num_busy = 0;
+        for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+            if ((MDEV_ST_DONE == mdp->state) ||
+                (MDEV_ST_FAILED == mdp->state))
+                continue;
+            if (! mdp->busy)
+                mdev_start(mdp, dmp, op);
+            if (mdp->busy) {
+#ifdef SES_MC_SG_ASYNC
+                pfd_arr[num_busy].fd = mdp->fd;
+                pfd_arr[num_busy].events = POLLIN;
+                pfd_arr[num_busy].revents = 0;
+                busy_arr[num_busy] = mdp;
+#endif
+                ++num_busy;
+            }
+            if ((MDEV_ST_DONE != mdp->state) &&
+                (MDEV_ST_FAILED != mdp->state))
+                ++num_active;
+        }
+        if (0 == num_active)
+            break;
+#ifdef SES_MC_SG_ASYNC
+        if (num_busy > 0) {
+            res = poll(pfd_arr, num_busy, 1000);
+            if ((res < 0) && (EINTR != errno)) {
+                res = errno;
+                pr2serr("%s: poll(): %s\n", __func__, safe_strerror(res));
+                ret = sg_convert_errno(res);
+                break;
+            }
+            for (k = 0; (res > 0) && (k < num_busy); ++k) {
+                if (pfd_arr[k].revents & (POLLIN | POLLERR | POLLHUP))
+                    mdev_reap(busy_arr[k], op);
+            }
+        }
+#endif
+        now = time(NULL);
+        if (now >= next_tbl_tm) {
+            mdev_print_table(mdp_arr, num_devs, now - start_tm, op);
+            next_tbl_tm = now + MDEV_TABLE_SECS;
+        }
+    }
+    if (ret) {          /* poll() failed: wait for commands in flight */
+        for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+            if (mdp->busy)
+                mdev_fail(mdp, ret);
+        }
+    }
+    mdev_print_table(mdp_arr, num_devs, time(NULL) - start_tm, op);
+    for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+        if (mdp->res && (0 == ret))
+            ret = mdp->res;
+    }
+    for (k = 0, mdp = mdp_arr; k < num_devs; ++k, ++mdp) {
+        if (mdp->fd >= 0) {
+            res = sg_cmds_close_device(mdp->fd);
+            if ((res < 0) && (0 == ret))
+                ret = sg_convert_errno(-res);
+        }
+        if (mdp->free_dip)
+            free(mdp->free_dip);
+        if (mdp->dout.free_doutp)
+            free(mdp->dout.free_doutp);
+    }
+    free(mdp_arr);
+#ifdef SES_MC_SG_ASYNC
+    free(pfd_arr);
+    free(busy_arr);
+#endif
+    return ret;
+}
 
 int
 main(int argc, char * argv[])
@@ -483,10 +1057,11 @@ main(int argc, char * argv[])
     bool want_file = false;
     bool verbose_given = false;
     bool version_given = false;
-    int res, c, len, k, n, rsp_len, resid, act_len, din_len, verb;
+    int res, c, len, k, n, rsp_len, resid, din_len, verb;
     int sg_fd = -1;
     int infd = -1;
     int do_help = 0;
+    int num_devs = 0;
     int ret = 0;
     uint32_t gen_code = 0;
     const char * device_name = NULL;
@@ -636,16 +1211,8 @@ main(int argc, char * argv[])
         return 0;
     }
     if (optind < argc) {
-        if (NULL == device_name) {
-            device_name = argv[optind];
-            ++optind;
-        }
-        if (optind < argc) {
-            for (; optind < argc; ++optind)
-                pr2serr("Unexpected extra argument: %s\n", argv[optind]);
-            usage();
-            return SG_LIB_SYNTAX_ERROR;
-        }
+        device_name = argv[optind];
+        num_devs = argc - optind;       /* DEVICE [DEVICE...] */
     }
 
 #ifdef DEBUG
@@ -710,15 +1277,6 @@ main(int argc, char * argv[])
 #endif
 #endif
 
-    sg_fd = sg_cmds_open_device(device_name, false /* rw */, op->verbose);
-    if (sg_fd < 0) {
-        if (op->verbose)
-            pr2serr(ME "open error: %s: %s\n", device_name,
-                    safe_strerror(-sg_fd));
-        ret = sg_convert_errno(-sg_fd);
-        goto fini;
-    }
-
     if (file_name && (! want_file))
         pr2serr("ignoring --in=FILE option\n");
     else if (file_name) {
@@ -824,6 +1382,19 @@ main(int argc, char * argv[])
                 "microcode status\ndpage might be dangerous\n");
         goto fini;
     }
+    if (num_devs > 1) {
+        ret = mdev_work(argv + optind, num_devs, dmp, op);
+        goto fini;
+    }
+
+    sg_fd = sg_cmds_open_device(device_name, false /* rw */, op->verbose);
+    if (sg_fd < 0) {
+        if (op->verbose)
+            pr2serr(ME "open error: %s: %s\n", device_name,
+                    safe_strerror(-sg_fd));
+        ret = sg_convert_errno(-sg_fd);
+        goto fini;
+    }
 
     dip = sg_memalign(din_len, 0, &free_dip, op->verbose > 3);
     if (NULL == dip) {
@@ -845,20 +1416,8 @@ main(int argc, char * argv[])
                                     0 /*default timeout */, &resid, true,
                                     verb);
     if (0 == res) {
-        rsp_len = sg_get_unaligned_be16(dip + 2) + 4;
-        act_len = din_len - resid;
-        if (rsp_len > din_len) {
-            pr2serr("<<< warning response buffer too small [%d but need "
-                    "%d]>>>\n", din_len, rsp_len);
-            rsp_len = din_len;
-        }
-        if (rsp_len > act_len) {
-            pr2serr("<<< warning response too short [actually got %d but "
-                    "need %d]>>>\n", act_len, rsp_len);
-            rsp_len = act_len;
-        }
-        if (rsp_len < 8) {
-            pr2serr("Download microcode status dpage too short\n");
+        rsp_len = dl_mc_rsp_len(dip, din_len, resid);
+        if (rsp_len < 0) {
             ret = SG_LIB_CAT_OTHER;
             goto fini;
         }
@@ -27,6 +27,7 @@
 #include "sg_lib_data.h"
 #include "sg_pt.h"
 #include "sg_cmds_basic.h"
+#include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 #include "sg_json_sg_lib.h"
@@ -36,10 +37,9 @@
  * to the given SCSI device. Based on sbc4r15.pdf .
  */
 
-static const char * version_str = "1.17 20231202";
+static const char * version_str = "1.18 20261018";
 #define MY_NAME "sg_stream_ctl"
 
-#define STREAM_CONTROL_SA 0x14
 #define GET_STREAM_STATUS_SA 0x16
 
 #define STREAM_CONTROL_OPEN 0x1
@@ -234,73 +234,6 @@ sg_ll_get_stream_status(int sg_fd, uint16_t s_str_id, uint8_t * resp,
     return ret;
 }
 
-/* Invokes a SCSI STREAM CONTROL command (SBC-4).  Return of 0 -> success,
- * various SG_LIB_CAT_* positive values or -1 -> other errors.
- * N.B. The is a device modifying command that is SERVICE ACTION IN(16)
- * command since it has data-in buffer that for open returns the
- * ASSIGNED_STR_ID field . */
-static int
-sg_ll_stream_control(int sg_fd, uint32_t str_ctl, uint16_t str_id,
-                     uint8_t * resp, uint32_t alloc_len, int * residp,
-                     bool noisy, int vb)
-{
-    int k, ret, res, sense_cat;
-    uint8_t scCdb[16] = {SG_SERVICE_ACTION_IN_16,
-           STREAM_CONTROL_SA, 0, 0,  0, 0, 0, 0,  0, 0, 0, 0, 0, 0, 0, 0};
-    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
-    struct sg_pt_base * ptvp;
-
-    if (str_ctl)
-        scCdb[1] |= (str_ctl & 0x3) << 5;
-    if (str_id)         /* Only used for close, stream id to close */
-        sg_put_unaligned_be16(str_id, scCdb + 4);
-    sg_put_unaligned_be32(alloc_len, scCdb + 10);
-    if (vb) {
-        char b[128];
-
-        pr2serr("    %s cdb: %s\n", sc_s,
-                sg_get_command_str(scCdb, (int)sizeof(scCdb), false,
-                                   sizeof(b), b));
-    }
-
-    ptvp = construct_scsi_pt_obj_with_fd(sg_fd, vb);
-    if (NULL == ptvp) {
-        pr2serr("%s: out of memory\n", sc_s);
-        return -1;
-    }
-    set_scsi_pt_cdb(ptvp, scCdb, sizeof(scCdb));
-    set_scsi_pt_data_in(ptvp, resp, alloc_len);
-    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
-    res = do_scsi_pt(ptvp, -1, DEF_PT_TIMEOUT, vb);
-    ret = sg_cmds_process_resp(ptvp, sc_s, res, noisy, vb, &sense_cat);
-    if (-1 == ret) {
-        if (get_scsi_pt_transport_err(ptvp))
-            ret = SG_LIB_TRANSPORT_ERROR;
-        else
-            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
-    } else if (-2 == ret) {
-        switch (sense_cat) {
-        case SG_LIB_CAT_RECOVERED:
-        case SG_LIB_CAT_NO_SENSE:
-            ret = 0;
-            break;
-        default:
-            ret = sense_cat;
-            break;
-        }
-    } else
-        ret = 0;
-    k = ret ? (int)alloc_len : get_scsi_pt_resid(ptvp);
-    if (residp)
-        *residp = k;
-    if ((vb > 2) && ((alloc_len - k) > 0)) {
-        pr2serr("%s: parameter data returned:\n", sc_s);
-        hex2stderr((const uint8_t *)resp, alloc_len - k, ((vb > 3) ? -1 : 1));
-    }
-    destruct_scsi_pt_obj(ptvp);
-    return ret;
-}
-
 static void
 dStrRaw(const uint8_t * str, int len)
 {
@@ -20,10 +20,22 @@
 #include <getopt.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifndef SG_LIB_WIN32
+#include <sys/mman.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
 #include "sg_cmds_extra.h"
@@ -40,7 +52,7 @@
  * This utility issues the SCSI WRITE BUFFER command to the given device.
  */
 
-static const char * version_str = "1.33 20230623";    /* spc6r07 */
+static const char * version_str = "1.34 20261018";    /* spc6r07 */
 
 static const char * my_name = "sg_write_buffer: ";    /* spc6r07 */
 
@@ -51,9 +63,64 @@ static const char * my_name = "sg_write_buffer: ";    /* spc6r07 */
 #define WRITE_BUFFER_CMDLEN 10
 #define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
 #define DEF_PT_TIMEOUT 300      /* 300 seconds, 5 minutes */
+#define DEF_NUM_THREADS 16      /* for --dev-list=FN */
+#define MX_NUM_THREADS 1024
+#define MX_UA_RETRIES 4         /* per command, for --dev-list=FN */
+#define MDEV_READY_SECS 180     /* TUR polling after activation, --verify */
+
+/* Per device state for the --dev-list=FN (multiple device) mode */
+struct mdev_elem_t {
+    char * dev_name;
+    bool rev_mismatch;  /* --revision=REV differs from INQUIRY's */
+    int dl_res;         /* download: 0 for success, else SG_LIB_CAT_* ... */
+    int act_res;        /* activation (and verify) result */
+    int bytes_sent;     /* acknowledged by device */
+    int ua_retries;     /* number of Unit Attentions retried */
+    int64_t dl_usecs;
+    int64_t act_usecs;
+    char rev_before[8]; /* product revision level, only with --verify */
+    char rev_after[8];
+};
+
+/* Shared by all worker threads in the --dev-list=FN mode. Each worker takes
+ * the next unvisited device (next_dev) until end_dev is reached. The image
+ * is mapped (or read) once and only read by the workers. */
+struct mdev_state_t {
+    bool dry_run;
+    bool verify;        /* TUR then INQUIRY after activation */
+    bool activate;      /* --bpw=CS,act or --wave= given */
+    bool activating;    /* false: download phase, true: activation phase */
+    int mode;
+    int mspec;
+    int id;
+    int offset;
+    int bpw;
+    int timeout;
+    int vb;
+    int num_threads;
+    int wave_sz;        /* devices per activation wave, 0 -> all */
+    int wave_secs;      /* pause between activation waves */
+    int num_devs;
+    int mx_devs;
+    int next_dev;       /* protected by mutex when threads are used */
+    int end_dev;
+    int img_len;
+    size_t map_len;
+    const uint8_t * img;
+    void * map_p;
+    uint8_t * img_buf;
+    uint8_t * free_img_buf;
+    const char * revision;      /* --revision=REV */
+    struct mdev_elem_t * dev_arr;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
 
 static const struct option long_options[] = {
     {"bpw", required_argument, 0, 'b'},
+    {"dev-list", required_argument, 0, 'D'},
+    {"dev_list", required_argument, 0, 'D'},
     {"dry-run", no_argument, 0, 'd'},
     {"dry_run", no_argument, 0, 'd'},
     {"help", no_argument, 0, 'h'},
@@ -65,11 +132,15 @@ static const struct option long_options[] = {
     {"read-stdin", no_argument, 0, 'r'},
     {"read_stdin", no_argument, 0, 'r'},
     {"raw", no_argument, 0, 'r'},
+    {"revision", required_argument, 0, 'R'},
     {"skip", required_argument, 0, 's'},
     {"specific", required_argument, 0, 'S'},
+    {"threads", required_argument, 0, 'T'},
     {"timeout", required_argument, 0, 't' },
     {"verbose", no_argument, 0, 'v'},
+    {"verify", no_argument, 0, 'y'},
     {"version", no_argument, 0, 'V'},
+    {"wave", required_argument, 0, 'w'},
     {0, 0, 0, 0},
 };
 
@@ -86,11 +157,19 @@ usage()
             "[--specific=MS]\n"
             "                       [--timeout=TO] [--verbose] [--version] "
             "DEVICE\n"
+            "       sg_write_buffer --dev-list=FN --in=FILE --mode=MO "
+            "[--revision=REV]\n"
+            "                       [--threads=NT] [--verify] "
+            "[--wave=WS[,SECS]] [OPTIONS]\n"
             "  where:\n"
             "    --bpw=CS|-b CS         CS is chunk size: bytes per write "
             "buffer\n"
             "                           command (def: 0 -> as many as "
             "possible)\n"
+            "    --dev-list=FN|-D FN    download FILE to each device named "
+            "in FN\n"
+            "                           concurrently; MO must be 0xd or "
+            "0xe\n"
             "    --dry-run|-d           skip WRITE BUFFER commands, do "
             "everything else\n"
             "    --help|-h              print out usage message then exit\n"
@@ -107,14 +186,27 @@ usage()
             "data' (obs))\n"
             "    --offset=OFF|-o OFF    buffer offset (unit: bytes, def: 0)\n"
             "    --read-stdin|-r        read from stdin (same as '-I -')\n"
+            "    --revision=REV|-R REV    expected product revision after "
+            "activation\n"
+            "                             (implies --verify)\n"
             "    --skip=SKIP|-s SKIP    bytes in file FILE to skip before "
             "reading\n"
             "    --specific=MS|-S MS    mode specific value; 3 bit field "
             "(0 to 7)\n"
+            "    --threads=NT|-T NT     maximum number of devices worked on "
+            "at once\n"
+            "                           with --dev-list=FN (def: 16)\n"
             "    --timeout=TO|-t TO     command timeout in seconds (def: "
             "300)\n"
             "    --verbose|-v           increase verbosity\n"
-            "    --version|-V           print version string and exit\n\n"
+            "    --verify|-y            after activation wait for TUR to "
+            "succeed then\n"
+            "                           report revision from INQUIRY\n"
+            "    --version|-V           print version string and exit\n"
+            "    --wave=WS[,SECS]|-w WS[,SECS]    activate deferred "
+            "microcode WS devices\n"
+            "                           at a time, pausing SECS between "
+            "waves (def: 0)\n\n"
             "Performs one or more SCSI WRITE BUFFER commands. Use '-m xxx' "
             "to list\navailable modes. A chunk size of 4 KB ('--bpw=4k') "
             "seems to work well.\nExample: sg_write_buffer -b 4k -I xxx.lod "
@@ -189,6 +281,417 @@ print_modes(void)
             "dmc_offs_ev_defer mode downloads.\n");
 }
 
+/* Called by sg_read_name_list() with each name in the --dev-list=FN file.
+ * Appends a device, whose name is owned by msp, to msp->dev_arr . */
+static int
+mdev_add_dev(char * name, void * v_msp)
+{
+    int mx;
+    struct mdev_state_t * msp = (struct mdev_state_t *)v_msp;
+    struct mdev_elem_t * t_arr;
+
+    if (msp->num_devs >= msp->mx_devs) {
+        mx = msp->mx_devs ? (2 * msp->mx_devs) : 64;
+        t_arr = (struct mdev_elem_t *)realloc(msp->dev_arr,
+                                              mx * sizeof(*t_arr));
+        if (NULL == t_arr) {
+            pr2serr("%s: out of memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        msp->dev_arr = t_arr;
+        msp->mx_devs = mx;
+    }
+    memset(msp->dev_arr + msp->num_devs, 0, sizeof(*t_arr));
+    msp->dev_arr[msp->num_devs++].dev_name = name;
+    return 0;
+}
+
+/* Places the product revision level from a standard INQUIRY response in
+ * rev (at least 5 bytes), trailing spaces removed. Returns 0 or error. */
+static int
+mdev_get_rev(int sg_fd, char * rev, int vb)
+{
+    int res, k;
+    uint8_t inq_resp[36];
+
+    memset(inq_resp, 0, sizeof(inq_resp));
+    res = sg_ll_inquiry(sg_fd, false, false, 0, inq_resp, sizeof(inq_resp),
+                        vb > 0, vb);
+    if (res)
+        return res;
+    memcpy(rev, inq_resp + 32, 4);
+    for (k = 4; (k > 0) && (' ' == rev[k - 1]); --k)
+        ;
+    rev[k] = '\0';
+    return 0;
+}
+
+/* Sends WRITE BUFFER with mode 0xf (activate deferred microcode), retrying
+ * on Unit Attention, unless this is a dry run. */
+static int
+mdev_wb_activate(const struct mdev_state_t * msp, int sg_fd,
+                 struct mdev_elem_t * mep)
+{
+    int k, res = 0;
+
+    for (k = 0; ! msp->dry_run; ++k) {
+        res = sg_ll_write_buffer_v2(sg_fd, MODE_ACTIVATE_MC, 0, 0, 0, NULL,
+                                    0, msp->timeout, msp->vb > 0, msp->vb);
+        if ((SG_LIB_CAT_UNIT_ATTENTION == res) && (k < MX_UA_RETRIES)) {
+            ++mep->ua_retries;
+            continue;
+        }
+        break;
+    }
+    return res;
+}
+
+/* Download phase for one device: sends the whole image in chunks of at
+ * most msp->bpw bytes. Output is suppressed (unless verbose) since many of
+ * these may run concurrently; results are collected in *mep. */
+static void
+mdev_download_one(const struct mdev_state_t * msp, struct mdev_elem_t * mep)
+{
+    int k, j, n, sg_fd;
+    int res = 0;
+    int vb = msp->vb;
+    int64_t start_usecs = sg_get_monotonic_usecs();
+
+    sg_fd = sg_cmds_open_device(mep->dev_name, false /* rw */, vb);
+    if (sg_fd < 0) {
+        if (vb)
+            pr2serr("%s: error opening %s: %s\n", __func__, mep->dev_name,
+                    safe_strerror(-sg_fd));
+        mep->dl_res = sg_convert_errno(-sg_fd);
+        goto fini;
+    }
+    if (msp->verify && (! msp->dry_run))
+        mdev_get_rev(sg_fd, mep->rev_before, vb);
+    for (k = 0; k < msp->img_len; k += n) {
+        n = msp->img_len - k;
+        if ((msp->bpw > 0) && (n > msp->bpw))
+            n = msp->bpw;
+        if (vb > 1)
+            pr2serr("%s: write buffer, mode=0x%x, id=%d, offset=%d, "
+                    "len=%d\n", mep->dev_name, msp->mode, msp->id,
+                    msp->offset + k, n);
+        if (msp->dry_run)
+            continue;
+        for (j = 0; ; ++j) {
+            res = sg_ll_write_buffer_v2(sg_fd, msp->mode, msp->mspec,
+                                        msp->id, msp->offset + k,
+                                        (void *)(msp->img + k), n,
+                                        msp->timeout, vb > 0, vb);
+            if ((SG_LIB_CAT_UNIT_ATTENTION == res) && (j < MX_UA_RETRIES)) {
+                ++mep->ua_retries;
+                continue;
+            }
+            break;
+        }
+        if (res)
+            break;
+        mep->bytes_sent = k + n;
+    }
+    mep->dl_res = res;
+    sg_cmds_close_device(sg_fd);
+fini:
+    mep->dl_usecs = sg_get_monotonic_usecs() - start_usecs;
+}
+
+/* Activation phase for one device: activates the deferred microcode, then
+ * if verifying waits for TEST UNIT READY to succeed and fetches the product
+ * revision with INQUIRY, comparing it with --revision=REV if given. */
+static void
+mdev_activate_one(const struct mdev_state_t * msp, struct mdev_elem_t * mep)
+{
+    int k, sg_fd, res;
+    int vb = msp->vb;
+    int64_t start_usecs = sg_get_monotonic_usecs();
+
+    sg_fd = sg_cmds_open_device(mep->dev_name, false /* rw */, vb);
+    if (sg_fd < 0) {
+        mep->act_res = sg_convert_errno(-sg_fd);
+        goto fini;
+    }
+    res = mdev_wb_activate(msp, sg_fd, mep);
+    if (res || (! msp->verify) || msp->dry_run)
+        goto close_fini;
+    for (k = 0; ; ++k) {
+        res = sg_ll_test_unit_ready(sg_fd, 0, false, vb);
+        if ((0 == res) || (k >= MDEV_READY_SECS))
+            break;
+        if ((SG_LIB_CAT_UNIT_ATTENTION != res) &&
+            (SG_LIB_CAT_NOT_READY != res) && (SG_LIB_CAT_BUSY != res) &&
+            (SG_LIB_CAT_TIMEOUT != res))
+            break;
+        sg_sleep_secs(1);
+    }
+    if (res) {
+        if (vb)
+            pr2serr("%s: not ready after activation\n", mep->dev_name);
+        goto close_fini;
+    }
+    res = mdev_get_rev(sg_fd, mep->rev_after, vb);
+    if (res) {
+        /* a first INQUIRY after microcode change may yield a UA */
+        res = mdev_get_rev(sg_fd, mep->rev_after, vb);
+        if (res)
+            goto close_fini;
+    }
+    if (msp->revision && strcmp(msp->revision, mep->rev_after)) {
+        mep->rev_mismatch = true;
+        res = SG_LIB_CAT_OTHER;
+    }
+close_fini:
+    mep->act_res = res;
+    sg_cmds_close_device(sg_fd);
+fini:
+    mep->act_usecs = sg_get_monotonic_usecs() - start_usecs;
+}
+
+/* Worker (thread) function, each takes the next unvisited device in the
+ * current range until there are none left. */
+static void *
+mdev_worker(void * v_msp)
+{
+    int k;
+    struct mdev_state_t * msp = (struct mdev_state_t *)v_msp;
+
+    while (true) {
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&msp->mutex);
+#endif
+        k = msp->next_dev++;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&msp->mutex);
+#endif
+        if (k >= msp->end_dev)
+            break;
+        if (msp->activating) {
+            if (0 == msp->dev_arr[k].dl_res)
+                mdev_activate_one(msp, msp->dev_arr + k);
+        } else
+            mdev_download_one(msp, msp->dev_arr + k);
+    }
+    return NULL;
+}
+
+/* Works on devices [start, end) of msp->dev_arr using up to
+ * msp->num_threads concurrent workers. Returns number of workers used. */
+static int
+mdev_run(struct mdev_state_t * msp, int start, int end)
+{
+    int num_thr = end - start;
+
+    msp->next_dev = start;
+    msp->end_dev = end;
+    if (num_thr > msp->num_threads)
+        num_thr = msp->num_threads;
+    return sg_run_workers(num_thr, mdev_worker, msp);
+}
+
+/* Maps (or if that is not possible, reads) the whole of file fnp, less
+ * the first skip bytes. If len is positive then exactly len bytes are
+ * provided, padded with 0xff bytes if the file is shorter. Returns 0 and
+ * sets msp->img and msp->img_len, or returns an SG_LIB_* error. */
+static int
+mdev_load_image(struct mdev_state_t * msp, const char * fnp, int skip,
+                int len)
+{
+    int fd, res, n, k;
+    int64_t avail;
+    struct stat a_st;
+
+    fd = open(fnp, O_RDONLY);
+    if (fd < 0) {
+        res = errno;
+        pr2serr("%scould not open %s for reading: %s\n", my_name, fnp,
+                safe_strerror(res));
+        return sg_convert_errno(res);
+    }
+    if ((fstat(fd, &a_st) < 0) || (! S_ISREG(a_st.st_mode))) {
+        pr2serr("%s%s should be a regular file with --dev-list=\n", my_name,
+                fnp);
+        close(fd);
+        return SG_LIB_FILE_ERROR;
+    }
+    avail = (int64_t)a_st.st_size - skip;
+    if (avail <= 0) {
+        pr2serr("%snothing to send from %s after skip=%d\n", my_name, fnp,
+                skip);
+        close(fd);
+        return SG_LIB_FILE_ERROR;
+    }
+    if (avail > INT32_MAX) {
+        pr2serr("%s%s is too large\n", my_name, fnp);
+        close(fd);
+        return SG_LIB_FILE_ERROR;
+    }
+#ifndef SG_LIB_WIN32
+    if ((len <= 0) || (len <= avail)) {
+        void * vp = mmap(NULL, a_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (MAP_FAILED != vp) {
+            close(fd);
+            msp->map_p = vp;
+            msp->map_len = a_st.st_size;
+            msp->img = (const uint8_t *)vp + skip;
+            msp->img_len = (len > 0) ? len : (int)avail;
+            return 0;
+        }
+        if (msp->vb)
+            pr2serr("%smmap(%s) failed, read instead\n", my_name, fnp);
+    }
+#endif
+    n = (len > 0) ? len : (int)avail;
+    msp->img_buf = sg_memalign(n, 0, &msp->free_img_buf, false);
+    if (NULL == msp->img_buf) {
+        pr2serr("%sout of memory\n", my_name);
+        close(fd);
+        return sg_convert_errno(ENOMEM);
+    }
+    memset(msp->img_buf, 0xff, n);
+    if ((skip > 0) && (lseek(fd, skip, SEEK_SET) < 0)) {
+        res = errno;
+        pr2serr("%scouldn't skip to required position on %s\n", my_name,
+                fnp);
+        close(fd);
+        return sg_convert_errno(res);
+    }
+    for (k = 0; k < n; k += res) {
+        res = read(fd, msp->img_buf + k, n - k);
+        if (res < 0) {
+            if (EINTR == errno) {
+                res = 0;
+                continue;
+            }
+            res = errno;
+            pr2serr("%scouldn't read from %s: %s\n", my_name, fnp,
+                    safe_strerror(res));
+            close(fd);
+            return sg_convert_errno(res);
+        } else if (0 == res)
+            break;      /* EOF, remainder stays 0xff */
+    }
+    close(fd);
+    msp->img = msp->img_buf;
+    msp->img_len = n;
+    return 0;
+}
+
+/* Implements --dev-list=FN . Downloads the image to all devices
+ * concurrently with a deferred microcode mode, reports each device's
+ * status, then (if requested) activates the new microcode in waves of
+ * msp->wave_sz devices. A wave is only started if every device in the
+ * previous wave activated (and verified) successfully. Returns 0 if all
+ * devices succeeded, else the first error. */
+static int
+mdev_work(struct mdev_state_t * msp, const char * dev_list_fn)
+{
+    int k, j, num_devs, num_thr, wave_sz, end;
+    int ret = 0;
+    int num_good = 0;
+    int num_act = 0;
+    int num_ua = 0;
+    int64_t start_usecs, elapsed_usecs;
+    struct mdev_elem_t * mep;
+    char b[80];
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&msp->mutex, NULL);
+#endif
+    ret = sg_read_name_list(dev_list_fn, mdev_add_dev, msp);
+    num_devs = msp->num_devs;
+    if (ret)
+        goto fini;
+    if (0 == num_devs) {
+        pr2serr("no devices found in %s\n", dev_list_fn);
+        ret = SG_LIB_SYNTAX_ERROR;
+        goto fini;
+    }
+    start_usecs = sg_get_monotonic_usecs();
+    num_thr = mdev_run(msp, 0, num_devs);
+    elapsed_usecs = sg_get_monotonic_usecs() - start_usecs;
+
+    printf("Download (mode=0x%x, %d bytes%s) to %d devices:\n", msp->mode,
+           msp->img_len, (msp->dry_run ? ", dry run" : ""), num_devs);
+    for (k = 0, mep = msp->dev_arr; k < num_devs; ++k, ++mep) {
+        if (0 == mep->dl_res) {
+            ++num_good;
+            snprintf(b, sizeof(b), "good");
+        } else {
+            sg_get_category_sense_str(mep->dl_res, sizeof(b), b, msp->vb);
+            if (0 == ret)
+                ret = mep->dl_res;
+        }
+        num_ua += mep->ua_retries;
+        printf("  %s: %s", mep->dev_name, b);
+        if (mep->dl_res)
+            printf(" after %d bytes", mep->bytes_sent);
+        if (mep->rev_before[0])
+            printf(" [rev: %s]", mep->rev_before);
+        printf(" (%" PRId64 ".%03d ms)\n", mep->dl_usecs / 1000,
+               (int)(mep->dl_usecs % 1000));
+    }
+    printf("Summary: %d good, %d failed, %d Unit Attentions retried; %d "
+           "worker%s\n", num_good, num_devs - num_good, num_ua, num_thr,
+           ((1 == num_thr) ? "" : "s"));
+    if (elapsed_usecs > 0)
+        printf("  time to complete: %" PRId64 ".%06d seconds\n",
+               elapsed_usecs / 1000000, (int)(elapsed_usecs % 1000000));
+    if ((! msp->activate) || (0 == num_good))
+        goto fini;
+
+    msp->activating = true;
+    wave_sz = (msp->wave_sz > 0) ? msp->wave_sz : num_devs;
+    for (k = 0, j = 0; k < num_devs; k = end, ++j) {
+        int w_good = 0;
+        int w_num = 0;
+
+        if ((k > 0) && (msp->wave_secs > 0))
+            sg_sleep_secs(msp->wave_secs);
+        end = ((k + wave_sz) < num_devs) ? (k + wave_sz) : num_devs;
+        mdev_run(msp, k, end);
+        printf("Activation wave %d:\n", j + 1);
+        for (mep = msp->dev_arr + k; mep < msp->dev_arr + end; ++mep) {
+            if (mep->dl_res)
+                continue;       /* download failed so not activated */
+            ++w_num;
+            if (0 == mep->act_res) {
+                ++w_good;
+                snprintf(b, sizeof(b), "activated");
+            } else if (mep->rev_mismatch)
+                snprintf(b, sizeof(b), "revision %s, expected %s",
+                         mep->rev_after, msp->revision);
+            else
+                sg_get_category_sense_str(mep->act_res, sizeof(b), b,
+                                          msp->vb);
+            printf("  %s: %s", mep->dev_name, b);
+            if (mep->rev_after[0] && (! mep->rev_mismatch))
+                printf(" [rev: %s]", mep->rev_after);
+            printf(" (%" PRId64 ".%03d ms)\n", mep->act_usecs / 1000,
+                   (int)(mep->act_usecs % 1000));
+            if (mep->act_res && (0 == ret))
+                ret = mep->act_res;
+        }
+        num_act += w_good;
+        if (w_good < w_num) {
+            end = num_devs;
+            printf("  wave failed, later waves not started\n");
+        }
+    }
+    printf("Activated: %d of %d downloaded\n", num_act, num_good);
+fini:
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&msp->mutex);
+#endif
+    for (k = 0; k < num_devs; ++k)
+        free(msp->dev_arr[k].dev_name);
+    free(msp->dev_arr);
+    msp->dev_arr = NULL;
+    return ret;
+}
+
 
 int
 main(int argc, char * argv[])
@@ -199,6 +702,7 @@ main(int argc, char * argv[])
     bool verbose_given = false;
     bool version_given = false;
     bool wb_len_given = false;
+    bool wave_given = false;
     int infd, res, c, len, k, n;
     int sg_fd = -1;
     int bpw = 0;
@@ -213,20 +717,25 @@ main(int argc, char * argv[])
     int wb_timeout = DEF_PT_TIMEOUT;
     int wb_mspec = 0;
     const char * device_name = NULL;
+    const char * dev_list_fn = NULL;
     const char * file_name = NULL;
     uint8_t * dop = NULL;
     uint8_t * read_buf = NULL;
     uint8_t * free_dop = NULL;
     char * cp;
     const struct mode_s * mp;
+    struct mdev_state_t ms;
+    struct mdev_state_t * msp = &ms;
     char ebuff[EBUFF_SZ];
 
+    memset(msp, 0, sizeof(*msp));
+    msp->num_threads = DEF_NUM_THREADS;
     if (getenv("SG3_UTILS_INVOCATION"))
         sg_rep_invocation(my_name, version_str, argc, argv, stderr);
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "b:dhi:I:l:m:o:rs:S:t:vV", long_options,
+        c = getopt_long(argc, argv, "b:dD:hi:I:l:m:o:rR:s:S:t:T:vVw:y", long_options,
                         &option_index);
         if (c == -1)
             break;
@@ -247,6 +756,9 @@ main(int argc, char * argv[])
         case 'd':
             dry_run = true;
             break;
+        case 'D':
+            dev_list_fn = optarg;
+            break;
         case 'h':
         case '?':
             ++do_help;
@@ -302,6 +814,15 @@ main(int argc, char * argv[])
         case 'r':       /* --read-stdin and --raw (previous name) */
             file_name = "-";
             break;
+        case 'R':
+            if ((strlen(optarg) < 1) || (strlen(optarg) > 4)) {
+                pr2serr("argument to '--revision=' should be 1 to 4 "
+                        "characters\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            msp->revision = optarg;
+            msp->verify = true;
+            break;
         case 's':
            wb_skip = sg_get_num(optarg);
            if (wb_skip < 0) {
@@ -323,6 +844,15 @@ main(int argc, char * argv[])
                 return SG_LIB_SYNTAX_ERROR;
             }
             break;
+        case 'T':
+            msp->num_threads = sg_get_num(optarg);
+            if ((msp->num_threads < 1) ||
+                (msp->num_threads > MX_NUM_THREADS)) {
+                pr2serr("argument to '--threads=' should be 1 to %d\n",
+                        MX_NUM_THREADS);
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
         case 'v':
             verbose_given = true;
             ++verbose;
@@ -330,6 +860,24 @@ main(int argc, char * argv[])
         case 'V':
             version_given = true;
             break;
+        case 'w':
+            msp->wave_sz = sg_get_num(optarg);
+            if (msp->wave_sz < 0) {
+                pr2serr("bad argument to '--wave='\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            if ((cp = strchr(optarg, ','))) {
+                msp->wave_secs = sg_get_num(cp + 1);
+                if (msp->wave_secs < 0) {
+                    pr2serr("bad SECS in '--wave=WS,SECS'\n");
+                    return SG_LIB_SYNTAX_ERROR;
+                }
+            }
+            wave_given = true;
+            break;
+        case 'y':
+            msp->verify = true;
+            break;
         default:
             pr2serr("unrecognised option code 0x%x ??\n", c);
             usage();
@@ -379,6 +927,46 @@ main(int argc, char * argv[])
         return 0;
     }
 
+    if (dev_list_fn) {
+        if (device_name) {
+            pr2serr("give either --dev-list=FN or DEVICE, not both\n");
+            return SG_LIB_CONTRADICT;
+        }
+        if ((MODE_DNLD_MC_EV_OFFS_DEFER != wb_mode) &&
+            (MODE_DNLD_MC_OFFS_DEFER != wb_mode)) {
+            pr2serr("--dev-list=FN needs a deferred download mode: "
+                    "dmc_offs_ev_defer [0xd] or dmc_offs_defer [0xe]\n");
+            return SG_LIB_CONTRADICT;
+        }
+        if ((NULL == file_name) || (0 == strcmp(file_name, "-"))) {
+            pr2serr("--dev-list=FN needs --in=FILE naming a regular "
+                    "file\n");
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        msp->dry_run = dry_run;
+        msp->activate = bpw_then_activate || wave_given;
+        msp->mode = wb_mode;
+        msp->mspec = wb_mspec;
+        msp->id = wb_id;
+        msp->offset = wb_offset;
+        msp->bpw = bpw;
+        msp->timeout = wb_timeout;
+        msp->vb = verbose;
+        ret = mdev_load_image(msp, file_name, wb_skip, wb_len);
+        if (0 == ret)
+            ret = mdev_work(msp, dev_list_fn);
+#ifndef SG_LIB_WIN32
+        if (msp->map_p)
+            munmap(msp->map_p, msp->map_len);
+#endif
+        if (msp->free_img_buf)
+            free(msp->free_img_buf);
+        goto err_out;
+    }
+    if (wave_given || msp->verify) {
+        pr2serr("--wave=, --verify and --revision= need --dev-list=FN\n");
+        return SG_LIB_CONTRADICT;
+    }
     if (NULL == device_name) {
         pr2serr("Missing device name!\n\n");
         usage();
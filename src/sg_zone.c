@@ -15,6 +15,8 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
 #include <getopt.h>
 #define __STDC_FORMAT_MACROS 1
 #include <inttypes.h>
@@ -23,10 +25,15 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "sg_lib.h"
 #include "sg_lib_data.h"
 #include "sg_pt.h"
 #include "sg_cmds_basic.h"
+#include "sg_cmds_extra.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
@@ -37,35 +44,60 @@
  *   - FINISH ZONE
  *   - OPEN ZONE
  *   - REMOVE ELEMENT AND MODIFY ZONES
+ *   - RESET WRITE POINTER
  *   - SEQUENTIALIZE ZONE
+ * either once, or in batch mode on each zone selected from REPORT ZONES.
  */
 
-static const char * version_str = "1.21 20230623";
+static const char * version_str = "1.23 20261018";
 
-#define SG_ZONING_OUT_CMDLEN 16
 #define CLOSE_ZONE_SA 0x1
 #define FINISH_ZONE_SA 0x2
 #define OPEN_ZONE_SA 0x3
+#define RESET_WRITE_POINTER_SA 0x4
 #define SEQUENTIALIZE_ZONE_SA 0x10
 #define REM_ELEM_MOD_ZONES_SA 0x1a      /* uses SERVICE ACTION IN(16) */
+#define REPORT_REALMS_SA 0x6            /* ZONING IN */
+
+/* zone types and conditions in REPORT ZONES zone descriptors */
+#define ZT_CONVENTIONAL 0x1
+#define ZT_SWR 0x2              /* sequential write required */
+#define ZT_SWP 0x3              /* sequential write preferred */
+#define ZT_SOBR 0x4             /* sequential or before required */
+#define ZT_GAP 0x5
+#define ZC_EMPTY 0x1
+#define ZC_IMP_OPEN 0x2
+#define ZC_EXP_OPEN 0x3
+#define ZC_CLOSED 0x4
+#define ZC_INACTIVE 0x5
+#define ZC_READ_ONLY 0xd
+#define ZC_FULL 0xe
+#define ZC_OFFLINE 0xf
 
-#define SENSE_BUFF_LEN 64       /* Arbitrary, could be larger */
 #define DEF_PT_TIMEOUT  60      /* 60 seconds */
+#define DEF_NUM_THREADS 4       /* batch mode: ZONE OUT commands in flight */
 
 
 static const struct option long_options[] = {
     {"all", no_argument, 0, 'a'},
     {"close", no_argument, 0, 'c'},
     {"count", required_argument, 0, 'C'},
+    {"dry-run", no_argument, 0, 'd'},
+    {"dry_run", no_argument, 0, 'd'},
     {"element", required_argument, 0, 'e'},
     {"finish", no_argument, 0, 'f'},
     {"help", no_argument, 0, 'h'},
+    {"in", required_argument, 0, 'i'},
     {"open", no_argument, 0, 'o'},
     {"quick", no_argument, 0, 'q'},
+    {"realm", required_argument, 0, 'm'},
     {"remove", no_argument, 0, 'r'},
+    {"reset", no_argument, 0, 'w'},
     {"reset-all", no_argument, 0, 'R'},     /* same as --all */
     {"reset_all", no_argument, 0, 'R'},
+    {"select", required_argument, 0, 's'},
     {"sequentialize", no_argument, 0, 'S'},
+    {"threads", required_argument, 0, 'T'},
     {"timeout", required_argument, 0, 't'},
     {"tmo", required_argument, 0, 't'},
     {"verbose", no_argument, 0, 'v'},
@@ -80,7 +112,8 @@ static const char * sa_name_arr[] = {
     "Close zone",
     "Finish zone",
     "Open zone",
-    "-", "-", "-", "-",
+    "Reset write pointer",
+    "-", "-", "-",
     "-",
     "-", "-", "-", "-",
     "-",
@@ -98,101 +131,630 @@ static void
 usage()
 {
     pr2serr("Usage: "
-            "sg_zone  [--all] [--close] [--count=ZC] [--element=EID] "
-            "[--finish]\n"
-            "                [--help] [--open] [--quick] [--remove] "
-            "[--sequentialize]\n"
-            "                [--timeout=SE] [--verbose] [--version] "
-            "[--zone=ID]\n"
-            "                DEVICE\n");
+            "sg_zone  [--all] [--close] [--count=ZC] [--dry-run] "
+            "[--element=EID]\n"
+            "                [--finish] [--help] [--in=FN] [--open] "
+            "[--quick]\n"
+            "                [--realm=RN] [--remove] [--reset] "
+            "[--select=SEL]\n"
+            "                [--sequentialize] [--threads=NT] "
+            "[--timeout=SE]\n"
+            "                [--verbose] [--version] [--zone=ID] DEVICE\n");
     pr2serr("  where:\n"
             "    --all|-a           sets the ALL flag in the cdb\n"
             "    --close|-c         issue CLOSE ZONE command\n"
-            "    --count=ZC|-C ZC    set zone count field (def: 0)\n"
+            "    --count=ZC|-C ZC    set zone count field (def: 0); in "
+            "batch mode\n"
+            "                        the most zones per command (def: "
+            "65535)\n"
+            "    --dry-run|-d       batch mode: list the zones selected, "
+            "don't act\n"
             "    --element=EID|-e EID    EID is the element identifier to "
             "remove;\n"
             "                            default is 0 which is an invalid "
             "EID\n"
             "    --finish|-f        issue FINISH ZONE command\n"
             "    --help|-h          print out usage message\n"
+            "    --in=FN|-i FN      batch mode: act on zone IDs read from "
+            "file FN\n"
             "    --open|-o          issue OPEN ZONE command\n"
             "    --quick|-q         bypass 15 second warn and wait "
             "(for --remove)\n"
+            "    --realm=RN|-m RN    batch mode: act on zones in realm RN's "
+            "active\n"
+            "                        zone domain\n"
             "    --remove|-r        issue REMOVE ELEMENT AND MODIFY ZONES "
             "command\n"
+            "    --reset|-w         issue RESET WRITE POINTER command\n"
+            "    --select=SEL|-s SEL    batch mode: act on zones that match "
+            "SEL, a\n"
+            "                           comma separated list of: any, "
+            "closed, empty,\n"
+            "                           eopen, full, iopen, open, rwp, "
+            "sobr, swp, swr\n"
             "    --sequentialize|-S    issue SEQUENTIALIZE ZONE command\n"
+            "    --threads=NT|-T NT    batch mode: commands in flight (def: "
+            "4)\n"
             "    --timeout=SE|-t SE    command timeout in seconds (def: "
             "60 secs)\n"
             "    --verbose|-v       increase verbosity\n"
             "    --version|-V       print version string and exit\n"
             "    --zone=ID|-z ID    ID is the starting LBA of the zone "
-            "(def: 0)\n\n"
+            "(def: 0); in\n"
+            "                       batch mode where REPORT ZONES starts\n\n"
             "Performs a SCSI OPEN ZONE, CLOSE ZONE, FINISH ZONE, "
-            "REMOVE ELEMENT AND\nMODIFY ZONES or SEQUENTIALIZE ZONE "
-            "command. Either --close, --finish,\n--open, --remove or "
-            "--sequentialize option needs to be given.\n");
+            "REMOVE ELEMENT AND\nMODIFY ZONES, RESET WRITE POINTER or "
+            "SEQUENTIALIZE ZONE command. One\nof --close, --finish, "
+            "--open, --remove, --reset or --sequentialize\nneeds to be "
+            "given. If --in=FN, --realm=RN or --select=SEL is given\nthen "
+            "the command is sent to each selected zone (batch mode).\n");
 }
 
-/* Invokes the zone out command indicated by 'sa' (ZBC).  Return of 0
- * -> success, various SG_LIB_CAT_* positive values or -1 -> other errors */
+
+/* Zone selection and state for the batch mode (i.e. when --select=SEL,
+ * --in=FN or --realm=RN is given) */
+struct zb_sel_t {
+    const char * name;
+    int cond;           /* zone condition (ZC_*), -1 for none */
+    int type;           /* zone type (ZT_*), -1 for none */
+    int rep_opt;        /* REPORT ZONES reporting option for cond, or 0 */
+};
+
+static const struct zb_sel_t zb_sel_arr[] = {
+    {"empty", ZC_EMPTY, -1, 0x1},
+    {"iopen", ZC_IMP_OPEN, -1, 0x2},
+    {"eopen", ZC_EXP_OPEN, -1, 0x3},
+    {"closed", ZC_CLOSED, -1, 0x4},
+    {"full", ZC_FULL, -1, 0x5},
+    {"swr", -1, ZT_SWR, 0},
+    {"swp", -1, ZT_SWP, 0},
+    {"sobr", -1, ZT_SOBR, 0},
+    {NULL, -1, -1, 0},
+};
+
+/* A run of adjacent zones, of the same type and length, that one ZONE OUT
+ * command with a zone count acts on */
+struct zb_run_t {
+    uint64_t zid;       /* starting LBA of first zone */
+    uint64_t zlen;      /* length of each zone in LBs */
+    int count;          /* number of zones in run */
+    int type;
+    int res;            /* 0 for success, else SG_LIB_CAT_* */
+    int num_cmds;       /* ZONE OUT commands sent for this run */
+};
+
+/* Shared by all worker threads in the batch mode. Each worker takes the
+ * next unvisited run (next_run) until none are left. */
+struct zb_state_t {
+    bool rwp;           /* 'rwp' selected: RWP Recommended set */
+    bool any_zc_cmd;    /* a command with a zone count > 1 has succeeded */
+    bool no_zc;         /* device rejected zone count, send one per zone */
+    int sa;             /* ZONE OUT service action */
+    int sg_fd;
+    int tmo;
+    int verbose;
+    int max_zc;         /* --count=ZC or 0xffff */
+    int cond_mask;      /* bit (1 << ZC_*) for each selected condition */
+    int type_mask;      /* bit (1 << ZT_*) for each selected type */
+    int rep_opt;        /* REPORT ZONES reporting option */
+    int num_runs;
+    int mx_runs;
+    int next_run;       /* protected by mutex when threads are used */
+    int num_skipped;    /* selected zones in a condition sa can't act on */
+    int num_list;       /* zone IDs from --in=FN */
+    int num_list_miss;  /* ... that are not the start of a zone */
+    uint64_t st_lba;    /* first LBA looked at */
+    uint64_t end_lba;   /* one past the last LBA looked at */
+    uint64_t * list;    /* sorted zone IDs from --in=FN, or NULL */
+    struct zb_run_t * run_arr;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
+
+
+/* Decodes the comma separated SEL list of zone conditions and types given
+ * to --select=SEL. Returns 0 if successful. */
 static int
-sg_ll_zone_out(int sg_fd, int sa, uint64_t zid, uint16_t zc, bool all,
-               int tmo, bool noisy, int verbose)
+zb_decode_sel(const char * arg, struct zb_state_t * zbp)
 {
-    int ret, res, sense_cat;
-    struct sg_pt_base * ptvp;
-    uint8_t zo_cdb[SG_ZONING_OUT_CMDLEN] =
-          {SG_ZONING_OUT, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  0, 0, 0, 0};
-    uint8_t sense_b[SENSE_BUFF_LEN] SG_C_CPP_ZERO_INIT;
-    char b[64];
-
-    zo_cdb[1] = 0x1f & sa;
-    if (REM_ELEM_MOD_ZONES_SA == sa) {  /* zid carries element identifier */
-        zo_cdb[0] = SG_SERVICE_ACTION_IN_16;    /* N.B. changing opcode */
-        sg_put_unaligned_be32((uint32_t)zid, zo_cdb + 10); /* element id */
-    } else {
-        sg_put_unaligned_be64(zid, zo_cdb + 2);
-        sg_put_unaligned_be16(zc, zo_cdb + 12);
-        if (all)
-            zo_cdb[14] = 0x1;
+    int k, n, num_cond;
+    const char * cp;
+    const char * np;
+    const struct zb_sel_t * selp;
+
+    for (cp = arg; cp && *cp; cp = np ? (np + 1) : NULL) {
+        np = strchr(cp, ',');
+        n = np ? (int)(np - cp) : (int)strlen(cp);
+        if (0 == n)
+            continue;
+        if ((3 == n) && (0 == strncmp(cp, "any", 3)))
+            continue;
+        if ((3 == n) && (0 == strncmp(cp, "rwp", 3))) {
+            zbp->rwp = true;
+            continue;
+        }
+        if ((4 == n) && (0 == strncmp(cp, "open", 4))) {
+            zbp->cond_mask |= (1 << ZC_IMP_OPEN) | (1 << ZC_EXP_OPEN);
+            continue;
+        }
+        for (selp = zb_sel_arr; selp->name; ++selp) {
+            if ((n == (int)strlen(selp->name)) &&
+                (0 == strncmp(cp, selp->name, n)))
+                break;
+        }
+        if (NULL == selp->name) {
+            pr2serr("--select=: unknown zone condition or type: %.*s\n", n,
+                    cp);
+            return SG_LIB_SYNTAX_ERROR;
+        }
+        if (selp->cond >= 0)
+            zbp->cond_mask |= (1 << selp->cond);
+        else
+            zbp->type_mask |= (1 << selp->type);
     }
-    sg_get_opcode_sa_name(zo_cdb[0], sa, -1, sizeof(b), b);
-    if (verbose) {
-        char d[128];
+    /* let the device filter on condition when only one is selected */
+    for (k = 0, num_cond = 0, selp = zb_sel_arr; selp->name; ++selp) {
+        if ((selp->cond >= 0) && (zbp->cond_mask & (1 << selp->cond))) {
+            ++num_cond;
+            k = selp->rep_opt;
+        }
+    }
+    if (1 == num_cond)
+        zbp->rep_opt = k;
+    else if ((0 == num_cond) && zbp->rwp)
+        zbp->rep_opt = 0x10;    /* RWP Recommended */
+    return 0;
+}
 
-        pr2serr("    %s cdb: %s\n", b,
-                sg_get_command_str(zo_cdb, SG_ZONING_OUT_CMDLEN,
-                                   false, sizeof(d), d));
+static int
+zb_cmp_lba(const void * ap, const void * bp)
+{
+    uint64_t a = *(const uint64_t *)ap;
+    uint64_t b = *(const uint64_t *)bp;
+
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+/* Reads zone IDs (starting LBAs) from fnp ('-' for stdin). Numbers are
+ * separated by whitespace or commas; '#' starts a comment that runs to the
+ * end of the line. The IDs are sorted with duplicates removed. Returns 0 if
+ * successful. */
+static int
+zb_read_list(const char * fnp, struct zb_state_t * zbp)
+{
+    bool have_stdin;
+    int k, n;
+    int mx_num = 0;
+    int64_t ll;
+    char * cp;
+    char * np;
+    uint64_t * t_arr;
+    FILE * fp;
+    char line[1024];
+
+    have_stdin = ((1 == strlen(fnp)) && ('-' == fnp[0]));
+    if (have_stdin)
+        fp = stdin;
+    else {
+        fp = fopen(fnp, "r");
+        if (NULL == fp) {
+            k = errno;
+            pr2serr("%s: unable to open %s: %s\n", __func__, fnp,
+                    safe_strerror(k));
+            return sg_convert_errno(k);
+        }
     }
+    while (fgets(line, sizeof(line), fp)) {
+        cp = strchr(line, '#');
+        if (cp)
+            *cp = '\0';
+        for (cp = line; cp; cp = np) {
+            cp += strspn(cp, " \t\r\n,");
+            if ('\0' == *cp)
+                break;
+            np = cp + strcspn(cp, " \t\r\n,");
+            if ('\0' == *np)
+                np = NULL;
+            else
+                *np++ = '\0';
+            ll = sg_get_llnum(cp);
+            if (ll < 0) {
+                pr2serr("%s: bad zone ID: %s\n", __func__, cp);
+                goto bad;
+            }
+            if (zbp->num_list >= mx_num) {
+                mx_num = mx_num ? (2 * mx_num) : 256;
+                t_arr = (uint64_t *)realloc(zbp->list, mx_num *
+                                            sizeof(uint64_t));
+                if (NULL == t_arr) {
+                    pr2serr("%s: out of memory\n", __func__);
+                    goto bad;
+                }
+                zbp->list = t_arr;
+            }
+            zbp->list[zbp->num_list++] = (uint64_t)ll;
+        }
+    }
+    if (! have_stdin)
+        fclose(fp);
+    if (zbp->num_list > 1) {
+        qsort(zbp->list, zbp->num_list, sizeof(uint64_t), zb_cmp_lba);
+        for (k = 1, n = 1; k < zbp->num_list; ++k) {
+            if (zbp->list[k] != zbp->list[n - 1])
+                zbp->list[n++] = zbp->list[k];
+        }
+        zbp->num_list = n;
+    }
+    return 0;
+bad:
+    if (! have_stdin)
+        fclose(fp);
+    return SG_LIB_SYNTAX_ERROR;
+}
 
-    ptvp = construct_scsi_pt_obj();
-    if (NULL == ptvp) {
-        pr2serr("%s: out of memory\n", b);
-        return -1;
+/* Sets the LBA range to look at to that of realm 'realm_id' in its active
+ * zone domain, found with REPORT REALMS. Zones of the realm in its other
+ * (inactive) zone domains can not be acted on. Returns 0 if successful. */
+static int
+zb_realm_range(struct zb_state_t * zbp, uint32_t realm_id)
+{
+    int res, resid, rlen, k, r_desc_len, num, dom;
+    const int mx_resp = 256 * 1024;
+    uint64_t loc, nr_loc, st, end;
+    uint8_t * rBuff;
+    uint8_t * free_rBuff = NULL;
+    const uint8_t * bp;
+    char b[80];
+
+    rBuff = sg_memalign(mx_resp, 0, &free_rBuff, false);
+    if (NULL == rBuff)
+        return sg_convert_errno(ENOMEM);
+    for (loc = 0; ; loc = nr_loc) {
+        res = sg_ll_zoning_in(zbp->sg_fd, REPORT_REALMS_SA, loc, false, 0,
+                              rBuff, mx_resp, &resid, true, zbp->verbose);
+        if (res) {
+            sg_get_category_sense_str(res, sizeof(b), b, zbp->verbose);
+            pr2serr("Report realms command: %s\n", b);
+            goto fini;
+        }
+        rlen = mx_resp - resid;
+        r_desc_len = (rlen >= 64) ? (int)sg_get_unaligned_be32(rBuff + 8) :
+                                    0;
+        if (r_desc_len < 32)
+            break;
+        num = (rlen - 64) / r_desc_len;
+        for (k = 0, bp = rBuff + 64; k < num; ++k, bp += r_desc_len) {
+            if (sg_get_unaligned_be32(bp + 0) != realm_id)
+                continue;
+            dom = bp[7];        /* active zone domain id */
+            if ((16 + (16 * (dom + 1))) > r_desc_len) {
+                pr2serr("realm %u: active zone domain %d has no start/end "
+                        "descriptor\n", realm_id, dom);
+                res = SG_LIB_CAT_MALFORMED;
+                goto fini;
+            }
+            st = sg_get_unaligned_be64(bp + 16 + (16 * dom));
+            end = sg_get_unaligned_be64(bp + 24 + (16 * dom)) + 1;
+            if (st > zbp->st_lba)
+                zbp->st_lba = st;
+            zbp->end_lba = end;
+            if (zbp->verbose)
+                pr2serr("realm %u, active zone domain %d: LBAs 0x%" PRIx64
+                        " to 0x%" PRIx64 "\n", realm_id, dom, st, end - 1);
+            goto fini;
+        }
+        nr_loc = sg_get_unaligned_be64(rBuff + 12);
+        if ((0 == num) || (nr_loc <= loc))
+            break;
     }
-    set_scsi_pt_cdb(ptvp, zo_cdb, sizeof(zo_cdb));
-    set_scsi_pt_sense(ptvp, sense_b, sizeof(sense_b));
-    res = do_scsi_pt(ptvp, sg_fd, tmo, verbose);
-    ret = sg_cmds_process_resp(ptvp, b, res, noisy,
-                               verbose, &sense_cat);
-    if (-1 == ret) {
-        if (get_scsi_pt_transport_err(ptvp))
-            ret = SG_LIB_TRANSPORT_ERROR;
-        else
-            ret = sg_convert_errno(get_scsi_pt_os_err(ptvp));
-    } else if (-2 == ret) {
-        switch (sense_cat) {
-        case SG_LIB_CAT_RECOVERED:
-        case SG_LIB_CAT_NO_SENSE:
-            ret = 0;
+    pr2serr("realm %u not found\n", realm_id);
+    res = SG_LIB_CAT_OTHER;
+fini:
+    free(free_rBuff);
+    return res;
+}
+
+/* Can ZONE OUT service action 'sa' change a zone of this condition? For
+ * example resetting the write pointer of an empty zone does nothing. */
+static bool
+zb_actionable(int sa, int cond)
+{
+    switch (cond) {
+    case ZC_INACTIVE:
+    case ZC_READ_ONLY:
+    case ZC_OFFLINE:
+        return false;
+    default:
+        break;
+    }
+    switch (sa) {
+    case RESET_WRITE_POINTER_SA:
+        return (ZC_EMPTY != cond);
+    case FINISH_ZONE_SA:
+        return (ZC_FULL != cond);
+    case OPEN_ZONE_SA:
+        return (ZC_EXP_OPEN != cond) && (ZC_FULL != cond);
+    case CLOSE_ZONE_SA:
+        return (ZC_IMP_OPEN == cond) || (ZC_EXP_OPEN == cond);
+    default:
+        return true;
+    }
+}
+
+/* Adds a zone to the last run if adjacent and alike, else starts a new
+ * run. Returns 0 if successful. */
+static int
+zb_add_zone(struct zb_state_t * zbp, uint64_t zs, uint64_t zlen, int type)
+{
+    struct zb_run_t * rp;
+
+    if (zbp->num_runs > 0) {
+        rp = zbp->run_arr + zbp->num_runs - 1;
+        if ((rp->count < zbp->max_zc) && (type == rp->type) &&
+            (zlen == rp->zlen) && (zs == rp->zid + (rp->count * zlen))) {
+            ++rp->count;
+            return 0;
+        }
+    }
+    if (zbp->num_runs >= zbp->mx_runs) {
+        zbp->mx_runs = zbp->mx_runs ? (2 * zbp->mx_runs) : 1024;
+        rp = (struct zb_run_t *)realloc(zbp->run_arr, zbp->mx_runs *
+                                        sizeof(*rp));
+        if (NULL == rp) {
+            pr2serr("%s: out of memory\n", __func__);
+            return sg_convert_errno(ENOMEM);
+        }
+        zbp->run_arr = rp;
+    }
+    rp = zbp->run_arr + zbp->num_runs++;
+    memset(rp, 0, sizeof(*rp));
+    rp->zid = zs;
+    rp->zlen = zlen;
+    rp->count = 1;
+    rp->type = type;
+    return 0;
+}
+
+/* Walks the zones from zbp->st_lba with REPORT ZONES and collects those
+ * selected into runs. With --in=FN it skips ahead to the next listed zone
+ * ID rather than reading every zone descriptor in between. Returns 0 if
+ * successful. */
+static int
+zb_scan(struct zb_state_t * zbp)
+{
+    bool sel;
+    int k, res, resid, rlen, num_zd, type, cond;
+    int li = 0;
+    const int mx_resp = 64 * 1024;
+    uint64_t lba, zs, zlen, mx_lba;
+    uint8_t * rzBuff;
+    uint8_t * free_rzBuff = NULL;
+    const uint8_t * bp;
+    char b[80];
+
+    rzBuff = sg_memalign(mx_resp, 0, &free_rzBuff, false);
+    if (NULL == rzBuff)
+        return sg_convert_errno(ENOMEM);
+    res = 0;
+    for (lba = zbp->st_lba; lba < zbp->end_lba; ) {
+        if (zbp->list) {
+            while ((li < zbp->num_list) && (zbp->list[li] < lba)) {
+                ++li;
+                ++zbp->num_list_miss;
+            }
+            if (li >= zbp->num_list)
+                break;
+            lba = zbp->list[li];    /* skip to next listed zone */
+            if (lba >= zbp->end_lba)
+                break;
+        }
+        res = sg_ll_report_zones(zbp->sg_fd, lba, true, zbp->rep_opt,
+                                 rzBuff, mx_resp, &resid, true,
+                                 (zbp->verbose > 1) ? zbp->verbose - 1 : 0);
+        if (res) {
+            sg_get_category_sense_str(res, sizeof(b), b, zbp->verbose);
+            pr2serr("Report zones command: %s\n", b);
             break;
-        default:
-            ret = sense_cat;
+        }
+        rlen = mx_resp - resid;
+        num_zd = (rlen > 64) ? ((rlen - 64) / 64) : 0;
+        if (0 == num_zd)
             break;
+        mx_lba = sg_get_unaligned_be64(rzBuff + 8);
+        for (k = 0, bp = rzBuff + 64; k < num_zd; ++k, bp += 64) {
+            type = bp[0] & 0xf;
+            cond = (bp[1] >> 4) & 0xf;
+            zlen = sg_get_unaligned_be64(bp + 8);
+            zs = sg_get_unaligned_be64(bp + 16);
+            if ((zs >= zbp->end_lba) || (0 == zlen))
+                break;
+            lba = zs + zlen;
+            sel = ((0 == zbp->cond_mask) || (zbp->cond_mask & (1 << cond)))
+                  && ((0 == zbp->type_mask) ||
+                      (zbp->type_mask & (1 << type))) &&
+                  ((! zbp->rwp) || (bp[1] & 0x1));
+            if (zbp->list) {
+                while ((li < zbp->num_list) && (zbp->list[li] < zs)) {
+                    ++li;
+                    ++zbp->num_list_miss;
+                }
+                if ((li >= zbp->num_list) || (zbp->list[li] != zs))
+                    sel = false;
+                else
+                    ++li;
+            }
+            if (! sel)
+                continue;
+            if ((ZT_CONVENTIONAL == type) || (ZT_GAP == type) ||
+                (! zb_actionable(zbp->sa, cond))) {     /* or no WP */
+                ++zbp->num_skipped;
+                if (zbp->verbose > 1)
+                    pr2serr("  skip zone 0x%" PRIx64 ", type 0x%x, "
+                            "condition 0x%x\n", zs, type, cond);
+                continue;
+            }
+            res = zb_add_zone(zbp, zs, zlen, type);
+            if (res)
+                goto fini;
         }
-    } else
-        ret = 0;
-    destruct_scsi_pt_obj(ptvp);
+        if ((k < num_zd) || (lba > mx_lba))
+            break;      /* beyond end_lba or the last zone */
+    }
+    if (zbp->list && (li < zbp->num_list) && (0 == res))
+        zbp->num_list_miss += zbp->num_list - li;
+fini:
+    free(free_rzBuff);
+    return res;
+}
+
+/* Sends the ZONE OUT command(s) for one run. If the device rejects a zone
+ * count then that run, and all later ones, are done one zone at a time. */
+static void
+zb_one(struct zb_state_t * zbp, struct zb_run_t * rp)
+{
+    bool no_zc, any_zc_cmd;
+    int k, res;
+    int vb = (zbp->verbose > 1) ? zbp->verbose - 1 : 0;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&zbp->mutex);
+#endif
+    no_zc = zbp->no_zc;
+    any_zc_cmd = zbp->any_zc_cmd;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&zbp->mutex);
+#endif
+    if ((rp->count > 1) && (! no_zc)) {
+        res = sg_ll_zone_out(zbp->sg_fd, zbp->sa, rp->zid,
+                             (uint16_t)rp->count, false, zbp->tmo, false, vb);
+        ++rp->num_cmds;
+        if ((SG_LIB_CAT_ILLEGAL_REQ != res) || any_zc_cmd) {
+            rp->res = res;
+#ifdef HAVE_PTHREAD_H
+            pthread_mutex_lock(&zbp->mutex);
+#endif
+            if (0 == res)
+                zbp->any_zc_cmd = true;
+#ifdef HAVE_PTHREAD_H
+            pthread_mutex_unlock(&zbp->mutex);
+#endif
+            return;
+        }
+        /* probably ZBC-1 where the zone count field is reserved */
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&zbp->mutex);
+#endif
+        if ((! zbp->no_zc) && zbp->verbose)
+            pr2serr("zone count rejected, one zone per command from now "
+                    "on\n");
+        zbp->no_zc = true;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&zbp->mutex);
+#endif
+    }
+    for (k = 0, res = 0; (k < rp->count) && (0 == res); ++k, ++rp->num_cmds)
+        res = sg_ll_zone_out(zbp->sg_fd, zbp->sa, rp->zid + (k * rp->zlen),
+                             0, false, zbp->tmo, false, vb);
+    rp->res = res;
+}
+
+/* Worker (thread) function, each takes the next unvisited run until there
+ * are none left. */
+static void *
+zb_worker(void * v_zbp)
+{
+    int k;
+    struct zb_state_t * zbp = (struct zb_state_t *)v_zbp;
+
+    while (true) {
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_lock(&zbp->mutex);
+#endif
+        k = zbp->next_run++;
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_unlock(&zbp->mutex);
+#endif
+        if (k >= zbp->num_runs)
+            break;
+        zb_one(zbp, zbp->run_arr + k);
+    }
+    return NULL;
+}
+
+/* Batch mode: selects zones then sends the ZONE OUT command given by
+ * zbp->sa to them, using up to num_thr concurrent workers. Outputs a line
+ * for each run that failed and a summary with the zones per second
+ * achieved. Returns 0 if all runs succeeded, else the first error. */
+static int
+zb_work(struct zb_state_t * zbp, int num_thr, bool dry_run,
+        const char * sa_name)
+{
+    int k, res;
+    int ret = 0;
+    int num_zones = 0;
+    int num_good = 0;
+    int num_cmds = 0;
+    int64_t start_usecs, elapsed_usecs;
+    struct zb_run_t * rp;
+    char b[80];
+
+    start_usecs = sg_get_monotonic_usecs();
+    res = zb_scan(zbp);
+    if (res)
+        return res;
+    for (k = 0, rp = zbp->run_arr; k < zbp->num_runs; ++k, ++rp)
+        num_zones += rp->count;
+    if (zbp->verbose || dry_run)
+        pr2serr("selected %d zone%s (%d run%s of adjacent zones), skipped "
+                "%d, scan took %" PRId64 " ms\n", num_zones,
+                (1 == num_zones) ? "" : "s", zbp->num_runs,
+                (1 == zbp->num_runs) ? "" : "s", zbp->num_skipped,
+                (sg_get_monotonic_usecs() - start_usecs) / 1000);
+    if (zbp->num_list_miss > 0)
+        pr2serr("%d zone ID%s from --in=FN not the start of a zone in "
+                "range, ignored\n", zbp->num_list_miss,
+                (1 == zbp->num_list_miss) ? "" : "s");
+    if (dry_run) {
+        for (k = 0, rp = zbp->run_arr; k < zbp->num_runs; ++k, ++rp)
+            printf("%s: zone ID=0x%" PRIx64 ", count=%d\n", sa_name,
+                   rp->zid, rp->count);
+        return 0;
+    }
+    if (0 == zbp->num_runs)
+        return 0;
+    if (num_thr > zbp->num_runs)
+        num_thr = zbp->num_runs;
+    start_usecs = sg_get_monotonic_usecs();
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&zbp->mutex, NULL);
+#endif
+    num_thr = sg_run_workers(num_thr, zb_worker, zbp);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&zbp->mutex);
+#endif
+    elapsed_usecs = sg_get_monotonic_usecs() - start_usecs;
+
+    for (k = 0, rp = zbp->run_arr; k < zbp->num_runs; ++k, ++rp) {
+        num_cmds += rp->num_cmds;
+        if (0 == rp->res) {
+            num_good += rp->count;
+            continue;
+        }
+        if (0 == ret)
+            ret = rp->res;
+        sg_get_category_sense_str(rp->res, sizeof(b), b, zbp->verbose);
+        printf("  zone ID=0x%" PRIx64 ", count=%d: %s\n", rp->zid,
+               rp->count, b);
+    }
+    printf("%s: %d of %d zones done with %d command%s", sa_name, num_good,
+           num_zones, num_cmds, (1 == num_cmds) ? "" : "s");
+    if (elapsed_usecs > 0)
+        printf(", %" PRId64 ".%03d secs, %.1f zones/sec\n",
+               elapsed_usecs / 1000000, (int)((elapsed_usecs / 1000) % 1000),
+               (num_good * 1000000.0) / elapsed_usecs);
+    else
+        printf("\n");
     return ret;
 }
 
@@ -201,11 +763,14 @@ int
 main(int argc, char * argv[])
 {
     bool all = false;
+    bool batch;
     bool close = false;
+    bool dry_run = false;
     bool finish = false;
     bool open = false;
     bool quick = false;
     bool reamz = false;
+    bool reset = false;
     bool element_id_given = false;
     bool sequentialize = false;
     bool verbose_given = false;
@@ -216,16 +781,21 @@ main(int argc, char * argv[])
     int verbose = 0;
     int ret = 0;
     int sa = 0;
+    int num_thr = DEF_NUM_THREADS;
     uint16_t zc = 0;
     uint64_t zid = 0;
     int64_t ll;
+    int64_t realm_id = -1;
     const char * device_name = NULL;
+    const char * in_fn = NULL;
+    const char * sel_s = NULL;
     const char * sa_name;
+    struct zb_state_t zb;
 
     while (1) {
         int option_index = 0;
 
-        c = getopt_long(argc, argv, "acC:e:fhoqrRSt:vVz:", long_options,
+        c = getopt_long(argc, argv, "acC:de:fhi:m:oqrRs:St:T:vVwz:", long_options,
                         &option_index);
         if (c == -1)
             break;
@@ -248,6 +818,9 @@ main(int argc, char * argv[])
             }
             zc = (uint16_t)n;
             break;
+        case 'd':
+            dry_run = true;
+            break;
         case 'e':
             ll = sg_get_llnum(optarg);
             if ((ll < 0) || (ll > UINT32_MAX)) {
@@ -267,6 +840,16 @@ main(int argc, char * argv[])
         case '?':
             usage();
             return 0;
+        case 'i':
+            in_fn = optarg;
+            break;
+        case 'm':
+            realm_id = sg_get_llnum(optarg);
+            if ((realm_id < 0) || (realm_id > UINT32_MAX)) {
+                pr2serr("bad argument to '--realm=RN'\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
         case 'o':
             open = true;
             sa = OPEN_ZONE_SA;
@@ -278,6 +861,9 @@ main(int argc, char * argv[])
             reamz = true;
             sa = REM_ELEM_MOD_ZONES_SA;
             break;
+        case 's':
+            sel_s = optarg;
+            break;
         case 'S':
             sequentialize = true;
             sa = SEQUENTIALIZE_ZONE_SA;
@@ -289,6 +875,14 @@ main(int argc, char * argv[])
                 return SG_LIB_SYNTAX_ERROR;
             }
             break;
+        case 'T':
+            num_thr = sg_get_num(optarg);
+            if ((num_thr < 1) || (num_thr > 1024)) {
+                pr2serr("--threads= expects an argument between 1 and "
+                        "1024\n");
+                return SG_LIB_SYNTAX_ERROR;
+            }
+            break;
         case 'v':
             verbose_given = true;
             ++verbose;
@@ -296,6 +890,10 @@ main(int argc, char * argv[])
         case 'V':
             version_given = true;
             break;
+        case 'w':
+            reset = true;
+            sa = RESET_WRITE_POINTER_SA;
+            break;
         case 'z':
             ll = sg_get_llnum(optarg);
             if (-1 == ll) {
@@ -346,10 +944,10 @@ main(int argc, char * argv[])
     }
 
     if (1 != ((int)close + (int)finish + (int)open + (int)sequentialize +
-              (int)reamz)) {
+              (int)reamz + (int)reset)) {
         pr2serr("One, and only one, of these options needs to be given:\n"
-                "   --close, --finish, --open, --remove or --sequentialize "
-                "\n\n");
+                "   --close, --finish, --open, --remove, --reset or "
+                "--sequentialize\n\n");
         usage();
         return SG_LIB_CONTRADICT;
     }
@@ -359,6 +957,25 @@ main(int argc, char * argv[])
         usage();
         return SG_LIB_CONTRADICT;
     }
+    batch = (in_fn || sel_s || (realm_id >= 0));
+    if (batch && (all || reamz)) {
+        pr2serr("--in=FN, --realm=RN and --select=SEL (batch mode) can't "
+                "be used with\n--all or --remove\n\n");
+        usage();
+        return SG_LIB_CONTRADICT;
+    }
+    if (dry_run && (! batch)) {
+        pr2serr("--dry-run only applies to batch mode (e.g. with "
+                "--select=SEL)\n\n");
+        usage();
+        return SG_LIB_CONTRADICT;
+    }
+    memset(&zb, 0, sizeof(zb));
+    if (sel_s) {
+        ret = zb_decode_sel(sel_s, &zb);
+        if (ret)
+            return ret;
+    }
     sa_name = sa_name_arr[sa];
 
     if (0 == tmo)
@@ -381,6 +998,32 @@ main(int argc, char * argv[])
     if (reamz && (! quick))
         sg_warn_and_wait(sa_name_arr[REM_ELEM_MOD_ZONES_SA], device_name,
                          false);
+    if (batch) {
+        zb.sa = sa;
+        zb.sg_fd = sg_fd;
+        zb.tmo = tmo;
+        zb.verbose = verbose;
+        zb.max_zc = zc ? zc : 0xffff;
+        zb.st_lba = zid;
+        zb.end_lba = UINT64_MAX;
+        if (in_fn) {
+            ret = zb_read_list(in_fn, &zb);
+            if (ret)
+                goto fini;
+            if (0 == zb.num_list) {
+                pr2serr("no zone IDs found in %s\n", in_fn);
+                ret = SG_LIB_SYNTAX_ERROR;
+                goto fini;
+            }
+        }
+        if (realm_id >= 0) {
+            ret = zb_realm_range(&zb, (uint32_t)realm_id);
+            if (ret)
+                goto fini;
+        }
+        ret = zb_work(&zb, num_thr, dry_run, sa_name);
+        goto fini;
+    }
 
     res = sg_ll_zone_out(sg_fd, sa, zid, zc, all, tmo, true, verbose);
     ret = res;
@@ -396,6 +1039,8 @@ main(int argc, char * argv[])
     }
 
 fini:
+    free(zb.list);
+    free(zb.run_arr);
     if (sg_fd >= 0) {
         res = sg_cmds_close_device(sg_fd);
         if (res < 0) {
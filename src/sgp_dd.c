@@ -89,12 +89,13 @@
 
 #include "sg_lib.h"
 #include "sg_cmds_basic.h"
+#include "sg_cmds_extra.h"
 #include "sg_io_linux.h"
 #include "sg_unaligned.h"
 #include "sg_pr2serr.h"
 
 
-static const char * version_str = "5.95 20231203";
+static const char * version_str = "5.99 20261018";
 
 #define DEF_BLOCK_SIZE 512
 #define DEF_BLOCKS_PER_TRANSFER 128
@@ -113,6 +114,10 @@ static const char * version_str = "5.95 20231203";
 
 #define SGP_READ10 0x28
 #define SGP_WRITE10 0x2a
+#define WRITE_STREAM16_OP 0x9a
+#define STREAM_CONTROL_OPEN 0x1
+#define STREAM_CONTROL_CLOSE 0x2
+#define STREAM_CONTROL_RESP_LEN 8
 #define DEF_NUM_THREADS 4
 #define MAX_NUM_THREADS 1024  /* was SG_MAX_QUEUE (16) but no longer applies */
 
@@ -136,6 +141,7 @@ static const char * version_str = "5.95 20231203";
 #define SG_FLAG_MMAP_IO 4
 #endif
 
+
 #define STR_SZ 1024
 #define INOUTF_SZ 512
 
@@ -150,6 +156,8 @@ struct flags_t {
     bool excl;
     bool fua;
     bool mmap;
+    bool noshare;
+    bool stream;
 };
 
 struct opts_t
@@ -180,12 +188,34 @@ struct opts_t
     int dio_incomplete_count;
     int sum_of_resids;
     bool mmap_active;
+    bool share_active;  /* READ buffer shared with WRITE, sg v4 driver */
+    bool hugepages;     /* --hugepages: transfer buffers on huge pages */
+    bool numa_auto;     /* --numa=auto: node of the HBA serving IFILE */
+    int numa_node;      /* bind transfer buffers to node, -1 -> don't */
     int chkaddr;        /* check read data contains 4 byte, big endian block
                          * addresses, once: check only 4 bytes per block */
     int progress;       /* --progress or -p, checked in sig_listen_thread */
     int verbose;
     int dry_run;
     int nocopy;
+    /* skip= and/or seek= given as extent lists (sgls). Then in_blk and
+     * out_blk count blocks from the start of the copy and the cursors,
+     * protected by inout_mutex, map them to LBAs */
+    bool sgl_active;
+    int i_sgl_elems;
+    int i_sgl_ind;
+    uint32_t i_sgl_off;
+    int o_sgl_elems;
+    int o_sgl_ind;
+    uint32_t o_sgl_off;
+    int64_t i_sgl_sum;
+    int64_t o_sgl_sum;
+    struct sg_lba_extent * i_sgl;
+    struct sg_lba_extent * o_sgl;
+    /* oflag=stream: one stream per worker thread if the device has enough,
+     * otherwise threads share them round robin */
+    int num_streams;
+    uint16_t str_ids[MAX_NUM_THREADS];
 };
 
 struct thread_arg
@@ -201,12 +231,17 @@ typedef struct request_element
     bool in_err;
     bool out_err;
     bool use_no_dxfer;
+    bool has_share;     /* this thread's infd and outfd are shared */
     int infd;
     int outfd;
     int64_t blk;
+    int64_t in_lba;     /* when sgl_active: LBA to read from */
+    int64_t out_lba;    /* when sgl_active: LBA to write to */
+    int64_t rd_blk;     /* LBA of last READ, for has_share retries */
     int num_blks;
     uint8_t * buffp;
     uint8_t * alloc_bp;
+    uint32_t huge_len;  /* when > 0, buffp from sg_linux_alloc_buf() */
     struct sg_io_hdr io_hdr;
     uint8_t cdb[MAX_SCSI_CDBSZ];
     uint8_t sb[SENSE_BUFF_LEN];
@@ -219,6 +254,7 @@ typedef struct request_element
     struct flags_t out_flags;
     int verbose;
     uint32_t pack_id;
+    uint16_t str_id;    /* when > 0, writes are WRITE STREAM(16) */
 } Rq_elem;
 
 static sigset_t signal_set;
@@ -279,6 +315,7 @@ static pthread_t threads[MAX_NUM_THREADS];
 static struct thread_arg thr_arg_a[MAX_NUM_THREADS];
 
 static bool shutting_down = false;
+static int sg_version = 0;
 static bool do_sync = false;
 static bool do_time = false;
 static bool start_tm_valid = false;
@@ -430,6 +467,74 @@ print_stats(const char * str)
                 outfull - my_opts.out_partial, my_opts.out_partial);
     }
 }
+/* oflag=stream: opens a stream on OFILE for each worker thread. If the
+ * device runs out of streams after the first, threads share the ones
+ * opened. Returns 0 if at least one stream is open. */
+static int
+streams_open(struct opts_t * clp)
+{
+    int k, res, resid;
+    int vb = (clp->verbose > 1) ? (clp->verbose - 1) : 0;
+    uint8_t b[STREAM_CONTROL_RESP_LEN];
+    char e[80];
+
+    for (k = 0, res = 0; k < clp->num_threads; ++k) {
+        memset(b, 0, sizeof(b));
+        resid = 0;
+        res = sg_ll_stream_control(clp->outfd, STREAM_CONTROL_OPEN, 0, b,
+                                   sizeof(b), &resid, (0 == k), vb);
+        if (res)
+            break;
+        if (((int)sizeof(b) - resid) < 6) {
+            res = SG_LIB_CAT_MALFORMED;
+            break;
+        }
+        clp->str_ids[k] = sg_get_unaligned_be16(b + 4);
+        clp->num_streams = k + 1;
+        if (clp->verbose > 1)
+            pr2serr("Opened stream id %u for thread %d\n", clp->str_ids[k],
+                    k);
+    }
+    if (clp->num_streams > 0) {
+        if (clp->num_streams < clp->num_threads)
+            pr2serr("oflag=stream: only %d streams opened, threads will "
+                    "share them\n", clp->num_streams);
+        else if (clp->verbose)
+            pr2serr("Opened %d streams on %s\n", clp->num_streams, outfn);
+        return 0;
+    }
+    if (SG_LIB_CAT_INVALID_OP == res)
+        pr2serr("oflag=stream: %s does not support STREAM CONTROL\n",
+                outfn);
+    else {
+        sg_get_category_sense_str(res, sizeof(e), e, clp->verbose);
+        pr2serr("oflag=stream: Stream control (open): %s\n", e);
+    }
+    return res ? res : SG_LIB_CAT_OTHER;
+}
+
+/* Closes any streams that streams_open() opened. Returns 0 if all closed
+ * successfully. */
+static int
+streams_close(struct opts_t * clp)
+{
+    int k, res;
+    int ret = 0;
+    int vb = (clp->verbose > 1) ? (clp->verbose - 1) : 0;
+    uint8_t b[STREAM_CONTROL_RESP_LEN];
+
+    for (k = clp->num_streams - 1; k >= 0; --k) {
+        res = sg_ll_stream_control(clp->outfd, STREAM_CONTROL_CLOSE,
+                                   clp->str_ids[k], b, sizeof(b), NULL, true,
+                                   vb);
+        if (res) {
+            pr2serr("Unable to close stream id %u\n", clp->str_ids[k]);
+            ret = res;
+        }
+    }
+    clp->num_streams = 0;
+    return ret;
+}
 
 static void
 interrupt_handler(int sig)
@@ -444,6 +549,7 @@ interrupt_handler(int sig)
     if (do_time)
         calc_duration_throughput(false);
     print_stats("");
+    streams_close(&my_opts);
     kill(getpid (), sig);
 }
 
@@ -545,8 +651,9 @@ usage()
             "[deb=VERB] [dio=0|1]\n"
             "               [fua=0|1|2|3] [sync=0|1] [thr=THR] "
             "[time=0|1] [verbose=VERB]\n"
-            "               [--dry-run] [--nocopy] [--progress] "
-            "[--verbose]\n"
+            "               [--dry-run] [--hugepages] [--nocopy] "
+            "[--numa=auto|NODE]\n"
+            "               [--progress] [--verbose]\n"
             "  where:\n"
             "    bpt         is blocks_per_transfer (default is 128)\n"
             "    bs          must be device logical block size (default "
@@ -564,15 +671,20 @@ usage()
             "    if          file or device to read from (def: stdin)\n"
             "    iflag       comma separated list from: [coe,dio,direct,dpo,"
             "dsync,excl,\n"
-            "                fua,mmap,null]\n"
+            "                fua,mmap,noshare,null]\n"
             "    of          file or device to write to (def: stdout), "
             "OFILE of '.'\n"
             "                treated as /dev/null\n"
             "    oflag       comma separated list from: [append,coe,dio,"
             "direct,dpo,\n"
-            "                dsync,excl,fua,mmap,null]\n"
-            "    seek        block position to start writing to OFILE\n"
-            "    skip        block position to start reading from IFILE\n"
+            "                dsync,excl,fua,mmap,noshare,null,stream]\n"
+            "    seek        block position to start writing to OFILE; or "
+            "@SFN (H@SFN\n"
+            "                for hex) or LBA0,NUM0,LBA1,NUM1... is a list "
+            "of extents\n"
+            "    skip        block position to start reading from IFILE; or "
+            "extents\n"
+            "                as for seek=\n"
             "    sync        0->no sync(def), 1->SYNCHRONIZE CACHE on OFILE "
             "after copy\n"
             "    thr         is number of threads, must be > 0, default 4, "
@@ -583,7 +695,11 @@ usage()
             "    --chkaddr|-c    check read data contains blk address\n"
             "    --dry-run|-d    prepare but bypass copy/read\n"
             "    --help|-h      output this usage message then exit\n"
+            "    --hugepages    transfer buffers on huge pages\n"
             "    --nocopy|-n    prevent copy apart to of=/dev/null\n"
+            "    --numa=auto|NODE    bind transfer buffers to NUMA node of "
+            "IFILE's\n"
+            "                        HBA, or to NODE\n"
             "    --progress|-p    outputs progress report every 2 minutes\n"
             "    --verbose|-v   increase verbosity of utility\n"
             "    --version|-V   output version string then exit\n"
@@ -591,6 +707,34 @@ usage()
             "specialized for SCSI devices, uses multiple POSIX threads\n");
 }
 
+/* Makes write_side_fd share the reserve request of read_side_fd. Returns
+ * true if the driver accepted, false (after a message) otherwise. */
+static bool
+sg_share_prepare(int write_side_fd, int read_side_fd, int id, bool vb_b)
+{
+    struct sg_extended_info sei;
+    struct sg_extended_info * seip = &sei;
+
+    memset(seip, 0, sizeof(*seip));
+    seip->sei_wr_mask |= SG_SEIM_SHARE_FD;
+    seip->sei_rd_mask |= SG_SEIM_SHARE_FD;
+    seip->share_fd = read_side_fd;
+    if (ioctl(write_side_fd, SG_SET_GET_EXTENDED, seip) < 0) {
+        int err = errno;
+        char b[STRERR_BUFF_LEN];
+
+        pr2serr("tid=%d: ioctl(EXTENDED(shared_fd=%d)) failed: %s, so "
+                "copy via user space\n", id, read_side_fd,
+                tsafe_strerror(err, b));
+        return false;
+    }
+    if (vb_b)
+        pr2serr("%s: tid=%d: ioctl(EXTENDED(shared_fd)) ok, read_side_fd=%d, "
+                "write_side_fd=%d\n", __func__, id, read_side_fd,
+                write_side_fd);
+    return true;
+}
+
 static int
 sgp_mem_mmap(int fd, int res_sz, uint8_t ** mmpp)
 {
@@ -816,6 +960,56 @@ sg_out_open(const char * fnp, struct flags_t * flagp, int bs, int bpt)
     return fd;
 }
 
+static bool
+sgp_fd_is_fifo(int fd)
+{
+    struct stat a_st;
+
+    return (0 == fstat(fd, &a_st)) && S_ISFIFO(a_st.st_mode);
+}
+
+/* Only called with inout_mutex held when sgl_active. Trims blocks so the
+ * transfer stays within the current extent of each extent list, places
+ * the LBAs to read from and write to in rep, then moves the cursors on. A
+ * side without an extent list is contiguous from skip= (or seek=). Returns
+ * the trimmed number of blocks. */
+static int
+sgl_claim(struct opts_t * clp, Rq_elem * rep, int blocks)
+{
+    const struct sg_lba_extent * i_ep = NULL;
+    const struct sg_lba_extent * o_ep = NULL;
+
+    if (clp->i_sgl) {
+        i_ep = clp->i_sgl + clp->i_sgl_ind;
+        if (blocks > (int64_t)i_ep->num - clp->i_sgl_off)
+            blocks = i_ep->num - clp->i_sgl_off;
+    }
+    if (clp->o_sgl) {
+        o_ep = clp->o_sgl + clp->o_sgl_ind;
+        if (blocks > (int64_t)o_ep->num - clp->o_sgl_off)
+            blocks = o_ep->num - clp->o_sgl_off;
+    }
+    if (i_ep) {
+        rep->in_lba = i_ep->lba + clp->i_sgl_off;
+        clp->i_sgl_off += blocks;
+        if (clp->i_sgl_off >= i_ep->num) {
+            ++clp->i_sgl_ind;
+            clp->i_sgl_off = 0;
+        }
+    } else
+        rep->in_lba = clp->skip + clp->in_blk;
+    if (o_ep) {
+        rep->out_lba = o_ep->lba + clp->o_sgl_off;
+        clp->o_sgl_off += blocks;
+        if (clp->o_sgl_off >= o_ep->num) {
+            ++clp->o_sgl_ind;
+            clp->o_sgl_off = 0;
+        }
+    } else
+        rep->out_lba = clp->seek + clp->in_blk;
+    return blocks;
+}
+
 static void *
 read_write_thread(void * v_tap)
 {
@@ -827,8 +1021,10 @@ read_write_thread(void * v_tap)
     bool enforce_write_ordering;
     int sz, c_addr;
     int64_t out_blk, out_count;
-    int64_t seek_skip = tap->seek_skip;
-    int blocks, status;
+    /* with extent lists out_blk and in_blk both count from 0 */
+    int64_t seek_skip = clp->sgl_active ? 0 : tap->seek_skip;
+    volatile int blocks;    /* may be reduced by sgl_claim() */
+    int status;
 
     stop_after_write = false;
     enforce_write_ordering = (FT_DEV_NULL != clp->out_type) &&
@@ -837,7 +1033,16 @@ read_write_thread(void * v_tap)
     memset(rep, 0, sizeof(*rep));
     /* Following clp members are constant during lifetime of thread */
     rep->bs = clp->bs;
-    if ((clp->num_threads > 1) && clp->mmap_active) {
+    if (clp->share_active) {
+        /* a share binds one read-side fd to one write-side fd and only
+         * has one request in flight, so each thread needs its own pair */
+        rep->infd = sg_in_open(infn, &clp->in_flags, rep->bs, clp->bpt);
+        if (rep->infd < 0) err_exit(-rep->infd, "error opening infn");
+        rep->outfd = sg_out_open(outfn, &clp->out_flags, rep->bs, clp->bpt);
+        if (rep->outfd < 0) err_exit(-rep->outfd, "error opening outfn");
+        rep->has_share = sg_share_prepare(rep->outfd, rep->infd, tap->id,
+                                          clp->verbose > 2);
+    } else if ((clp->num_threads > 1) && clp->mmap_active) {
         /* sg devices need separate file descriptor */
         if (clp->in_flags.mmap && (FT_SG == clp->in_type)) {
             rep->infd = sg_in_open(infn, &clp->in_flags, rep->bs, clp->bpt);
@@ -862,11 +1067,19 @@ read_write_thread(void * v_tap)
     rep->in_flags = clp->in_flags;
     rep->out_flags = clp->out_flags;
     rep->use_no_dxfer = (FT_DEV_NULL == clp->out_type);
+    if (clp->num_streams > 0)
+        rep->str_id = clp->str_ids[tap->id % clp->num_streams];
     if (clp->mmap_active) {
         int fd = clp->in_flags.mmap ? rep->infd : rep->outfd;
 
         status = sgp_mem_mmap(fd, sz, &rep->buffp);
         if (status) err_exit(status, "sgp_mem_mmap() failed");
+    } else if (clp->hugepages || (clp->numa_node >= 0)) {
+        rep->buffp = sg_linux_alloc_buf(sz, clp->hugepages, clp->numa_node,
+                                        &rep->huge_len,
+                                        (0 == tap->id) ? clp->verbose : 0);
+        if (NULL == rep->buffp)
+            err_exit(ENOMEM, "out of memory creating user buffers\n");
     } else {
         rep->buffp = sg_memalign(sz, 0 /* page align */, &rep->alloc_bp,
                                  false);
@@ -891,6 +1104,8 @@ read_write_thread(void * v_tap)
             break;
         }
         blocks = (clp->in_count > clp->bpt) ? clp->bpt : clp->in_count;
+        if (clp->sgl_active)
+            blocks = sgl_claim(clp, rep, blocks);
         rep->wr = false;
         rep->blk = clp->in_blk;
         rep->num_blks = blocks;
@@ -904,6 +1119,9 @@ read_write_thread(void * v_tap)
         clp->out_count -= blocks;
         status = pthread_mutex_unlock(&clp->inout_mutex);
         if (0 != status) err_exit(status, "unlock inout_mutex");
+        if (clp->sgl_active)
+            rep->blk = rep->in_lba;
+        rep->rd_blk = rep->blk;
 
         pthread_cleanup_push(cleanup_in, (void *)clp);
         if (FT_SG == clp->in_type)
@@ -970,7 +1188,7 @@ read_write_thread(void * v_tap)
             break;
 
         rep->wr = true;
-        rep->blk = out_blk;
+        rep->blk = clp->sgl_active ? rep->out_lba : out_blk;
 
         if (0 == rep->num_blks) {
             break;      /* read nothing so leave loop */
@@ -992,6 +1210,12 @@ read_write_thread(void * v_tap)
 
     if (rep->alloc_bp)
         free(rep->alloc_bp);
+    if (rep->huge_len > 0)
+        sg_linux_free_buf(rep->buffp, rep->huge_len);
+    if (clp->share_active) {
+        close(rep->infd);       /* closing either side undoes the share */
+        close(rep->outfd);
+    }
     if (rep->in_err || rep->out_err) {
         stop_after_write = true;
 #ifdef HAVE_C11_ATOMICS
@@ -1012,9 +1236,16 @@ normal_in_operation(struct opts_t * clp, Rq_elem * rep, int blocks)
     int res, status;
     char strerr_buff[STRERR_BUFF_LEN + 1];
 
-    while (((res = read(rep->infd, rep->buffp, blocks * rep->bs)) < 0) &&
-           ((EINTR == errno) || (EAGAIN == errno)))
-        ;
+    if (clp->sgl_active) {  /* extent lists: position each read */
+        while (((res = pread64(rep->infd, rep->buffp, blocks * rep->bs,
+                               (off64_t)rep->blk * rep->bs)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+    } else {
+        while (((res = read(rep->infd, rep->buffp, blocks * rep->bs)) < 0)
+               && ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+    }
     if (res < 0) {
         if (rep->in_flags.coe) {
             memset(rep->buffp, 0, rep->num_blks * rep->bs);
@@ -1062,9 +1293,18 @@ normal_out_operation(struct opts_t * clp, Rq_elem * rep, int blocks,
     int res, status;
     char strerr_buff[STRERR_BUFF_LEN + 1];
 
-    while (((res = write(rep->outfd, rep->buffp, rep->num_blks * rep->bs))
-            < 0) && ((EINTR == errno) || (EAGAIN == errno)))
-        ;
+    if (clp->sgl_active) {  /* extent lists: position each write */
+        while (((res = pwrite64(rep->outfd, rep->buffp,
+                                rep->num_blks * rep->bs,
+                                (off64_t)rep->blk * rep->bs)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+    } else {
+        while (((res = write(rep->outfd, rep->buffp,
+                             rep->num_blks * rep->bs)) < 0) &&
+               ((EINTR == errno) || (EAGAIN == errno)))
+            ;
+    }
     if (res < 0) {
         if (rep->out_flags.coe) {
             pr2serr(">> ignored error for out blk=%" PRId64 " for %d bytes, "
@@ -1096,9 +1336,12 @@ normal_out_operation(struct opts_t * clp, Rq_elem * rep, int blocks,
     if (0 != status) err_exit(status, "lock inout_mutex");
 }
 
+/* When str_id is non-zero a WRITE STREAM(16) is built, cdb_sz must be 16
+ * and write_true set. */
 static int
 sg_build_scsi_cdb(uint8_t * cdbp, int cdb_sz, unsigned int blocks,
-                  int64_t start_block, bool write_true, bool fua, bool dpo)
+                  int64_t start_block, bool write_true, bool fua, bool dpo,
+                  uint16_t str_id)
 {
     int rd_opcode[] = {0x8, 0x28, 0xa8, 0x88};
     int wr_opcode[] = {0xa, 0x2a, 0xaa, 0x8a};
@@ -1153,6 +1396,18 @@ sg_build_scsi_cdb(uint8_t * cdbp, int cdb_sz, unsigned int blocks,
         break;
     case 16:
         sz_ind = 3;
+        if (write_true && (str_id > 0)) {
+            cdbp[0] = WRITE_STREAM16_OP;
+            sg_put_unaligned_be64((uint64_t)start_block, cdbp + 2);
+            sg_put_unaligned_be16(str_id, cdbp + 10);
+            sg_put_unaligned_be16((uint16_t)blocks, cdbp + 12);
+            if (blocks & (~0xffff)) {
+                pr2serr("%sfor WRITE STREAM(16), maximum number of blocks "
+                        "is %d\n", my_name, 0xffff);
+                return 1;
+            }
+            break;
+        }
         cdbp[0] = (uint8_t)(write_true ? wr_opcode[sz_ind] :
                                                rd_opcode[sz_ind]);
         sg_put_unaligned_be64((uint64_t)start_block, cdbp + 2);
@@ -1236,6 +1491,27 @@ sg_in_operation(struct opts_t * clp, Rq_elem * rep)
     }   /* end of while loop */
 }
 
+/* When has_share, a failed WRITE may have released the READ's buffer, so
+ * before the WRITE is retried the READ is done again. Returns as for
+ * sg_finish_io() or -1 if the READ could not be started. */
+static int
+sg_share_reread(struct opts_t * clp, Rq_elem * rep)
+{
+    int res;
+    int64_t wr_blk = rep->blk;
+
+    rep->wr = false;
+    rep->blk = rep->rd_blk;
+    res = sg_start_io(rep);
+    if (0 == res)
+        res = sg_finish_io(false, rep, &clp->inout_mutex);
+    else
+        res = -1;
+    rep->wr = true;
+    rep->blk = wr_blk;
+    return res;
+}
+
 static void
 sg_out_operation(struct opts_t * clp, Rq_elem * rep, bool bump_out_blk)
 {
@@ -1259,6 +1535,17 @@ sg_out_operation(struct opts_t * clp, Rq_elem * rep, bool bump_out_blk)
             /* try again with same addr, count info */
             /* now re-acquire out mutex for balance */
             /* N.B. This re-write could now be out of write sequence */
+            if (rep->has_share) {
+                res = sg_share_reread(clp, rep);
+                if (res) {
+                    pr2serr("%sre-reading blk=%" PRId64 " for shared write "
+                            "retry failed\n", my_name, rep->rd_blk);
+                    if (exit_status <= 0)
+                        exit_status = (res > 0) ? res : SG_LIB_CAT_OTHER;
+                    rep->out_err = true;
+                    return;
+                }
+            }
             break;
         case SG_LIB_CAT_MEDIUM_HARD:
             if (0 == rep->out_flags.coe) {
@@ -1311,12 +1598,13 @@ sg_start_io(Rq_elem * rep)
     bool dpo = rep->wr ? rep->out_flags.dpo : rep->in_flags.dpo;
     bool dio = rep->wr ? rep->out_flags.dio : rep->in_flags.dio;
     bool mmap = rep->wr ? rep->out_flags.mmap : rep->in_flags.mmap;
-    bool no_dxfer = rep->wr ? false : rep->use_no_dxfer;
+    /* when sharing neither side moves data to or from user space */
+    bool no_dxfer = rep->has_share || (rep->wr ? false : rep->use_no_dxfer);
     int cdbsz = rep->wr ? rep->cdbsz_out : rep->cdbsz_in;
     int res;
 
     if (sg_build_scsi_cdb(rep->cdb, cdbsz, rep->num_blks, rep->blk,
-                          rep->wr, fua, dpo)) {
+                          rep->wr, fua, dpo, (rep->wr ? rep->str_id : 0))) {
         pr2serr("%sbad cdb build, start_blk=%" PRId64 ", blocks=%d\n",
                 my_name, rep->blk, rep->num_blks);
         return -1;
@@ -1339,7 +1627,9 @@ sg_start_io(Rq_elem * rep)
     if (mmap)
         hp->flags |= SG_FLAG_MMAP_IO;
     if (no_dxfer)
-        hp->flags |= SG_FLAG_NO_DXFER;
+        hp->flags |= SGV4_FLAG_NO_DXFER;
+    if (rep->has_share)
+        hp->flags |= SGV4_FLAG_SHARE;
     if (rep->verbose > 8) {
         pr2serr("%s: SCSI %s, blk=%" PRId64 " num_blks=%d\n", __func__,
                 rep->wr ? "WRITE" : "READ", rep->blk, rep->num_blks);
@@ -1479,8 +1769,12 @@ process_flags(const char * arg, struct flags_t * fp)
             fp->fua = true;
         else if (0 == strcmp(cp, "mmap"))
             fp->mmap = true;
+        else if (0 == strcmp(cp, "noshare"))
+            fp->noshare = true;
         else if (0 == strcmp(cp, "null"))
             ;
+        else if (0 == strcmp(cp, "stream"))
+            fp->stream = true;
         else {
             pr2serr("unrecognised flag: %s\n", cp);
             return 1;
@@ -1674,6 +1968,7 @@ main(int argc, char * argv[])
     clp->out_type = FT_OTHER;
     clp->cdbsz_in = DEF_SCSI_CDBSZ;
     clp->cdbsz_out = DEF_SCSI_CDBSZ;
+    clp->numa_node = -1;
     infn[0] = '\0';
     outfn[0] = '\0';
     if (getenv("SG3_UTILS_INVOCATION"))
@@ -1774,16 +2069,46 @@ main(int argc, char * argv[])
                 return SG_LIB_SYNTAX_ERROR;
             }
         } else if (0 == strcmp(key,"seek")) {
-            seek = sg_get_llnum(buf);
-            if ((seek < 0) || (seek > MAX_COUNT_SKIP_SEEK)) {
-                pr2serr("%sbad argument to 'seek='\n", my_name);
-                return SG_LIB_SYNTAX_ERROR;
+            if (strchr(buf, ',') || strchr(buf, '@')) {
+                free(clp->o_sgl);
+                clp->o_sgl = NULL;
+                res = sg_get_lba_extents(buf, &clp->o_sgl,
+                                         &clp->o_sgl_elems,
+                                         &clp->o_sgl_sum,
+                                         MAX_COUNT_SKIP_SEEK, clp->verbose);
+                if (res) {
+                    pr2serr("%sbad extent list given to 'seek='\n",
+                            my_name);
+                    return res;
+                }
+                seek = clp->o_sgl[0].lba;
+            } else {
+                seek = sg_get_llnum(buf);
+                if ((seek < 0) || (seek > MAX_COUNT_SKIP_SEEK)) {
+                    pr2serr("%sbad argument to 'seek='\n", my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
             }
         } else if (0 == strcmp(key,"skip")) {
-            skip = sg_get_llnum(buf);
-            if ((skip < 0) || (skip > MAX_COUNT_SKIP_SEEK)) {
-                pr2serr("%sbad argument to 'skip='\n", my_name);
-                return SG_LIB_SYNTAX_ERROR;
+            if (strchr(buf, ',') || strchr(buf, '@')) {
+                free(clp->i_sgl);
+                clp->i_sgl = NULL;
+                res = sg_get_lba_extents(buf, &clp->i_sgl,
+                                         &clp->i_sgl_elems,
+                                         &clp->i_sgl_sum,
+                                         MAX_COUNT_SKIP_SEEK, clp->verbose);
+                if (res) {
+                    pr2serr("%sbad extent list given to 'skip='\n",
+                            my_name);
+                    return res;
+                }
+                skip = clp->i_sgl[0].lba;
+            } else {
+                skip = sg_get_llnum(buf);
+                if ((skip < 0) || (skip > MAX_COUNT_SKIP_SEEK)) {
+                    pr2serr("%sbad argument to 'skip='\n", my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
             }
         } else if (0 == strcmp(key,"sync"))
             do_sync = !! sg_get_num(buf);
@@ -1835,9 +2160,23 @@ main(int argc, char * argv[])
                    (0 == strcmp(key, "-?"))) {
             usage();
             return 0;
-        } else if ((0 == strncmp(key, "--nc", 4)) ||
+        } else if (0 == strncmp(key, "--huge", 6))
+            clp->hugepages = true;
+        else if ((0 == strncmp(key, "--nc", 4)) ||
                    (0 == strncmp(key, "--nocopy", 8)))
             clp->nocopy = true;
+        else if (0 == strcmp(key, "--numa")) {
+            if (0 == strcmp(buf, "auto"))
+                clp->numa_auto = true;
+            else {
+                clp->numa_node = sg_get_num(buf);
+                if (clp->numa_node < 0) {
+                    pr2serr("%s--numa= expects 'auto' or a node number\n",
+                            my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
+            }
+        }
         else if (0 == strncmp(key, "--prog", 6))
             ++clp->progress;
         else if (0 == strncmp(key, "--verb", 6)) {
@@ -1889,7 +2228,7 @@ main(int argc, char * argv[])
         pr2serr("skip and seek cannot be negative\n");
         return SG_LIB_SYNTAX_ERROR;
     }
-    if (clp->out_flags.append && (seek > 0)) {
+    if (clp->out_flags.append && ((seek > 0) || clp->o_sgl)) {
         pr2serr("Can't use both append and seek switches\n");
         return SG_LIB_SYNTAX_ERROR;
     }
@@ -1902,6 +2241,12 @@ main(int argc, char * argv[])
         return SG_LIB_SYNTAX_ERROR;
     } else if (clp->in_flags.mmap || clp->out_flags.mmap)
         clp->mmap_active = true;
+    if (clp->mmap_active &&
+        (clp->hugepages || clp->numa_auto || (clp->numa_node >= 0))) {
+        pr2serr("with the mmap flag the sg driver supplies the buffers, so "
+                "--hugepages\nand --numa= cannot be used\n");
+        return SG_LIB_CONTRADICT;
+    }
     /* defaulting transfer size to 128*2048 for CD/DVDs is too large
        for the block layer in lk 2.6 and results in an EIO on the
        SG_IO ioctl. So reduce it in that case. */
@@ -2038,6 +2383,29 @@ main(int argc, char * argv[])
         pr2serr("For more information use '--help'\n");
         return SG_LIB_SYNTAX_ERROR;
     }
+    clp->sgl_active = (clp->i_sgl || clp->o_sgl);
+    if (clp->i_sgl && ((STDIN_FILENO == clp->infd) ||
+                       sgp_fd_is_fifo(clp->infd))) {
+        pr2serr("skip= extent list needs a seekable IFILE\n");
+        return SG_LIB_CONTRADICT;
+    }
+    if (clp->o_sgl && ((STDOUT_FILENO == clp->outfd) ||
+                       sgp_fd_is_fifo(clp->outfd))) {
+        pr2serr("seek= extent list needs a seekable OFILE\n");
+        return SG_LIB_CONTRADICT;
+    }
+    if (clp->sgl_active) {
+        /* copy no more than the smaller extent list holds */
+        int64_t sgl_count = clp->i_sgl ? clp->i_sgl_sum : clp->o_sgl_sum;
+
+        if (clp->o_sgl && (clp->o_sgl_sum < sgl_count))
+            sgl_count = clp->o_sgl_sum;
+        if (dd_count > sgl_count)
+            pr2serr("count=%" PRId64 " reduced to %" PRId64 ", the blocks "
+                    "in the extent list\n", dd_count, sgl_count);
+        if ((dd_count < 0) || (dd_count > sgl_count))
+            dd_count = sgl_count;
+    }
     if (dd_count < 0) {
         in_num_sect = -1;
         if (FT_SG == clp->in_type) {
@@ -2124,24 +2492,97 @@ main(int argc, char * argv[])
         return SG_LIB_CAT_OTHER;
     }
     if (! cdbsz_given) {
+        int64_t in_hi = dd_count + skip;
+        int64_t out_hi = dd_count + seek;
+
+        for (k = 0; k < clp->i_sgl_elems; ++k) {
+            if ((int64_t)(clp->i_sgl[k].lba + clp->i_sgl[k].num) > in_hi)
+                in_hi = clp->i_sgl[k].lba + clp->i_sgl[k].num;
+        }
+        for (k = 0; k < clp->o_sgl_elems; ++k) {
+            if ((int64_t)(clp->o_sgl[k].lba + clp->o_sgl[k].num) > out_hi)
+                out_hi = clp->o_sgl[k].lba + clp->o_sgl[k].num;
+        }
         if ((FT_SG == clp->in_type) && (MAX_SCSI_CDBSZ != clp->cdbsz_in) &&
-            (((dd_count + skip) > UINT_MAX) || (clp->bpt > USHRT_MAX))) {
+            ((in_hi > UINT_MAX) || (clp->bpt > USHRT_MAX))) {
             pr2serr("Note: SCSI command size increased to 16 bytes (for "
                     "'if')\n");
             clp->cdbsz_in = MAX_SCSI_CDBSZ;
         }
         if ((FT_SG == clp->out_type) && (MAX_SCSI_CDBSZ != clp->cdbsz_out) &&
-            (((dd_count + seek) > UINT_MAX) || (clp->bpt > USHRT_MAX))) {
+            ((out_hi > UINT_MAX) || (clp->bpt > USHRT_MAX))) {
             pr2serr("Note: SCSI command size increased to 16 bytes (for "
                     "'of')\n");
             clp->cdbsz_out = MAX_SCSI_CDBSZ;
         }
     }
 
+    if (clp->out_flags.stream) {
+        if (FT_SG != clp->out_type) {
+            if (clp->verbose)
+                pr2serr("oflag=stream ignored as OFILE is not a sg "
+                        "device\n");
+            clp->out_flags.stream = false;
+        } else if (clp->bpt > 0xffff) {
+            pr2serr("oflag=stream: WRITE STREAM(16) takes at most 65535 "
+                    "blocks, reduce bpt\n");
+            return SG_LIB_CONTRADICT;
+        } else if (MAX_SCSI_CDBSZ != clp->cdbsz_out) {
+            if (cdbsz_given) {
+                pr2serr("oflag=stream needs cdbsz=16 (WRITE STREAM(16))\n");
+                return SG_LIB_CONTRADICT;
+            }
+            clp->cdbsz_out = MAX_SCSI_CDBSZ;
+        }
+    }
+
+    if ((FT_SG == clp->in_type) && (FT_SG == clp->out_type) &&
+        (! clp->in_flags.noshare) && (! clp->out_flags.noshare)) {
+        sg_version = sg_linux_driver_version();
+        if (0 == sg_version) {
+            if (clp->verbose)
+                pr2serr("unable to fetch sg driver version, copy via user "
+                        "space\n");
+        } else if (sg_version < SG_LINUX_SHARE_MIN_VERSION) {
+            if (clp->verbose)
+                pr2serr("sg driver version %d.%d.%d lacks request sharing, "
+                        "copy via user space\n", sg_version / 10000,
+                        (sg_version / 100) % 100, sg_version % 100);
+        } else if (clp->mmap_active || clp->in_flags.dio ||
+                   clp->out_flags.dio || clp->in_flags.coe ||
+                   clp->chkaddr) {
+            /* these need the data in, or from, user space */
+            if (clp->verbose)
+                pr2serr("request sharing not used with mmap, dio, coe or "
+                        "chkaddr\n");
+        } else {
+            clp->share_active = true;
+            if (clp->verbose)
+                pr2serr("sg driver version %d.%d.%d: READ buffers shared "
+                        "with WRITEs (iflag=noshare to stop)\n",
+                        sg_version / 10000, (sg_version / 100) % 100,
+                        sg_version % 100);
+        }
+    }
+
+    if (clp->numa_auto) {
+        /* data comes from IFILE so prefer the node of its HBA */
+        if ((clp->infd >= 0) && (FT_DEV_NULL != clp->in_type))
+            clp->numa_node = sg_linux_fd_numa_node(clp->infd, clp->verbose);
+        if ((clp->numa_node < 0) && (clp->outfd >= 0))
+            clp->numa_node = sg_linux_fd_numa_node(clp->outfd,
+                                                   clp->verbose);
+        if (clp->numa_node < 0) {
+            if (clp->verbose)
+                pr2serr("--numa=auto: HBA's node unknown so no binding\n");
+        } else if (clp->verbose)
+            pr2serr("--numa=auto: buffers on node %d\n", clp->numa_node);
+    }
+
     clp->in_count = dd_count;
     clp->in_rem_count = dd_count;
     clp->skip = skip;
-    clp->in_blk = skip;
+    clp->in_blk = clp->sgl_active ? 0 : skip;
     clp->out_count = dd_count;
     clp->out_rem_count = dd_count;
     clp->seek = seek;
@@ -2149,7 +2590,7 @@ main(int argc, char * argv[])
     if (0 != status) err_exit(status, "init inout_mutex");
     status = pthread_mutex_lock(&clp->inout_mutex);
     if (0 != status) err_exit(status, "lock inout_mutex");
-    clp->out_blk = seek;
+    clp->out_blk = clp->sgl_active ? 0 : seek;
     status = pthread_mutex_unlock(&clp->inout_mutex);
     if (0 != status) err_exit(status, "unlock inout_mutex");
 
@@ -2160,6 +2601,13 @@ main(int argc, char * argv[])
         pr2serr("Due to --dry-run option, bypass copy/read\n");
         goto fini;
     }
+    if (clp->out_flags.stream) {
+        res = streams_open(clp);
+        if (res) {
+            exit_status = res;
+            goto fini;
+        }
+    }
     sigemptyset(&signal_set);
     sigaddset(&signal_set, SIGINT);
     status = pthread_sigmask(SIG_BLOCK, &signal_set, NULL);
@@ -2237,6 +2685,11 @@ degen:
                 pr2serr("Unable to synchronize cache\n");
         }
     }
+    if (clp->num_streams > 0) {
+        res = streams_close(clp);
+        if (res && (0 == exit_status))
+            exit_status = res;
+    }
 
 #if 0
 #if SG_LIB_ANDROID
@@ -2263,6 +2716,8 @@ fini:
         if (clp->outfd >= 0)
             close(clp->outfd);
     }
+    free(clp->i_sgl);
+    free(clp->o_sgl);
     res = exit_status;
     if ((0 != clp->out_count) && (0 == clp->dry_run)) {
         pr2serr(">>>> Some error occurred, remaining blocks=%" PRId64 "\n",
@@ -36,7 +36,7 @@
  * renamed [20181221]
  */
 
-static const char * version_str = "2.25 20231016";
+static const char * version_str = "2.26 20261018";
 
 #define _XOPEN_SOURCE 600
 #ifndef _GNU_SOURCE
@@ -169,8 +169,6 @@ using namespace std;
 
 #define EBUFF_SZ 768
 
-#define PROC_SCSI_SG_VERSION "/proc/scsi/sg/version"
-#define SYS_SCSI_SG_VERSION "/sys/module/sg/version"
 
 struct flags_t {
     bool append;
@@ -272,6 +270,9 @@ struct global_collection
     bool verify;                /* don't copy, verify like Unix: cmp */
     bool prefetch;              /* for verify: do PF(b),RD(a),V(b)_a_data */
     bool unshare;               /* let close() do file unshare operation */
+    bool hugepages;             /* transfer buffers on huge pages */
+    bool numa_auto;             /* bind to node of HBA serving IFILE */
+    int numa_node;              /* bind transfer buffers, -1 -> don't */
     const char * infp;
     const char * outfp;
     const char * out2fp;
@@ -306,6 +307,7 @@ typedef struct request_element
     int num_blks;
     uint8_t * buffp;
     uint8_t * alloc_bp;
+    uint32_t huge_len;  /* when > 0, buffp from sg_linux_alloc_buf() */
     struct sg_io_hdr io_hdr;
     struct sg_io_v4 io_hdr4[2];
     uint8_t cmd[MAX_SCSI_CDBSZ];
@@ -410,7 +412,6 @@ static int sgh_do_deferred_mrq(Rq_elem * rep, mrq_arr_t & def_arr);
 
 static pthread_mutex_t strerr_mut = PTHREAD_MUTEX_INITIALIZER;
 
-static bool have_sg_version = false;
 static int sg_version = 0;
 static bool sg_version_lt_4 = false;
 static bool sg_version_ge_40045 = false;
@@ -485,8 +486,9 @@ usage(int pg_num)
             "[sync=0|1]\n"
             "               [thr=THR] [time=0|1|2[,TO]] [unshare=1|0] "
             "[verbose=VERB]\n"
-            "               [--compare] [--dry-run] [--prefetch] "
-            "[-v|-vv|-vvv]\n"
+            "               [--compare] [--dry-run] [--hugepages] "
+            "[--numa=auto|NODE]\n"
+            "               [--prefetch] [-v|-vv|-vvv]\n"
             "               [--verbose] [--verify] [--version]\n\n"
             "  where the main options (shown in first group above) are:\n"
             "    bs          must be device logical block size (default "
@@ -586,6 +588,10 @@ page2:
             "                    address, used once only checks first "
             "address in block\n"
             "    --dry-run|-d    prepare but bypass copy/read\n"
+            "    --hugepages    transfer buffers on huge pages\n"
+            "    --numa=auto|NODE    bind transfer buffers to NUMA node of "
+            "IFILE's\n"
+            "                        HBA, or to NODE\n"
             "    --prefetch|-p    with verify: do pre-fetch first\n"
             "    --verbose|-v   increase verbosity of utility\n\n"
             "Use '-hhh' or '-hhhh' for more information about flags.\n"
@@ -945,35 +951,6 @@ v4hdr_out_lk(const char * leadin, const sg_io_v4 * h4p, int id)
     pthread_mutex_unlock(&strerr_mut);
 }
 
-static void
-fetch_sg_version(void)
-{
-    FILE * fp;
-    char b[96];
-
-    have_sg_version = false;
-    sg_version = 0;
-    fp = fopen(PROC_SCSI_SG_VERSION, "r");
-    if (fp && fgets(b, sizeof(b) - 1, fp)) {
-        if (1 == sscanf(b, "%d", &sg_version))
-            have_sg_version = !!sg_version;
-    } else {
-        int j, k, l;
-
-        if (fp)
-            fclose(fp);
-        fp = fopen(SYS_SCSI_SG_VERSION, "r");
-        if (fp && fgets(b, sizeof(b) - 1, fp)) {
-            if (3 == sscanf(b, "%d.%d.%d", &j, &k, &l)) {
-                sg_version = (j * 10000) + (k * 100) + l;
-                have_sg_version = !!sg_version;
-            }
-        }
-    }
-    if (fp)
-        fclose(fp);
-}
-
 static void
 calc_duration_throughput(int contin)
 {
@@ -1522,8 +1499,13 @@ read_write_thread(void * v_tip)
         n = sz;
         if (clp->unbalanced_mrq)
             n *= clp->nmrqs;
-        rep->buffp = sg_memalign(n, 0 /* page align */, &rep->alloc_bp,
-                                 false);
+        if (clp->hugepages || (clp->numa_node >= 0))
+            rep->buffp = sg_linux_alloc_buf(n, clp->hugepages,
+                                            clp->numa_node, &rep->huge_len,
+                                            (0 == rep->id) ? vb : 0);
+        else
+            rep->buffp = sg_memalign(n, 0 /* page align */, &rep->alloc_bp,
+                                     false);
         if (NULL == rep->buffp)
             err_exit(ENOMEM, "out of memory creating user buffers\n");
     }
@@ -1832,6 +1814,11 @@ fini:
         rep->alloc_bp = NULL;
         rep->buffp = NULL;
     }
+    if (rep->huge_len > 0) {
+        sg_linux_free_buf(rep->buffp, rep->huge_len);
+        rep->huge_len = 0;
+        rep->buffp = NULL;
+    }
 
     if (sg_version_ge_40045) {
         if (clp->noshare) {
@@ -4298,6 +4285,20 @@ parse_cmdline_sanity(int argc, char * argv[], struct global_collection * clp,
         else if ((0 == strncmp(key, "--help", 6)) ||
                    (0 == strcmp(key, "-?")))
             ++clp->help;
+        else if (0 == strncmp(key, "--huge", 6))
+            clp->hugepages = true;
+        else if (0 == strcmp(key, "--numa")) {
+            if (0 == strcmp(buf, "auto"))
+                clp->numa_auto = true;
+            else {
+                clp->numa_node = sg_get_num(buf);
+                if (clp->numa_node < 0) {
+                    pr2serr("%s--numa= expects 'auto' or a node number\n",
+                            my_name);
+                    return SG_LIB_SYNTAX_ERROR;
+                }
+            }
+        }
         else if ((0 == strncmp(key, "--prefetch", 10)) ||
                  (0 == strncmp(key, "--pre-fetch", 11)))
             clp->prefetch = true;
@@ -4396,6 +4397,12 @@ parse_cmdline_sanity(int argc, char * argv[], struct global_collection * clp,
         pr2serr("dio flag can only be used with noshare=1\n");
         return SG_LIB_SYNTAX_ERROR;
     }
+    if ((clp->in_flags.mmap || clp->out_flags.mmap) &&
+        (clp->hugepages || clp->numa_auto || (clp->numa_node >= 0))) {
+        pr2serr("with the mmap flag the sg driver supplies the buffers, so "
+                "--hugepages\nand --numa= cannot be used\n");
+        return SG_LIB_CONTRADICT;
+    }
     if (clp->nmrqs > 0) {
         if (clp->in_flags.mrq_immed || clp->out_flags.mrq_immed)
             clp->mrq_async = true;
@@ -4476,11 +4483,12 @@ main(int argc, char * argv[])
     clp->sdt_crt = DEF_SDT_CRT_SEC;
     clp->nmrqs = DEF_NUM_MRQS;
     clp->unshare = true;
+    clp->numa_node = -1;
     inf[0] = '\0';
     outf[0] = '\0';
     out2f[0] = '\0';
     outregf[0] = '\0';
-    fetch_sg_version();
+    sg_version = sg_linux_driver_version();
     if (sg_version >= 40045)
         sg_version_ge_40045 = true;
 
@@ -4905,6 +4913,20 @@ main(int argc, char * argv[])
         }
     }
 
+    if (clp->numa_auto) {
+        /* data comes from IFILE so prefer the node of its HBA */
+        if ((clp->infd >= 0) && (FT_DEV_NULL != clp->in_type))
+            clp->numa_node = sg_linux_fd_numa_node(clp->infd, clp->verbose);
+        if ((clp->numa_node < 0) && (clp->outfd >= 0))
+            clp->numa_node = sg_linux_fd_numa_node(clp->outfd,
+                                                   clp->verbose);
+        if (clp->numa_node < 0) {
+            if (clp->verbose)
+                pr2serr("--numa=auto: HBA's node unknown so no binding\n");
+        } else if (clp->verbose)
+            pr2serr("--numa=auto: buffers on node %d\n", clp->numa_node);
+    }
+
     // clp->in_count = dd_count;
     clp->in_rem_count = dd_count;
     clp->out_count = dd_count;